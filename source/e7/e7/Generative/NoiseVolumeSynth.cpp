@@ -0,0 +1,161 @@
+// Max Hermann, August 8, 2010
+#include "NoiseVolumeSynth.h"
+#include <cmath>
+#include <algorithm>
+
+//linux/ unix specific includes
+#ifndef WIN32
+#include <stdlib.h>
+#endif
+
+NoiseVolumeSynth::NoiseVolumeSynth( unsigned seed )
+: m_noise( seed ),
+  m_type( RidgedMF ),
+  m_scale( 3.f ),
+  m_size( 0 ),
+  m_slabDepthSamples( 4 ),
+  m_level( -1 ),
+  m_slab( 0 ),
+  m_slabLevel( 0 ),
+  m_z0( 0 ),
+  m_z1( 0 )
+{
+}
+
+void NoiseVolumeSynth::start( int size, NoiseType type, float scale,
+                              int levels, int slabDepth )
+{
+	m_size  = size;
+	m_type  = type;
+	m_scale = scale;
+	m_slabDepthSamples = std::max( 1, slabDepth );
+
+	// coarsest level should have at least 2 samples per axis
+	m_level = std::max( 1, levels ) - 1;
+	while( m_level > 0 && (size >> m_level) < 2 )
+		m_level--;
+	if( size < 1 )
+		m_level = -1;
+
+	m_slab = 0;
+	m_z0 = m_z1 = 0;
+}
+
+bool NoiseVolumeSynth::step()
+{
+	if( done() ) 
+		return false;
+
+	int s  = 1 << m_level,          // sample stride of current level
+	    n  = (m_size + s - 1) / s,  // samples per axis
+	    k0 = m_slab,
+	    k1 = std::min( n, k0 + m_slabDepthSamples );
+
+	// Evaluate samples of slab, rows in parallel
+	int rows = n*(k1-k0);
+	m_samples.resize( 3*n*rows );
+
+	#pragma omp parallel for schedule(dynamic)
+	for( int r=0; r < rows; ++r )
+		evalRow( (r % n)*s, (k0 + r/n)*s, s, n, &m_samples[3*n*r] );
+
+	// Resample to full resolution
+	m_z0 = k0*s;
+	m_z1 = std::min( m_size, k1*s );
+	m_slabData.resize( 3*m_size*m_size*(m_z1-m_z0) );
+
+	float* dst = &m_slabData[0];
+	for( int z=m_z0; z < m_z1; ++z )
+		for( int y=0; y < m_size; ++y )
+		{
+			const float* row = &m_samples[ 3*n*((z/s - k0)*n + y/s) ];
+			for( int x=0; x < m_size; ++x, dst+=3 )
+			{
+				const float* src = row + 3*(x/s);
+				dst[0] = src[0];
+				dst[1] = src[1];
+				dst[2] = src[2];
+			}
+		}
+
+	// Advance to next slab or level
+	m_slabLevel = m_level;
+	m_slab = k1;
+	if( m_slab >= n )
+	{
+		m_slab = 0;
+		m_level--;
+	}
+	return true;
+}
+
+void NoiseVolumeSynth::evalRow( int y, int z, int stride, int n, float* out ) const
+{
+	static const float ofs_arr[3] = { 17.f, 177.f, 1777.f };
+
+	// Octave sums as in PerlinNoise::turbulence(), fBm() and ridgedmf() with
+	// the settings of the VolumeWarp example
+	const int   octaves = (m_type==Turbulence) ? 2 : ((m_type==FBm) ? 5 : 3);
+	const float lacunarity = 2.0, 
+	            gain       = 0.5, 
+	            offset     = 1.0;
+
+	const int block = 64;
+	float px[block], py[block], pz[block], fx[block], fy[block], fz[block],
+	      nv[block], sum[block], prev[block];
+
+	float dy = m_scale * (float)y/(m_size-1),
+	      dz = m_scale * (float)z/(m_size-1);
+
+	for( int ch=0; ch < 3; ++ch )
+	{
+		float ofs = ofs_arr[ch];
+
+		for( int first=0; first < n; first += block )
+		{
+			int m = std::min( block, n - first );
+			for( int i=0; i < m; ++i )
+			{
+				float dx = m_scale * (float)((first+i)*stride)/(m_size-1);
+				px[i] = ofs+dx;
+				py[i] = ofs+dy;
+				pz[i] = ofs+dz;
+				sum [i] = 0;
+				prev[i] = 1.0;
+			}
+
+			float freq = 1.0,
+			      amp  = (m_type==RidgedMF) ? 0.5 : 1.0;
+			for( int o=0; o < octaves; ++o )
+			{
+				for( int i=0; i < m; ++i )
+				{
+					fx[i] = freq*px[i];
+					fy[i] = freq*py[i];
+					fz[i] = freq*pz[i];
+				}
+				m_noise.noise_batch( fx, fy, fz, nv, m );
+
+				for( int i=0; i < m; ++i )
+				{
+					if( m_type == Turbulence )
+						sum[i] += fabs( nv[i] )*amp;
+					else
+					if( m_type == FBm )
+						sum[i] += nv[i]*amp;
+					else
+					{
+						float h = PerlinNoise::ridge( nv[i], offset );
+						sum[i] += h*amp*prev[i];
+						prev[i] = h;
+					}
+				}
+				freq *= lacunarity;
+				amp  *= gain;
+			}
+
+			for( int i=0; i < m; ++i )
+				out[ 3*(first+i) + ch ] = (m_type==FBm) ? sum[i] * 0.5 + 0.5 : sum[i];
+		}
+	}
+}
@@ -0,0 +1,74 @@
+// Max Hermann, August 8, 2010
+#ifndef NOISEVOLUMESYNTH_H
+#define NOISEVOLUMESYNTH_H
+
+#include "PerlinNoise.h"
+#include <vector>
+
+//-----------------------------------------------------------------------------
+//	class NoiseVolumeSynth
+//-----------------------------------------------------------------------------
+
+/// Progressive synthesis of a 3 channel noise volume, e.g. a warp field.
+///
+/// The size^3 volume is refined coarse-to-fine, level l sampling every 2^l-th
+/// voxel of the full resolution grid. Each level is computed in slabs along
+/// z, the voxels of a slab in parallel (if compiled with OpenMP) using
+/// vectorized noise. After each step() the finished slab is available at full
+/// resolution (nearest neighbour upsampled on coarse levels), such that a 3D
+/// texture can be updated slab by slab over several frames.
+///
+/// Voxel (x,y,z) of channel ch samples the noise at scale*(x,y,z)/(size-1)
+/// offset by 17, 177 or 1777 respectively, i.e. three independent fields.
+class NoiseVolumeSynth
+{
+public:
+	enum NoiseType { Turbulence, FBm, RidgedMF };
+
+	NoiseVolumeSynth( unsigned seed=0 );
+
+	/// Restart synthesis of size^3 volume with given number of refinement
+	/// levels (1 for full resolution only) and slab depth in samples.
+	void start( int size, NoiseType type, float scale=3.f,
+	            int levels=3, int slabDepth=4 );
+
+	/// Compute next slab, returns false if the volume was complete already.
+	bool step();
+
+	/// True if finest level is complete
+	bool done() const { return m_level < 0; }
+
+	int size() const { return m_size; }
+	NoiseType type() const { return m_type; }
+
+	///@{ Full resolution z-range [slabZ(),slabZ()+slabDepth()) of last step()
+	///   with RGB interleaved voxels in x,y,z order
+	int          slabZ    () const { return m_z0; }
+	int          slabDepth() const { return m_z1 - m_z0; }
+	const float* slabData () const { return m_slabData.empty() ? 0 : &m_slabData[0]; }
+	///@}
+
+	/// Level of last step(), 0 is the finest
+	int slabLevel() const { return m_slabLevel; }
+
+protected:
+	/// Evaluate n samples along x with given stride in row (y,z) of full grid
+	void evalRow( int y, int z, int stride, int n, float* out ) const;
+
+private:
+	PerlinNoiseGenerator m_noise;
+	NoiseType m_type;
+	float     m_scale;
+	int       m_size;
+	int       m_slabDepthSamples;
+
+	int       m_level;      // current level, -1 if done
+	int       m_slab;       // first sample layer of next slab in level
+	int       m_slabLevel;  // level of last step()
+	int       m_z0, m_z1;   // full resolution z-range of last step()
+
+	std::vector<float> m_samples;   // level samples of last slab
+	std::vector<float> m_slabData;  // full resolution data of last slab
+};
+
+#endif // NOISEVOLUMESYNTH_H
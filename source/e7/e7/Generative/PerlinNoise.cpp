@@ -7,6 +7,11 @@
 #include <stdlib.h>
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PERLINNOISE_SSE2
+#include <emmintrin.h>
+#endif
+
 unsigned char PerlinNoise::s_permutation[512] = { 151,160,137,91,90,15,
    131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,8,99,37,240,21,10,23,
    190, 6,148,247,120,234,75,0,26,197,62,94,252,219,203,117,35,11,32,57,177,33,
@@ -157,3 +162,220 @@ float PerlinNoise::grad( int hash, float x, float y, float z )
 	return g[3*h+0]*x + g[3*h+1]*y + g[3*h+2]*z;
   #endif
 }
+
+//-----------------------------------------------------------------------------
+//	PerlinNoiseGenerator
+//-----------------------------------------------------------------------------
+
+PerlinNoiseGenerator::PerlinNoiseGenerator( unsigned seed )
+: m_seed( seed )
+{
+	for( int i=0; i < 16; ++i )
+	{
+		for( int j=0; j < 3; ++j )
+			m_gradients[i][j] = PerlinNoise::s_gradients[3*i+j];
+		m_gradients[i][3] = 0.f;
+	}
+
+	unsigned short perm[256];
+	for( int i=0; i < 256; ++i )
+		perm[i] = PerlinNoise::s_permutation[i];
+
+	// Fisher-Yates shuffle of reference permutation via LCG
+	if( seed )
+	{
+		unsigned state = seed;
+		for( int i=255; i > 0; --i )
+		{
+			state = state * 1103515245 + 12345;
+			int j = (int)((state >> 16) % (unsigned)(i+1));
+			unsigned short tmp = perm[i];
+			perm[i] = perm[j];
+			perm[j] = tmp;
+		}
+	}
+
+	for( int i=0; i < 512; ++i )
+		m_permutation[i] = perm[i & 255];
+}
+
+float PerlinNoiseGenerator::noise( float x, float y, float z ) const
+{
+	// same as PerlinNoise::noise()
+	const unsigned short* hash = m_permutation;
+
+	int X = (int)x & 255,
+		Y = (int)y & 255,
+		Z = (int)z & 255;
+	x -= (int)x;
+	y -= (int)y;
+	z -= (int)z;
+
+	float u = PerlinNoise::fade(x),
+		  v = PerlinNoise::fade(y),
+		  w = PerlinNoise::fade(z);
+
+	int A = hash[X  ]+Y,  AA = hash[A]+Z,  AB = hash[A+1]+Z,
+		B = hash[X+1]+Y,  BA = hash[B]+Z,  BB = hash[B+1]+Z;
+
+	return PerlinNoise::lerp(w, 
+		PerlinNoise::lerp(v, PerlinNoise::lerp(u, grad(hash[AA  ], x  , y  , z   ),
+		                                          grad(hash[BA  ], x-1, y  , z   )),
+		                     PerlinNoise::lerp(u, grad(hash[AB  ], x  , y-1, z   ),
+		                                          grad(hash[BB  ], x-1, y-1, z   ))),
+		PerlinNoise::lerp(v, PerlinNoise::lerp(u, grad(hash[AA+1], x  , y  , z-1 ),
+		                                          grad(hash[BA+1], x-1, y  , z-1 )),
+		                     PerlinNoise::lerp(u, grad(hash[AB+1], x  , y-1, z-1 ),
+		                                          grad(hash[BB+1], x-1, y-1, z-1 ))));
+}
+
+#ifdef PERLINNOISE_SSE2
+namespace {
+
+// SSE2 versions of PerlinNoise::fade(), lerp() and grad() with the same 
+// order of operations
+inline __m128 fade4( __m128 t )
+{
+	__m128 t3 = _mm_mul_ps( _mm_mul_ps( t, t ), t ),
+	       p  = _mm_add_ps( _mm_sub_ps( _mm_mul_ps( _mm_mul_ps( _mm_set1_ps(6.f), t ), t ),
+	                                    _mm_mul_ps( _mm_set1_ps(15.f), t ) ),
+	                        _mm_set1_ps(10.f) );
+	return _mm_mul_ps( t3, p );
+}
+
+inline __m128 lerp4( __m128 t, __m128 a, __m128 b )
+{
+	return _mm_add_ps( a, _mm_mul_ps( t, _mm_sub_ps( b, a ) ) );
+}
+
+inline __m128 grad4( const float (*gradients)[4], const int* hash,
+                     __m128 x, __m128 y, __m128 z )
+{
+	// gradient rows, transpose to xyz registers. Loads are unaligned since
+	// operator new need not honour the table alignment before C++17.
+	__m128 g0 = _mm_loadu_ps( gradients[ hash[0] & 15 ] ),
+	       g1 = _mm_loadu_ps( gradients[ hash[1] & 15 ] ),
+	       g2 = _mm_loadu_ps( gradients[ hash[2] & 15 ] ),
+	       g3 = _mm_loadu_ps( gradients[ hash[3] & 15 ] );
+	_MM_TRANSPOSE4_PS( g0, g1, g2, g3 );
+	return _mm_add_ps( _mm_add_ps( _mm_mul_ps( g0, x ), _mm_mul_ps( g1, y ) ),
+	                   _mm_mul_ps( g2, z ) );
+}
+
+void noise4( const unsigned short* hash, const float (*gradients)[4],
+             const float* px, const float* py, const float* pz, float* result )
+{
+	__m128 x = _mm_loadu_ps( px ),
+	       y = _mm_loadu_ps( py ),
+	       z = _mm_loadu_ps( pz );
+
+	// integer and fractional part
+	__m128i xi = _mm_cvttps_epi32( x ),
+	        yi = _mm_cvttps_epi32( y ),
+	        zi = _mm_cvttps_epi32( z );
+	x = _mm_sub_ps( x, _mm_cvtepi32_ps( xi ) );
+	y = _mm_sub_ps( y, _mm_cvtepi32_ps( yi ) );
+	z = _mm_sub_ps( z, _mm_cvtepi32_ps( zi ) );
+
+	int X[4], Y[4], Z[4];
+	_mm_storeu_si128( (__m128i*)X, xi );
+	_mm_storeu_si128( (__m128i*)Y, yi );
+	_mm_storeu_si128( (__m128i*)Z, zi );
+
+	// hashed corners per lane
+	int hAA[4], hBA[4], hAB[4], hBB[4], hAA1[4], hBA1[4], hAB1[4], hBB1[4];
+	for( int l=0; l < 4; ++l )
+	{
+		int Xl = X[l] & 255, Yl = Y[l] & 255, Zl = Z[l] & 255;
+		int A = hash[Xl  ]+Yl,  AA = hash[A]+Zl,  AB = hash[A+1]+Zl,
+		    B = hash[Xl+1]+Yl,  BA = hash[B]+Zl,  BB = hash[B+1]+Zl;
+		hAA[l] = hash[AA];  hAA1[l] = hash[AA+1];
+		hBA[l] = hash[BA];  hBA1[l] = hash[BA+1];
+		hAB[l] = hash[AB];  hAB1[l] = hash[AB+1];
+		hBB[l] = hash[BB];  hBB1[l] = hash[BB+1];
+	}
+
+	__m128 u = fade4( x ),
+	       v = fade4( y ),
+	       w = fade4( z );
+
+	__m128 one = _mm_set1_ps( 1.f ),
+	       x1 = _mm_sub_ps( x, one ),
+	       y1 = _mm_sub_ps( y, one ),
+	       z1 = _mm_sub_ps( z, one );
+
+	__m128 r =
+		lerp4(w, lerp4(v, lerp4(u, grad4(gradients, hAA , x , y , z  ),
+		                           grad4(gradients, hBA , x1, y , z  )),
+		                  lerp4(u, grad4(gradients, hAB , x , y1, z  ),
+		                           grad4(gradients, hBB , x1, y1, z  ))),
+		         lerp4(v, lerp4(u, grad4(gradients, hAA1, x , y , z1 ),
+		                           grad4(gradients, hBA1, x1, y , z1 )),
+		                  lerp4(u, grad4(gradients, hAB1, x , y1, z1 ),
+		                           grad4(gradients, hBB1, x1, y1, z1 ))));
+	_mm_storeu_ps( result, r );
+}
+
+} // anonymous namespace
+#endif // PERLINNOISE_SSE2
+
+void PerlinNoiseGenerator::noise_batch( const float* x, const float* y, const float* z,
+                                        float* result, int n ) const
+{
+	int i=0;
+#ifdef PERLINNOISE_SSE2
+	for( ; i+4 <= n; i+=4 )
+		noise4( m_permutation, m_gradients, x+i, y+i, z+i, result+i );
+#endif
+	for( ; i < n; ++i )
+		result[i] = noise( x[i], y[i], z[i] );
+}
+
+float PerlinNoiseGenerator::turbulence( float x, float y, float z, 
+                                        int octaves, float lacunarity, float gain ) const
+{
+	float sum  = 0.0,
+		  freq = 1.0,
+		  amp  = 1.0;
+	for( int i=0; i < octaves; ++i )
+	{
+		sum += fabs( noise(freq*x,freq*y,freq*z) )*amp;
+		freq *= lacunarity;
+		amp *= gain;
+	}
+	return sum;
+}
+
+float PerlinNoiseGenerator::fBm( float x, float y, float z, 
+                                 int octaves, float lacunarity, float gain ) const
+{
+	float sum  = 0.0,
+		  freq = 1.0,
+		  amp  = 1.0;
+	for( int i=0; i < octaves; ++i )
+	{
+		sum += noise(freq*x,freq*y,freq*z)*amp;
+		freq *= lacunarity;
+		amp *= gain;
+	}
+	return sum;
+}
+
+float PerlinNoiseGenerator::ridgedmf( float x, float y, float z, 
+                                      int octaves, float lacunarity, float gain,
+                                      float offset ) const
+{
+	float sum  = 0,
+		  freq = 1.0, 
+		  amp  = 0.5,
+		  prev = 1.0;
+	for( int i=0; i < octaves; ++i ) 
+	{
+		float n = PerlinNoise::ridge(noise(freq*x,freq*y,freq*z), offset);
+		sum += n*amp*prev;
+		prev = n;
+		freq *= lacunarity;
+		amp *= gain;
+	}
+	return sum;
+}
@@ -2,6 +2,12 @@
 #ifndef PERLINNOISE_H
 #define PERLINNOISE_H
 
+#ifdef _MSC_VER
+	#define PERLINNOISE_ALIGN(n) __declspec(align(n))
+#else
+	#define PERLINNOISE_ALIGN(n) __attribute__((aligned(n)))
+#endif
+
 //-----------------------------------------------------------------------------
 //	class PerlinNoise
 //-----------------------------------------------------------------------------
@@ -44,4 +50,52 @@ public:
 	static float grad( int hash, float x, float y, float z );
 };
 
+//-----------------------------------------------------------------------------
+//	class PerlinNoiseGenerator
+//-----------------------------------------------------------------------------
+
+/// Seeded Perlin Noise, same functions as PerlinNoise but on its own tables.
+/// The tables are generated on construction and not modified afterwards,
+/// such that a single generator can be shared by several threads and
+/// differently seeded generators can be evaluated concurrently. Tables are
+/// compact (16 bit permutation, gradients packed to 4 floats) and aligned to
+/// cache lines. Seed 0 reproduces the reference permutation of PerlinNoise.
+class PerlinNoiseGenerator
+{
+public:
+	explicit PerlinNoiseGenerator( unsigned seed=0 );
+
+	unsigned seed() const { return m_seed; }
+
+	float noise( float x, float y, float z ) const;
+
+	/// Evaluate noise() for n points given as separate coordinate arrays,
+	/// 4 points at once via SSE2 if available. Results are bit-identical as
+	/// long as the compiler does not contract the scalar path into FMAs.
+	void  noise_batch( const float* x, const float* y, const float* z,
+	                   float* result, int n ) const;
+
+	float turbulence( float x, float y, float z, 
+	                  int octaves, float lacunarity=2.0, float gain=0.5 ) const;
+
+	float fBm( float x, float y, float z, 
+	           int octaves, float lacunarity=2.0, float gain=0.5 ) const;
+
+	float ridgedmf( float x, float y, float z, 
+	                int octaves, float lacunarity=2.0, float gain=0.5,
+	                float offset=1.0 ) const;
+
+protected:
+	float grad( int hash, float x, float y, float z ) const
+	{
+		const float* g = m_gradients[ hash & 15 ];
+		return g[0]*x + g[1]*y + g[2]*z;
+	}
+
+private:
+	PERLINNOISE_ALIGN(64) float          m_gradients[16][4];
+	PERLINNOISE_ALIGN(64) unsigned short m_permutation[512];
+	unsigned m_seed;
+};
+
 #endif // PERLINNOISE_H
@@ -21,7 +21,7 @@
 #include <VolumeRendering/VolumeUtils.h>  // load_volume(), create_volume_tex()
 #include <VolumeRendering/VolumeRendererRaycast.h>
 //#include <Generative/NoiseShader.h>
-#include <Generative/PerlinNoise.h>
+#include <Generative/NoiseVolumeSynth.h>
 
 #ifdef WIN32
 #pragma warning(disable: 4244)
@@ -32,6 +32,7 @@
 #define SCREENSHOT_HEIGHT (2*1080) //2048 //(2048+1024)
 #define ASPECT (SCREENSHOT_WIDTH/(float)SCREENSHOT_HEIGHT)
 #define TEXTURE_SIZE_CHANGE_POSSIBLE_WITHOUT_DRIVER_CRASH
+#define WARP_TEXTURE_SIZE 64
 
 using namespace std;
 
@@ -120,7 +121,13 @@ public:
 	void setFoV( float fov ) { m_fov = fov; reshape(-1,-1); }
 
 protected:
-	bool genWarpTexture( GL::GLTexture& wtex, float (*n4) (int,float,float,float) );
+	/// Start synthesis of warp texture, if progressive the texture is refined
+	/// coarse-to-fine slab by slab in subsequent idle() calls, otherwise it
+	/// is computed completely at full resolution right away.
+	bool genWarpTexture( GL::GLTexture& wtex, NoiseVolumeSynth::NoiseType type,
+	                     bool progressive=true );
+	/// Compute next slab of pending warp texture synthesis and upload it
+	bool refineWarpTexture( GL::GLTexture& wtex );
 
 	void onKeyPressed( unsigned char key );
 
@@ -129,6 +136,7 @@ private:
 	GL::GLTexture     m_vtex;
 	GL::GLTexture     m_wtex;
 	VolumeRendererRaycast m_vren;
+	NoiseVolumeSynth  m_warpSynth;
 
 	bool m_animation;
 	float m_fov;
@@ -136,33 +144,17 @@ private:
 	State m_states[2];
 };
 
-// warp noise helper functions
-// (vector valued noise, channel ch=0,1,2 corresponds to (x,y,z) component)
-
-inline float wnoise_turbulence( int ch, float x, float y, float z )
-{
-	static float ofs_arr[3] = { 17.f, 177.f, 1777.f };
-	float ofs = ofs_arr[ch];
-	return PerlinNoise::turbulence( ofs+x, ofs+y, ofs+z, 2 );
-}
-
-inline float wnoise_fBm( int ch, float x, float y, float z )
-{
-	static float ofs_arr[3] = { 17.f, 177.f, 1777.f };
-	float ofs = ofs_arr[ch];
-	return PerlinNoise::fBm( ofs+x, ofs+y, ofs+z, 5 ) * 0.5 + 0.5;
-}
-
-inline float wnoise_ridgedmf( int ch, float x, float y, float z )
-{
-	static float ofs_arr[3] = { 17.f, 177.f, 1777.f };
-	float ofs = ofs_arr[ch];
-	return PerlinNoise::ridgedmf( ofs+x, ofs+y, ofs+z, 3 );
-}
-
 //-----------------------------------------------------------------------------
 void Raycaster::idle()
 {
+	// progressive warp texture synthesis
+	if( !m_warpSynth.done() )
+	{
+		refineWarpTexture( m_wtex );
+		if( !m_animation )
+			update();
+	}
+
 	//if( !m_animation ) return;
 
 	if( m_animation )
@@ -314,15 +306,15 @@ void Raycaster::onKeyPressed( unsigned char key )
 
 	case '5':
 		cout << "Generating turbulence warp..." << endl;
-		genWarpTexture( m_wtex, wnoise_turbulence );
+		genWarpTexture( m_wtex, NoiseVolumeSynth::Turbulence );
 		break;
 	case '6':
 		cout << "Generating fBm warp..." << endl;
-		genWarpTexture( m_wtex, wnoise_fBm );
+		genWarpTexture( m_wtex, NoiseVolumeSynth::FBm );
 		break;
 	case '7':
 		cout << "Generating ridgedmf warp..." << endl;
-		genWarpTexture( m_wtex, wnoise_ridgedmf );
+		genWarpTexture( m_wtex, NoiseVolumeSynth::RidgedMF );
 		break;
 
 	case 'T':
@@ -349,50 +341,62 @@ void Raycaster::onKeyPressed( unsigned char key )
 
 //-----------------------------------------------------------------------------
 
-bool Raycaster::genWarpTexture( GL::GLTexture& wtex, float (*n4) (int,float,float,float) )
+bool Raycaster::genWarpTexture( GL::GLTexture& wtex, NoiseVolumeSynth::NoiseType type,
+                                bool progressive )
 {
 	// Use 3 independent noise fields as displacement maps
-	int size=64;
-	float* data = new float[size*size*size*3];
-
-	for( int z=0; z<size; ++z )
-		for( int y=0; y<size; ++y )
-			for( int x=0; x<size; ++x )
-			{
-				float scale = 3.f;
-				float dx = scale * (float)x/(size-1),
-					  dy = scale * (float)y/(size-1),
-					  dz = scale * (float)z/(size-1);
-
-				data[3*(z*size*size + y*size + x)+0] = n4( 0, dx,dy,dz );
-				data[3*(z*size*size + y*size + x)+1] = n4( 1, dx,dy,dz );
-				data[3*(z*size*size + y*size + x)+2] = n4( 2, dx,dy,dz );
-			}
+	int size = WARP_TEXTURE_SIZE;
 
 	// --- Create warp texture ---
 
-	if( !wtex.Create( GL_TEXTURE_3D ) )
+	// (Re)allocate only on size change, such that the previous warp remains
+	// visible until overwritten by progressive synthesis
+	if( wtex.GetDepth() != size )
 	{
-		cerr << "Error: Coudln't create 3D texture!" << endl;
-		delete [] data;  // free data buffer
-		return false;
+		if( !wtex.Create( GL_TEXTURE_3D ) )
+		{
+			cerr << "Error: Coudln't create 3D texture!" << endl;
+			return false;
+		}
+
+		// don't forget to set HW supported parameters	
+		// GL_CLAMP_TO_EDGE / GL_CLAMP / GL_REPEAT
+		wtex.SetWrapMode  ( GL_MIRRORED_REPEAT_ARB ); //GL_REPEAT );
+		wtex.SetFilterMode( GL_LINEAR );
+
+		if( !wtex.Image( 0, /*GL_RGBA8*/ GL_RGBA32F, size,size,size, 0, 
+		                 GL_RGB, GL_FLOAT, NULL ) )
+		{
+			cerr << "Error: Couldn't allocate 3D warp texture!" << endl;
+			return false;
+		}
 	}
 
-	// don't forget to set HW supported parameters	
-	// GL_CLAMP_TO_EDGE / GL_CLAMP / GL_REPEAT
-	wtex.SetWrapMode  ( GL_MIRRORED_REPEAT_ARB ); //GL_REPEAT );
-	wtex.SetFilterMode( GL_LINEAR );
+	// --- Synthesize warp volume ---
+
+	m_warpSynth.start( size, type, 3.f, progressive ? 3 : 1 );
 
-	// GPU download
-	if( !wtex.Image( 0, /*GL_RGBA8*/ GL_RGBA32F, size,size,size, 0, 
-	                 GL_RGB, GL_FLOAT, data ) )
+	if( !progressive )
+		while( !m_warpSynth.done() )
+			if( !refineWarpTexture( wtex ) )
+				return false;
+
+	return true;
+}
+
+bool Raycaster::refineWarpTexture( GL::GLTexture& wtex )
+{
+	if( !m_warpSynth.step() )
+		return true;
+
+	// GPU download of finished slab
+	int size = m_warpSynth.size();
+	if( !wtex.SubImage( 0, 0,0,m_warpSynth.slabZ(), size,size,m_warpSynth.slabDepth(), 
+	                    GL_RGB, GL_FLOAT, (void*)m_warpSynth.slabData() ) )
 	{
 		cerr << "Error: Couldn't upload warp volume to 3D texture!" << endl;
-		delete [] data;  // free data buffer
 		return false;
 	}
-	
-	delete [] data;  // free data buffer
 	return true;
 }
 
@@ -437,7 +441,7 @@ bool Raycaster::init( int argc, char* argv[] )
 	// --- Create warp texture ---
 
 	if( verbosity > 1 ) cout << "Creating warp texture..." << endl;
-	if( !genWarpTexture( m_wtex, wnoise_ridgedmf ) )
+	if( !genWarpTexture( m_wtex, NoiseVolumeSynth::RidgedMF, false ) )
 	{
 		return false;
 	}
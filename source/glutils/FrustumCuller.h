@@ -0,0 +1,230 @@
+#ifndef FRUSTUMCULLER_H
+#define FRUSTUMCULLER_H
+
+#include <vector>
+#include <cstddef>
+
+#if defined(__AVX__)
+#define FRUSTUMCULLER_AVX
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUMCULLER_SSE
+#include <xmmintrin.h>
+#endif
+
+/// Axis aligned bounding boxes stored as structure of arrays for batched
+/// culling via FrustumCuller.
+struct AABBArray
+{
+	std::vector<float> minx, miny, minz, maxx, maxy, maxz;
+
+	size_t size() const { return minx.size(); }
+	void clear() { resize( 0 ); }
+	void resize( size_t n )
+	{
+		minx.resize( n ); miny.resize( n ); minz.resize( n );
+		maxx.resize( n ); maxy.resize( n ); maxz.resize( n );
+	}
+	void set( size_t i, const float bmin[3], const float bmax[3] )
+	{
+		minx[i] = bmin[0]; miny[i] = bmin[1]; minz[i] = bmin[2];
+		maxx[i] = bmax[0]; maxy[i] = bmax[1]; maxz[i] = bmax[2];
+	}
+	void push_back( const float bmin[3], const float bmax[3] )
+	{
+		resize( size()+1 );
+		set( size()-1, bmin, bmax );
+	}
+};
+
+/**
+  Batched culling of axis aligned bounding boxes against a set of up to 8
+  planes, e.g. the 6 planes of a viewing frustum or additional clip planes.
+  A plane (a,b,c,d) is given by ax + by + cz + d = 0 with the inside on the
+  positive side. A box is culled if it is completely on the negative side of
+  any plane, i.e. if none of its corners has positive distance (same as
+  Frustum::clip_aabb() in mnoise2).
+
+  Consecutive boxes are tested 8 at a time with AVX, 4 at a time with SSE,
+  remaining ones and all boxes w/o SIMD support one by one. Results are
+  identical in either case. Default builds use SSE; AVX requires compiling
+  with -mavx or /arch:AVX (or higher, e.g. CMake option MNOISE2_USE_AVX2
+  of mnoise2).
+
+  For hierarchies (e.g. octrees with consecutive children) each visible box
+  yields a plane mask of the planes it intersects. Boxes completely inside
+  a plane are inside this plane for all their children as well, such that
+  children only have to be tested against the planes in their parents mask.
+  If the mask is zero the box is completely inside and children need no
+  testing at all.
+*/
+class FrustumCuller
+{
+public:
+	enum { MaxPlanes = 8 };
+
+	FrustumCuller(): m_numPlanes(0) {}
+
+	/// Set planes given as numPlanes consecutive (a,b,c,d) tuples
+	void setPlanes( const float* planes, int numPlanes )
+	{
+		m_numPlanes = numPlanes < (int)MaxPlanes ? numPlanes : (int)MaxPlanes;
+		for( int k=0; k < m_numPlanes; k++ )
+			for( int j=0; j < 4; j++ )
+				m_planes[k][j] = planes[4*k+j];
+	}
+
+	int numPlanes() const { return m_numPlanes; }
+
+	/// Mask with all planes set
+	unsigned allPlanes() const { return (1u << m_numPlanes) - 1; }
+
+	/// Cull boxes [first,first+count) against the planes in planeMask.
+	/// Indices of visible boxes are written to visible and, if masks is given,
+	/// the planes each visible box intersects to the same position in masks.
+	/// Both arrays must hold count entries. Returns the number of visible
+	/// boxes, indices are in increasing order.
+	int cull( const AABBArray& boxes, size_t first, size_t count,
+	          int* visible, unsigned char* masks=NULL,
+	          unsigned planeMask=~0u ) const
+	{
+		planeMask &= allPlanes();
+		int numVisible = 0;
+		size_t i = first, end = first + count;
+
+		// All boxes are inside if no plane has to be tested
+		if( planeMask == 0 )
+		{
+			for( ; i < end; i++, numVisible++ )
+			{
+				visible[numVisible] = (int)i;
+				if( masks ) masks[numVisible] = 0;
+			}
+			return numVisible;
+		}
+
+	#if defined(FRUSTUMCULLER_AVX)
+		for( ; i+8 <= end; i+=8 )
+			numVisible += cullBlock<AVXLanes>( boxes, i, planeMask,
+			                visible+numVisible, masks ? masks+numVisible : NULL );
+	#elif defined(FRUSTUMCULLER_SSE)
+		for( ; i+4 <= end; i+=4 )
+			numVisible += cullBlock<SSELanes>( boxes, i, planeMask,
+			                visible+numVisible, masks ? masks+numVisible : NULL );
+	#endif
+		for( ; i < end; i++ )
+			numVisible += cullBlock<ScalarLanes>( boxes, i, planeMask,
+			                visible+numVisible, masks ? masks+numVisible : NULL );
+
+		return numVisible;
+	}
+
+protected:
+	/// Single box as one lane
+	struct ScalarLanes
+	{
+		enum { Width = 1 };
+		typedef float V;
+		static V load ( const float* p ) { return *p; }
+		static V set1 ( float a ) { return a; }
+		static V add  ( V a, V b ) { return a + b; }
+		static V mul  ( V a, V b ) { return a * b; }
+		/// Bit mask of lanes <= 0
+		static unsigned nonPositive( V a ) { return a <= 0.f ? 1u : 0u; }
+	};
+
+#if defined(FRUSTUMCULLER_SSE)
+	struct SSELanes
+	{
+		enum { Width = 4 };
+		typedef __m128 V;
+		static V load ( const float* p ) { return _mm_loadu_ps( p ); }
+		static V set1 ( float a ) { return _mm_set1_ps( a ); }
+		static V add  ( V a, V b ) { return _mm_add_ps( a, b ); }
+		static V mul  ( V a, V b ) { return _mm_mul_ps( a, b ); }
+		static unsigned nonPositive( V a )
+		{
+			return (unsigned)_mm_movemask_ps( _mm_cmple_ps( a, _mm_setzero_ps() ) );
+		}
+	};
+#endif
+
+#if defined(FRUSTUMCULLER_AVX)
+	struct AVXLanes
+	{
+		enum { Width = 8 };
+		typedef __m256 V;
+		static V load ( const float* p ) { return _mm256_loadu_ps( p ); }
+		static V set1 ( float a ) { return _mm256_set1_ps( a ); }
+		static V add  ( V a, V b ) { return _mm256_add_ps( a, b ); }
+		static V mul  ( V a, V b ) { return _mm256_mul_ps( a, b ); }
+		static unsigned nonPositive( V a )
+		{
+			return (unsigned)_mm256_movemask_ps(
+				_mm256_cmp_ps( a, _mm256_setzero_ps(), _CMP_LE_OQ ) );
+		}
+	};
+#endif
+
+	/// Cull L::Width boxes starting at i, returns number of visible boxes
+	template<class L>
+	int cullBlock( const AABBArray& b, size_t i, unsigned planeMask,
+	               int* visible, unsigned char* masks ) const
+	{
+		typedef typename L::V V;
+
+		V minx = L::load( &b.minx[i] ), maxx = L::load( &b.maxx[i] ),
+		  miny = L::load( &b.miny[i] ), maxy = L::load( &b.maxy[i] ),
+		  minz = L::load( &b.minz[i] ), maxz = L::load( &b.maxz[i] );
+
+		unsigned outside = 0;             // lanes outside of any plane
+		unsigned straddle[MaxPlanes];     // lanes intersecting plane k
+		for( int k=0; k < m_numPlanes; k++ )
+		{
+			straddle[k] = 0;
+			if( !(planeMask & (1u << k)) )
+				continue;
+
+			// Distances of corners farthest along (pos) and against (neg)
+			// the plane normal, summed in the same order as Frustum does.
+			const float* p = m_planes[k];
+			V a = L::set1( p[0] ), bb = L::set1( p[1] ), c = L::set1( p[2] ),
+			  d = L::set1( p[3] );
+			V pos = L::add( L::add( L::add(
+			          L::mul( a,  p[0] > 0.f ? maxx : minx ),
+			          L::mul( bb, p[1] > 0.f ? maxy : miny ) ),
+			          L::mul( c,  p[2] > 0.f ? maxz : minz ) ), d );
+			V neg = L::add( L::add( L::add(
+			          L::mul( a,  p[0] > 0.f ? minx : maxx ),
+			          L::mul( bb, p[1] > 0.f ? miny : maxy ) ),
+			          L::mul( c,  p[2] > 0.f ? minz : maxz ) ), d );
+
+			outside    |= L::nonPositive( pos );
+			straddle[k] = L::nonPositive( neg );
+		}
+
+		int n = 0;
+		for( int l=0; l < (int)L::Width; l++ )
+		{
+			if( outside & (1u << l) )
+				continue;
+
+			visible[n] = (int)i + l;
+			if( masks )
+			{
+				unsigned m = 0;
+				for( int k=0; k < m_numPlanes; k++ )
+					m |= ((straddle[k] >> l) & 1u) << k;
+				masks[n] = (unsigned char)m;
+			}
+			n++;
+		}
+		return n;
+	}
+
+private:
+	float m_planes[MaxPlanes][4];
+	int   m_numPlanes;
+};
+
+#endif // FRUSTUMCULLER_H
@@ -73,7 +73,7 @@ namespace Intersect
 	/// Ray triangle intersection as described in
 	/// "Fast, Minimum Storage Ray/Triangle Intersection" by Mller and Trumbore
 	/// http://www.cs.virginia.edu/~gfx/Courses/2003/ImageSynthesis/papers/Acceleration/Fast%20MinimumStorage%20RayTriangle%20Intersection.pdf
-	RayTriangleIntersection intersect( const Ray& r, const Triangle& t )
+	inline RayTriangleIntersection intersect( const Ray& r, const Triangle& t )
 	{
 		Vec3 T  = r.origin - t.v0,
 			 E1 = t.v1 - t.v0,
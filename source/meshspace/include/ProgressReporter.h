@@ -0,0 +1,83 @@
+// ProgressReporter - progress and cancellation interface for long analyses
+#ifndef PROGRESSREPORTER_H
+#define PROGRESSREPORTER_H
+
+#include <cstdio>
+
+/** @addtogroup meshtools
+  * @{ */
+
+/**
+	\brief Interface for long running computations to report progress.
+
+	Computations call \a setProgress() from arbitrary (also OpenMP worker)
+	threads and poll \a isCancelled() to stop early. Implementations must be
+	thread-safe. A cancelled computation returns as soon as possible, its
+	output is incomplete and should be discarded by the caller.
+
+	See for instance \a JobScheduler in meshspace.
+*/
+class ProgressReporter
+{
+public:
+	virtual ~ProgressReporter() {}
+
+	/// Report progress as fraction in [0,1]
+	virtual void setProgress( double fraction ) = 0;
+
+	/// Returns true if the computation should be stopped
+	virtual bool isCancelled() const = 0;
+};
+
+/**
+	\brief Thread-safe step counter for (OpenMP) loops.
+
+	Forwards progress in full percent to an optional \a ProgressReporter. If
+	no reporter is given progress is printed to the console instead.
+*/
+class ProgressCounter
+{
+public:
+	ProgressCounter( int total, const char* label, ProgressReporter* reporter=NULL )
+	: m_total(total),
+	  m_count(0),
+	  m_percent(-1),
+	  m_label(label),
+	  m_reporter(reporter)
+	{}
+
+	/// Count a finished step, may be called concurrently from several threads.
+	void step()
+	{
+		#pragma omp critical (ProgressCounter)
+		{
+			m_count++;
+			int percent = (m_total > 0) ? (100*m_count) / m_total : 100;
+			if( percent != m_percent )
+			{
+				m_percent = percent;
+				if( m_reporter )
+					m_reporter->setProgress( percent / 100. );
+				else
+					printf("%s %d%% (%d / %d)\r",m_label,percent,m_count,m_total);
+			}
+		}
+	}
+
+	/// Returns true if the associated computation was cancelled.
+	bool isCancelled() const { return m_reporter && m_reporter->isCancelled(); }
+
+	/// Finish console output
+	void finish() { if( !m_reporter ) printf("\n"); }
+
+private:
+	int m_total;
+	int m_count;
+	int m_percent;
+	const char* m_label;
+	ProgressReporter* m_reporter;
+};
+
+/** @} */ // end group
+
+#endif // PROGRESSREPORTER_H
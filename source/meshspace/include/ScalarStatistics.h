@@ -0,0 +1,33 @@
+#ifndef SCALARSTATISTICS_H
+#define SCALARSTATISTICS_H
+
+#include <vector>
+#include <cstddef>
+
+/** @addtogroup meshtools
+  * @{ */
+
+/// Statistics on large float arrays, e.g. per vertex scalar fields.
+/// Reductions are vectorized via SSE (if available) and parallelized via
+/// OpenMP. NaN values are ignored throughout.
+namespace ScalarStatistics
+{
+	/// Minimum and maximum value, returns false if there is no valid value.
+	bool minmax( const float* values, size_t n, float& minval, float& maxval );
+
+	/// Histogram with bins.size() equally spaced bins over [minval,maxval],
+	/// values outside this range are ignored.
+	void histogram( const float* values, size_t n, float minval, float maxval,
+	                std::vector<size_t>& bins );
+
+	/// Range between lower and upper percentile (given as fractions in [0,1]),
+	/// e.g. 0.01 and 0.99 to ignore 1% outliers at both ends. Percentiles are
+	/// estimated via a histogram with numBins bins over the min/max range.
+	/// Returns false if there is no valid value.
+	bool percentileRange( const float* values, size_t n, float lower, float upper,
+	                      float& lo, float& hi, int numBins=4096 );
+}
+
+/** @} */ // end group
+
+#endif // SCALARSTATISTICS_H
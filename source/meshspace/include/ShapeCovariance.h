@@ -4,6 +4,7 @@
 
 #include <Eigen/Dense>
 #include <vector>
+#include "ProgressReporter.h"
 
 /** @addtogroup meshtools
   * @{ */
@@ -51,10 +52,8 @@ void devectorizeCovariance( const Eigen::VectorXd v, Eigen::Matrix3d& Sigma );
 /// Compute sample covariance tensors for zero-mean data matrix
 /// @param [in]  X  Data matrix with vectorized 3D displacements in columns.
 /// @param [out] S  Covariance matrices encoded as 6D column vectors.
-void computeSampleCovariance( const Eigen::MatrixXd& X, Eigen::MatrixXd& S  );
-
-/// Provided for convenience
-void computeSampleCovariance( const Eigen::MatrixXd& X, std::vector<Eigen::Matrix3d> S );
+/// @param [in]  progress  Optional progress reporter (console output if NULL)
+void computeSampleCovariance( const Eigen::MatrixXd& X, Eigen::MatrixXd& S, ProgressReporter* progress=NULL );
 ///@}
 
 //-----------------------------------------------------------------------------
@@ -65,7 +64,8 @@ void computeSampleCovariance( const Eigen::MatrixXd& X, std::vector<Eigen::Matri
 /// @param[in]  B      Shape basis, i.e. eigenvectors scaled by eigenvalues
 /// @param[in]  gamma  Tikhonov regularization parameter
 /// @param[out] G      Inter point covariance tensor (vectorized in columns, 6xn)
-void computeInterPointCovariance( const Eigen::MatrixXd& B, double gamma, Eigen::MatrixXd& G );
+/// @param[in]  progress  Optional progress reporter (console output if NULL)
+void computeInterPointCovariance( const Eigen::MatrixXd& B, double gamma, Eigen::MatrixXd& G, ProgressReporter* progress=NULL );
 
 /// Precompute part of interaction tensor depending solely on p.
 /// @param[in]  B      Shape basis, i.e. eigenvectors scaled by eigenvalues
@@ -3,6 +3,7 @@
 
 #include "meshtools.h"
 #include "MeshBuffer.h"
+#include "ProgressReporter.h"
 #include <Eigen/Dense>
 
 /** @addtogroup meshtools
@@ -23,7 +24,8 @@ struct PCAModel
 /// \param[out] pcmb     Output MeshBuffer with mean shape
 /// \param[out] model    \a PCAModel with eigenvectors, ~values and mean
 /// \param[out] mshape   Mean shape as \a meshtools::Mesh
-void computePCA( /*const*/ MeshBuffer& samples, MeshBuffer& pcmb, PCAModel& model, meshtools::Mesh& mshape );
+/// \param[in]  progress Optional progress reporter
+void computePCA( /*const*/ MeshBuffer& samples, MeshBuffer& pcmb, PCAModel& model, meshtools::Mesh& mshape, ProgressReporter* progress=NULL );
 
 /// De-vectorize a 3n x 1 vector into a 3 x n matrix
 Eigen::Matrix3Xd reshape( const Eigen::VectorXd& v );
@@ -0,0 +1,90 @@
+// SymmetricEigensolver3 - batched eigen-decomposition of symmetric 3x3 tensors
+#ifndef SYMMETRICEIGENSOLVER3_H
+#define SYMMETRICEIGENSOLVER3_H
+
+#include <Eigen/Dense>
+
+/** @addtogroup meshtools
+  * @{ */
+
+/// Batched closed-form eigen-decomposition of symmetric 3x3 matrices.
+///
+/// Eigenvalues are computed analytically via the trigonometric solution of
+/// the characteristic polynomial, eigenvectors via cross products of the rows
+/// of (A - lambda I) followed by Gram-Schmidt. Tensors with (nearly) repeated
+/// eigenvalues, where the analytic eigenvectors become ill-conditioned, are
+/// detected per tensor and re-solved with cyclic Jacobi rotations instead.
+/// In both cases the returned eigenvectors form a right-handed orthonormal
+/// basis, i.e. a proper rotation matrix.
+///
+/// Input and output are accessed in structure-of-arrays layout with an
+/// arbitrary element stride. Internally tensors are processed in small blocks
+/// which are gathered into contiguous lanes (to allow auto-vectorization of
+/// the analytic path) and distributed over threads via OpenMP.
+///
+/// For the classical method see
+/// - Smith, "Eigenvalues of a symmetric 3x3 matrix", CACM 4(4), 1961
+/// - Eberly, "A Robust Eigensolver for 3x3 Symmetric Matrices", 2014
+namespace SymmetricEigensolver3 {
+
+/// Read-only view on n symmetric 3x3 matrices in structure-of-arrays layout.
+/// Component k of tensor i is found at a[k][i*stride] where the components
+/// are ordered (a00, a01, a02, a11, a12, a22), i.e. the same order as used by
+/// \a ShapeCovariance::vectorizeCovariance().
+struct TensorsSoA
+{
+	TensorsSoA(): n(0), stride(1) { for( int k=0; k < 6; k++ ) a[k]=0; }
+	const double* a[6];
+	int n;
+	int stride;
+};
+
+/// Output view on n eigen-decompositions in structure-of-arrays layout.
+/// Eigenvalues are sorted in descending order, lambda[k][i*lambdaStride].
+/// The eigenvector matrix is stored column-major, i.e. the j-th component of
+/// the k-th eigenvector of tensor i is found at R[3*k+j][i*RStride].
+struct EigenSystemsSoA
+{
+	EigenSystemsSoA(): lambdaStride(1), RStride(1)
+	{
+		for( int k=0; k < 3; k++ ) lambda[k]=0;
+		for( int k=0; k < 9; k++ ) R[k]=0;
+	}
+	double* lambda[3];
+	double* R[9];
+	int lambdaStride;
+	int RStride;
+};
+
+/// Statistics of a batch solve, mainly for debugging and benchmarking.
+struct SolveInfo
+{
+	SolveInfo(): numTensors(0), numJacobi(0) {}
+	int numTensors; ///< Number of processed tensors
+	int numJacobi;  ///< Number of tensors which required the Jacobi fallback
+};
+
+/// Solve all tensors of the given batch.
+/// @param [in]  in   Input tensors
+/// @param [out] out  Eigenvalues and eigenvectors, must provide in.n entries
+/// @param [in]  degeneracyTolerance  Relative eigenvalue gap below which the
+///                   Jacobi fallback is used instead of the analytic solution
+SolveInfo solve( const TensorsSoA& in, EigenSystemsSoA& out,
+	             double degeneracyTolerance=1e-5 );
+
+/// Solve a single tensor with cyclic Jacobi rotations (reference solution).
+/// Eigenvalues are sorted descending, eigenvectors stored in columns of R.
+void solveJacobi( const Eigen::Matrix3d& A, Eigen::Vector3d& lambda, Eigen::Matrix3d& R );
+
+/// Convenience wrapper for a tensor field vectorized in columns of a 6xn
+/// matrix (see \a ShapeCovariance::vectorizeCovariance()).
+/// @param [in]  S       Vectorized symmetric tensors (6xn)
+/// @param [out] R       Eigenvectors, column-major 3x3 vectorized in columns (9xn)
+/// @param [out] lambda  Eigenvalues sorted descending in columns (3xn)
+SolveInfo solve( const Eigen::MatrixXd& S, Eigen::MatrixXd& R, Eigen::Matrix3Xd& lambda );
+
+}; // namespace SymmetricEigensolver3
+
+/** @} */ // end group
+
+#endif // SYMMETRICEIGENSOLVER3_H
@@ -0,0 +1,113 @@
+#ifndef TRIANGLEBVH_H
+#define TRIANGLEBVH_H
+
+#include <meshtools.h> // OpenMesh and Eigen/Dense, meshtools::Mesh
+#include "Intersect.h"
+#include <vector>
+#include <limits>
+
+/** @addtogroup meshtools
+  * @{ */
+
+/**
+	\class TriangleBVH
+
+	Bounding volume hierarchy for ray queries against a triangle mesh.
+
+	The hierarchy is built top-down with the surface area heuristic (SAH)
+	evaluated on a fixed number of centroid bins per split. Triangles are
+	stored as flat vertex and index arrays, reordered such that each leaf
+	references a contiguous range. The actual ray-triangle test is
+	\a Intersect::intersect().
+
+	All queries return only the closest hit. Batch queries via
+	\a intersect(const std::vector<Intersect::Ray>&,...) trace packets of
+	consecutive (and thus usually coherent) rays together through the
+	hierarchy and are parallelized via OpenMP.
+*/
+class TriangleBVH
+{
+public:
+	/// Ray hit, face is -1 if no triangle was hit
+	struct Hit
+	{
+		int    face; ///< Index of hit face in input mesh
+		double t;    ///< Ray parameter of hit point, i.e. origin + t*dir
+		Intersect::UV bc; ///< Barycentric coordinates of hit point
+
+		Hit(): face(-1), t(std::numeric_limits<double>::infinity()) {}
+		bool valid() const { return face >= 0; }
+	};
+
+	enum {
+		MaxLeafSize = 4,  ///< Maximum number of triangles per leaf
+		NumBins     = 16, ///< Number of bins for SAH split evaluation
+		PacketSize  = 16  ///< Number of rays traced together in batch queries
+	};
+
+	///@{ Build hierarchy
+	void build( const meshtools::Mesh& mesh );
+	/// Build from flat arrays, 3 coordinates per vertex and 3 indices per face
+	void build( const std::vector<double>& vertices, const std::vector<unsigned>& indices );
+	///@}
+
+	///@{ Single ray queries
+	/// Closest hit with ray parameter in [tmin,tmax]
+	Hit intersect( const Intersect::Ray& ray, double tmin=0.,
+		double tmax=std::numeric_limits<double>::infinity() ) const;
+	/// Closest hit in both directions along the ray, i.e. minimal |t|
+	Hit intersectLine( const Intersect::Ray& ray ) const;
+	///@}
+
+	/// Batch query with packet traversal. If bothDirections is set, closest
+	/// hits along the ray lines are returned (see \a intersectLine()).
+	void intersect( const std::vector<Intersect::Ray>& rays, std::vector<Hit>& hits,
+		bool bothDirections=false ) const;
+
+	/// Collect faces whose bounding boxes are not completely outside the convex
+	/// region bounded by the given planes, e.g. a view frustum. A point x is
+	/// inside if a*x[0] + b*x[1] + c*x[2] + d >= 0 for all planes (a,b,c,d).
+	/// The result is conservative and unordered.
+	void queryPlanes( const double (*planes)[4], int numPlanes, std::vector<int>& faces ) const;
+
+	/// Return hit point in world coordinates
+	Intersect::Vec3 hitPoint( const Hit& hit ) const;
+
+	int numTriangles() const { return (int)m_faceIds.size(); }
+	int numNodes()     const { return (int)m_nodes.size(); }
+
+protected:
+	/// Nodes are stored depth-first, i.e. the left child of an inner node
+	/// directly follows its parent.
+	struct Node
+	{
+		double bmin[3], bmax[3];
+		int    first; ///< Leaf: first triangle; inner node: index of right child
+		int    count; ///< Number of triangles, 0 for inner nodes
+		int    axis;  ///< Split axis of inner node (left child has smaller centroids)
+	};
+
+	struct BuildRef
+	{
+		double bmin[3], bmax[3], centroid[3];
+		int    tri;
+	};
+
+	int  buildRecursive( std::vector<BuildRef>& refs, int begin, int end );
+	void intersectPacket( const Intersect::Ray* rays, int n, double tmin,
+		double* tmax, Hit* hits ) const;
+	bool intersectTriangle( const Intersect::Ray& ray, int tri, double tmin,
+		double tmax, Hit& hit ) const;
+	Intersect::Triangle triangle( int tri ) const;
+
+private:
+	std::vector<double>   m_vertices; ///< 3 coordinates per vertex
+	std::vector<unsigned> m_indices;  ///< 3 vertex indices per triangle (in leaf order)
+	std::vector<int>      m_faceIds;  ///< Input face index per triangle (in leaf order)
+	std::vector<Node>     m_nodes;    ///< Root is m_nodes[0]
+	std::vector<int>      m_triOfFace;///< Triangle index per input face (-1 if none)
+};
+
+/** @} */ // end group
+
+#endif // TRIANGLEBVH_H
@@ -0,0 +1,120 @@
+#ifndef VERTEXSELECTION_H
+#define VERTEXSELECTION_H
+
+#include <meshtools.h> // OpenMesh and Eigen/Dense, meshtools::Mesh
+#include <vector>
+#include <utility>
+
+/** @addtogroup meshtools
+  * @{ */
+
+/**
+	\class VertexSelection
+
+	Set of vertex indices stored as compressed bitset.
+
+	Following the layout of roaring bitmaps the index range is split into
+	chunks of 2^16 indices. Each non-empty chunk is stored either as sorted
+	array of 16-bit offsets (sparse chunks) or as bitmap of 1024 64-bit words
+	(dense chunks with more than \a ArrayMax entries). Set algebra on dense
+	chunks is performed word-wise, i.e. in O(n/64).
+
+	Indices can be exported as sorted list (e.g. for GPU upload), as runs of
+	consecutive indices or as per vertex mask.
+*/
+class VertexSelection
+{
+public:
+	/// Run of consecutive indices, given as first index and length
+	typedef std::pair<unsigned,unsigned> Run;
+
+	enum {
+		ChunkBits   = 16,
+		ChunkSize   = 1 << ChunkBits,
+		ArrayMax    = 4096,          ///< Chunks with more entries are bitmaps
+		BitmapWords = ChunkSize / 64
+	};
+
+	///@{ Element access
+	void   clear() { m_chunks.clear(); }
+	bool   empty() const { return m_chunks.empty(); }
+	/// Number of selected indices
+	size_t size() const;
+	bool   contains( unsigned idx ) const;
+	void   insert( unsigned idx );
+	void   erase ( unsigned idx );
+	void   insert( const std::vector<unsigned>& idx );
+	void   erase ( const std::vector<unsigned>& idx );
+	/// Insert range [first,last)
+	void   insertRange( unsigned first, unsigned last );
+	///@}
+
+	///@{ Set algebra
+	VertexSelection& operator |= ( const VertexSelection& other ); ///< Union
+	VertexSelection& operator &= ( const VertexSelection& other ); ///< Intersection
+	VertexSelection& operator -= ( const VertexSelection& other ); ///< Difference
+	VertexSelection operator | ( const VertexSelection& other ) const { VertexSelection s(*this); return s |= other; }
+	VertexSelection operator & ( const VertexSelection& other ) const { VertexSelection s(*this); return s &= other; }
+	VertexSelection operator - ( const VertexSelection& other ) const { VertexSelection s(*this); return s -= other; }
+	bool operator == ( const VertexSelection& other ) const;
+	bool operator != ( const VertexSelection& other ) const { return !(*this == other); }
+	///@}
+
+	///@{ Export
+	/// Sorted list of selected indices
+	void toIndices( std::vector<unsigned>& idx ) const;
+	/// Runs of consecutive indices in ascending order
+	void toRuns( std::vector<Run>& runs ) const;
+	/// Mask of given size with 1 for selected and 0 for unselected indices
+	void toMask( std::vector<float>& mask, unsigned size ) const;
+	/// Replace selection by given runs
+	void fromRuns( const std::vector<Run>& runs );
+	///@}
+
+	///@{ Topological operations via vertex one-ring neighbourhoods
+	/// Add all neighbours of selected vertices (repeated rings times)
+	void grow  ( const meshtools::Mesh& mesh, int rings=1 );
+	/// Remove selected vertices with unselected neighbours (repeated rings times)
+	void shrink( const meshtools::Mesh& mesh, int rings=1 );
+	///@}
+
+protected:
+	typedef unsigned long long Word;
+
+	/// Chunk of 2^16 indices sharing the same high bits
+	struct Chunk
+	{
+		unsigned key;                        ///< High bits of indices
+		std::vector<unsigned short> array;   ///< Sorted low bits, if sparse
+		std::vector<Word>           bitmap;  ///< BitmapWords words, if dense
+		unsigned                    count;   ///< Number of entries
+
+		Chunk( unsigned key_=0 ): key(key_), count(0) {}
+		bool isBitmap() const { return !bitmap.empty(); }
+		bool contains( unsigned short low ) const;
+		bool insert  ( unsigned short low ); ///< Returns true if inserted
+		bool erase   ( unsigned short low ); ///< Returns true if erased
+		void toBitmap();
+		void toArray();
+		/// Convert to the cheaper representation for current count
+		void optimize();
+		/// Bitmap words of this chunk (converted if stored as array)
+		void words( std::vector<Word>& w ) const;
+		/// Set from bitmap words
+		void setWords( const std::vector<Word>& w );
+	};
+
+	/// Return chunk position for key, or position where it would be inserted
+	size_t lowerBound( unsigned key ) const;
+	Chunk* findChunk( unsigned key );
+	const Chunk* findChunk( unsigned key ) const;
+	Chunk& getChunk( unsigned key );
+	void removeEmptyChunks();
+
+private:
+	std::vector<Chunk> m_chunks; ///< Sorted by key
+};
+
+/** @} */ // end group
+
+#endif // VERTEXSELECTION_H
@@ -7,7 +7,7 @@
 using Eigen::MatrixXd;
 using Eigen::Matrix3Xd;
 
-void CovarianceClustering::compute( const MatrixXd& S, const Matrix3Xd& pts, ClusterParms parms )
+void CovarianceClustering::compute( const MatrixXd& S, const Matrix3Xd& pts, ClusterParms parms, ProgressReporter* progress )
 {
 	using std::cout;
 	using std::endl;
@@ -32,6 +32,9 @@ void CovarianceClustering::compute( const MatrixXd& S, const Matrix3Xd& pts, Clu
 	unsigned n = (unsigned)S.cols();
 	MatrixXd D( n, n );
 	computeDistanceMatrix( m_tensorData, m_pointData, m_parms, D );
+
+	// Distance matrix accounts for roughly the first 10% of progress
+	if( progress ) progress->setProgress( 0.1 );
 	
 	// Clustering
 	cout << "Starting clustering..." << endl;
@@ -42,8 +45,13 @@ void CovarianceClustering::compute( const MatrixXd& S, const Matrix3Xd& pts, Clu
 
 	double bestObjective = std::numeric_limits<double>::max();
 	std::vector<double> objectiveGraph;
+	m_labels .clear();
+	m_medoids.clear();
 	for( unsigned i=0; i < m_parms.repetitions; i++ )
 	{
+		if( progress && progress->isCancelled() )
+			break;
+
 		// seed points
 		seedGen.seed();
 		seedGen.getSeeds( seedPoints );
@@ -67,6 +75,8 @@ void CovarianceClustering::compute( const MatrixXd& S, const Matrix3Xd& pts, Clu
 		}
 
 		objectiveGraph.push_back( objective );
+
+		if( progress ) progress->setProgress( 0.1 + 0.9*(i+1) / m_parms.repetitions );
 	}
 
 	std::cout << "Graph of objective function values:" << std::endl;
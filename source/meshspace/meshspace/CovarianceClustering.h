@@ -3,6 +3,7 @@
 
 #include "ShapeCovariance.h"
 #include "ClusterSeeds.h"
+#include "ProgressReporter.h"
 #include <Eigen/Dense>
 
 class CovarianceClustering
@@ -29,7 +30,10 @@ public:
 		{}
 	};
 	
-	void compute( const Eigen::MatrixXd& S, const Eigen::Matrix3Xd& pts, ClusterParms parms );
+	/// Compute clustering, best result of all repetitions is kept. If the
+	/// optional progress reporter signals cancellation, the best result of the
+	/// repetitions finished so far is kept.
+	void compute( const Eigen::MatrixXd& S, const Eigen::Matrix3Xd& pts, ClusterParms parms, ProgressReporter* progress=NULL );
 
 	const std::vector<unsigned int>& getLabels() const { return m_labels; }
 	const std::vector<unsigned int>& getMedoids() const { return m_medoids; }
@@ -75,7 +75,7 @@ double crossvalidate( const MatrixXd& X, const VectorXd& x0, const PCAModel& pca
 //-----------------------------------------------------------------------------
 //  crossvalidate()
 //----------------------------------------------------------------------------- 
-void crossvalidate( const MatrixXd& X, const std::vector<double>& gamma, std::vector<double>& error, std::vector<double>& baseline )
+void crossvalidate( const MatrixXd& X, const std::vector<double>& gamma, std::vector<double>& error, std::vector<double>& baseline, ProgressReporter* progress )
 {
 	using namespace std;
 
@@ -91,6 +91,9 @@ void crossvalidate( const MatrixXd& X, const std::vector<double>& gamma, std::ve
 	unsigned count = m / step;
 	for( unsigned i=0; i < m; i+=step )	
 	{
+		if( progress && progress->isCancelled() )
+			break;
+
 		cout << "Cross-validation " << i+1 << " / " << m << endl;
 
 		// Leave out i-th column of X
@@ -115,6 +118,9 @@ void crossvalidate( const MatrixXd& X, const std::vector<double>& gamma, std::ve
 			double V0 = crossvalidate( Xi, xi, pca, gamma[g] );
 			cout << "    gamma=" << gamma[g] << ", error=" << V0 << endl;
 			err(g) += V0 / (double)count;
+
+			if( progress ) 
+				progress->setProgress( (i + step*(g+1.)/gamma.size()) / (double)m );
 		}
 		cout << endl;
 	}
@@ -4,12 +4,16 @@
 
 #include <Eigen/Dense>
 #include <vector>
+#include "ProgressReporter.h"
 
 /// Cross validate gamma parameter for model-based deformation & inter-point covariance analysis
 /// @param[in]  X      Shape dataset, i.e. displacement vector fields (vectorized in columns)
 /// @param[in]  gamma  Sampling of parameter space
 /// @param[out] error  Reconstruction error for each sampling value gamma
+/// @param[out] baseline  Error between left out shapes and mean shape
+/// @param[in]  progress  Optional progress reporter, results are incomplete if cancelled
 void crossvalidate( const Eigen::MatrixXd& X, const std::vector<double>& gamma, 
-				    std::vector<double>& error, std::vector<double>& baseline );
+				    std::vector<double>& error, std::vector<double>& baseline,
+					ProgressReporter* progress=NULL );
 
 #endif // CROSSVALIDATE_H
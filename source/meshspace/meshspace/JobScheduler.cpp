@@ -0,0 +1,218 @@
+#include "JobScheduler.h"
+#include <QRunnable>
+#include <QThread>
+#include <QMutexLocker>
+#include <exception>
+#include <iostream>
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+	QAtomicInt g_nextJobId( 1 );
+}
+
+//-----------------------------------------------------------------------------
+// 	JobRunner
+//-----------------------------------------------------------------------------
+/// Executes a single job on a pool thread, keeps job alive until finished.
+class JobRunner : public QRunnable
+{
+public:
+	JobRunner( JobPtr job, JobScheduler* scheduler )
+	: m_job(job), m_scheduler(scheduler)
+	{
+		setAutoDelete( true );
+	}
+
+	void run()
+	{
+	#ifdef USE_OPENMP
+		// Avoid oversubscription by concurrent OpenMP parallel regions
+		omp_set_num_threads( m_scheduler->numThreadsPerJob() );
+	#endif
+		m_scheduler->notifyStarted( m_job.get() );
+		m_job->execute();
+		m_scheduler->notifyFinished( m_job.get() );
+	}
+
+private:
+	JobPtr        m_job;
+	JobScheduler* m_scheduler;
+};
+
+//-----------------------------------------------------------------------------
+// 	Job
+//-----------------------------------------------------------------------------
+Job::Job( std::string name )
+: m_id( g_nextJobId.fetchAndAddOrdered(1) ),
+  m_name( name ),
+  m_state( Pending ),
+  m_cancelled( 0 ),
+  m_permille( 0 ),
+  m_scheduler( NULL )
+{}
+
+//-----------------------------------------------------------------------------
+Job::State Job::state() const
+{
+	QMutexLocker lock( &m_mutex );
+	return m_state;
+}
+
+//-----------------------------------------------------------------------------
+std::string Job::error() const
+{
+	QMutexLocker lock( &m_mutex );
+	return m_error;
+}
+
+//-----------------------------------------------------------------------------
+bool Job::isDone() const
+{
+	QMutexLocker lock( &m_mutex );
+	return m_state != Pending && m_state != Running;
+}
+
+//-----------------------------------------------------------------------------
+void Job::wait()
+{
+	QMutexLocker lock( &m_mutex );
+	while( m_state == Pending || m_state == Running )
+		m_done.wait( &m_mutex );
+}
+
+//-----------------------------------------------------------------------------
+void Job::setProgress( double fraction )
+{
+	int permille = (int)(1000.*fraction);
+	if( permille < 0    ) permille = 0;
+	if( permille > 1000 ) permille = 1000;
+
+	// Only notify on change
+	if( m_permille.fetchAndStoreOrdered( permille ) != permille && m_scheduler )
+		m_scheduler->notifyProgress( this );
+}
+
+//-----------------------------------------------------------------------------
+void Job::execute()
+{
+	{
+		QMutexLocker lock( &m_mutex );
+		if( isCancelled() )
+		{
+			// Cancelled before it was started
+			m_state = Cancelled;
+			m_done.wakeAll();
+			return;
+		}
+		m_state = Running;
+	}
+
+	State state = Finished;
+	std::string error;
+	try
+	{
+		run();
+		if( isCancelled() )
+			state = Cancelled;
+	}
+	catch( std::exception& e )
+	{
+		state = Failed;
+		error = e.what();
+		std::cerr << "Job::execute() : Job \"" << m_name << "\" failed with "
+			<< "exception: " << error << std::endl;
+	}
+	catch( ... )
+	{
+		state = Failed;
+		error = "Unknown exception";
+		std::cerr << "Job::execute() : Job \"" << m_name << "\" failed with "
+			<< "unknown exception!" << std::endl;
+	}
+
+	QMutexLocker lock( &m_mutex );
+	m_state = state;
+	m_error = error;
+	m_done.wakeAll();
+}
+
+//-----------------------------------------------------------------------------
+// 	JobScheduler
+//-----------------------------------------------------------------------------
+JobScheduler::JobScheduler( int numWorkers, QObject* parent )
+: QObject( parent ),
+  m_numWorkers( numWorkers > 0 ? numWorkers : 2 )
+{
+	int numCores = QThread::idealThreadCount();
+	m_numThreadsPerJob = (numCores > m_numWorkers) ? numCores / m_numWorkers : 1;
+
+	m_pool.setMaxThreadCount( m_numWorkers );
+}
+
+//-----------------------------------------------------------------------------
+JobScheduler::~JobScheduler()
+{
+	cancelAll();
+	m_pool.waitForDone();
+}
+
+//-----------------------------------------------------------------------------
+void JobScheduler::enqueue( JobPtr job )
+{
+	if( !job.get() )
+		return;
+
+	job->m_scheduler = this;
+	{
+		QMutexLocker lock( &m_mutex );
+		m_active.insert( job->id(), job );
+	}
+	m_pool.start( new JobRunner( job, this ) );
+}
+
+//-----------------------------------------------------------------------------
+JobPtr JobScheduler::job( int id ) const
+{
+	QMutexLocker lock( &m_mutex );
+	return m_active.value( id );
+}
+
+//-----------------------------------------------------------------------------
+int JobScheduler::numActiveJobs() const
+{
+	QMutexLocker lock( &m_mutex );
+	return m_active.size();
+}
+
+//-----------------------------------------------------------------------------
+void JobScheduler::cancelAll()
+{
+	QMutexLocker lock( &m_mutex );
+	QMap<int,JobPtr>::iterator it = m_active.begin();
+	for( ; it != m_active.end(); ++it )
+		it.value()->cancel();
+}
+
+//-----------------------------------------------------------------------------
+void JobScheduler::notifyStarted( Job* job )
+{
+	emit jobStarted( job->id() );
+}
+
+//-----------------------------------------------------------------------------
+void JobScheduler::notifyProgress( Job* job )
+{
+	emit jobProgress( job->id(), job->progress() );
+}
+
+//-----------------------------------------------------------------------------
+void JobScheduler::notifyFinished( Job* job )
+{
+	{
+		QMutexLocker lock( &m_mutex );
+		m_active.remove( job->id() );
+	}
+	emit jobFinished( job->id() );
+}
@@ -0,0 +1,201 @@
+// JobScheduler - background execution of long running analyses
+#ifndef JOBSCHEDULER_H
+#define JOBSCHEDULER_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QMap>
+#include <boost/shared_ptr.hpp>
+#include <string>
+#include "ProgressReporter.h"
+
+class JobScheduler;
+
+/** @addtogroup meshspaceGUI_grp meshspace GUI
+  * @{ */
+
+//-----------------------------------------------------------------------------
+// 	Job
+//-----------------------------------------------------------------------------
+/**
+	\brief Abstract unit of work executed by \a JobScheduler.
+
+	Subclasses implement \a run() and pass the job itself as \a ProgressReporter
+	to the computation, which allows progress display and cooperative
+	cancellation. See \a Task for jobs with a typed result.
+*/
+class Job : public ProgressReporter
+{
+public:
+	enum State { Pending, Running, Finished, Cancelled, Failed };
+
+	Job( std::string name );
+	virtual ~Job() {}
+
+	int         id()    const { return m_id; }
+	std::string name()  const { return m_name; }
+	State       state() const;
+	/// Error message of a failed job
+	std::string error() const;
+
+	/// Returns true if job is not pending or running anymore.
+	bool isDone() const;
+	/// Block until job is done.
+	void wait();
+
+	/// Request cancellation. Pending jobs are not started at all, running
+	/// jobs stop when they poll \a isCancelled() the next time.
+	void cancel() { m_cancelled.fetchAndStoreOrdered( 1 ); }
+
+	///@{ Implementation of \a ProgressReporter (thread-safe)
+	void setProgress( double fraction );
+	bool isCancelled() const { return (int)m_cancelled != 0; }
+	///@}
+
+	/// Last reported progress in [0,1]
+	double progress() const { return (int)m_permille / 1000.; }
+
+protected:
+	/// Actual computation, executed on a worker thread
+	virtual void run() = 0;
+
+private:
+	friend class JobScheduler;
+	friend class JobRunner;
+	void execute();
+
+	int              m_id;
+	std::string      m_name;
+	std::string      m_error;
+	State            m_state;
+	QAtomicInt       m_cancelled;
+	QAtomicInt       m_permille;
+	JobScheduler*    m_scheduler; ///< Notified on progress, set on submit
+	mutable QMutex   m_mutex;
+	QWaitCondition   m_done;
+};
+
+typedef boost::shared_ptr<Job> JobPtr;
+
+//-----------------------------------------------------------------------------
+// 	Task
+//-----------------------------------------------------------------------------
+/// Job with a typed result, see \a Future.
+template<typename T>
+class Task : public Job
+{
+public:
+	typedef T Result;
+
+	Task( std::string name ): Job(name), m_result() {}
+
+	/// Result of the computation, only valid if job finished successfully.
+	const T& result() const { return m_result; }
+
+protected:
+	/// Actual computation, executed on a worker thread
+	virtual T compute() = 0;
+
+	void run() { m_result = compute(); }
+
+	T m_result;
+};
+
+//-----------------------------------------------------------------------------
+// 	Future
+//-----------------------------------------------------------------------------
+/// Handle to the result of a submitted \a Task.
+template<typename T>
+class Future
+{
+public:
+	Future() {}
+	Future( boost::shared_ptr< Task<T> > task ): m_task(task) {}
+
+	bool   isValid()  const { return m_task.get() != NULL; }
+	bool   isDone()   const { return m_task->isDone(); }
+	double progress() const { return m_task->progress(); }
+	void   cancel()         { m_task->cancel(); }
+
+	/// Block until the task is done and return its result.
+	const T& get() const { m_task->wait(); return m_task->result(); }
+
+	JobPtr job() const { return m_task; }
+	boost::shared_ptr< Task<T> > task() const { return m_task; }
+
+private:
+	boost::shared_ptr< Task<T> > m_task;
+};
+
+//-----------------------------------------------------------------------------
+// 	JobScheduler
+//-----------------------------------------------------------------------------
+/**
+	\brief Executes jobs on a fixed pool of worker threads.
+
+	Each worker runs one job at a time. To not oversubscribe the machine when
+	jobs use OpenMP internally, the number of OpenMP threads per worker is
+	limited to the number of cores divided by the number of workers.
+
+	Signals are emitted from worker threads, i.e. connections to GUI objects
+	are queued automatically. Progress signals are emitted at most once per
+	permille.
+*/
+class JobScheduler : public QObject
+{
+	Q_OBJECT
+
+public:
+	/// Create scheduler with given number of workers (<=0 for default of 2)
+	JobScheduler( int numWorkers=0, QObject* parent=0 );
+	/// Cancels all jobs and waits for running jobs to finish.
+	~JobScheduler();
+
+	/// Submit a typed task, the scheduler takes ownership.
+	template<typename T>
+	Future<T> submit( Task<T>* task )
+	{
+		boost::shared_ptr< Task<T> > ptr( task );
+		enqueue( ptr );
+		return Future<T>( ptr );
+	}
+
+	/// Submit an untyped job.
+	void enqueue( JobPtr job );
+
+	/// Return currently pending or running job by id (NULL if not available)
+	JobPtr job( int id ) const;
+	/// Number of pending and running jobs
+	int numActiveJobs() const;
+
+	int numWorkers() const { return m_numWorkers; }
+	int numThreadsPerJob() const { return m_numThreadsPerJob; }
+
+public slots:
+	void cancelAll();
+
+signals:
+	void jobStarted( int id );
+	void jobProgress( int id, double progress );
+	void jobFinished( int id );
+
+private:
+	friend class Job;
+	friend class JobRunner;
+	void notifyStarted( Job* job );
+	void notifyProgress( Job* job );
+	void notifyFinished( Job* job );
+
+	QThreadPool       m_pool;
+	int               m_numWorkers;
+	int               m_numThreadsPerJob;
+	QMap<int,JobPtr>  m_active;
+	mutable QMutex    m_mutex;
+};
+
+/** @} */ // end group
+
+#endif // JOBSCHEDULER_H
@@ -87,6 +87,7 @@ MainWindow::MainWindow()
 	connect( actOpenAnimation, SIGNAL(triggered()), this, SLOT(openAnimation()) );
 	connect( actSaveMesh,      SIGNAL(triggered()), this, SLOT(saveMesh()) );
 	connect( actQuit,          SIGNAL(triggered()), this, SLOT(close()) );
+	connect( m_viewer, SIGNAL(statusMessage(QString,int)), statusBar(), SLOT(showMessage(const QString&,int)) );
 
 	// --- layout ---
 
@@ -4,7 +4,9 @@
 #include <GL/glew.h>
 #include <GL/GL.h>
 #include <glutils/GLError.h>
+#include <ScalarStatistics.h>
 #include <vector>
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
@@ -27,6 +29,7 @@ void MeshObject::setMesh( boost::shared_ptr<meshtools::Mesh> mesh, bool keepMesh
 		m_meshBuffer.clear();
 		m_meshBuffer.addFrame( m_mesh.get() );
 	}
+	m_picker.invalidate();
 }
 
 //-----------------------------------------------------------------------------
@@ -48,6 +51,7 @@ void MeshObject::updateMesh()
 {
 	// Create reference mesh from first frame in MeshBuffer
 	m_mesh = boost::shared_ptr<meshtools::Mesh>( m_meshBuffer.createMesh() );	
+	m_picker.invalidate();
 }
 
 //-----------------------------------------------------------------------------
@@ -63,6 +67,7 @@ bool MeshObject::addFrame( meshtools::Mesh* mesh )
 	meshtools::updateMeshVertexNormals( mesh );
 
 	// Add to mesh buffer
+	m_picker.invalidate();
 	return m_meshBuffer.addFrame( mesh );
 }
 
@@ -112,6 +117,22 @@ void MeshObject::render( int flags )
 
 			// Scalar attribute
 			scalarLoc = m_shader.program()->getAttribLocation("scalar");
+			if( activeChannelFrame() && scalarLoc >= 0 )
+			{
+				// Buffer object of active channel, re-uploaded only if the
+				// frame or the channel changed
+				uploadScalarChannel();
+				glBindBuffer( GL_ARRAY_BUFFER, m_scalarVBO );
+				glVertexAttribPointer( scalarLoc, 1, GL_FLOAT, GL_FALSE, 0, 0 );
+				glBindBuffer( GL_ARRAY_BUFFER, 0 );
+				glEnableVertexAttribArray( scalarLoc );
+
+				// Uniforms
+				glUniform1f( m_shader.program()->getUniformLocation("scalarShift"), m_scalarShift );
+				glUniform1f( m_shader.program()->getUniformLocation("scalarScale"), m_scalarScale );
+				glUniform1i( m_shader.program()->getUniformLocation("mapScalars"), 1 );
+			}
+			else
 			if( !m_scalarAttribBuffer.empty() && scalarLoc >= 0 )
 			{
 				// Attribute buffer
@@ -161,11 +182,14 @@ void MeshObject::renderPoints( const std::vector<unsigned>& idx )
 //-----------------------------------------------------------------------------
 void MeshObject::renderSelectedPoints()
 {	
-	if( m_selectedVertices.empty() ) return;
-	// TODO: Update index vector only on change in selection set.
-	std::vector<unsigned> idx;
-	idx.insert( idx.begin(), m_selectedVertices.begin(), m_selectedVertices.end() );
-	m_meshBuffer.drawPoints( idx );
+	// Index vector is only updated on change in selection set
+	if( m_selectedIndicesDirty )
+	{
+		getSelectedVertices().toIndices( m_selectedIndices );
+		m_selectedIndicesDirty = false;
+	}
+	if( m_selectedIndices.empty() ) return;
+	m_meshBuffer.drawPoints( m_selectedIndices );
 }
 
 //-----------------------------------------------------------------------------
@@ -187,6 +211,18 @@ BoundingBox MeshObject::getBoundingBox() const
 	return bbox;
 }
 
+//-----------------------------------------------------------------------------
+void MeshObject::destroy()
+{
+	if( m_scalarVBO )
+	{
+		glDeleteBuffers( 1, &m_scalarVBO );
+		m_scalarVBO = 0;
+		m_uploadedFrame = -1;
+		GL::CheckGLError("MeshObject::destroy()");
+	}
+}
+
 //-----------------------------------------------------------------------------
 double MeshObject::projectVertexNormal( unsigned idx, float x, float y, float z ) const
 {
@@ -204,27 +240,24 @@ void MeshObject::selectVertices( const std::vector<unsigned>& idx, bool selected
 		m_selectionAttribBuffer.clear();
 		m_selectionAttribBuffer.resize( numVerts, 0.0 );
 	}
-	// Set selected vertices to 1.0
-	for( unsigned i=0; i < idx.size(); i++ )
-	{	
-		unsigned id = idx[i];
-		if( id < numVerts ) {
-			m_selectionAttribBuffer[id] = selected ? 1.f : 0.f;
 
-			if( selected )
-			{
-				// Add index to selected set
-				m_selectedVertices.insert( id );
-			}
-			else
-			{
-				// Remove index from selected set
-				std::set<unsigned>::iterator it = m_selectedVertices.find( id );
-				if( it != m_selectedVertices.end() )
-					m_selectedVertices.erase( it );
-			}
+	// Set selected vertices to 1.0 (or 0.0 when deselecting)
+	std::vector<unsigned> valid;
+	valid.reserve( idx.size() );
+	for( unsigned i=0; i < idx.size(); i++ )
+		if( idx[i] < numVerts )
+		{
+			m_selectionAttribBuffer[idx[i]] = selected ? 1.f : 0.f;
+			valid.push_back( idx[i] );
 		}
-	}
+
+	// Update selection set
+	VertexSelection& sel = m_selectionLayers[m_activeLayer];
+	if( selected )
+		sel.insert( valid );
+	else
+		sel.erase( valid );
+	m_selectedIndicesDirty = true;
 }
 
 //------------------------------------------------------------------------------
@@ -238,14 +271,82 @@ void MeshObject::selectVertex( unsigned idx, bool selected )
 //------------------------------------------------------------------------------
 void MeshObject::selectNone()
 {
-	m_selectedVertices.clear();
-	m_selectionAttribBuffer.clear();
-	m_selectionAttribBuffer.resize( numVertices(), 0.0 );
+	m_selectionLayers[m_activeLayer].clear();
+	updateSelectionBuffers();
+}
+
+//------------------------------------------------------------------------------
+void MeshObject::growSelection( int rings )
+{
+	if( !m_mesh ) return;
+	m_selectionLayers[m_activeLayer].grow( *m_mesh, rings );
+	updateSelectionBuffers();
+}
+
+//------------------------------------------------------------------------------
+void MeshObject::shrinkSelection( int rings )
+{
+	if( !m_mesh ) return;
+	m_selectionLayers[m_activeLayer].shrink( *m_mesh, rings );
+	updateSelectionBuffers();
+}
+
+//------------------------------------------------------------------------------
+const VertexSelection& MeshObject::getSelectedVertices() const
+{
+	static const VertexSelection empty;
+	SelectionLayers::const_iterator it = m_selectionLayers.find( m_activeLayer );
+	return (it != m_selectionLayers.end()) ? it->second : empty;
+}
+
+//------------------------------------------------------------------------------
+void MeshObject::setSelectedVertices( const VertexSelection& selection )
+{
+	m_selectionLayers[m_activeLayer] = selection;
+	updateSelectionBuffers();
+}
+
+//------------------------------------------------------------------------------
+void MeshObject::setActiveSelectionLayer( std::string name )
+{
+	m_activeLayer = name;
+	m_selectionLayers[m_activeLayer]; // Create if not existing
+	updateSelectionBuffers();
+}
+
+//------------------------------------------------------------------------------
+std::vector<std::string> MeshObject::selectionLayers() const
+{
+	std::vector<std::string> names;
+	SelectionLayers::const_iterator it = m_selectionLayers.begin();
+	for( ; it != m_selectionLayers.end(); ++it )
+		names.push_back( it->first );
+	return names;
+}
+
+//------------------------------------------------------------------------------
+void MeshObject::removeSelectionLayer( std::string name )
+{
+	m_selectionLayers.erase( name );
+	if( name == m_activeLayer )
+		updateSelectionBuffers();
+}
+
+//------------------------------------------------------------------------------
+void MeshObject::updateSelectionBuffers()
+{
+	const VertexSelection& sel = getSelectedVertices();
+	sel.toMask( m_selectionAttribBuffer, numVertices() );
+	sel.toIndices( m_selectedIndices );
+	m_selectedIndicesDirty = false;
 }
 
 //------------------------------------------------------------------------------
 void MeshObject::setScalars( const std::vector<float>& scalars, bool autoscale )
 {
+	// Show these scalars instead of a per frame channel
+	m_activeScalarChannel.clear();
+
 	m_scalarAttribBuffer.clear();
 	m_scalarAttribBuffer.insert( m_scalarAttribBuffer.begin(),
 		scalars.begin(), scalars.end() );
@@ -253,17 +354,13 @@ void MeshObject::setScalars( const std::vector<float>& scalars, bool autoscale )
 	if( autoscale )
 	{
 		// Find min/max value
-		float minval=std::numeric_limits<float>::max(),
-			  maxval=-minval;	
-		for( unsigned int i=0; i < scalars.size(); i++ )
-		{
-			maxval = scalars[i] > maxval ? scalars[i] : maxval;
-			minval = scalars[i] < minval ? scalars[i] : minval;
-		}
+		float minval=0.f, maxval=1.f;
+		if( !scalars.empty() )
+			ScalarStatistics::minmax( &scalars[0], scalars.size(), minval, maxval );
 
 		// Set parameters to rescale to [0,1] inside shader
 		m_scalarShift = -minval;
-		m_scalarScale = 1.f / (maxval - minval);		
+		m_scalarScale = (maxval > minval) ? 1.f / (maxval - minval) : 1.f;
 	}
 }
 
@@ -275,6 +372,141 @@ void MeshObject::setScalarShiftScale( float shift, float scale )
 	//std::cout << "Scalars shift=" << m_scalarShift << ", scale=" << m_scalarScale << std::endl;
 }
 
+//------------------------------------------------------------------------------
+bool MeshObject::setScalarChannel( std::string name, const std::vector<float>& values )
+{
+	size_t size = (size_t)m_meshBuffer.numFrames() * m_meshBuffer.numVertices();
+	if( values.size() != size )
+	{
+		std::cerr << "MeshObject::setScalarChannel() : Size mismatch, expected "
+			<< size << " values but got " << values.size() << "!" << std::endl;
+		return false;
+	}
+
+	ScalarChannel& channel = m_scalarChannels[name];
+	channel.values   = values;
+	channel.revision = ++m_scalarRevision;
+	return true;
+}
+
+//------------------------------------------------------------------------------
+bool MeshObject::setScalarChannelFrame( std::string name, int frame, const std::vector<float>& values )
+{
+	size_t n = m_meshBuffer.numVertices();
+	if( frame < 0 || frame >= (int)m_meshBuffer.numFrames() || values.size() != n )
+	{
+		std::cerr << "MeshObject::setScalarChannelFrame() : Invalid frame or size mismatch!" << std::endl;
+		return false;
+	}
+
+	ScalarChannel& channel = m_scalarChannels[name];
+	channel.values.resize( (size_t)m_meshBuffer.numFrames() * n, 0.f );
+	std::copy( values.begin(), values.end(), channel.values.begin() + (size_t)frame*n );
+	channel.revision = ++m_scalarRevision;
+	return true;
+}
+
+//------------------------------------------------------------------------------
+void MeshObject::removeScalarChannel( std::string name )
+{
+	m_scalarChannels.erase( name );
+}
+
+//------------------------------------------------------------------------------
+std::vector<std::string> MeshObject::scalarChannels() const
+{
+	std::vector<std::string> names;
+	ScalarChannels::const_iterator it = m_scalarChannels.begin();
+	for( ; it != m_scalarChannels.end(); ++it )
+		names.push_back( it->first );
+	return names;
+}
+
+//------------------------------------------------------------------------------
+void MeshObject::setActiveScalarChannel( std::string name )
+{
+	m_activeScalarChannel = name;
+}
+
+//------------------------------------------------------------------------------
+bool MeshObject::scalarChannelRange( std::string name, int frame, float& minval, float& maxval ) const
+{
+	ScalarChannels::const_iterator it = m_scalarChannels.find( name );
+	size_t n = m_meshBuffer.numVertices();
+	if( it == m_scalarChannels.end() || frame < 0 
+		|| it->second.values.size() < (size_t)(frame+1)*n )
+		return false;
+
+	return ScalarStatistics::minmax( &it->second.values[(size_t)frame*n], n, minval, maxval );
+}
+
+//------------------------------------------------------------------------------
+void MeshObject::autoscaleScalars( float outlierFraction )
+{
+	// Values of active channel over all frames or static scalars
+	const std::vector<float>* values = &m_scalarAttribBuffer;
+	ScalarChannels::const_iterator it = m_scalarChannels.find( m_activeScalarChannel );
+	if( it != m_scalarChannels.end() )
+		values = &it->second.values;
+
+	float lo, hi;
+	if( values->empty() ||
+		!ScalarStatistics::percentileRange( &(*values)[0], values->size(), 
+		                                    outlierFraction, 1.f - outlierFraction, lo, hi ) )
+		return;
+
+	m_scalarShift = -lo;
+	m_scalarScale = (hi > lo) ? 1.f / (hi - lo) : 1.f;
+}
+
+//------------------------------------------------------------------------------
+const float* MeshObject::activeChannelFrame() const
+{
+	if( m_activeScalarChannel.empty() )
+		return NULL;
+
+	ScalarChannels::const_iterator it = m_scalarChannels.find( m_activeScalarChannel );
+	size_t n     = m_meshBuffer.numVertices();
+	int    frame = std::max( m_meshBuffer.curFrame(), 0 );
+	if( it == m_scalarChannels.end() || n == 0
+		|| it->second.values.size() < (size_t)(frame+1)*n )
+		return NULL;
+
+	return &it->second.values[(size_t)frame*n];
+}
+
+//------------------------------------------------------------------------------
+void MeshObject::uploadScalarChannel()
+{
+	const float* data = activeChannelFrame();
+	if( !data )
+		return;
+
+	const ScalarChannel& channel = m_scalarChannels[m_activeScalarChannel];
+	int frame = std::max( m_meshBuffer.curFrame(), 0 );
+
+	if( !m_scalarVBO )
+	{
+		glGenBuffers( 1, &m_scalarVBO );
+		GL::CheckGLError("MeshObject::uploadScalarChannel() - glGenBuffers()");
+	}
+	else
+	if( m_uploadedChannel  == m_activeScalarChannel &&
+		m_uploadedFrame    == frame &&
+		m_uploadedRevision == channel.revision )
+		return; // Up to date
+
+	glBindBuffer( GL_ARRAY_BUFFER, m_scalarVBO );
+	glBufferData( GL_ARRAY_BUFFER, sizeof(float)*m_meshBuffer.numVertices(), data,
+		GL_STREAM_DRAW );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	GL::CheckGLError("MeshObject::uploadScalarChannel()");
+
+	m_uploadedChannel  = m_activeScalarChannel;
+	m_uploadedFrame    = frame;
+	m_uploadedRevision = channel.revision;
+}
+
 //------------------------------------------------------------------------------
 meshtools::Mesh* MeshObject::createMesh( int frame ) /*const*/
 {
@@ -4,11 +4,14 @@
 #define SCENE_MESHOBJECT_H
 
 #include "scene.h"
-#include <set>
+#include <map>
+#include <string>
 #include <boost/shared_ptr.hpp>
 #include <meshtools.h>
 #include "MeshBuffer.h"
 #include "MeshShader.h"
+#include "MeshPicker.h"
+#include "VertexSelection.h"
 
 namespace scene {
 
@@ -35,12 +38,21 @@ public:
 	enum Shaders { NoShader, DefaultShader };
 
 	MeshObject()
-	: m_shaderMode( DefaultShader )
+	: m_shaderMode( DefaultShader ),
+	  m_scalarShift( 0.f ),
+	  m_scalarScale( 1.f ),
+	  m_scalarRevision( 0 ),
+	  m_scalarVBO( 0 ),
+	  m_uploadedFrame( -1 ),
+	  m_uploadedRevision( 0 ),
+	  m_activeLayer( "default" ),
+	  m_selectedIndicesDirty( false )
 	{}
 
 	///@{ Implementation of \a scene::Object
 	void render( int flags=Object::RenderDefault );
 	BoundingBox getBoundingBox() const;
+	void destroy();
 	///@}
 	
 	/// Render specified vertices as GL_POINTS. (No index check is performed.)
@@ -102,6 +114,9 @@ public:
 	/// meshBuffer()->createMesh() after setting the color information.
 	meshtools::Mesh* createMesh( int frame=-1 ) /*const*/;
 
+	/// CPU picking on current frame, see \a MeshPicker
+	MeshPicker& picker() { return m_picker; }
+
 	/// Wrap \a MeshBuffer::projectVertexNormal()
 	double projectVertexNormal( unsigned idx, float x, float y, float z ) const;
 
@@ -109,24 +124,68 @@ public:
 	void selectVertices( const std::vector<unsigned>&, bool selected=true );
 	void selectVertex( unsigned idx, bool selected=true );	
 	void selectNone();
-	std::set<unsigned> getSelectedVertices() const { return m_selectedVertices; }
+	/// Grow current selection by vertex one-ring neighbourhoods
+	void growSelection( int rings=1 );
+	/// Shrink current selection by vertex one-ring neighbourhoods
+	void shrinkSelection( int rings=1 );
+	/// Current selection, i.e. selection of active layer
+	const VertexSelection& getSelectedVertices() const;
+	/// Replace current selection, e.g. by result of set operations on layers
+	void setSelectedVertices( const VertexSelection& selection );
+	///@}
+
+	///@{ Named selection layers, only the active layer is edited and rendered
+	/// Set active layer, a new empty layer is created if name does not exist
+	void setActiveSelectionLayer( std::string name );
+	std::string activeSelectionLayer() const { return m_activeLayer; }
+	std::vector<std::string> selectionLayers() const;
+	/// Access layer by name, a new empty layer is created if name does not exist
+	VertexSelection& selectionLayer( std::string name ) { return m_selectionLayers[name]; }
+	void removeSelectionLayer( std::string name );
 	///@}
 
 	/// Set scalar field on vertices (e.g. used for color-coding in shader)
 	/// Automatically adjust value shift scale to min/max scalar range.
+	/// Deactivates the active scalar channel, see \a setActiveScalarChannel().
 	void setScalars( const std::vector<float>& scalars, bool autoscale=true );
 
 	std::vector<float>& scalars() { return m_scalarAttribBuffer; }
 	void setScalarShiftScale( float shift, float scale );
 
+	///@{ Per frame scalar channels
+	/// Set named channel with numFrames() x numVertices() values, stored frame
+	/// after frame. Replaces an existing channel of the same name. Returns
+	/// false on size mismatch.
+	bool setScalarChannel( std::string name, const std::vector<float>& values );
+	/// Set values of a single frame, the channel is created if not existing.
+	bool setScalarChannelFrame( std::string name, int frame, const std::vector<float>& values );
+	void removeScalarChannel( std::string name );
+	std::vector<std::string> scalarChannels() const;
+	/// Color-code given channel, replacing the scalars set via \a setScalars()
+	/// while active. An empty name switches back to these scalars.
+	void setActiveScalarChannel( std::string name );
+	std::string activeScalarChannel() const { return m_activeScalarChannel; }
+	/// Value range of a channel frame, returns false if not available
+	bool scalarChannelRange( std::string name, int frame, float& minval, float& maxval ) const;
+	/// Adjust shift-scale to the value range of the active channel over all
+	/// frames (or of the static scalars). The given fraction of outliers is
+	/// ignored at both ends, 0 corresponds to the min/max range.
+	void autoscaleScalars( float outlierFraction=0.f );
+	///@}
+
 	/// Recompile the used \a MeshShader from source
 	bool reloadShader();
 
 	MeshShader& meshShader() { return m_shader; }
 
 private:
+	// Non-copyable, owns GL buffer object
+	MeshObject( const MeshObject& );
+	MeshObject& operator=( const MeshObject& );
+
 	boost::shared_ptr<meshtools::Mesh> m_mesh;  ///< Reference mesh (1st frame of an animation sequence)
 	MeshBuffer m_meshBuffer; ///< Buffer objects and rendering functionality
+	MeshPicker m_picker;     ///< Ray-cast picking, kept in sync with mesh buffer
 
 	int m_shaderMode; ///< See enum \a Shaders
 	MeshShader m_shader; ///< GLSL shader with support for selection and scalar vertex attributes
@@ -136,7 +195,37 @@ private:
 
 	float m_scalarShift, m_scalarScale; // Shift-scale scalars to [0,1]
 
-	std::set<unsigned> m_selectedVertices; ///< Indices of currently selected vertices
+	/// Scalar values per frame, streamed to GPU for current frame only
+	struct ScalarChannel
+	{
+		std::vector<float> values;   ///< numFrames x numVertices values
+		unsigned           revision; ///< Changed on each modification
+	};
+	typedef std::map<std::string,ScalarChannel> ScalarChannels;
+	ScalarChannels m_scalarChannels;
+	std::string    m_activeScalarChannel;
+	unsigned       m_scalarRevision;
+
+	// Lazy upload of active channel, only on change of frame or channel
+	GLuint      m_scalarVBO; ///< GL buffer object id, 0 if not yet created
+	std::string m_uploadedChannel;
+	int         m_uploadedFrame;
+	unsigned    m_uploadedRevision;
+
+	/// Values of active channel in current frame, NULL if not available
+	const float* activeChannelFrame() const;
+	/// Make sure the scalar buffer object contains the current frame
+	void uploadScalarChannel();
+
+	typedef std::map<std::string,VertexSelection> SelectionLayers;
+	SelectionLayers m_selectionLayers; ///< Named vertex selections
+	std::string     m_activeLayer;     ///< Name of currently edited selection layer
+
+	std::vector<unsigned> m_selectedIndices; ///< Sorted indices of active selection for rendering
+	bool m_selectedIndicesDirty;
+
+	/// Update selection attribute and index buffers from active layer
+	void updateSelectionBuffers();
 };
 
 } // namespace scene 
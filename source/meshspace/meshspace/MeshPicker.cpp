@@ -0,0 +1,229 @@
+// MeshPicker, part of scene - minimalistic scene graph library
+#include "MeshPicker.h"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+using Intersect::Ray;
+using Intersect::Vec3;
+
+namespace scene {
+
+//-----------------------------------------------------------------------------
+MeshPicker::View::View( const double* mvp, int width_, int height_ )
+: modelViewProjection( Eigen::Map<const Eigen::Matrix4d>( mvp ) ),
+  width ( std::max( width_,  1 ) ),
+  height( std::max( height_, 1 ) )
+{
+	inverse = modelViewProjection.inverse();
+}
+
+//-----------------------------------------------------------------------------
+Ray MeshPicker::View::ray( double x, double y ) const
+{
+	double ndcx = 2.*x / width - 1.,
+	       ndcy = 1. - 2.*y / height;
+
+	Eigen::Vector4d pnear = inverse * Eigen::Vector4d( ndcx, ndcy, -1., 1. ),
+	                pfar  = inverse * Eigen::Vector4d( ndcx, ndcy,  1., 1. );
+	pnear /= pnear(3);
+	pfar  /= pfar (3);
+
+	return Ray( Vec3( pnear(0), pnear(1), pnear(2) ),
+	            Vec3( pfar(0)-pnear(0), pfar(1)-pnear(1), pfar(2)-pnear(2) ) );
+}
+
+//-----------------------------------------------------------------------------
+bool MeshPicker::View::project( const float* p, double& x, double& y, double& z ) const
+{
+	Eigen::Vector4d clip = modelViewProjection * Eigen::Vector4d( p[0], p[1], p[2], 1. );
+	if( clip(3) <= 0. )
+		return false;
+
+	x = (clip(0)/clip(3) + 1.) * .5 * width;
+	y = (1. - clip(1)/clip(3)) * .5 * height;
+	z =  clip(2)/clip(3);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+MeshPicker::MeshPicker()
+: m_valid(false),
+  m_frame(-1),
+  m_vdata(NULL),
+  m_vsize(0),
+  m_isize(0),
+  m_epsilon(0.)
+{}
+
+//-----------------------------------------------------------------------------
+void MeshPicker::sync( const MeshBuffer& mb )
+{
+	int frame = std::max( mb.curFrame(), 0 );
+	const float* vdata = mb.vbuffer().empty() ? NULL : &mb.vbuffer()[0];
+
+	if( m_valid && m_frame == frame && m_vdata == vdata
+		&& m_vsize == mb.vbuffer().size() && m_isize == mb.ibuffer().size() )
+		return;
+
+	m_valid = true;
+	m_frame = frame;
+	m_vdata = vdata;
+	m_vsize = mb.vbuffer().size();
+	m_isize = mb.ibuffer().size();
+
+	// Vertices of current frame
+	size_t n   = mb.numVertices(),
+	       ofs = (size_t)frame*3*n;
+	std::vector<double> vertices;
+	if( mb.vbuffer().size() >= ofs + 3*n )
+		vertices.assign( mb.vbuffer().begin() + ofs, mb.vbuffer().begin() + ofs + 3*n );
+
+	// Ray offset relative to bounding box diagonal
+	double bmin[3] = { 0.,0.,0. }, bmax[3] = { 0.,0.,0. };
+	for( size_t i=0; i < vertices.size(); i++ )
+	{
+		int d = (int)(i%3);
+		if( i < 3 || vertices[i] < bmin[d] ) bmin[d] = vertices[i];
+		if( i < 3 || vertices[i] > bmax[d] ) bmax[d] = vertices[i];
+	}
+	m_epsilon = 1e-5 * sqrt( (bmax[0]-bmin[0])*(bmax[0]-bmin[0])
+	                       + (bmax[1]-bmin[1])*(bmax[1]-bmin[1])
+	                       + (bmax[2]-bmin[2])*(bmax[2]-bmin[2]) );
+
+	// Point clouds result in an empty hierarchy
+	if( vertices.empty() )
+		m_bvh.build( vertices, std::vector<unsigned>() );
+	else
+		m_bvh.build( vertices, mb.ibuffer() );
+}
+
+//-----------------------------------------------------------------------------
+bool MeshPicker::pickPoint( const MeshBuffer& mb, const View& view, double x, double y,
+	double* point )
+{
+	sync( mb );
+
+	TriangleBVH::Hit hit = m_bvh.intersect( view.ray( x, y ) );
+	if( !hit.valid() )
+		return false;
+
+	Vec3 p = m_bvh.hitPoint( hit );
+	point[0] = p.x;
+	point[1] = p.y;
+	point[2] = p.z;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+bool MeshPicker::isVisible( const float* p, const float* n, double x, double y,
+	const View& view ) const
+{
+	// Segment from vertex to near plane along its viewing ray
+	Vec3 origin( p[0], p[1], p[2] ),
+	     dir = view.ray( x, y ).origin - origin;
+
+	// Back-facing?
+	if( n && n[0]*dir.x + n[1]*dir.y + n[2]*dir.z <= 0. )
+		return false;
+
+	// Occluded? Offset start of segment to skip adjacent triangles.
+	double len = sqrt( dir.dot( dir ) );
+	if( len <= 0. )
+		return true;
+	return !m_bvh.intersect( Ray( origin, dir ), m_epsilon / len, 1. ).valid();
+}
+
+//-----------------------------------------------------------------------------
+bool MeshPicker::pickRectangle( const MeshBuffer& mb, const View& view,
+	int x0, int y0, int x1, int y1, std::vector<unsigned>& selected, bool visibleOnly )
+{
+	selected.clear();
+	sync( mb );
+
+	unsigned n = mb.numVertices();
+	size_t ofs = (size_t)m_frame*3*n;
+	if( n==0 || mb.vbuffer().size() < ofs + 3*n )
+	{
+		std::cerr << "MeshPicker::pickRectangle() : Invalid mesh buffer!" << std::endl;
+		return false;
+	}
+	const float* vb = &mb.vbuffer()[ofs];
+	const float* nb = (mb.nbuffer().size() >= ofs + 3*n) ? &mb.nbuffer()[ofs] : NULL;
+
+	if( x0 > x1 ) std::swap( x0, x1 );
+	if( y0 > y1 ) std::swap( y0, y1 );
+
+	// Frustum planes of rectangle in world coordinates, derived from the
+	// clip space conditions -w <= x,y,z <= w restricted to the rectangle
+	double xl = 2.*x0 / view.width - 1.,
+	       xr = 2.*x1 / view.width - 1.,
+	       yt = 1. - 2.*y0 / view.height,
+	       yb = 1. - 2.*y1 / view.height;
+
+	const Eigen::Matrix4d& M = view.modelViewProjection;
+	Eigen::Vector4d r0 = M.row(0).transpose(), r1 = M.row(1).transpose(),
+	                r2 = M.row(2).transpose(), r3 = M.row(3).transpose();
+	Eigen::Vector4d frustum[6] = {
+		r0 - xl*r3, xr*r3 - r0,
+		r1 - yb*r3, yt*r3 - r1,
+		r3 + r2,    r3 - r2 };
+
+	double planes[6][4];
+	for( int i=0; i < 6; i++ )
+		for( int j=0; j < 4; j++ )
+			planes[i][j] = frustum[i](j);
+
+	// Candidate vertices are those of triangles overlapping the frustum
+	std::vector<unsigned> candidates;
+	const MeshBuffer::IndexBuffer& ib = mb.ibuffer();
+	if( ib.empty() )
+	{
+		candidates.resize( n );
+		for( unsigned i=0; i < n; i++ )
+			candidates[i] = i;
+	}
+	else
+	{
+		std::vector<int> faces;
+		m_bvh.queryPlanes( planes, 6, faces );
+
+		std::vector<char> marked( n, 0 );
+		for( size_t i=0; i < faces.size(); i++ )
+			for( int k=0; k < 3; k++ )
+			{
+				unsigned idx = ib[ 3*faces[i] + k ];
+				if( !marked[idx] )
+				{
+					marked[idx] = 1;
+					candidates.push_back( idx );
+				}
+			}
+	}
+
+	// Test candidates in parallel
+	int numCandidates = (int)candidates.size();
+	std::vector<char> inside( numCandidates, 0 );
+	#pragma omp parallel for schedule(dynamic,256)
+	for( int i=0; i < numCandidates; i++ )
+	{
+		const float* p = vb + 3*candidates[i];
+		double x, y, z;
+		if( !view.project( p, x, y, z ) )
+			continue;
+		if( x < x0 || x > x1 || y < y0 || y > y1 || z < -1. || z > 1. )
+			continue;
+		if( visibleOnly && !isVisible( p, nb ? nb + 3*candidates[i] : NULL, x, y, view ) )
+			continue;
+		inside[i] = 1;
+	}
+
+	for( int i=0; i < numCandidates; i++ )
+		if( inside[i] )
+			selected.push_back( candidates[i] );
+	std::sort( selected.begin(), selected.end() );
+
+	return true;
+}
+
+} // namespace scene
@@ -0,0 +1,100 @@
+// MeshPicker, part of scene - minimalistic scene graph library
+#ifndef SCENE_MESHPICKER_H
+#define SCENE_MESHPICKER_H
+
+#include <MeshBuffer.h>
+#include <TriangleBVH.h>
+#include <Eigen/Dense>
+#include <vector>
+
+namespace scene {
+
+//-----------------------------------------------------------------------------
+// 	MeshPicker
+//-----------------------------------------------------------------------------
+/**
+	\brief CPU ray-cast picking on a \a MeshBuffer, no OpenGL required.
+
+	Keeps a \a TriangleBVH of the current frame of a mesh buffer which is
+	rebuilt lazily when the frame or the vertex buffer changes. Call
+	\a invalidate() after modifying vertex data in place, e.g. via
+	\a MeshBuffer::normalizeSize().
+
+	Queries are given a \a View, i.e. the combined modelview-projection matrix
+	and the viewport size of the camera. Window coordinates have their origin
+	in the upper left corner (as in Qt).
+
+	A rectangle selection is answered as frustum query: the BVH culls all
+	triangles outside the frustum spanned by the rectangle, the vertices of
+	the remaining triangles are tested in parallel (OpenMP). Optionally only
+	vertices on front faces which are not occluded are selected, where
+	occlusion is tested by casting a ray from the vertex towards the camera.
+	Point clouds (without index buffer) are supported without occlusion test.
+*/
+class MeshPicker
+{
+public:
+	/// Camera parameters for picking
+	struct View
+	{
+		EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+		Eigen::Matrix4d modelViewProjection;
+		Eigen::Matrix4d inverse; ///< Inverse of modelViewProjection
+		int width, height;       ///< Viewport size in pixels
+
+		View()
+		: modelViewProjection(Eigen::Matrix4d::Identity()),
+		  inverse(Eigen::Matrix4d::Identity()),
+		  width(1), height(1)
+		{}
+		/// Construct from column-major matrix as used by OpenGL
+		View( const double* mvp, int width_, int height_ );
+
+		/// Ray through window position, origin on near plane, dir to far plane
+		Intersect::Ray ray( double x, double y ) const;
+		/// Project point to window coordinates and NDC depth, returns false
+		/// if point lies behind the camera.
+		bool project( const float* p, double& x, double& y, double& z ) const;
+	};
+
+	MeshPicker();
+
+	/// Force rebuild of the hierarchy on next query
+	void invalidate() { m_valid = false; }
+
+	/// Closest surface point under window position of current frame, returns
+	/// false if no surface was hit.
+	bool pickPoint( const MeshBuffer& mb, const View& view, double x, double y,
+	                double* point );
+
+	/// Vertices of current frame inside window rectangle [x0,x1]x[y0,y1].
+	/// If visibleOnly is set only non-occluded vertices on front faces are
+	/// returned. Returns false on invalid mesh buffer.
+	bool pickRectangle( const MeshBuffer& mb, const View& view,
+	                    int x0, int y0, int x1, int y1,
+	                    std::vector<unsigned>& selected, bool visibleOnly=true );
+
+	/// Hierarchy of current frame of given mesh buffer
+	const TriangleBVH& bvh( const MeshBuffer& mb ) { sync( mb ); return m_bvh; }
+
+protected:
+	/// Rebuild hierarchy if frame or buffers changed
+	void sync( const MeshBuffer& mb );
+
+	/// Returns true if vertex is on a front face and not occluded
+	bool isVisible( const float* p, const float* n, double x, double y,
+	                const View& view ) const;
+
+private:
+	TriangleBVH  m_bvh;
+	bool         m_valid;
+	int          m_frame;
+	const float* m_vdata;
+	size_t       m_vsize, m_isize;
+	double       m_epsilon; ///< Ray offset, relative to bounding box diagonal
+};
+
+} // namespace scene
+
+#endif // SCENE_MESHPICKER_H
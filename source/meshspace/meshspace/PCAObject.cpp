@@ -6,9 +6,14 @@
 
 namespace scene {
 	
-void PCAObject::derivePCAModelFrom( const MeshObject& mo )
+void PCAObject::derivePCAModelFrom( const MeshObject& mo, ProgressReporter* progress )
 {	
-	computePCA( const_cast<MeshObject&>(mo).meshBuffer(), meshBuffer(), m_pca, m_mshape );
+	derivePCAModelFrom( const_cast<MeshObject&>(mo).meshBuffer(), progress );
+}
+
+void PCAObject::derivePCAModelFrom( MeshBuffer& samples, ProgressReporter* progress )
+{	
+	computePCA( samples, meshBuffer(), m_pca, m_mshape, progress );
 
 	MeshObject::setMesh( &m_mshape, true );
 }
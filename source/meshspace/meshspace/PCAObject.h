@@ -21,7 +21,9 @@ public:
 	{}
 
 	/// Compute PCA model for given mesh sequence
-	void derivePCAModelFrom( const MeshObject& mo );
+	void derivePCAModelFrom( const MeshObject& mo, ProgressReporter* progress=NULL );
+	/// Compute PCA model for given mesh buffer (e.g. a copy of a mesh sequence)
+	void derivePCAModelFrom( MeshBuffer& samples, ProgressReporter* progress=NULL );
 
 	///@{ Reimplemented from MeshObject, show i-th eigenmode plus mean shape
 	void setFrame( int i );
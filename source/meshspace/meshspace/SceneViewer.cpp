@@ -7,6 +7,7 @@
 #include "PCAObject.h"
 #include "TensorfieldObject.h"
 #include "Crossvalidate.h"
+#include "CovarianceClustering.h"
 
 #include <qfileinfo.h>
 #include <QDebug>
@@ -19,6 +20,7 @@
 #include <QMessageBox>
 #include <QInputDialog>
 #include <QFileInfo>
+#include <QDir>
 
 #include <fstream>
 
@@ -52,6 +54,14 @@ SceneViewer::SceneViewer( QWidget* parent )
 	connect( m_propertiesWidget, SIGNAL(redrawRequired()), this, SLOT(updateScene()) );
 	connect( m_propertiesWidget, SIGNAL(modelChanged()), this, SLOT(updateModel()) );
 
+	// --- Background jobs ---
+
+	m_scheduler = new JobScheduler( 2, this );
+
+	connect( m_scheduler, SIGNAL(jobStarted(int)), this, SLOT(onJobStarted(int)) );
+	connect( m_scheduler, SIGNAL(jobProgress(int,double)), this, SLOT(onJobProgress(int,double)) );
+	connect( m_scheduler, SIGNAL(jobFinished(int)), this, SLOT(onJobFinished(int)) );
+
 	// --- Actions ---
 	// Shortcut description is also added to QGLViewer help.
 
@@ -63,6 +73,14 @@ SceneViewer::SceneViewer( QWidget* parent )
 	actSelectFrontFaces->setCheckable( true );
 	actSelectFrontFaces->setChecked( m_selectFrontFaces );
 
+	QAction* actGrowSelection = new QAction(tr("Grow selection"),this);
+	actGrowSelection->setShortcut( Qt::CTRL + Qt::Key_Plus );
+	QGLViewer::setKeyDescription( Qt::CTRL + Qt::Key_Plus, "Grow vertex selection by one-ring" );
+
+	QAction* actShrinkSelection = new QAction(tr("Shrink selection"),this);
+	actShrinkSelection->setShortcut( Qt::CTRL + Qt::Key_Minus );
+	QGLViewer::setKeyDescription( Qt::CTRL + Qt::Key_Minus, "Shrink vertex selection by one-ring" );
+
 	QAction* actExportSelection = new QAction(tr("Export selection..."),this);
 
 	QAction* actReloadShaders = new QAction(tr("Reload shaders"),this);
@@ -80,12 +98,15 @@ SceneViewer::SceneViewer( QWidget* parent )
 	QAction* actExportCovariance = new QAction(tr("Export covariance tensor field to Nrrd"),this);
 	QAction* actCrossvalidate = new QAction(tr("Cross-validate gamma on current PCA model"),this);
 	QAction* actComputeEigenmodes = new QAction(tr("Compute eigenmodes"),this);
+	QAction* actCancelJobs = new QAction(tr("Cancel background computations"),this);
 
 	QAction* actExportMatrix = new QAction(tr("Export current mesh vertex matrix as text file"),this);
 	QAction* actImportMatrix = new QAction(tr("Import mesh vertex matrix, replacing vertices of current mesh"),this);
 
 	connect( actSelectNone, SIGNAL(triggered()), this, SLOT(selectNone()) );
 	connect( actSelectFrontFaces, SIGNAL(toggled(bool)), this, SLOT(selectFrontFaces(bool)) );
+	connect( actGrowSelection, SIGNAL(triggered()), this, SLOT(growSelection()) );
+	connect( actShrinkSelection, SIGNAL(triggered()), this, SLOT(shrinkSelection()) );
 	connect( actExportSelection, SIGNAL(triggered()), this, SLOT(exportSelection()) );
 	connect( actReloadShaders, SIGNAL(triggered()), this, SLOT(reloadShaders()) );
 	connect( actNormalizeScale, SIGNAL(triggered()), this, SLOT(normalizeScale()) );
@@ -100,9 +121,12 @@ SceneViewer::SceneViewer( QWidget* parent )
 	connect( actExportMatrix, SIGNAL(triggered()), this, SLOT(exportMatrix()) );
 	connect( actImportMatrix, SIGNAL(triggered()), this, SLOT(importMatrix()) );	
 	connect( actComputeEigenmodes, SIGNAL(triggered()), this, SLOT(computeEigenmodes()) );
+	connect( actCancelJobs, SIGNAL(triggered()), this, SLOT(cancelJobs()) );
 
 	m_actions.push_back( actSelectNone );
 	m_actions.push_back( actSelectFrontFaces );
+	m_actions.push_back( actGrowSelection );
+	m_actions.push_back( actShrinkSelection );
 	m_actions.push_back( actExportSelection );
 	m_actions.push_back( actExportSelection );
 	m_actions.push_back( genSeparator(this) );
@@ -124,6 +148,16 @@ SceneViewer::SceneViewer( QWidget* parent )
 	m_actions.push_back( actLoadCovariance );
 	m_actions.push_back( actExportCovariance );
 	m_actions.push_back( actCrossvalidate );
+	m_actions.push_back( genSeparator(this) );
+	m_actions.push_back( actCancelJobs );
+}
+
+SceneViewer::~SceneViewer()
+{
+	// Release GL resources of all objects while our context still exists
+	makeCurrent();
+	for( unsigned i=0; i < m_scene.objects().size(); i++ )
+		m_scene.objects().at(i)->destroy();
 }
 
 QWidget* SceneViewer::getInspector()
@@ -151,6 +185,9 @@ QString SceneViewer::helpString() const
 
 void SceneViewer::removeObject( int idx )
 {
+	// Release GL resources here, a background job may still hold the object
+	makeCurrent();
+	m_scene.objects().at( idx )->destroy();
 	m_scene.removeSceneObject( idx );
 	updateModel();
 	updateBoundingBox();
@@ -598,11 +635,6 @@ void SceneViewer::draw()
 // Selection
 //----------------------------------------------------------------------------
 
-// We currently select only vertices on front faces. More convenient would be
-// to perform selection only on closest surface to viewer. Sadly, deciding
-// which points are on closest surface based on depth value is not working yet.
-//#define SCENEVIEWER_SELECTION_DEPTH_DISAMBIGUATION
-
 void SceneViewer::selectNone()
 {
 	// De-select vertices
@@ -611,6 +643,20 @@ void SceneViewer::selectNone()
 	updateGL();
 }
 
+void SceneViewer::growSelection()
+{
+	if( currentMeshObject() ) 
+		currentMeshObject()->growSelection();
+	updateGL();
+}
+
+void SceneViewer::shrinkSelection()
+{
+	if( currentMeshObject() ) 
+		currentMeshObject()->shrinkSelection();
+	updateGL();
+}
+
 void SceneViewer::selectFrontFaces( bool enable )
 {
 	m_selectFrontFaces = enable;
@@ -628,8 +674,7 @@ void SceneViewer::exportSelection()
 	}
 
 	// Get selection
-	typedef std::set<unsigned> Selection;
-	Selection selection = mo->getSelectedVertices();
+	const VertexSelection& selection = mo->getSelectedVertices();
 	if( selection.empty() )
 	{
 		QMessageBox::warning( this, tr("Export selection warning"),
@@ -653,121 +698,39 @@ void SceneViewer::exportSelection()
 		return;
 	}
 
-	std::cout << "Selection:" << std::endl;
-	for( Selection::const_iterator it=selection.begin(); it!=selection.end(); ++it )
-	{
-		std::cout << (*it) << std::endl; // DEBUG
-		f << *it << std::endl;
-	}
+	std::vector<unsigned> idx;
+	selection.toIndices( idx );
+	for( size_t i=0; i < idx.size(); i++ )
+		f << idx[i] << std::endl;
 
 	f.close();
 }
 
-void SceneViewer::drawWithNames()
-{
-	using namespace scene;
-
-	// Draw each object with a different name (for object selection)
-	//m_scene.render( Object::RenderSurface | Object::RenderNames );
-
-	// Draw each vertex of current mesh with a different name (for vertex selection)
-	if( currentMeshObject() )
-	{
-		currentMeshObject()->render( Object::RenderPoints | Object::RenderNames );
-	}
-}
-
-void SceneViewer::endSelection( const QPoint& point )
+void SceneViewer::selectBrush( const QRect& rect )
 {
-	// See: http://www.libqglviewer.com/examples/multiSelect.html
-
-	// Flush GL buffers
-	glFlush();
-
-	// Get the number of objects that were seen through the pick matrix frustum. Reset GL_RENDER mode.
-	GLint nbHits = glRenderMode(GL_RENDER);
-
-	// Find 3D intersection with closest surface point
-	bool found;
-	qglviewer::Vec selectedPoint;
-	m_selectedPoint = QGLViewer::camera()->pointUnderPixel( point, found );
-
-	// Intersection ray
-	qglviewer::Vec ray_origin, ray_dir;
-	QGLViewer::camera()->convertClickToLine( point, ray_origin, ray_dir );
-	ray_dir.normalize();
-
-#ifdef SCENEVIEWER_SELECTION_DEPTH_DISAMBIGUATION
-	// Find depth value of closest surface (assuming render mode is surface)
-	unsigned depth, depth2;
-	const unsigned zrange = std::numeric_limits<unsigned>::max(); // (unsigned)0x7fffffff
-	
-	// Variant 2: Project intersection point again
-	qglviewer::Vec 
-		windowPoint = QGLViewer::camera()->projectedCoordinatesOf( m_selectedPoint );
-	depth2 = m_selectedPoint.z * zrange;
-
-	// Variant 1: Read depth manually from depth buffer
-	updateGL();
-	glReadPixels( point.x(), point.y(), 1,1, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, (void*)&depth );
-#endif
-
 	// Vertex selection is currently only implemented for MeshObjects
 	scene::MeshObject* meshObject = currentMeshObject();
 	if( !meshObject )
-		return;	
-	
-	// Get selection
-	std::vector<unsigned> selected;
-	if (nbHits > 0)
-	{
-		// Interpret results : each object created 4 values in the selectBuffer().
-		// (selectBuffer())[4*i+3] is the id pushed on the stack.
-		for( int i=0; i<nbHits; ++i )
-		{
-			unsigned id = (selectBuffer())[4*i+3];
-			
-			bool discard = false;
-
-			// Only consider points on front-facing surfaces
-			if( m_selectFrontFaces )
-			{
-				// Check if hit point is front-facing
-				double sign = meshObject->projectVertexNormal( id, 
-					                ray_origin.x, ray_origin.y, ray_origin.z );
-
-				// Discard back-facing points
-				if( sign < 0.1 )
-					discard = true;
-			}
-
-		  #ifdef SCENEVIEWER_SELECTION_DEPTH_DISAMBIGUATION
-			// Only consider points on closest surface
-			if( false )			
-			{
-				// Debug hit record
-				GLuint hitrec[4];			
-				memcpy( (void*)&hitrec[0], (void*)&((selectBuffer())[4*i]), sizeof(GLuint)*4 );
+		return;
 
-				// Window depth of closest hit
-				unsigned min_depth = (selectBuffer())[4*i+1];
-				double thresh  = abs((double)depth - (double)min_depth) / (double)zrange;
-				double thresh2 = abs((double)min_depth - (double)depth2) / (double)zrange;
+	// Picking is done on the CPU via scene::MeshPicker, which avoids the
+	// GL_SELECT render pass and depth buffer readback.
+	GLdouble mvp[16];
+	QGLViewer::camera()->getModelViewProjectionMatrix( mvp );
+	scene::MeshPicker::View view( mvp, width(), height() );
 
-				// Skip points far away from closest surface
-				//if( fabs(dist) > 0.001f )
-				//	discard = true;
+	scene::MeshPicker& picker = meshObject->picker();
+	const MeshBuffer& mb = meshObject->meshBuffer();
 
-				qDebug() << id << ": min-depth = " << (unsigned)(selectBuffer())[4*i+1] << ", t1 = " << thresh << ", t2 = " << thresh2 << ", sign = " << sign;
-			}
-		  #endif
-
-			if( discard )
-				continue;
+	// Find 3D intersection with closest surface point
+	double p[3];
+	if( picker.pickPoint( mb, view, rect.center().x(), rect.center().y(), p ) )
+		m_selectedPoint = qglviewer::Vec( p[0], p[1], p[2] );
 
-			selected.push_back( id );
-		}
-	}
+	// Get selection, optionally only visible vertices on front faces
+	std::vector<unsigned> selected;
+	picker.pickRectangle( mb, view, rect.left(), rect.top(), rect.right(), rect.bottom(),
+	                      selected, m_selectFrontFaces );
 
 	// Apply selection
 	switch( m_selectionMode )
@@ -776,14 +739,6 @@ void SceneViewer::endSelection( const QPoint& point )
 	case SelectRemove : meshObject->selectVertices( selected, false );	break;
 	default: break;
 	}
-
-	// DEBUG
-	if( m_selectionMode==SelectAdd && !selected.empty())
-	{
-		qDebug() << "Selected vertices:";
-		for( int i=0; i < selected.size(); i++ )
-			qDebug() << selected[i];
-	}
 }
 
 //----------------------------------------------------------------------------
@@ -800,7 +755,7 @@ void SceneViewer::mouseMoveEvent( QMouseEvent* e )
 		m_brushRectangle = m_brushRectangle.normalized();
 
 		// Update selection while mouse is moving
-		QGLViewer::select( m_brushRectangle.center() );	
+		selectBrush( m_brushRectangle );
 		updateGL();
 	}
 
@@ -1013,18 +968,238 @@ void SceneViewer::computeDistance()
 	if( !mo_source || !mo_target )
 		return;
 
-	Mesh* source = mo_source->meshBuffer().createMesh();
 	Mesh* target = mo_target->meshBuffer().createMesh();
 
-	std::vector<float> dist;
-	filters::closestPointDistance( *source, *target, dist );
+	// Distance of each source frame to target, stored as per frame channel
+	// to allow playback of the error map along the animation
+	std::vector<float> values;
+	for( unsigned frame=0; frame < mo_source->numFrames(); frame++ )
+	{
+		Mesh* source = mo_source->meshBuffer().createMesh( frame );
 
-	mo_source->setScalars( dist );
+		std::vector<float> dist;
+		filters::closestPointDistance( *source, *target, dist );
+		values.insert( values.end(), dist.begin(), dist.end() );
+
+		delete source;
+	}
+
+	if( mo_source->setScalarChannel( "distance", values ) )
+	{
+		mo_source->setActiveScalarChannel( "distance" );
+		mo_source->autoscaleScalars( 0.01f );
+	}
 
-	delete source;
 	delete target;
 }
 
+//----------------------------------------------------------------------------
+// Background jobs
+//----------------------------------------------------------------------------
+
+namespace {
+
+/// Task creating a new scene object, which is added to the scene when finished
+class SceneObjectTask : public Task<scene::MeshObject*>
+{
+public:
+	SceneObjectTask( std::string name ): Task<scene::MeshObject*>( name ) {}
+	~SceneObjectTask() { delete m_result; }
+
+	/// Transfer ownership of result to caller
+	scene::MeshObject* takeObject()
+	{
+		scene::MeshObject* obj = m_result;
+		m_result = NULL;
+		return obj;
+	}
+};
+
+/// Derive PCA model from a copy of a mesh buffer
+class PCATask : public SceneObjectTask
+{
+public:
+	PCATask( const MeshBuffer& samples, std::string name )
+	: SceneObjectTask( name ), m_samples( samples )
+	{}
+
+protected:
+	scene::MeshObject* compute()
+	{
+		scene::PCAObject* pco = new scene::PCAObject;
+		pco->derivePCAModelFrom( m_samples, this );
+		pco->setName( name() );
+		return (scene::MeshObject*)pco;
+	}
+
+private:
+	MeshBuffer m_samples;
+};
+
+/// Derive covariance tensor field from a copy of a PCA model
+class TensorfieldTask : public SceneObjectTask
+{
+public:
+	TensorfieldTask( const PCAModel& pca, int mode, double gamma, double scale,
+		             std::string cachePath, std::string name )
+	: SceneObjectTask( name ),
+	  m_pca( pca ),
+	  m_mode( mode ),
+	  m_gamma( gamma ),
+	  m_scale( scale ),
+	  m_cachePath( cachePath )
+	{}
+
+protected:
+	scene::MeshObject* compute()
+	{
+		scene::TensorfieldObject* tfo = new scene::TensorfieldObject;
+		tfo->setCachePath( m_cachePath );
+		tfo->deriveTensorsFromPCAModel( m_pca, m_mode, m_gamma, m_scale, this );
+		tfo->setName( name() );
+		return (scene::MeshObject*)tfo;
+	}
+
+private:
+	PCAModel    m_pca;
+	int         m_mode;
+	double      m_gamma, m_scale;
+	std::string m_cachePath;
+};
+
+/// Cluster a copy of a tensor field, labels are applied when finished
+class ClusteringTask : public Task< std::vector<unsigned> >
+{
+public:
+	ClusteringTask( scene::ObjectPtr tfo, const Eigen::MatrixXd& S, const Eigen::Matrix3Xd& pts,
+		            CovarianceClustering::ClusterParms parms )
+	: Task< std::vector<unsigned> >( "Clustering of " + tfo->getName() ),
+	  m_tfo( tfo ),
+	  m_S( S ),
+	  m_pts( pts ),
+	  m_parms( parms )
+	{}
+
+	scene::TensorfieldObject* tensorfield() const
+	{
+		return dynamic_cast<scene::TensorfieldObject*>( m_tfo.get() );
+	}
+
+	int numClusters() const { return m_parms.k; }
+
+protected:
+	std::vector<unsigned> compute()
+	{
+		CovarianceClustering cl;
+		cl.compute( m_S, m_pts, m_parms, this );
+		return cl.getLabels();
+	}
+
+private:
+	scene::ObjectPtr   m_tfo; ///< Keeps tensor field alive until job is finished
+	Eigen::MatrixXd    m_S;
+	Eigen::Matrix3Xd   m_pts;
+	CovarianceClustering::ClusterParms m_parms;
+};
+
+/// Cross-validate gamma on data matrix, results are printed to the console
+class CrossvalidationTask : public Task<bool>
+{
+public:
+	CrossvalidationTask( const Eigen::MatrixXd& X, const std::vector<double>& gamma )
+	: Task<bool>( "Cross-validation" ),
+	  m_X( X ),
+	  m_gamma( gamma )
+	{}
+
+protected:
+	bool compute()
+	{
+		std::vector<double> error, baseline;
+		crossvalidate( m_X, m_gamma, error, baseline, this );
+		if( isCancelled() )
+			return false;
+
+		// Print results
+		using namespace std;
+		cout << "Cross-validation result:" << endl;
+		for( unsigned i=0; i < error.size(); i++ )
+			cout << m_gamma[i] << ", " << error[i] << endl;	
+		cout << "Baseline error:" << endl;
+		for( unsigned i=0; i < baseline.size(); i++ )
+			cout << baseline[i] << endl;
+		return true;
+	}
+
+private:
+	Eigen::MatrixXd     m_X;
+	std::vector<double> m_gamma;
+};
+
+} // anonymous namespace
+
+void SceneViewer::submitJob( JobPtr job )
+{
+	m_jobs.insert( job->id(), job );
+	m_scheduler->enqueue( job );
+	emit statusMessage( tr("Queued %1").arg( job->name().c_str() ), 0 );
+}
+
+void SceneViewer::cancelJobs()
+{
+	m_scheduler->cancelAll();
+}
+
+void SceneViewer::onJobStarted( int id )
+{
+	if( !m_jobs.contains(id) )
+		return;
+	emit statusMessage( tr("Started %1").arg( m_jobs[id]->name().c_str() ), 0 );
+}
+
+void SceneViewer::onJobProgress( int id, double progress )
+{
+	if( !m_jobs.contains(id) )
+		return;
+	emit statusMessage( tr("%1 (%2%)").arg( m_jobs[id]->name().c_str() )
+		.arg( (int)(100.*progress) ), 0 );
+}
+
+void SceneViewer::onJobFinished( int id )
+{
+	JobPtr job = m_jobs.take( id );
+	if( !job.get() )
+		return;
+
+	QString name( job->name().c_str() );
+	switch( job->state() )
+	{
+	case Job::Cancelled: 
+		emit statusMessage( tr("Cancelled %1").arg( name ), 5000 ); 
+		return;
+	case Job::Failed:
+		emit statusMessage( tr("Failed %1 : %2").arg( name ).arg( job->error().c_str() ), 5000 );
+		return;
+	default:
+		emit statusMessage( tr("Finished %1").arg( name ), 5000 );
+		break;
+	}
+
+	// Add resulting scene object
+	SceneObjectTask* sot = dynamic_cast<SceneObjectTask*>( job.get() );
+	if( sot )
+		addMeshObject( sot->takeObject() );
+
+	// Update tensor visualization and optionally transfer labels to mesh
+	ClusteringTask* ct = dynamic_cast<ClusteringTask*>( job.get() );
+	if( ct && ct->tensorfield() )
+	{
+		ct->tensorfield()->setClusters( ct->result(), ct->numClusters() );
+		transferClusterLabels( ct->result(), ct->numClusters() );
+		updateScene();
+	}
+}
+
 void SceneViewer::computePCA()
 {
 	using scene::MeshObject;
@@ -1034,12 +1209,8 @@ void SceneViewer::computePCA()
 	if( !mo )
 		return;
 
-	PCAObject* pco = new PCAObject;
-	pco->derivePCAModelFrom( *mo );
-
-	pco->setName( std::string("PCA Model of ") + mo->getName() );
-
-	addMeshObject( (MeshObject*)pco );
+	submitJob( JobPtr( new PCATask( mo->meshBuffer(),
+		std::string("PCA Model of ") + mo->getName() ) ) );
 }
 
 void SceneViewer::computeCovariance()
@@ -1098,12 +1269,13 @@ void SceneViewer::computeCovariance()
 			return;
 	}
 
-	// Create tensorfield object
-	TensorfieldObject* tfo = new TensorfieldObject;
-	tfo->deriveTensorsFromPCAModel( pco->getPCAModel(), mode, gamma, scale );
-	tfo->setName( modes.at(mode).toStdString() + std::string(" of ") + pco->getName() );
+	// Create tensorfield object, results are cached across sessions
+	QString cachePath = QDir::tempPath() + "/meshspace-cache";
+	QDir().mkpath( cachePath );
 
-	addMeshObject( (MeshObject*)tfo );
+	submitJob( JobPtr( new TensorfieldTask( pco->getPCAModel(), mode, gamma, scale,
+		cachePath.toStdString(),
+		modes.at(mode).toStdString() + std::string(" of ") + pco->getName() ) ) );
 }
 
 void SceneViewer::loadCovariance()
@@ -1166,9 +1338,7 @@ void SceneViewer::computeCrossValidation()
 		return;
 
 	// FIXME: Hard-coded test
-	std::vector<double> gamma, 
-		                error,
-						baseline;
+	std::vector<double> gamma;
 	//gamma[ 0] = 10000000;
 	//gamma[ 1] =  5000000;
 	//gamma[ 2] =  2000000;
@@ -1198,27 +1368,16 @@ void SceneViewer::computeCrossValidation()
 	gamma.push_back( 0.001 );
 	gamma.push_back( 0.0005 );
 
-	unsigned numSamples = (unsigned)gamma.size();
-
 	// HACK: Assemble data matrix from PCA model
 	Eigen::MatrixXd X = pco->getPCAModel().X;
 	for( unsigned col=0; col < X.cols(); col++ )
 		X.col(col) += pco->getPCAModel().mu;
 
-	// Perform cross validation (expensive!)
-	crossvalidate( X, gamma, error, baseline );
-
-	// Print results
-	using namespace std;
-	cout << "Cross-validation result:" << endl;
-	for( unsigned i=0; i < error.size(); i++ )
-		cout << gamma[i] << ", " << error[i] << endl;	
-	cout << "Baseline error:" << endl;
-	for( unsigned i=0; i < baseline.size(); i++ )
-		cout << baseline[i] << endl;
+	// Perform cross validation in background (expensive!), results are
+	// printed to the console.
+	submitJob( JobPtr( new CrossvalidationTask( X, gamma ) ) );
 }
 
-#include "CovarianceClustering.h"
 void SceneViewer::computeClustering()
 {
 	using scene::TensorfieldObject;
@@ -1245,12 +1404,14 @@ void SceneViewer::computeClustering()
 	parms.weightPointDist = QInputDialog::getDouble( this, tr("Clustering parameters"),
 		tr("Weight factor for Point distance"), parms.weightPointDist, 0.0, 1000000.0, 2 );
 	
-	// Compute clustering
-	CovarianceClustering cl;
-	cl.compute( tfo->getTensorField(), tfo->getPositions(), parms );
-	
-	// Update tensor visualization
-	tfo->setClusters( cl.getLabels(), parms.k );
+	// Compute clustering in background, results are applied in onJobFinished()
+	scene::ObjectPtr obj = m_scene.objects().at( selectedObject() );
+	submitJob( JobPtr( new ClusteringTask( obj, tfo->getTensorField(), tfo->getPositions(), parms ) ) );
+}
+
+void SceneViewer::transferClusterLabels( const std::vector<unsigned>& labels, int k )
+{
+	using scene::MeshObject;
 
 	// Transfer to mesh buffer
 	bool ok;
@@ -1273,17 +1434,17 @@ void SceneViewer::computeClustering()
 		{
 			MeshObject* mo = dynamic_cast<MeshObject*>( m_scene.objects().at(selIdx).get() );
 			if( !mo )
-				qDebug() << "SceneViewer::computeClustering() : Transfer selection is not a mesh!";				
+				qDebug() << "SceneViewer::transferClusterLabels() : Transfer selection is not a mesh!";				
 			else
 			{
-				if( mo->numVertices() != cl.getLabels().size() )
-					qDebug() << "SceneViewer::computeClustering() : Mismatch between mesh and cluster label size!";
+				if( mo->numVertices() != labels.size() )
+					qDebug() << "SceneViewer::transferClusterLabels() : Mismatch between mesh and cluster label size!";
 				else
 				{
 					// Set mesh scalars according to cluster index
-					std::vector<float> scalars( cl.getLabels().size() );
-					for( unsigned i=0; i < cl.getLabels().size(); i++ )
-						scalars[i] = (float)cl.getLabels().at(i) / (parms.k-1);
+					std::vector<float> scalars( labels.size() );
+					for( unsigned i=0; i < labels.size(); i++ )
+						scalars[i] = (float)labels.at(i) / (k-1);
 					mo->setScalars( scalars );
 				}
 			}
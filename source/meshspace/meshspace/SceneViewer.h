@@ -9,6 +9,7 @@
 #include <QItemSelection>
 #include <QRect>
 #include <QList>
+#include <QMap>
 
 #include <glutils/PhongShader.h>
 #include "MeshShader.h"
@@ -16,6 +17,7 @@
 #include "scene.h"
 #include "MeshObject.h"
 #include "meshtools.h"
+#include "JobScheduler.h"
 
 class ObjectPropertiesWidget;
 class ObjectBrowserWidget;
@@ -40,6 +42,7 @@ class SceneViewer : public QGLViewer
 
 public:
 	SceneViewer( QWidget* parent=0 );
+	~SceneViewer();
 
 	QList<QAction*> getActions() { return m_actions; }
 	
@@ -67,6 +70,13 @@ public slots:
 	/// Write current mesh to disk.
 	void saveMesh( QString filename );
 
+	/// Cancel all pending and running background jobs.
+	void cancelJobs();
+
+signals:
+	/// Status information, e.g. on progress of background jobs
+	void statusMessage( QString msg, int timeout );
+
 protected slots:
 	void updateModel();
 	void updateScene();
@@ -78,6 +88,8 @@ protected slots:
 	int  selectedObject() const; // Returns index of currently selected row in list view
 
 	void selectNone();
+	void growSelection();
+	void shrinkSelection();
 	void selectFrontFaces(bool);
 	void exportSelection();
 
@@ -100,16 +112,18 @@ protected slots:
 	void importMatrix();
 
 	void removeObject(int);
+
+	///@{ Background job notifications (see \a JobScheduler)
+	void onJobStarted( int id );
+	void onJobProgress( int id, double progress );
+	void onJobFinished( int id );
+	///@}
 	
 protected:
 	///@{ QGLViewer implementation
 	void draw();
 	void init();
 	QString helpString() const;
-	// Selection stuff
-	void drawWithNames();
-	//void postSelection( const QPoint& point );
-	void endSelection( const QPoint& point );
 	///@}
 
 	///@{ Custom mouse events
@@ -134,8 +148,17 @@ protected:
 
 	///@{ Selection / brush functions
 	void drawSelectionRectangle() const;
+	/// Add or remove vertices inside brush rectangle to current mesh object
+	/// (depending on selection mode).
+	void selectBrush( const QRect& rect );
 	///@}
 
+	/// Submit a long running computation to the background job scheduler
+	void submitJob( JobPtr job );
+
+	/// Color a user selected mesh object according to cluster labels
+	void transferClusterLabels( const std::vector<unsigned>& labels, int k );
+
 private:
 	scene::Scene       m_scene; ///< The scene to be rendered
 	QStandardItemModel m_model; ///< A model for manipulating the scenegraph
@@ -150,6 +173,9 @@ private:
 
 	QList<QAction*> m_actions;
 
+	JobScheduler*     m_scheduler; ///< Executes long running analyses
+	QMap<int,JobPtr>  m_jobs;      ///< Submitted jobs not yet finished
+
 	float m_pointSize; ///< Point size for point cloud rendering, change via via mouse wheel + alt
 };
 
@@ -0,0 +1,559 @@
+// SoftwareRenderer, part of scene - minimalistic scene graph library
+#include "SoftwareRenderer.h"
+#include "TransferFunction.h"
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFTWARERENDERER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const unsigned NoTriangle = std::numeric_limits<unsigned>::max();
+
+/// Evaluate three edge functions at 4 horizontally adjacent pixels starting
+/// with values e[i] and horizontal increments A[i]. Stores the edge values in
+/// w[i*4+lane] and returns a coverage bit mask (bit set if lane is inside).
+inline int edgeMask4( const float* e, const float* A, float* w )
+{
+#ifdef SOFTWARERENDERER_SSE2
+	const __m128 ofs  = _mm_set_ps( 3.f, 2.f, 1.f, 0.f );
+	const __m128 zero = _mm_setzero_ps();
+	__m128 w0 = _mm_add_ps( _mm_set1_ps(e[0]), _mm_mul_ps( _mm_set1_ps(A[0]), ofs ) ),
+	       w1 = _mm_add_ps( _mm_set1_ps(e[1]), _mm_mul_ps( _mm_set1_ps(A[1]), ofs ) ),
+	       w2 = _mm_add_ps( _mm_set1_ps(e[2]), _mm_mul_ps( _mm_set1_ps(A[2]), ofs ) );
+	__m128 inside = _mm_and_ps( _mm_and_ps( _mm_cmpge_ps( w0, zero ),
+	                                        _mm_cmpge_ps( w1, zero ) ),
+	                                        _mm_cmpge_ps( w2, zero ) );
+	_mm_storeu_ps( w+0, w0 );
+	_mm_storeu_ps( w+4, w1 );
+	_mm_storeu_ps( w+8, w2 );
+	return _mm_movemask_ps( inside );
+#else
+	int mask = 0;
+	for( int l=0; l < 4; l++ )
+	{
+		w[0+l] = e[0] + A[0]*l;
+		w[4+l] = e[1] + A[1]*l;
+		w[8+l] = e[2] + A[2]*l;
+		if( w[0+l] >= 0.f && w[4+l] >= 0.f && w[8+l] >= 0.f )
+			mask |= (1 << l);
+	}
+	return mask;
+#endif
+}
+
+inline float clamp01( float v )
+{
+	return v < 0.f ? 0.f : (v > 1.f ? 1.f : v);
+}
+
+inline void normalize3( float* v )
+{
+	float len = sqrt( v[0]*v[0] + v[1]*v[1] + v[2]*v[2] );
+	if( len > 0.f )
+	{
+		v[0] /= len; v[1] /= len; v[2] /= len;
+	}
+}
+
+inline float dot3( const float* a, const float* b )
+{
+	return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+}
+
+int numThreads()
+{
+#ifdef USE_OPENMP
+	return omp_get_max_threads();
+#else
+	return 1;
+#endif
+}
+
+int threadNum()
+{
+#ifdef USE_OPENMP
+	return omp_get_thread_num();
+#else
+	return 0;
+#endif
+}
+
+} // anonymous namespace
+
+namespace scene {
+
+//-----------------------------------------------------------------------------
+bool SoftwareRenderer::Image::savePPM( std::string filename ) const
+{
+	std::ofstream of( filename.c_str(), std::ios_base::binary );
+	if( !of.is_open() )
+	{
+		std::cerr << "SoftwareRenderer::Image::savePPM() : Could not open "
+			<< filename << std::endl;
+		return false;
+	}
+	of << "P6\n" << width << " " << height << "\n255\n";
+	if( !rgb.empty() )
+		of.write( (const char*)&rgb[0], rgb.size() );
+	return of.good();
+}
+
+//-----------------------------------------------------------------------------
+SoftwareRenderer::SoftwareRenderer( int width, int height )
+: m_scalarShift( 0.f ),
+  m_scalarScale( 1.f ),
+  m_tf( NULL ),
+  m_mapScalars( false ),
+  m_znear( 0.1f ),
+  m_numTilesX( 0 ),
+  m_numTilesY( 0 ),
+  m_numBinThreads( 0 )
+{
+	setSize( width, height );
+	setBackground( 1.f, 1.f, 1.f );
+	setColor( 0.8f, 0.8f, 0.8f );
+	lookAt( Eigen::Vector3f(0.f,0.f,3.f), Eigen::Vector3f::Zero(), Eigen::Vector3f::UnitY() );
+	setPerspective( 30.f, 0.1f, 10.f );
+}
+
+//-----------------------------------------------------------------------------
+void SoftwareRenderer::setSize( int width, int height )
+{
+	m_width  = std::max( width,  1 );
+	m_height = std::max( height, 1 );
+}
+
+//-----------------------------------------------------------------------------
+void SoftwareRenderer::setBackground( float r, float g, float b )
+{
+	m_background[0] = r;
+	m_background[1] = g;
+	m_background[2] = b;
+}
+
+//-----------------------------------------------------------------------------
+void SoftwareRenderer::setColor( float r, float g, float b )
+{
+	m_color[0] = r;
+	m_color[1] = g;
+	m_color[2] = b;
+}
+
+//-----------------------------------------------------------------------------
+void SoftwareRenderer::setScalarShiftScale( float shift, float scale )
+{
+	m_scalarShift = shift;
+	m_scalarScale = scale;
+}
+
+//-----------------------------------------------------------------------------
+void SoftwareRenderer::lookAt( const Eigen::Vector3f& eye, const Eigen::Vector3f& center,
+	                           const Eigen::Vector3f& up )
+{
+	Eigen::Vector3f f = (center - eye).normalized(),
+	                s = f.cross( up ).normalized(),
+	                u = s.cross( f );
+
+	m_view.setIdentity();
+	m_view.block<1,3>(0,0) =  s.transpose();
+	m_view.block<1,3>(1,0) =  u.transpose();
+	m_view.block<1,3>(2,0) = -f.transpose();
+	m_view(0,3) = -s.dot( eye );
+	m_view(1,3) = -u.dot( eye );
+	m_view(2,3) =  f.dot( eye );
+}
+
+//-----------------------------------------------------------------------------
+void SoftwareRenderer::setPerspective( float fovy, float znear, float zfar )
+{
+	float f = 1.f / tan( 0.5f * fovy * 3.14159265f / 180.f );
+	float aspect = (float)m_width / (float)m_height;
+
+	m_proj.setZero();
+	m_proj(0,0) = f / aspect;
+	m_proj(1,1) = f;
+	m_proj(2,2) = (zfar + znear) / (znear - zfar);
+	m_proj(2,3) = 2.f*zfar*znear / (znear - zfar);
+	m_proj(3,2) = -1.f;
+
+	m_znear = znear;
+}
+
+//-----------------------------------------------------------------------------
+void SoftwareRenderer::fitView( const MeshBuffer& mb, int frame,
+	                            float azimuth, float elevation, float fovy )
+{
+	unsigned n = mb.numVertices();
+	const MeshBuffer::FloatBuffer& vb = mb.vbuffer();
+	size_t ofs = (size_t)frame*3*n;
+	if( n==0 || vb.size() < ofs + 3*n )
+		return;
+
+	// Bounding sphere (centered at bounding box center)
+	Eigen::Vector3f bmin = Eigen::Vector3f::Constant(  std::numeric_limits<float>::max() ),
+	                bmax = Eigen::Vector3f::Constant( -std::numeric_limits<float>::max() );
+	for( unsigned i=0; i < n; i++ )
+	{
+		Eigen::Vector3f p( vb[ofs+3*i], vb[ofs+3*i+1], vb[ofs+3*i+2] );
+		bmin = bmin.cwiseMin( p );
+		bmax = bmax.cwiseMax( p );
+	}
+	Eigen::Vector3f c = 0.5f*(bmin + bmax);
+	float r = 0.f;
+	for( unsigned i=0; i < n; i++ )
+	{
+		Eigen::Vector3f p( vb[ofs+3*i], vb[ofs+3*i+1], vb[ofs+3*i+2] );
+		r = std::max( r, (p - c).norm() );
+	}
+	if( r <= 0.f ) r = 1.f;
+
+	// Distance such that bounding sphere fits into vertical field of view
+	const float deg2rad = 3.14159265f / 180.f;
+	float d = 1.05f * r / sin( 0.5f*fovy*deg2rad );
+
+	Eigen::Vector3f dir( cos(elevation*deg2rad)*sin(azimuth*deg2rad),
+	                     sin(elevation*deg2rad),
+	                     cos(elevation*deg2rad)*cos(azimuth*deg2rad) );
+
+	lookAt( c + d*dir, c, Eigen::Vector3f::UnitY() );
+	setPerspective( fovy, std::max( d - 1.1f*r, 0.01f*d ), d + 1.1f*r );
+}
+
+//-----------------------------------------------------------------------------
+bool SoftwareRenderer::render( const MeshBuffer& mb, int frame, Image& img,
+	                           const std::vector<float>& scalars )
+{
+	// Sanity checks
+	unsigned n = mb.numVertices();
+	if( n==0 || frame < 0 || frame >= (int)mb.numFrames()
+		|| mb.vbuffer().size() < (size_t)(frame+1)*3*n )
+	{
+		std::cerr << "SoftwareRenderer::render() : Invalid mesh buffer or frame!" << std::endl;
+		return false;
+	}
+	if( mb.numIndices() < 3 )
+	{
+		std::cerr << "SoftwareRenderer::render() : Point clouds are not supported!" << std::endl;
+		return false;
+	}
+	m_mapScalars = m_tf && !scalars.empty();
+	if( m_mapScalars && scalars.size() != n )
+	{
+		std::cerr << "SoftwareRenderer::render() : Mismatch between number of "
+			"scalars and vertices!" << std::endl;
+		m_mapScalars = false;
+	}
+
+	img.width  = m_width;
+	img.height = m_height;
+	img.rgb.resize( 3*m_width*m_height );
+
+	transformVertices( mb, frame, scalars );
+	setupTriangles( mb );
+	binTriangles();
+
+	int numTiles = m_numTilesX * m_numTilesY;
+	#pragma omp parallel for schedule(dynamic)
+	for( int t=0; t < numTiles; t++ )
+		rasterizeTile( t % m_numTilesX, t / m_numTilesX, img );
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+void SoftwareRenderer::transformVertices( const MeshBuffer& mb, int frame,
+	                                      const std::vector<float>& scalars )
+{
+	int n = (int)mb.numVertices();
+	size_t ofs = (size_t)frame*3*n;
+	const MeshBuffer::FloatBuffer& vb = mb.vbuffer();
+
+	// Use stored normals if available, else average face normals
+	std::vector<float> fallbackNormals;
+	const float* normals = NULL;
+	if( mb.nbuffer().size() >= ofs + 3*n )
+		normals = &mb.nbuffer()[ofs];
+	else
+	{
+		const MeshBuffer::IndexBuffer& ib = mb.ibuffer();
+		fallbackNormals.assign( 3*n, 0.f );
+		for( size_t i=0; i+2 < ib.size(); i+=3 )
+		{
+			const float *p0 = &vb[ofs+3*ib[i]],
+			            *p1 = &vb[ofs+3*ib[i+1]],
+			            *p2 = &vb[ofs+3*ib[i+2]];
+			float e1[3] = { p1[0]-p0[0], p1[1]-p0[1], p1[2]-p0[2] },
+			      e2[3] = { p2[0]-p0[0], p2[1]-p0[1], p2[2]-p0[2] };
+			float fn[3] = { e1[1]*e2[2] - e1[2]*e2[1],
+			                e1[2]*e2[0] - e1[0]*e2[2],
+			                e1[0]*e2[1] - e1[1]*e2[0] };
+			for( int k=0; k < 3; k++ )
+				for( int d=0; d < 3; d++ )
+					fallbackNormals[3*ib[i+k]+d] += fn[d];
+		}
+		normals = &fallbackNormals[0];
+	}
+
+	Eigen::Matrix4f PV = m_proj * m_view;
+	Eigen::Matrix3f R  = m_view.topLeftCorner<3,3>();
+
+	m_vertices.resize( n );
+	#pragma omp parallel for
+	for( int i=0; i < n; i++ )
+	{
+		Eigen::Vector4f p( vb[ofs+3*i], vb[ofs+3*i+1], vb[ofs+3*i+2], 1.f );
+		Eigen::Vector4f pv   = m_view * p,
+		                clip = PV * p;
+		Eigen::Vector3f nv   = R * Eigen::Vector3f( normals[3*i], normals[3*i+1], normals[3*i+2] );
+
+		Vertex& v = m_vertices[i];
+		v.clipped = clip(3) < m_znear;
+		v.invW    = v.clipped ? 0.f : 1.f / clip(3);
+		v.sx      = (0.5f + 0.5f*clip(0)*v.invW) * m_width;
+		v.sy      = (0.5f - 0.5f*clip(1)*v.invW) * m_height;
+		v.sz      = clip(2)*v.invW;
+		for( int d=0; d < 3; d++ )
+		{
+			v.pos   [d] = pv(d);
+			v.normal[d] = nv(d);
+		}
+		v.scalar = m_mapScalars ? scalars[i] : 0.f;
+	}
+}
+
+//-----------------------------------------------------------------------------
+void SoftwareRenderer::setupTriangles( const MeshBuffer& mb )
+{
+	const MeshBuffer::IndexBuffer& ib = mb.ibuffer();
+	int numTriangles = (int)ib.size() / 3;
+
+	m_triangles.resize( numTriangles );
+	#pragma omp parallel for
+	for( int t=0; t < numTriangles; t++ )
+	{
+		Triangle& tri = m_triangles[t];
+		tri.valid = false;
+		for( int k=0; k < 3; k++ )
+			tri.v[k] = ib[3*t+k];
+
+		const Vertex &v0 = m_vertices[tri.v[0]],
+		             &v1 = m_vertices[tri.v[1]],
+		             &v2 = m_vertices[tri.v[2]];
+		if( v0.clipped || v1.clipped || v2.clipped )
+			continue;
+
+		// Edge function i is zero on the edge opposite to vertex i
+		tri.A[0] = v1.sy - v2.sy;  tri.B[0] = v2.sx - v1.sx;  tri.C[0] = v1.sx*v2.sy - v2.sx*v1.sy;
+		tri.A[1] = v2.sy - v0.sy;  tri.B[1] = v0.sx - v2.sx;  tri.C[1] = v2.sx*v0.sy - v0.sx*v2.sy;
+		tri.A[2] = v0.sy - v1.sy;  tri.B[2] = v1.sx - v0.sx;  tri.C[2] = v0.sx*v1.sy - v1.sx*v0.sy;
+
+		float area = tri.A[0]*v0.sx + tri.B[0]*v0.sy + tri.C[0];
+		if( fabs(area) < 1e-12f )
+			continue;
+
+		// Two-sided rendering, flip back-facing triangles
+		if( area < 0.f )
+		{
+			for( int k=0; k < 3; k++ )
+			{
+				tri.A[k] = -tri.A[k];
+				tri.B[k] = -tri.B[k];
+				tri.C[k] = -tri.C[k];
+			}
+			area = -area;
+		}
+		tri.invArea = 1.f / area;
+
+		// Screen bounding box
+		float xmin = std::min( v0.sx, std::min( v1.sx, v2.sx ) ),
+		      xmax = std::max( v0.sx, std::max( v1.sx, v2.sx ) ),
+		      ymin = std::min( v0.sy, std::min( v1.sy, v2.sy ) ),
+		      ymax = std::max( v0.sy, std::max( v1.sy, v2.sy ) );
+		tri.xmin = std::max( (int)floor(xmin), 0 );
+		tri.ymin = std::max( (int)floor(ymin), 0 );
+		tri.xmax = std::min( (int)ceil (xmax), m_width -1 );
+		tri.ymax = std::min( (int)ceil (ymax), m_height-1 );
+
+		tri.valid = tri.xmin <= tri.xmax && tri.ymin <= tri.ymax;
+	}
+}
+
+//-----------------------------------------------------------------------------
+void SoftwareRenderer::binTriangles()
+{
+	m_numTilesX = (m_width  + TileSize - 1) / TileSize;
+	m_numTilesY = (m_height + TileSize - 1) / TileSize;
+	int numTiles = m_numTilesX * m_numTilesY;
+
+	m_numBinThreads = numThreads();
+	m_bins.resize( m_numBinThreads * numTiles );
+	for( size_t i=0; i < m_bins.size(); i++ )
+		m_bins[i].clear();
+
+	// Each thread bins a contiguous range of triangles into its own bins,
+	// iterating bins in thread order thus preserves submission order.
+	int numTriangles = (int)m_triangles.size();
+	#pragma omp parallel
+	{
+		int tid = threadNum();
+		#pragma omp for schedule(static)
+		for( int t=0; t < numTriangles; t++ )
+		{
+			const Triangle& tri = m_triangles[t];
+			if( !tri.valid )
+				continue;
+
+			for( int ty=tri.ymin/TileSize; ty <= tri.ymax/TileSize; ty++ )
+				for( int tx=tri.xmin/TileSize; tx <= tri.xmax/TileSize; tx++ )
+					m_bins[tid*numTiles + ty*m_numTilesX + tx].push_back( (unsigned)t );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+void SoftwareRenderer::rasterizeTile( int tx, int ty, Image& img ) const
+{
+	int x0 = tx*TileSize,
+	    y0 = ty*TileSize,
+	    x1 = std::min( x0 + (int)TileSize, m_width ),
+	    y1 = std::min( y0 + (int)TileSize, m_height );
+	int tile     = ty*m_numTilesX + tx;
+	int numTiles = m_numTilesX * m_numTilesY;
+
+	// Tile local depth and visibility buffer
+	std::vector<float>    depth( TileSize*TileSize, std::numeric_limits<float>::max() );
+	std::vector<unsigned> triId( TileSize*TileSize, NoTriangle );
+	std::vector<float>    bary ( 2*TileSize*TileSize );
+
+	for( int thread=0; thread < m_numBinThreads; thread++ )
+	{
+		const std::vector<unsigned>& bin = m_bins[thread*numTiles + tile];
+		for( size_t i=0; i < bin.size(); i++ )
+		{
+			const Triangle& tri = m_triangles[bin[i]];
+			float z0 = m_vertices[tri.v[0]].sz,
+			      z1 = m_vertices[tri.v[1]].sz,
+			      z2 = m_vertices[tri.v[2]].sz;
+
+			int rx0 = std::max( tri.xmin, x0 ),
+			    rx1 = std::min( tri.xmax, x1-1 ),
+			    ry0 = std::max( tri.ymin, y0 ),
+			    ry1 = std::min( tri.ymax, y1-1 );
+
+			for( int y=ry0; y <= ry1; y++ )
+			{
+				// Edge functions at first pixel center of this row
+				float e[3];
+				for( int k=0; k < 3; k++ )
+					e[k] = tri.A[k]*(rx0 + 0.5f) + tri.B[k]*(y + 0.5f) + tri.C[k];
+
+				for( int x=rx0; x <= rx1; x+=4 )
+				{
+					float w[12];
+					int mask = edgeMask4( e, tri.A, w );
+					if( rx1 - x < 3 )
+						mask &= (1 << (rx1 - x + 1)) - 1;
+
+					for( int l=0; mask; l++, mask >>= 1 )
+					{
+						if( !(mask & 1) )
+							continue;
+
+						float b0 = w[0+l]*tri.invArea,
+						      b1 = w[4+l]*tri.invArea,
+						      b2 = 1.f - b0 - b1;
+						float z  = b0*z0 + b1*z1 + b2*z2;
+
+						int idx = (y - y0)*TileSize + (x + l - x0);
+						if( z >= -1.f && z <= 1.f && z < depth[idx] )
+						{
+							depth[idx]     = z;
+							triId[idx]     = bin[i];
+							bary [2*idx]   = b0;
+							bary [2*idx+1] = b1;
+						}
+					}
+
+					for( int k=0; k < 3; k++ )
+						e[k] += 4.f*tri.A[k];
+				}
+			}
+		}
+	}
+
+	// Shade visible surface
+	unsigned char bg[3] = {
+		(unsigned char)(255.f*clamp01(m_background[0])),
+		(unsigned char)(255.f*clamp01(m_background[1])),
+		(unsigned char)(255.f*clamp01(m_background[2])) };
+	for( int y=y0; y < y1; y++ )
+		for( int x=x0; x < x1; x++ )
+		{
+			int idx = (y - y0)*TileSize + (x - x0);
+			unsigned char* rgb = &img.rgb[3*(y*m_width + x)];
+			if( triId[idx] == NoTriangle )
+			{
+				rgb[0] = bg[0]; rgb[1] = bg[1]; rgb[2] = bg[2];
+			}
+			else
+				shade( triId[idx], bary[2*idx], bary[2*idx+1],
+				       1.f - bary[2*idx] - bary[2*idx+1], rgb );
+		}
+}
+
+//-----------------------------------------------------------------------------
+void SoftwareRenderer::shade( unsigned t, float b0, float b1, float b2, unsigned char* rgb ) const
+{
+	const Triangle& tri = m_triangles[t];
+	const Vertex &v0 = m_vertices[tri.v[0]],
+	             &v1 = m_vertices[tri.v[1]],
+	             &v2 = m_vertices[tri.v[2]];
+
+	// Perspective correct interpolation weights
+	float p0 = b0*v0.invW,
+	      p1 = b1*v1.invW,
+	      p2 = b2*v2.invW,
+	      s  = 1.f / (p0 + p1 + p2);
+	p0 *= s; p1 *= s; p2 *= s;
+
+	float N[3], E[3];
+	for( int d=0; d < 3; d++ )
+	{
+		N[d] =   p0*v0.normal[d] + p1*v1.normal[d] + p2*v2.normal[d];
+		E[d] = -(p0*v0.pos[d]    + p1*v1.pos[d]    + p2*v2.pos[d]);
+	}
+	normalize3( N );
+	normalize3( E );
+
+	// Base color
+	float color[3] = { m_color[0], m_color[1], m_color[2] };
+	if( m_mapScalars )
+	{
+		float scalar = p0*v0.scalar + p1*v1.scalar + p2*v2.scalar;
+		m_tf->getColor( clamp01( (scalar + m_scalarShift)*m_scalarScale ),
+			color[0], color[1], color[2] );
+	}
+
+	// Two-sided Phong shading (see mesh.fs) with head light, i.e. L = E
+	const float* L = E;
+	float NL = dot3( N, L );
+	float R[3] = { 2.f*N[0]*NL - L[0], 2.f*N[1]*NL - L[1], 2.f*N[2]*NL - L[2] };
+	normalize3( R );
+
+	float diff = clamp01( std::max( (float)fabs(NL), 0.2f ) );
+	float spec = clamp01( 0.3f * (float)pow( fabs(dot3( R, E )), 32.f ) );
+	for( int d=0; d < 3; d++ )
+		rgb[d] = (unsigned char)( 255.f * clamp01( 0.2f*color[d] + 0.8f*diff*color[d] + spec ) );
+}
+
+} // namespace scene
@@ -0,0 +1,131 @@
+// SoftwareRenderer, part of scene - minimalistic scene graph library
+#ifndef SCENE_SOFTWARERENDERER_H
+#define SCENE_SOFTWARERENDERER_H
+
+#include <MeshBuffer.h>
+#include <Eigen/Dense>
+#include <string>
+#include <vector>
+
+class TransferFunction;
+
+namespace scene {
+
+//-----------------------------------------------------------------------------
+// 	SoftwareRenderer
+//-----------------------------------------------------------------------------
+/**
+	\brief Offscreen CPU rasterizer for \a MeshBuffer, no OpenGL required.
+
+	Intended for batch rendering of thumbnails and turntable sequences on
+	headless machines. Shading matches the two-sided Phong model of the mesh
+	shader, scalar vertex attributes are color coded via a \a TransferFunction
+	(only its CPU lookup \a TransferFunction::getColor() is used).
+
+	The pipeline is tile based and parallelized via OpenMP:
+	- Vertex stage: transform all vertices of the given frame.
+	- Setup and binning: compute edge functions per triangle and sort the
+	  triangles into screen tiles of \a TileSize x \a TileSize pixels.
+	- Raster stage: tiles are rasterized independently, evaluating the edge
+	  functions for 4 pixels at once (SSE2 if available). Only the visible
+	  triangle per pixel is shaded (deferred shading).
+
+	Triangles crossing the near plane are discarded, i.e. the camera should
+	not be inside the mesh, see \a fitView().
+*/
+class SoftwareRenderer
+{
+public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	enum { TileSize = 64 };
+
+	/// 8-bit RGB image, rows stored top to bottom
+	struct Image
+	{
+		int width, height;
+		std::vector<unsigned char> rgb;
+
+		Image(): width(0), height(0) {}
+		/// Write binary PPM (P6) file
+		bool savePPM( std::string filename ) const;
+	};
+
+	SoftwareRenderer( int width=512, int height=512 );
+
+	///@{ Render settings
+	void setSize( int width, int height );
+	void setBackground( float r, float g, float b );
+	/// Base color of surface without scalar mapping
+	void setColor( float r, float g, float b );
+	/// Set camera in world coordinates (as gluLookAt)
+	void lookAt( const Eigen::Vector3f& eye, const Eigen::Vector3f& center,
+	             const Eigen::Vector3f& up );
+	/// Set perspective projection (as gluPerspective), fovy in degrees
+	void setPerspective( float fovy, float znear, float zfar );
+	/// Place camera on a sphere around the bounding sphere of the given frame,
+	/// angles in degrees. Azimuth rotates around the y-axis (turntable).
+	void fitView( const MeshBuffer& mb, int frame=0,
+	              float azimuth=0.f, float elevation=20.f, float fovy=30.f );
+	/// Transfer function for scalar mapping (NULL to disable)
+	void setTransferFunction( const TransferFunction* tf ) { m_tf = tf; }
+	/// Shift-scale applied to scalars before lookup, see \a MeshObject
+	void setScalarShiftScale( float shift, float scale );
+	///@}
+
+	/// Render single frame of mesh buffer, optionally color coding per vertex
+	/// scalars (requires a transfer function). Returns false on invalid input.
+	bool render( const MeshBuffer& mb, int frame, Image& img,
+	             const std::vector<float>& scalars = std::vector<float>() );
+
+protected:
+	/// Transformed vertex
+	struct Vertex
+	{
+		float sx, sy, sz; ///< Screen coordinates and NDC depth
+		float invW;       ///< 1/w for perspective correct interpolation
+		float pos[3];     ///< View space position
+		float normal[3];  ///< View space normal
+		float scalar;
+		bool  clipped;    ///< Behind near plane
+	};
+
+	/// Edge function setup of a triangle
+	struct Triangle
+	{
+		float A[3], B[3], C[3]; ///< Edge functions E_i(x,y) = A_i*x + B_i*y + C_i
+		float invArea;
+		int   xmin, ymin, xmax, ymax;
+		unsigned v[3];
+		bool  valid;
+	};
+
+	void transformVertices( const MeshBuffer& mb, int frame, const std::vector<float>& scalars );
+	void setupTriangles( const MeshBuffer& mb );
+	void binTriangles();
+	void rasterizeTile( int tx, int ty, Image& img ) const;
+	void shade( unsigned tri, float b0, float b1, float b2, unsigned char* rgb ) const;
+
+private:
+	int   m_width, m_height;
+	float m_background[3];
+	float m_color[3];
+	float m_scalarShift, m_scalarScale;
+	const TransferFunction* m_tf;
+	bool  m_mapScalars;
+
+	Eigen::Matrix4f m_view, m_proj;
+	float m_znear;
+
+	// Per frame buffers
+	std::vector<Vertex>   m_vertices;
+	std::vector<Triangle> m_triangles;
+	int m_numTilesX, m_numTilesY;
+	/// Triangle bins per thread and tile, index [thread*numTiles + tile]
+	std::vector< std::vector<unsigned> > m_bins;
+	int m_numBinThreads;
+};
+
+} // namespace scene
+
+#endif // SCENE_SOFTWARERENDERER_H
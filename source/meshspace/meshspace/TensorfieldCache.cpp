@@ -0,0 +1,251 @@
+// TensorfieldCache, part of scene - minimalistic scene graph library
+#include "TensorfieldCache.h"
+#include <fstream>
+#include <iostream>
+#include <cstring> // memcmp()
+
+namespace {
+
+const char     TFCacheMagic[8] = { 'T','F','C','A','C','H','E','\0' };
+const unsigned TFCacheVersion  = 1;
+
+/// 64-bit FNV-1a hash
+class FNV1a
+{
+public:
+	FNV1a(): m_h( 14695981039346656037ULL ) {}
+
+	void add( const void* data, size_t size )
+	{
+		const unsigned char* p = (const unsigned char*)data;
+		for( size_t i=0; i < size; i++ )
+		{
+			m_h ^= p[i];
+			m_h *= 1099511628211ULL;
+		}
+	}
+
+	template<typename Derived>
+	void addMatrix( const Eigen::PlainObjectBase<Derived>& M )
+	{
+		unsigned dims[2] = { (unsigned)M.rows(), (unsigned)M.cols() };
+		add( dims, sizeof(dims) );
+		add( M.data(), M.size()*sizeof(typename Derived::Scalar) );
+	}
+
+	unsigned long long value() const { return m_h; }
+
+private:
+	unsigned long long m_h;
+};
+
+unsigned long long alignOffset( unsigned long long ofs, unsigned long long alignment )
+{
+	return ((ofs + alignment - 1) / alignment) * alignment;
+}
+
+} // anonymous namespace
+
+namespace scene {
+
+//-----------------------------------------------------------------------------
+TensorfieldCache::Hash TensorfieldCache::hashPCAModel( const PCAModel& pca, int mode, double gamma, double scale )
+{
+	FNV1a h;
+	h.add( &mode,  sizeof(int) );
+	h.add( &gamma, sizeof(double) );
+	h.add( &scale, sizeof(double) );
+	h.addMatrix( pca.mu );
+	h.addMatrix( pca.ev );
+	h.addMatrix( pca.PC );
+	h.addMatrix( pca.X );
+	return h.value();
+}
+
+//-----------------------------------------------------------------------------
+TensorfieldCache::TensorfieldCache()
+: m_hash( 0 )
+{}
+
+//-----------------------------------------------------------------------------
+void TensorfieldCache::clear()
+{
+	m_filename.clear();
+	m_hash = 0;
+	m_blocks.clear();
+	m_data.clear();
+}
+
+//-----------------------------------------------------------------------------
+void TensorfieldCache::addBlock( BlockId id, const Eigen::MatrixXd& M )
+{
+	BlockEntry e;
+	e.id     = (unsigned)id;
+	e.type   = TypeDouble;
+	e.rows   = (unsigned)M.rows();
+	e.cols   = (unsigned)M.cols();
+	e.offset = 0; // determined in write()
+	e.size   = (unsigned long long)M.size() * sizeof(double);
+	m_blocks.push_back( e );
+	m_data  .push_back( (const char*)M.data() );
+}
+
+//-----------------------------------------------------------------------------
+void TensorfieldCache::addBlock( BlockId id, const std::vector<unsigned>& labels )
+{
+	BlockEntry e;
+	e.id     = (unsigned)id;
+	e.type   = TypeUnsigned;
+	e.rows   = 1;
+	e.cols   = (unsigned)labels.size();
+	e.offset = 0; // determined in write()
+	e.size   = (unsigned long long)labels.size() * sizeof(unsigned);
+	m_blocks.push_back( e );
+	m_data  .push_back( labels.empty() ? NULL : (const char*)&labels[0] );
+}
+
+//-----------------------------------------------------------------------------
+bool TensorfieldCache::write( std::string filename )
+{
+	using namespace std;
+	ofstream of( filename, ios_base::binary );
+	if( !of.is_open() )
+	{
+		cerr << "TensorfieldCache::write() : Could not open "
+			 << filename << endl;
+		return false;
+	}
+
+	// Layout blocks behind header and directory
+	unsigned numBlocks = (unsigned)m_blocks.size();
+	unsigned long long ofs = sizeof(TFCacheMagic) + 2*sizeof(unsigned) + sizeof(Hash)
+	                       + numBlocks*sizeof(BlockEntry);
+	for( unsigned i=0; i < numBlocks; i++ )
+	{
+		ofs = alignOffset( ofs, BlockAlignment );
+		m_blocks[i].offset = ofs;
+		ofs += m_blocks[i].size;
+	}
+
+	// Header and directory
+	of.write( TFCacheMagic, sizeof(TFCacheMagic) );
+	of.write( (char*)&TFCacheVersion, sizeof(unsigned) );
+	of.write( (char*)&numBlocks, sizeof(unsigned) );
+	of.write( (char*)&m_hash, sizeof(Hash) );
+	if( numBlocks > 0 )
+		of.write( (char*)&m_blocks[0], numBlocks*sizeof(BlockEntry) );
+
+	// Column blocks (zero padded to alignment)
+	const char zeros[BlockAlignment] = { 0 };
+	for( unsigned i=0; i < numBlocks; i++ )
+	{
+		unsigned long long pad = m_blocks[i].offset - (unsigned long long)of.tellp();
+		of.write( zeros, (std::streamsize)pad );
+		if( m_blocks[i].size > 0 )
+			of.write( m_data[i], (std::streamsize)m_blocks[i].size );
+	}
+
+	bool success = of.good();
+	of.close();
+
+	// Written data is not referenced anymore
+	m_data.clear();
+	if( success )
+		m_filename = filename;
+
+	return success;
+}
+
+//-----------------------------------------------------------------------------
+bool TensorfieldCache::open( std::string filename )
+{
+	using namespace std;
+	clear();
+
+	ifstream f( filename, ios_base::binary );
+	if( !f.is_open() )
+		return false; // Missing cache files are not an error
+
+	char     magic[sizeof(TFCacheMagic)];
+	unsigned version, numBlocks;
+	Hash     hash;
+
+	f.read( magic, sizeof(magic) );
+	f.read( (char*)&version,   sizeof(unsigned) );
+	f.read( (char*)&numBlocks, sizeof(unsigned) );
+	f.read( (char*)&hash,      sizeof(Hash) );
+	if( !f.good() || memcmp( magic, TFCacheMagic, sizeof(magic) ) != 0 || version != TFCacheVersion )
+	{
+		cerr << "TensorfieldCache::open() : " << filename
+			 << " is not a valid TFCACHE file!" << endl;
+		return false;
+	}
+
+	vector<BlockEntry> blocks( numBlocks );
+	if( numBlocks > 0 )
+		f.read( (char*)&blocks[0], numBlocks*sizeof(BlockEntry) );
+	if( !f.good() )
+	{
+		cerr << "TensorfieldCache::open() : Corrupt block directory in "
+			 << filename << endl;
+		return false;
+	}
+
+	m_filename = filename;
+	m_hash     = hash;
+	m_blocks   = blocks;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+int TensorfieldCache::findBlock( BlockId id ) const
+{
+	for( unsigned i=0; i < m_blocks.size(); i++ )
+		if( m_blocks[i].id == (unsigned)id )
+			return (int)i;
+	return -1;
+}
+
+//-----------------------------------------------------------------------------
+bool TensorfieldCache::readRaw( const BlockEntry& e, char* dst ) const
+{
+	using namespace std;
+	ifstream f( m_filename, ios_base::binary );
+	if( !f.is_open() )
+	{
+		cerr << "TensorfieldCache::readBlock() : Could not open "
+			 << m_filename << endl;
+		return false;
+	}
+
+	f.seekg( (std::streamoff)e.offset );
+	if( e.size > 0 )
+		f.read( dst, (std::streamsize)e.size );
+	return f.good();
+}
+
+//-----------------------------------------------------------------------------
+bool TensorfieldCache::readBlock( BlockId id, Eigen::MatrixXd& M ) const
+{
+	int i = findBlock( id );
+	if( i < 0 || m_blocks[i].type != TypeDouble )
+		return false;
+
+	M.resize( m_blocks[i].rows, m_blocks[i].cols );
+	return readRaw( m_blocks[i], (char*)M.data() );
+}
+
+//-----------------------------------------------------------------------------
+bool TensorfieldCache::readBlock( BlockId id, std::vector<unsigned>& labels ) const
+{
+	int i = findBlock( id );
+	if( i < 0 || m_blocks[i].type != TypeUnsigned )
+		return false;
+
+	labels.resize( m_blocks[i].cols );
+	if( labels.empty() )
+		return true;
+	return readRaw( m_blocks[i], (char*)&labels[0] );
+}
+
+} // namespace scene
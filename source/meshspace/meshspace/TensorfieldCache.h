@@ -0,0 +1,99 @@
+// TensorfieldCache, part of scene - minimalistic scene graph library
+#ifndef SCENE_TENSORFIELDCACHE_H
+#define SCENE_TENSORFIELDCACHE_H
+
+#include <ShapePCA.h>  // for PCAModel
+#include <Eigen/Dense>
+#include <string>
+#include <vector>
+
+namespace scene {
+
+//-----------------------------------------------------------------------------
+// 	TensorfieldCache
+//-----------------------------------------------------------------------------
+/**
+	\brief Chunked binary container for derived tensor field data.
+
+	A cache file consists of a fixed size header, a block directory and a
+	sequence of column blocks:
+	- Header: magic "TFCACHE", format version, number of blocks and a content
+	  hash of the source \a PCAModel (see \a hashPCAModel()).
+	- Directory: one entry per block with block id, element type, number of
+	  rows and columns, file offset and size in bytes.
+	- Blocks: raw little endian column-major data, each block aligned to
+	  \a BlockAlignment bytes such that it can be memory-mapped directly.
+
+	Opening a cache via \a open() only reads header and directory, the actual
+	blocks are loaded lazily via \a readBlock().
+
+	For writing, blocks are registered via \a addBlock() which only stores a
+	reference to the given data, i.e. the data must stay valid until
+	\a write() was called.
+*/
+class TensorfieldCache
+{
+public:
+	/// Content of a column block
+	enum BlockId {
+		Tensors       = 1, ///< Vectorized tensors (6xn double)
+		Eigenvalues   = 2, ///< Square roots of eigenvalues, descending (3xn double)
+		Eigenvectors  = 3, ///< Column-major rotation matrices (9xn double)
+		Positions     = 4, ///< Glyph centers (3xn double)
+		ClusterLabels = 5  ///< Cluster index per glyph (1xn unsigned)
+	};
+
+	typedef unsigned long long Hash;
+
+	enum { BlockAlignment = 64 };
+
+	/// Hash over all data of a PCA model and the tensor derivation parameters.
+	static Hash hashPCAModel( const PCAModel& pca, int mode, double gamma, double scale );
+
+	TensorfieldCache();
+
+	///@{ Writing
+	void clear();
+	void setModelHash( Hash h ) { m_hash = h; }
+	void addBlock( BlockId id, const Eigen::MatrixXd& M );
+	void addBlock( BlockId id, const std::vector<unsigned>& labels );
+	bool write( std::string filename );
+	///@}
+
+	///@{ Lazy reading
+	/// Read header and block directory. Returns false if file is not valid.
+	bool open( std::string filename );
+	bool isOpen() const { return !m_filename.empty(); }
+	bool hasBlock( BlockId id ) const { return findBlock(id) >= 0; }
+	bool readBlock( BlockId id, Eigen::MatrixXd& M ) const;
+	bool readBlock( BlockId id, std::vector<unsigned>& labels ) const;
+	///@}
+
+	Hash modelHash() const { return m_hash; }
+
+protected:
+	enum ElementType { TypeDouble = 1, TypeUnsigned = 2 };
+
+	struct BlockEntry
+	{
+		unsigned id;
+		unsigned type;
+		unsigned rows;
+		unsigned cols;
+		unsigned long long offset;
+		unsigned long long size;
+	};
+
+	int findBlock( BlockId id ) const;
+	bool readRaw( const BlockEntry& e, char* dst ) const;
+
+private:
+	std::string             m_filename; ///< Opened cache file (empty if none)
+	Hash                    m_hash;
+	std::vector<BlockEntry> m_blocks;
+	std::vector<const char*> m_data;    ///< Pending blocks for write()
+};
+
+} // namespace scene
+
+#endif // SCENE_TENSORFIELDCACHE_H
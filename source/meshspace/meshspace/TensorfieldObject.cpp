@@ -1,7 +1,9 @@
 #include "TensorfieldObject.h"
 #include <ShapeCovariance.h>
+#include <SymmetricEigensolver3.h>
 #include <cmath>
 #include <fstream>
+#include <cstdio>
 
 #include "MatrixUtilities.h"
 using MatrixUtilities::removeColumn;
@@ -93,9 +95,25 @@ TensorfieldObject::TensorfieldObject()
 	  m_glyphRes      ( 8  ),  // 16 = high quality
 	  m_glyphSharpness( 3. ),  // 3. is Kindlman default
 	  m_glyphScale    ( 1. ),
-	  m_glyphSqrtEV   ( false )
+	  m_glyphSqrtEV   ( false ),
+	  m_cacheHash     ( 0 ),
+	  m_tensorFieldPending( false )
 {}
 
+const Eigen::MatrixXd& TensorfieldObject::getTensorField() const
+{
+	// Glyphs restored from cache do not require the input tensors, hence
+	// these are only loaded on first access.
+	if( m_tensorFieldPending )
+	{
+		if( !m_cache.readBlock( TensorfieldCache::Tensors, m_tensorField ) )
+			std::cerr << "TensorfieldObject::getTensorField() : "
+				"Could not load tensors from cache!" << std::endl;
+		m_tensorFieldPending = false;
+	}
+	return m_tensorField;
+}
+
 void TensorfieldObject::setGlyphPositions( meshtools::Mesh* mesh )
 {
 	// NOT IMPLEMENTED YET!
@@ -172,6 +190,8 @@ void TensorfieldObject::exportTensorfieldAsNrrd( std::string path, std::string b
 {
 	using namespace std;
 
+	const Eigen::MatrixXd& S = getTensorField();
+
 	string filename      = basename + ".nrrd",
 		   filename_raw  = basename + ".raw",
 	       filename_mesh = basename + "-mesh.lmpd";
@@ -188,7 +208,7 @@ void TensorfieldObject::exportTensorfieldAsNrrd( std::string path, std::string b
 	hf << "NRRD0002" << endl
 	   << "type: double" << endl
 	   << "dimension: 3" << endl
-	   << "sizes: " << m_tensorField.rows() << " " << m_tensorField.cols() << endl
+	   << "sizes: " << S.rows() << " " << S.cols() << endl
 	   << "endian: little" << endl
 	   << "encoding: raw" << endl
 	   << "data file: ./" << filename_raw << endl
@@ -205,7 +225,7 @@ void TensorfieldObject::exportTensorfieldAsNrrd( std::string path, std::string b
 			 << filename_raw << endl;
 		return;	
 	}
-	rf.write( (char*)m_tensorField.data(), m_tensorField.cols()*m_tensorField.rows()*sizeof(double) );
+	rf.write( (char*)S.data(), S.cols()*S.rows()*sizeof(double) );
 	rf.close();
 
 	// Write mesh data
@@ -224,20 +244,22 @@ void TensorfieldObject::saveTensorfield( std::string filename )
 		return;
 	}
 
+	const Eigen::MatrixXd& S = getTensorField();
+
 	// FOR DEBUGGING
 	double* ptr_pos = (double*)m_pos.data();
-	double* ptr_S   = (double*)m_tensorField.data();
+	double* ptr_S   = (double*)S.data();
 
 	const char magic[] = "TENSORFIELD";	
-	unsigned nrows = (unsigned)m_tensorField.rows(),
-		     ncols = (unsigned)m_tensorField.cols(),
+	unsigned nrows = (unsigned)S.rows(),
+		     ncols = (unsigned)S.cols(),
 			 npts  = (unsigned)m_pos.cols();
 
 	of.write( magic, sizeof(magic) );
 	of.write( (char*)&nrows, sizeof(unsigned) );
 	of.write( (char*)&ncols, sizeof(unsigned) );
 	of.write( (char*)&npts, sizeof(unsigned) );
-	of.write( (char*)m_tensorField.data(), sizeof(double)*nrows*ncols );
+	of.write( (char*)S.data(), sizeof(double)*nrows*ncols );
 	of.write( (char*)m_pos.data(), sizeof(double)*3*npts );
 	of.close();
 }
@@ -337,7 +359,7 @@ unsigned TensorfieldObject::filterTensorField( Eigen::MatrixXd& S, Eigen::Matrix
 #endif
 }
 
-void TensorfieldObject::deriveTensorsFromPCAModel( const PCAModel& pca,  int mode, double gamma, double scale )
+void TensorfieldObject::deriveTensorsFromPCAModel( const PCAModel& pca,  int mode, double gamma, double scale, ProgressReporter* progress )
 {
 	using std::cerr;
 	using std::cout;
@@ -357,6 +379,21 @@ void TensorfieldObject::deriveTensorsFromPCAModel( const PCAModel& pca,  int mod
 			  "specified!" << endl;
 	}
 
+	// Skip computation if a cached result for this model exists
+	TensorfieldCache::Hash hash = 0;
+	std::string cacheFile;
+	if( !m_cachePath.empty() )
+	{
+		hash = TensorfieldCache::hashPCAModel( pca, mode, gamma, scale );
+		cacheFile = cacheFilename( hash );
+		m_glyphSqrtEV = (mode == InterPointCovariance); // see below
+		if( loadTensorfieldCache( cacheFile, hash ) )
+		{
+			cout << "Loaded tensor field from cache " << cacheFile << endl;
+			return;
+		}
+	}
+
 	// For all modes we place glyph at vertex positions of mean shape
 	setGlyphPositions( reshape(pca.mu) );
 
@@ -364,7 +401,9 @@ void TensorfieldObject::deriveTensorsFromPCAModel( const PCAModel& pca,  int mod
 	{
 		cout << "Computing anatomic covariance, scaled by " << scale << endl;
 		Eigen::MatrixXd S;
-		computeSampleCovariance( pca.X, S );
+		computeSampleCovariance( pca.X, S, progress );
+		if( progress && progress->isCancelled() )
+			return;
 		m_glyphSqrtEV = false;
 		deriveTensorsFromCovariance( S );
 	}
@@ -373,7 +412,9 @@ void TensorfieldObject::deriveTensorsFromPCAModel( const PCAModel& pca,  int mod
 	{
 		cout << "Computing unweighted inter-point covariance with gamma = " << gamma << ", scaled by " << scale << endl;
 		Eigen::MatrixXd G;
-		computeInterPointCovariance( pca.PC * pca.ev.asDiagonal(), gamma, G );
+		computeInterPointCovariance( pca.PC * pca.ev.asDiagonal(), gamma, G, progress );
+		if( progress && progress->isCancelled() )
+			return;
 		G *= scale;
 		m_glyphSqrtEV = false;
 		deriveTensorsFromCovariance( G );
@@ -383,8 +424,12 @@ void TensorfieldObject::deriveTensorsFromPCAModel( const PCAModel& pca,  int mod
 	{
 		cout << "Computing inter-point covariance with gamma = " << gamma << ", scaled by " << scale << endl;
 		Eigen::MatrixXd S, G;
-		computeSampleCovariance( pca.X, S );
-		computeInterPointCovariance( pca.PC * pca.ev.asDiagonal(), gamma, G );
+		computeSampleCovariance( pca.X, S, progress );
+		if( progress && progress->isCancelled() )
+			return;
+		computeInterPointCovariance( pca.PC * pca.ev.asDiagonal(), gamma, G, progress );
+		if( progress && progress->isCancelled() )
+			return;
 
 		// Weight inter-point with anatomic covariance tensor
 		for( unsigned p=0; p < G.cols(); p++ )
@@ -409,61 +454,103 @@ void TensorfieldObject::deriveTensorsFromPCAModel( const PCAModel& pca,  int mod
 		m_glyphSqrtEV = true;
 		deriveTensorsFromCovariance( G );
 	}
+
+	if( !cacheFile.empty() )
+		saveTensorfieldCache( cacheFile, hash );
 }
 
-void TensorfieldObject::deriveTensorsFromCovariance( const Eigen::MatrixXd& S )
+std::string TensorfieldObject::cacheFilename( TensorfieldCache::Hash hash ) const
 {
-	using ShapeCovariance::devectorizeCovariance;
+	char name[64];
+	sprintf( name, "/tensorfield-%016llx.tfcache", hash );
+	return m_cachePath + std::string(name);
+}
 
-	// Store input tensor field
-	m_tensorField = S;
-	
-	// Variables
-	int n = (int)S.cols();
-	
-	m_R     .resize( 9, n );
-	m_Lambda.resize( 3, n );
+bool TensorfieldObject::loadTensorfieldCache( std::string filename, TensorfieldCache::Hash hash )
+{
+	m_cache.clear();
+	if( !m_cache.open( filename ) || m_cache.modelHash() != hash )
+		return false;
 
-	int countFixedRotations = 0;
-	
-	// Compute spectrum
-	int n_update = n / 200;
-	for( int i=0; i < n; ++i )
+	// Only blocks required for glyph generation are loaded right away
+	Eigen::MatrixXd pos, lambda, R;
+	if( !m_cache.readBlock( TensorfieldCache::Positions,    pos    ) || pos   .rows()!=3 ||
+		!m_cache.readBlock( TensorfieldCache::Eigenvalues,  lambda ) || lambda.rows()!=3 ||
+		!m_cache.readBlock( TensorfieldCache::Eigenvectors, R      ) || R     .rows()!=9 ||
+		!m_cache.hasBlock ( TensorfieldCache::Tensors ) )
 	{
-		// Progress info
-		if( n_update>0 && (i%n_update == 0 || i==n-1) )
-			std::cout << "Computing tensor spectrum " << (100*i/(n-1)) << "% "
-				"(point " << i+1 << " / " << n << ") \r";
-
-		// SVD
-		Eigen::Matrix3d Sigma;
-		devectorizeCovariance( S.col(i), Sigma );
-		Eigen::JacobiSVD< Eigen::Matrix3d > svd( Sigma, Eigen::ComputeFullU );
-
-		// Store rotation
-	  #if 0
-		m_R.col(i) = Eigen::Map<Eigen::VectorXd>( svd.matrixU().data(), 9 );
-	  #else
-		for( int j=0; j < 9; j++ )
-			m_R(j,i) = svd.matrixU().data()[j];
-	  #endif
+		std::cerr << "TensorfieldObject::loadTensorfieldCache() : "
+			"Incomplete cache file " << filename << std::endl;
+		m_cache.clear();
+		return false;
+	}
 
-	  #if 0
-		// Turn reflection into rotation
-		if( m_R.determinant() < 0. )
-		{
-			m_R.col(2) *= -1.;
-			countFixedRotations++;
-		}
-	  #endif
+	setGlyphPositions( pos );
+	m_Lambda = lambda;
+	m_R      = R;
+	m_tensorField.resize( 0, 0 );
+	m_tensorFieldPending = true;
 
-		// Store scaling
-		m_Lambda.col(i) = svd.singularValues().cwiseSqrt();
+	std::vector<unsigned> labels;
+	if( m_cache.readBlock( TensorfieldCache::ClusterLabels, labels ) && !labels.empty() )
+	{
+		m_clusterIndices = labels;
+		m_numClusters = 0;
+		for( unsigned i=0; i < labels.size(); i++ )
+			m_numClusters = std::max( m_numClusters, labels[i]+1 );
 	}
-	std::cout << std::endl;
 
-	if( countFixedRotations > 0 )
-		std::cout << "Fixed " << countFixedRotations << " rotation matrices" << std::endl;
+	m_cacheFilename = filename;
+	m_cacheHash     = hash;
+
+	// Create tensor glyphs
+	m_dirtyFlag = CompleteChange;
+	updateTensorfield();
+	return true;
+}
+
+void TensorfieldObject::saveTensorfieldCache( std::string filename, TensorfieldCache::Hash hash )
+{
+	Eigen::MatrixXd lambda = m_Lambda,
+	                pos    = m_pos;
+
+	TensorfieldCache cache;
+	cache.setModelHash( hash );
+	cache.addBlock( TensorfieldCache::Tensors,      getTensorField() );
+	cache.addBlock( TensorfieldCache::Eigenvalues,  lambda );
+	cache.addBlock( TensorfieldCache::Eigenvectors, m_R );
+	cache.addBlock( TensorfieldCache::Positions,    pos );
+	if( !m_clusterIndices.empty() )
+		cache.addBlock( TensorfieldCache::ClusterLabels, m_clusterIndices );
+
+	if( cache.write( filename ) )
+	{
+		m_cacheFilename = filename;
+		m_cacheHash     = hash;
+	}
+}
+
+void TensorfieldObject::deriveTensorsFromCovariance( const Eigen::MatrixXd& S )
+{
+	// Store input tensor field
+	m_tensorField = S;
+	m_tensorFieldPending = false;
+	m_cacheFilename.clear();
+
+	// Compute spectrum of all tensors at once. The batched solver returns
+	// right-handed orthonormal eigenvectors and eigenvalues sorted descending.
+	std::cout << "Computing tensor spectrum of " << S.cols() << " tensors..." << std::endl;
+	SymmetricEigensolver3::SolveInfo info = 
+		SymmetricEigensolver3::solve( S, m_R, m_Lambda );
+
+	if( info.numJacobi > 0 )
+		std::cout << "Used Jacobi fallback for " << info.numJacobi 
+		          << " nearly degenerate tensors" << std::endl;
+
+	// Store scaling. Covariance tensors are positive semi-definite, taking the
+	// absolute value only guards against round-off (and matches the singular
+	// values formerly used here).
+	m_Lambda = m_Lambda.cwiseAbs().cwiseSqrt();
 	
 	// Create tensor glyphs
 	m_dirtyFlag = CompleteChange;
@@ -731,6 +818,10 @@ void TensorfieldObject::setClusters( const std::vector<unsigned int>& indices, u
 				numClusters = indices.at(i);
 	}
 	m_numClusters = numClusters;
+
+	// Keep cached result in sync
+	if( !m_cacheFilename.empty() )
+		saveTensorfieldCache( m_cacheFilename, m_cacheHash );
 }
 
 } // namespace scene
@@ -4,6 +4,7 @@
 #include <meshtools.h>
 #include <ShapePCA.h>  // for PCAModel
 #include "MeshObject.h"
+#include "TensorfieldCache.h"
 
 #include <string>
 
@@ -37,8 +38,13 @@ public:
 
 	TensorfieldObject();
 
-	// Internally calls deriveTensorsFromCovariance() and setGlyphPositions()
-	void deriveTensorsFromPCAModel( const PCAModel& pca, int mode=AnatomicCovariance, double gamma=0.0, double scale=1.0 );
+	// Internally calls deriveTensorsFromCovariance() and setGlyphPositions().
+	// If a cache path is set, results are loaded from a matching cache file
+	// instead of being recomputed (see \a setCachePath()).
+	// An optional progress reporter allows to cancel the computation, in which
+	// case no tensors are derived.
+	void deriveTensorsFromPCAModel( const PCAModel& pca, int mode=AnatomicCovariance, double gamma=0.0, double scale=1.0,
+		ProgressReporter* progress=NULL );
 
 	void createTestScene();
 
@@ -74,8 +80,16 @@ public:
 	void exportTensorfieldAsNrrd( std::string path, std::string basename, MeshBuffer* mb=NULL );
 	///@}
 
+	///@{ Tensorfield cache
+	/// Set directory for \a TensorfieldCache files, empty string disables caching.
+	/// Cache files are named after the hash of the source PCA model.
+	void setCachePath( std::string path ) { m_cachePath = path; }
+	std::string getCachePath() const { return m_cachePath; }
+	///@}
+
 	void setClusters( const std::vector<unsigned int>& indices, unsigned numClusters=-1 );
-	const Eigen::MatrixXd& getTensorField() const { return m_tensorField; }
+	/// Input tensorfield, lazily loaded if glyphs were restored from cache
+	const Eigen::MatrixXd& getTensorField() const;
 	const Eigen::Matrix3Xd& getPositions() const { return m_pos; }
 
 protected:
@@ -92,6 +106,12 @@ protected:
 	/// Returns the number of filtered out tensors.
 	unsigned filterTensorField( Eigen::MatrixXd& S, Eigen::Matrix3Xd& pts, double threshold=0.0001 );
 
+	///@{ Cache IO, see \a TensorfieldCache
+	std::string cacheFilename( TensorfieldCache::Hash hash ) const;
+	bool loadTensorfieldCache( std::string filename, TensorfieldCache::Hash hash );
+	void saveTensorfieldCache( std::string filename, TensorfieldCache::Hash hash );
+	///@}
+
 protected:
 	void updateFaces   ( int glyphId );
 	void updateVertices( int glyphId );
@@ -122,7 +142,13 @@ private:
 	Eigen::Matrix3Xd m_Lambda; ///< Eigenvalues  (3x1 vectors in columns)
 	Eigen::Matrix3Xd m_pos;    ///< Glyph centers
 
-	Eigen::MatrixXd m_tensorField; ///< Input tensorfield
+	mutable Eigen::MatrixXd m_tensorField; ///< Input tensorfield (see getTensorField())
+
+	std::string m_cachePath;             ///< Cache directory, see setCachePath()
+	std::string m_cacheFilename;         ///< Cache file of current tensorfield
+	TensorfieldCache::Hash m_cacheHash;  ///< Model hash of current tensorfield
+	mutable TensorfieldCache m_cache;    ///< Opened cache for lazy block loading
+	mutable bool m_tensorFieldPending;   ///< Tensorfield not yet loaded from cache
 
 	std::vector<unsigned int> m_clusterIndices;
 	unsigned m_numClusters;
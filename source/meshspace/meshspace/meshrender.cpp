@@ -0,0 +1,127 @@
+// meshrender - Headless thumbnail and turntable rendering via SoftwareRenderer
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include "meshtools.h"
+#include "MeshBuffer.h"
+#include "SoftwareRenderer.h"
+#include "TransferFunction.h"
+
+const char g_usage[] =
+"meshrender - Render meshes offscreen without OpenGL (e.g. on headless servers).\n"
+"\n"
+"Usage: meshrender [options] <mesh> <output_prefix>\n"
+"\n"
+"Options:\n"
+"  -s <size>     Image width and height in pixels (default 256)\n"
+"  -n <views>    Number of turntable views around y-axis (default 1)\n"
+"  -e <degrees>  Camera elevation (default 20)\n"
+"  -f <frame>    Frame of a mesh animation (.mb) to render (default 0)\n"
+"  -c <file>     Text file with one scalar per vertex, color coded via the\n"
+"                default transfer function after scaling to [0,1]\n"
+"\n"
+"Input can be any OpenMesh file format or a MESHBUFFER (.mb) animation. \n"
+"Views are written as binary PPM files <output_prefix>_<view>.ppm.\n";
+
+bool loadScalars( const char* filename, std::vector<float>& scalars )
+{
+	std::ifstream f( filename );
+	if( !f.is_open() )
+	{
+		std::cerr << "Could not open " << filename << "!" << std::endl;
+		return false;
+	}
+	float s;
+	while( f >> s )
+		scalars.push_back( s );
+	return true;
+}
+
+int main( int argc, char* argv[] )
+{
+	using namespace std;
+
+	// -- Parse command line
+	int size=256, numViews=1, frame=0;
+	float elevation=20.f;
+	const char* scalarFile = NULL;
+
+	int i=1;
+	for( ; i+1 < argc && argv[i][0]=='-'; i+=2 )
+	{
+		string opt( argv[i] );
+		if( opt == "-s" ) size       = atoi( argv[i+1] ); else
+		if( opt == "-n" ) numViews   = atoi( argv[i+1] ); else
+		if( opt == "-e" ) elevation  = (float)atof( argv[i+1] ); else
+		if( opt == "-f" ) frame      = atoi( argv[i+1] ); else
+		if( opt == "-c" ) scalarFile = argv[i+1];
+		else
+		{
+			cout << g_usage;
+			return 0;
+		}
+	}
+	if( argc - i != 2 || size < 1 || numViews < 1 )
+	{
+		cout << g_usage;
+		return 0;
+	}
+	string filename( argv[i] ), prefix( argv[i+1] );
+
+	// -- Load mesh
+	MeshBuffer mb;
+	string ext = filename.substr( filename.find_last_of('.') + 1 );
+	if( ext == "mb" || ext == "meshbuffer" )
+	{
+		if( !mb.read( filename.c_str() ) )
+			return -1;
+	}
+	else
+	{
+		meshtools::Mesh mesh;
+		if( !meshtools::loadMesh( mesh, filename.c_str() ) )
+			return -1;
+		meshtools::updateMeshVertexNormals( &mesh );
+		mb.addFrame( &mesh );
+	}
+
+	// -- Scalars
+	vector<float> scalars;
+	TransferFunction tf;
+	scene::SoftwareRenderer renderer( size, size );
+	if( scalarFile )
+	{
+		if( !loadScalars( scalarFile, scalars ) || scalars.empty() )
+			return -1;
+
+		float minval=scalars[0], maxval=scalars[0];
+		for( size_t j=0; j < scalars.size(); j++ )
+		{
+			minval = std::min( minval, scalars[j] );
+			maxval = std::max( maxval, scalars[j] );
+		}
+		renderer.setTransferFunction( &tf );
+		renderer.setScalarShiftScale( -minval, maxval > minval ? 1.f/(maxval - minval) : 1.f );
+	}
+
+	// -- Render turntable
+	for( int view=0; view < numViews; view++ )
+	{
+		renderer.fitView( mb, frame, 360.f * view / numViews, elevation );
+
+		scene::SoftwareRenderer::Image img;
+		if( !renderer.render( mb, frame, img, scalars ) )
+			return -1;
+
+		char suffix[16];
+		sprintf( suffix, "_%03d.ppm", view );
+		if( !img.savePPM( prefix + suffix ) )
+			return -1;
+	}
+
+	return 0;
+}
@@ -125,10 +125,15 @@ public:
 	: m_name("(unnamed)"),
 	  m_visible(true)
 	{}
+	virtual ~Object() {}
 	
 	virtual void render( int flags=RenderDefault )=0;
 	virtual BoundingBox getBoundingBox() const=0;
 
+	/// Release OpenGL resources, requires valid OpenGL context. Must be called
+	/// before the object is dropped, since its destructor may run on any thread.
+	virtual void destroy() {}
+
 	std::string getName() const { return m_name; }
 	Color       getColor() const { return m_color; }
 	bool        isVisible() const { return m_visible; }
@@ -155,8 +160,8 @@ typedef std::vector< ObjectPtr >    ObjectPtrArray;
 /**
 	\brief Minimalistic scenegraph (so far not a graph but simply a set of objects)
 
-	Currently objects can only be added and there is no possibility to
-	remove them from the scene yet.
+	Objects are shared via \a ObjectPtr, call \a Object::destroy() with the
+	OpenGL context current before removing an object from the scene.
 */
 class Scene
 {
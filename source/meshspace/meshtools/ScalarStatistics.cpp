@@ -0,0 +1,184 @@
+#include "ScalarStatistics.h"
+#include <algorithm>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SCALARSTATISTICS_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace {
+
+/// Number of values processed per OpenMP work item
+const int BlockSize = 1 << 16;
+
+inline int numBlocks( size_t n )
+{
+	return (int)((n + BlockSize - 1) / BlockSize);
+}
+
+/// Update min/max with values of block, NaN values are skipped
+void minmaxBlock( const float* v, size_t n, float& minval, float& maxval )
+{
+	size_t i = 0;
+#ifdef SCALARSTATISTICS_SSE
+	if( n >= 4 )
+	{
+		// MINPS/MAXPS return the second operand if either one is NaN
+		__m128 vmin = _mm_set1_ps( minval ),
+		       vmax = _mm_set1_ps( maxval );
+		for( ; i+4 <= n; i+=4 )
+		{
+			__m128 x = _mm_loadu_ps( v+i );
+			vmin = _mm_min_ps( x, vmin );
+			vmax = _mm_max_ps( x, vmax );
+		}
+		float a[4], b[4];
+		_mm_storeu_ps( a, vmin );
+		_mm_storeu_ps( b, vmax );
+		for( int k=0; k < 4; k++ )
+		{
+			minval = std::min( minval, a[k] );
+			maxval = std::max( maxval, b[k] );
+		}
+	}
+#endif
+	// Comparisons are false for NaN
+	for( ; i < n; i++ )
+	{
+		if( v[i] < minval ) minval = v[i];
+		if( v[i] > maxval ) maxval = v[i];
+	}
+}
+
+} // anonymous namespace
+
+namespace ScalarStatistics
+{
+
+//-----------------------------------------------------------------------------
+bool minmax( const float* values, size_t n, float& minval, float& maxval )
+{
+	float mn =  std::numeric_limits<float>::max(),
+	      mx = -std::numeric_limits<float>::max();
+
+	int nb = numBlocks( n );
+	#pragma omp parallel
+	{
+		float tmn = mn, tmx = mx;
+
+		#pragma omp for schedule(static)
+		for( int b=0; b < nb; b++ )
+		{
+			size_t begin = (size_t)b * BlockSize;
+			minmaxBlock( values + begin, std::min( n - begin, (size_t)BlockSize ), tmn, tmx );
+		}
+
+		#pragma omp critical
+		{
+			mn = std::min( mn, tmn );
+			mx = std::max( mx, tmx );
+		}
+	}
+
+	if( mn > mx )
+		return false;
+
+	minval = mn;
+	maxval = mx;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+void histogram( const float* values, size_t n, float minval, float maxval,
+                std::vector<size_t>& bins )
+{
+	int numBins = (int)bins.size();
+	std::fill( bins.begin(), bins.end(), 0 );
+	if( numBins == 0 || !(maxval >= minval) )
+		return;
+
+	double scale = (maxval > minval) ? numBins / ((double)maxval - minval) : 0.;
+
+	int nb = numBlocks( n );
+	#pragma omp parallel
+	{
+		// Thread local histogram
+		std::vector<size_t> local( numBins, 0 );
+
+		#pragma omp for schedule(static)
+		for( int b=0; b < nb; b++ )
+		{
+			size_t begin = (size_t)b * BlockSize,
+			       end   = std::min( n, begin + BlockSize );
+			for( size_t i=begin; i < end; i++ )
+			{
+				float v = values[i];
+				// Negated comparison also rejects NaN
+				if( !(v >= minval && v <= maxval) )
+					continue;
+				int bin = (int)((v - minval) * scale);
+				local[ std::min( bin, numBins-1 ) ]++;
+			}
+		}
+
+		#pragma omp critical
+		{
+			for( int i=0; i < numBins; i++ )
+				bins[i] += local[i];
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+bool percentileRange( const float* values, size_t n, float lower, float upper,
+                      float& lo, float& hi, int numBins )
+{
+	float minval, maxval;
+	if( !minmax( values, n, minval, maxval ) )
+		return false;
+
+	if( maxval == minval || numBins < 1 || (lower <= 0.f && upper >= 1.f) )
+	{
+		lo = minval;
+		hi = maxval;
+		return true;
+	}
+
+	std::vector<size_t> bins( numBins );
+	histogram( values, n, minval, maxval, bins );
+
+	size_t total = 0;
+	for( int i=0; i < numBins; i++ )
+		total += bins[i];
+
+	double width = ((double)maxval - minval) / numBins;
+	double lowerCount = std::max( 0.f, lower ) * total,
+	       upperCount = std::min( 1.f, upper ) * total;
+
+	// Lower bound is start of first bin exceeding lower percentile,
+	// upper bound is end of first bin reaching upper percentile.
+	size_t count = 0;
+	int ilo = 0, ihi = numBins-1;
+	for( ; ilo < numBins-1 && (double)(count + bins[ilo]) <= lowerCount; ilo++ )
+		count += bins[ilo];
+	count = 0;
+	for( int i=0; i < numBins; i++ )
+	{
+		count += bins[i];
+		if( (double)count >= upperCount )
+		{
+			ihi = i;
+			break;
+		}
+	}
+
+	lo = (float)(minval + ilo * width);
+	hi = (float)(minval + (ihi+1) * width);
+	if( hi < lo )
+		std::swap( lo, hi );
+	hi = std::min( hi, maxval );
+	return true;
+}
+
+} // namespace ScalarStatistics
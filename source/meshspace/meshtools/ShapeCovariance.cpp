@@ -33,68 +33,29 @@ void devectorizeCovariance( const VectorXd v, Matrix3d& Sigma )
 // Sample covariance functions
 //----------------------------------------------------------------------------- 
 
-void computeSampleCovariance( const MatrixXd& X, MatrixXd& S  )
+void computeSampleCovariance( const MatrixXd& X, MatrixXd& S, ProgressReporter* progress )
 {
 	int p = (int)X.rows() / 3;
 	
 	S.resize( 6, p );
 	
-	unsigned counter=0;
-	const int n_update = p / 200;
+	ProgressCounter counter( p, "Computing anatomic covariance", progress );
 	#pragma omp parallel for
 	for( int i=0; i < p; ++i )
 	{
-		#pragma omp atomic
-		counter++;
-
-		// Progress indicator
-	  #ifdef USE_OPENMP
-		const int id = omp_get_thread_num();
-	  #else
-		const int id = 0;
-	  #endif
-		if( id==0 )
-			if( counter%n_update==0 )
-				printf("Computing anatomic covariance %d%% (point %d / %d)\r",(100*counter)/(p-1),counter+1,p);
+		// OpenMP loops can not be left early, skip remaining work instead
+		if( counter.isCancelled() )
+			continue;
 
 		Matrix3d Sigma;
 		sampleCovariance( X.block( 3*i, 0, 3, X.cols() ), Sigma );
 		VectorXd v;
 		vectorizeCovariance( Sigma, v );
 		S.col(i) = v;
-	}
-	printf("\n");
-}
-
-void computeSampleCovariance( const MatrixXd& X, std::vector<Matrix3d> S )
-{
-	using ShapeCovariance::sampleCovariance;	
-	
-	int p = (int)X.rows() / 3;
-	
-	S.resize( p );	
 
-	unsigned counter=0;
-	const int n_update = p / 200;
-	#pragma omp parallel for
-	for( int i=0; i < p; ++i )
-	{
-		#pragma omp atomic
-		counter++;
-		
-		// Progress indicator
-	  #ifdef USE_OPENMP
-		const int id = omp_get_thread_num();
-	  #else
-		const int id = 0;
-	  #endif
-		if( id==0 )
-			if( counter%n_update==0 )
-				printf("Computing anatomic covariance %d%% (point %d / %d)\r",(100*counter)/(p-1),counter+1,p);
-
-		sampleCovariance( X.block( 3*p, 0, 3, X.cols() ), S[i] );
-	}	
-	printf("\n");
+		counter.step();
+	}
+	counter.finish();
 }
 
 //-----------------------------------------------------------------------------
@@ -128,7 +89,7 @@ void computeInterPointZ( const MatrixXd& B, double gamma, MatrixXd& Z )
 	}
 }
 
-void computeInterPointCovariance( const MatrixXd& B, double gamma, MatrixXd& G )
+void computeInterPointCovariance( const MatrixXd& B, double gamma, MatrixXd& G, ProgressReporter* progress )
 {
 	int n = (int)B.rows() / 3;  // Number of 3D vectors	
 	
@@ -136,23 +97,13 @@ void computeInterPointCovariance( const MatrixXd& B, double gamma, MatrixXd& G )
 	G.resize( 6, n );
 	
 	// Compute overview tensor
-	unsigned counter=0;
-	const int n_update = n / 200;
+	ProgressCounter counter( n, "Computing inter-point covariance", progress );
 	#pragma omp parallel for
 	for( int p=0; p < n; ++p )
 	{	
-		#pragma omp atomic
-		counter++;
-		
-		// Progress indicator
-	  #ifdef USE_OPENMP
-		const int id = omp_get_thread_num();
-	  #else
-		const int id = 0;
-	  #endif
-		if( id==0 )
-			if( counter%n_update==0 )
-				printf("Computing inter-point covariance %d%% (point %d / %d)\r",(100*counter)/(n-1),counter+1,n);
+		// OpenMP loops can not be left early, skip remaining work instead
+		if( counter.isCancelled() )
+			continue;
 
 		// Precompute part of interaction tensor depending solely on p
 		MatrixXd Zp;
@@ -174,8 +125,10 @@ void computeInterPointCovariance( const MatrixXd& B, double gamma, MatrixXd& G )
 		VectorXd v;
 		vectorizeCovariance( Gp, v );
 		G.col(p) = v;
+
+		counter.step();
 	}
-	printf("\n");
+	counter.finish();
 }
 
 //-----------------------------------------------------------------------------
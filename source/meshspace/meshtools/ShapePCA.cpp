@@ -15,7 +15,7 @@ Eigen::Matrix3Xd reshape( const Eigen::VectorXd& v )
 	return mat;
 }
 
-void computePCA( /*const*/ MeshBuffer& samples, MeshBuffer& pcmb, PCAModel& model, meshtools::Mesh& mshape )
+void computePCA( /*const*/ MeshBuffer& samples, MeshBuffer& pcmb, PCAModel& model, meshtools::Mesh& mshape, ProgressReporter* progress )
 {
 	// Map vertex buffer to data matrix
 	Eigen::Map<Eigen::MatrixXf> Xf( &(samples.vbuffer()[0]), samples.numVertices()*3, samples.numFrames() );
@@ -23,9 +23,16 @@ void computePCA( /*const*/ MeshBuffer& samples, MeshBuffer& pcmb, PCAModel& mode
 	// Copy float to double matrix (since we internally mostly use double matrices)
 	Eigen::MatrixXd X = Xf.cast<double>();
 	
+	if( progress ) progress->setProgress( 0.1 );
+
 	// Compute PCA
 	computePCA( X, model.PC, model.ev, model.mu );
 
+	// The decomposition itself can not be interrupted, stop afterwards
+	if( progress && progress->isCancelled() )
+		return;
+	if( progress ) progress->setProgress( 0.8 );
+
 	// Also store zero-mean data matrix for further analyis
 	model.X = X;
 	centerMatrix( model.X );
@@ -50,4 +57,6 @@ void computePCA( /*const*/ MeshBuffer& samples, MeshBuffer& pcmb, PCAModel& mode
 	
 	// Free temporary memory
 	delete mesh;
+
+	if( progress ) progress->setProgress( 1.0 );
 }
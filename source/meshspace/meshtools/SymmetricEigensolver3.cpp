@@ -0,0 +1,299 @@
+#include "SymmetricEigensolver3.h"
+#include <cmath>
+#include <algorithm>
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+namespace SymmetricEigensolver3 {
+
+namespace {
+
+/// Number of tensors gathered into contiguous lanes per block
+const int BlockSize = 64;
+
+/// Contiguous per-block working set in structure-of-arrays layout
+struct Block
+{
+	double a[6][BlockSize];      ///< Input tensor components
+	double scale[BlockSize];     ///< Normalization factor (max. abs. entry)
+	double lambda[3][BlockSize]; ///< Eigenvalues, descending (normalized)
+	double R[9][BlockSize];      ///< Eigenvectors, column-major
+	int    degenerate[BlockSize];///< 1 if Jacobi fallback is required
+};
+
+const double TwoThirdsPi = 2.0943951023931954923;
+
+/// Analytic eigenvalues of normalized tensors (branch-free, vectorizable).
+void eigenvaluesAnalytic( Block& b, int n, double tol )
+{
+	for( int i=0; i < n; ++i )
+	{
+		// Normalize to max. absolute entry to avoid over-/underflow
+		double s = std::max( std::max( std::fabs(b.a[0][i]), std::fabs(b.a[1][i]) ),
+		           std::max( std::max( std::fabs(b.a[2][i]), std::fabs(b.a[3][i]) ),
+		                     std::max( std::fabs(b.a[4][i]), std::fabs(b.a[5][i]) ) ) );
+		double inv = (s > 0.) ? 1./s : 0.;
+		b.scale[i] = s;
+
+		double a00 = b.a[0][i]*inv, a01 = b.a[1][i]*inv, a02 = b.a[2][i]*inv,
+		       a11 = b.a[3][i]*inv, a12 = b.a[4][i]*inv, a22 = b.a[5][i]*inv;
+
+		// Shift by mean eigenvalue, B = (A - qI) / p
+		double q  = (a00 + a11 + a22) / 3.,
+		       b00 = a00 - q, b11 = a11 - q, b22 = a22 - q,
+		       p2 = b00*b00 + b11*b11 + b22*b22 + 2.*(a01*a01 + a02*a02 + a12*a12),
+		       p  = std::sqrt( p2 / 6. ),
+		       ip = (p > 0.) ? 1./p : 0.;
+
+		b00 *= ip; b11 *= ip; b22 *= ip;
+		double c01 = a01*ip, c02 = a02*ip, c12 = a12*ip;
+
+		// det(B)/2 clamped to the valid range of acos
+		double h = .5*( b00*(b11*b22 - c12*c12)
+		              - c01*(c01*b22 - c12*c02)
+		              + c02*(c01*c12 - b11*c02) );
+		h = std::min( std::max( h, -1. ), 1. );
+
+		double phi = std::acos( h ) / 3.,
+		       beta2 = 2.*std::cos( phi ),
+		       beta0 = 2.*std::cos( phi + TwoThirdsPi ),
+		       beta1 = -(beta0 + beta2);
+
+		b.lambda[0][i] = q + p*beta2;
+		b.lambda[1][i] = q + p*beta1;
+		b.lambda[2][i] = q + p*beta0;
+
+		// Eigenvector computation is ill-conditioned for small gaps
+		double gap = p * std::min( beta2 - beta1, beta1 - beta0 );
+		b.degenerate[i] = (gap < tol) ? 1 : 0;
+	}
+}
+
+/// Unit eigenvector for eigenvalue l via the best conditioned cross product
+/// of the rows of (A - lI).
+inline void eigenvectorCross( const double* A, double l, double* v )
+{
+	double r0[3] = { A[0]-l, A[1],   A[2]   },
+	       r1[3] = { A[1],   A[3]-l, A[4]   },
+	       r2[3] = { A[2],   A[4],   A[5]-l };
+
+	double c[3][3] = {
+		{ r0[1]*r1[2]-r0[2]*r1[1], r0[2]*r1[0]-r0[0]*r1[2], r0[0]*r1[1]-r0[1]*r1[0] },
+		{ r0[1]*r2[2]-r0[2]*r2[1], r0[2]*r2[0]-r0[0]*r2[2], r0[0]*r2[1]-r0[1]*r2[0] },
+		{ r1[1]*r2[2]-r1[2]*r2[1], r1[2]*r2[0]-r1[0]*r2[2], r1[0]*r2[1]-r1[1]*r2[0] } };
+
+	double d0 = c[0][0]*c[0][0] + c[0][1]*c[0][1] + c[0][2]*c[0][2],
+	       d1 = c[1][0]*c[1][0] + c[1][1]*c[1][1] + c[1][2]*c[1][2],
+	       d2 = c[2][0]*c[2][0] + c[2][1]*c[2][1] + c[2][2]*c[2][2];
+
+	int    k = (d0 >= d1) ? ((d0 >= d2) ? 0 : 2) : ((d1 >= d2) ? 1 : 2);
+	double d = (k==0) ? d0 : ((k==1) ? d1 : d2);
+	double s = 1. / std::sqrt( d );
+
+	v[0] = c[k][0]*s;
+	v[1] = c[k][1]*s;
+	v[2] = c[k][2]*s;
+}
+
+/// Analytic eigenvectors for all non-degenerate tensors of a block.
+void eigenvectorsAnalytic( Block& b, int n )
+{
+	for( int i=0; i < n; ++i )
+	{
+		if( b.degenerate[i] )
+			continue;
+
+		double inv = 1. / b.scale[i];
+		double A[6] = { b.a[0][i]*inv, b.a[1][i]*inv, b.a[2][i]*inv,
+		                b.a[3][i]*inv, b.a[4][i]*inv, b.a[5][i]*inv };
+
+		// Eigenvectors of the two extremal eigenvalues
+		double e0[3], e2[3];
+		eigenvectorCross( A, b.lambda[0][i], e0 );
+		eigenvectorCross( A, b.lambda[2][i], e2 );
+
+		// Enforce orthogonality via Gram-Schmidt
+		double dot = e0[0]*e2[0] + e0[1]*e2[1] + e0[2]*e2[2];
+		e2[0] -= dot*e0[0];  e2[1] -= dot*e0[1];  e2[2] -= dot*e0[2];
+		double s = 1. / std::sqrt( e2[0]*e2[0] + e2[1]*e2[1] + e2[2]*e2[2] );
+		e2[0] *= s;  e2[1] *= s;  e2[2] *= s;
+
+		// Middle eigenvector completes a right-handed basis, e1 = e2 x e0
+		double e1[3] = { e2[1]*e0[2] - e2[2]*e0[1],
+		                 e2[2]*e0[0] - e2[0]*e0[2],
+		                 e2[0]*e0[1] - e2[1]*e0[0] };
+
+		for( int j=0; j < 3; j++ )
+		{
+			b.R[  j][i] = e0[j];
+			b.R[3+j][i] = e1[j];
+			b.R[6+j][i] = e2[j];
+		}
+	}
+}
+
+/// Jacobi fallback for all degenerate tensors of a block.
+int eigensystemsJacobi( Block& b, int n )
+{
+	int count = 0;
+	for( int i=0; i < n; ++i )
+	{
+		if( !b.degenerate[i] )
+			continue;
+
+		double s = b.scale[i],
+		       inv = (s > 0.) ? 1./s : 0.;
+
+		Eigen::Matrix3d A;
+		A(0,0) = b.a[0][i]*inv;  A(0,1) = b.a[1][i]*inv;  A(0,2) = b.a[2][i]*inv;
+		A(1,0) = A(0,1);         A(1,1) = b.a[3][i]*inv;  A(1,2) = b.a[4][i]*inv;
+		A(2,0) = A(0,2);         A(2,1) = A(1,2);         A(2,2) = b.a[5][i]*inv;
+
+		Eigen::Vector3d lambda;
+		Eigen::Matrix3d R;
+		solveJacobi( A, lambda, R );
+
+		for( int k=0; k < 3; k++ )
+			b.lambda[k][i] = lambda(k);
+		for( int j=0; j < 9; j++ )
+			b.R[j][i] = R.data()[j];
+
+		count++;
+	}
+	return count;
+}
+
+} // anonymous namespace
+
+//-----------------------------------------------------------------------------
+void solveJacobi( const Eigen::Matrix3d& A_, Eigen::Vector3d& lambda, Eigen::Matrix3d& R )
+{
+	const int maxSweeps = 32;
+
+	Eigen::Matrix3d A = A_;
+	Eigen::Matrix3d V = Eigen::Matrix3d::Identity();
+
+	for( int sweep=0; sweep < maxSweeps; ++sweep )
+	{
+		double off  = A(0,1)*A(0,1) + A(0,2)*A(0,2) + A(1,2)*A(1,2),
+		       diag = A(0,0)*A(0,0) + A(1,1)*A(1,1) + A(2,2)*A(2,2);
+		if( off <= 1e-30 * diag || off == 0. )
+			break;
+
+		// Cyclic sweep over the upper off-diagonal entries
+		for( int p=0; p < 2; ++p )
+			for( int q=p+1; q < 3; ++q )
+			{
+				if( A(p,q) == 0. )
+					continue;
+
+				// Rotation angle annihilating A(p,q)
+				double theta = (A(q,q) - A(p,p)) / (2.*A(p,q)),
+				       t = ((theta >= 0.) ? 1. : -1.) /
+				           (std::fabs(theta) + std::sqrt(theta*theta + 1.)),
+				       c = 1. / std::sqrt(t*t + 1.),
+				       s = t*c;
+
+				Eigen::Matrix3d J = Eigen::Matrix3d::Identity();
+				J(p,p) = c;  J(p,q) = s;
+				J(q,p) = -s; J(q,q) = c;
+
+				A = J.transpose() * A * J;
+				A(p,q) = A(q,p) = 0.;
+				V = V * J;
+			}
+	}
+
+	// Sort descending
+	int idx[3] = { 0, 1, 2 };
+	for( int i=0; i < 2; i++ )
+		for( int j=i+1; j < 3; j++ )
+			if( A(idx[j],idx[j]) > A(idx[i],idx[i]) )
+				std::swap( idx[i], idx[j] );
+
+	for( int k=0; k < 3; k++ )
+	{
+		lambda(k) = A(idx[k],idx[k]);
+		R.col(k) = V.col(idx[k]);
+	}
+
+	// Turn reflection into rotation
+	if( R.determinant() < 0. )
+		R.col(2) *= -1.;
+}
+
+//-----------------------------------------------------------------------------
+SolveInfo solve( const TensorsSoA& in, EigenSystemsSoA& out, double degeneracyTolerance )
+{
+	SolveInfo info;
+	info.numTensors = in.n;
+
+	const int numBlocks = (in.n + BlockSize - 1) / BlockSize;
+	int numJacobi = 0;
+
+	#pragma omp parallel for schedule(static) reduction(+:numJacobi)
+	for( int blk=0; blk < numBlocks; ++blk )
+	{
+		Block b;
+		int first = blk * BlockSize,
+		    n = std::min( BlockSize, in.n - first );
+
+		// Gather strided input into contiguous lanes
+		for( int k=0; k < 6; k++ )
+		{
+			const double* src = in.a[k] + (size_t)first*in.stride;
+			for( int i=0; i < n; i++ )
+				b.a[k][i] = src[(size_t)i*in.stride];
+		}
+
+		eigenvaluesAnalytic ( b, n, degeneracyTolerance );
+		eigenvectorsAnalytic( b, n );
+		numJacobi += eigensystemsJacobi( b, n );
+
+		// Scatter results, undo normalization of eigenvalues
+		for( int k=0; k < 3; k++ )
+		{
+			double* dst = out.lambda[k] + (size_t)first*out.lambdaStride;
+			for( int i=0; i < n; i++ )
+				dst[(size_t)i*out.lambdaStride] = b.lambda[k][i] * b.scale[i];
+		}
+		for( int j=0; j < 9; j++ )
+		{
+			double* dst = out.R[j] + (size_t)first*out.RStride;
+			for( int i=0; i < n; i++ )
+				dst[(size_t)i*out.RStride] = b.R[j][i];
+		}
+	}
+
+	info.numJacobi = numJacobi;
+	return info;
+}
+
+//-----------------------------------------------------------------------------
+SolveInfo solve( const Eigen::MatrixXd& S, Eigen::MatrixXd& R, Eigen::Matrix3Xd& lambda )
+{
+	int n = (int)S.cols();
+	R     .resize( 9, n );
+	lambda.resize( 3, n );
+
+	// Column-major 6xn, 9xn and 3xn matrices are strided SoA views
+	TensorsSoA in;
+	in.n = n;
+	in.stride = 6;
+	for( int k=0; k < 6; k++ )
+		in.a[k] = S.data() + k;
+
+	EigenSystemsSoA out;
+	out.lambdaStride = 3;
+	out.RStride      = 9;
+	for( int k=0; k < 3; k++ )
+		out.lambda[k] = lambda.data() + k;
+	for( int j=0; j < 9; j++ )
+		out.R[j] = R.data() + j;
+
+	SolveInfo info = solve( in, out );
+	return info;
+}
+
+}; // namespace SymmetricEigensolver3
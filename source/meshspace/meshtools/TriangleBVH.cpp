@@ -0,0 +1,509 @@
+#include "TriangleBVH.h"
+#include <algorithm>
+#include <cmath>
+
+using Intersect::Ray;
+using Intersect::Vec3;
+
+namespace {
+
+const double Infinity = std::numeric_limits<double>::infinity();
+
+/// Ray data prepared for slab tests
+struct PreparedRay
+{
+	double org[3], invDir[3];
+
+	void set( const Ray& r )
+	{
+		const double dir[3] = { r.dir.x, r.dir.y, r.dir.z };
+		org[0] = r.origin.x;
+		org[1] = r.origin.y;
+		org[2] = r.origin.z;
+		for( int d=0; d < 3; d++ )
+			// Avoid 0*inf = NaN in slab test for axis aligned rays
+			invDir[d] = (dir[d] != 0.) ? 1./dir[d] : 1e300;
+	}
+};
+
+/// Slab test, returns true if ray hits box within [tmin,tmax]
+inline bool hitBox( const double* bmin, const double* bmax, const PreparedRay& r,
+	double tmin, double tmax )
+{
+	for( int d=0; d < 3; d++ )
+	{
+		double t0 = (bmin[d] - r.org[d]) * r.invDir[d],
+		       t1 = (bmax[d] - r.org[d]) * r.invDir[d];
+		if( t0 > t1 ) std::swap( t0, t1 );
+		if( t0 > tmin ) tmin = t0;
+		if( t1 < tmax ) tmax = t1;
+		if( tmin > tmax )
+			return false;
+	}
+	return true;
+}
+
+inline void resetBox( double* bmin, double* bmax )
+{
+	for( int d=0; d < 3; d++ )
+	{
+		bmin[d] =  Infinity;
+		bmax[d] = -Infinity;
+	}
+}
+
+inline void growBox( double* bmin, double* bmax, const double* omin, const double* omax )
+{
+	for( int d=0; d < 3; d++ )
+	{
+		bmin[d] = std::min( bmin[d], omin[d] );
+		bmax[d] = std::max( bmax[d], omax[d] );
+	}
+}
+
+inline double boxArea( const double* bmin, const double* bmax )
+{
+	double dx = bmax[0]-bmin[0], dy = bmax[1]-bmin[1], dz = bmax[2]-bmin[2];
+	if( dx < 0. || dy < 0. || dz < 0. ) return 0.;
+	return 2.*(dx*dy + dy*dz + dz*dx);
+}
+
+/// Comparison of build references by centroid along an axis
+struct CentroidLess
+{
+	int axis;
+	CentroidLess( int axis_ ): axis(axis_) {}
+	template<typename T>
+	bool operator () ( const T& a, const T& b ) const
+	{
+		return a.centroid[axis] < b.centroid[axis];
+	}
+};
+
+/// Predicate for partitioning build references by centroid bin
+struct CentroidBinLess
+{
+	int    axis;
+	double offset, scale;
+	int    numBins, split;
+	CentroidBinLess( int axis_, double offset_, double scale_, int numBins_, int split_ )
+	: axis(axis_), offset(offset_), scale(scale_), numBins(numBins_), split(split_)
+	{}
+	template<typename T>
+	bool operator () ( const T& a ) const
+	{
+		int b = std::min( (int)((a.centroid[axis] - offset) * scale), numBins-1 );
+		return b < split;
+	}
+};
+
+} // anonymous namespace
+
+//-----------------------------------------------------------------------------
+void TriangleBVH::build( const meshtools::Mesh& mesh )
+{
+	using meshtools::Mesh;
+
+	// Flat vertex array
+	std::vector<double> vertices( 3*mesh.n_vertices() );
+	for( int i=0; i < (int)mesh.n_vertices(); i++ )
+	{
+		const Mesh::Point& p = mesh.point( Mesh::VertexHandle( i ) );
+		vertices[3*i+0] = p[0];
+		vertices[3*i+1] = p[1];
+		vertices[3*i+2] = p[2];
+	}
+
+	// Flat index array of all triangles
+	std::vector<unsigned> indices;
+	std::vector<int>      faces;
+	indices.reserve( 3*mesh.n_faces() );
+	faces  .reserve(   mesh.n_faces() );
+	Mesh::ConstFaceIter f_it = mesh.faces_begin();
+	for( ; f_it != mesh.faces_end(); ++f_it )
+	{
+		unsigned idx[3];
+		int k=0;
+		Mesh::ConstFaceVertexIter fv_it = mesh.cfv_iter( f_it );
+		for( ; fv_it && k < 3; ++fv_it, k++ )
+			idx[k] = fv_it.handle().idx();
+		if( k < 3 )
+			continue;
+
+		indices.insert( indices.end(), idx, idx+3 );
+		faces.push_back( f_it.handle().idx() );
+	}
+
+	build( vertices, indices );
+
+	// Map back to mesh face indices
+	m_triOfFace.assign( mesh.n_faces(), -1 );
+	for( size_t i=0; i < m_faceIds.size(); i++ )
+	{
+		m_faceIds[i] = faces[ m_faceIds[i] ];
+		m_triOfFace[ m_faceIds[i] ] = (int)i;
+	}
+}
+
+//-----------------------------------------------------------------------------
+void TriangleBVH::build( const std::vector<double>& vertices, const std::vector<unsigned>& indices )
+{
+	m_vertices = vertices;
+	m_nodes.clear();
+	m_indices.clear();
+	m_faceIds.clear();
+
+	int numTris = (int)indices.size() / 3;
+	if( numTris == 0 )
+	{
+		m_triOfFace.clear();
+		return;
+	}
+
+	// Bounding box and centroid per triangle
+	std::vector<BuildRef> refs( numTris );
+	for( int t=0; t < numTris; t++ )
+	{
+		BuildRef& ref = refs[t];
+		ref.tri = t;
+		resetBox( ref.bmin, ref.bmax );
+		for( int k=0; k < 3; k++ )
+		{
+			const double* p = &m_vertices[ 3*indices[3*t+k] ];
+			growBox( ref.bmin, ref.bmax, p, p );
+		}
+		for( int d=0; d < 3; d++ )
+			ref.centroid[d] = 0.5*(ref.bmin[d] + ref.bmax[d]);
+	}
+
+	m_nodes.reserve( 2*numTris / MaxLeafSize + 1 );
+	buildRecursive( refs, 0, numTris );
+
+	// Store triangles in leaf order
+	m_indices.resize( 3*numTris );
+	m_faceIds.resize( numTris );
+	m_triOfFace.assign( numTris, -1 );
+	for( int i=0; i < numTris; i++ )
+	{
+		int t = refs[i].tri;
+		for( int k=0; k < 3; k++ )
+			m_indices[3*i+k] = indices[3*t+k];
+		m_faceIds  [i] = t;
+		m_triOfFace[t] = i;
+	}
+}
+
+//-----------------------------------------------------------------------------
+int TriangleBVH::buildRecursive( std::vector<BuildRef>& refs, int begin, int end )
+{
+	int nodeIdx = (int)m_nodes.size();
+	m_nodes.push_back( Node() );
+
+	// Node bounds and centroid bounds
+	Node node;
+	double cmin[3], cmax[3];
+	resetBox( node.bmin, node.bmax );
+	resetBox( cmin, cmax );
+	for( int i=begin; i < end; i++ )
+	{
+		growBox( node.bmin, node.bmax, refs[i].bmin, refs[i].bmax );
+		growBox( cmin, cmax, refs[i].centroid, refs[i].centroid );
+	}
+	node.first = begin;
+	node.count = end - begin;
+	node.axis  = 0;
+
+	// Split along largest centroid extent
+	int axis = 0;
+	for( int d=1; d < 3; d++ )
+		if( cmax[d]-cmin[d] > cmax[axis]-cmin[axis] )
+			axis = d;
+	double extent = cmax[axis] - cmin[axis];
+
+	if( node.count <= MaxLeafSize || extent <= 0. )
+	{
+		m_nodes[nodeIdx] = node;
+		return nodeIdx;
+	}
+
+	// Bin centroids
+	int    binCount[NumBins];
+	double binMin[NumBins][3], binMax[NumBins][3];
+	for( int b=0; b < NumBins; b++ )
+	{
+		binCount[b] = 0;
+		resetBox( binMin[b], binMax[b] );
+	}
+	double binScale = NumBins / extent;
+	for( int i=begin; i < end; i++ )
+	{
+		int b = std::min( (int)((refs[i].centroid[axis] - cmin[axis]) * binScale), (int)NumBins-1 );
+		binCount[b]++;
+		growBox( binMin[b], binMax[b], refs[i].bmin, refs[i].bmax );
+	}
+
+	// Sweep from right to get area and count right of each split plane
+	double rightArea[NumBins];
+	int    rightCount[NumBins];
+	double amin[3], amax[3];
+	resetBox( amin, amax );
+	int count = 0;
+	for( int b=NumBins-1; b > 0; b-- )
+	{
+		growBox( amin, amax, binMin[b], binMax[b] );
+		count += binCount[b];
+		rightArea [b] = boxArea( amin, amax );
+		rightCount[b] = count;
+	}
+
+	// Sweep from left and evaluate SAH cost for split between bin b-1 and b
+	int    bestSplit = -1;
+	double bestCost  = Infinity;
+	resetBox( amin, amax );
+	count = 0;
+	for( int b=1; b < NumBins; b++ )
+	{
+		growBox( amin, amax, binMin[b-1], binMax[b-1] );
+		count += binCount[b-1];
+		if( count == 0 || rightCount[b] == 0 )
+			continue;
+		double cost = boxArea( amin, amax )*count + rightArea[b]*rightCount[b];
+		if( cost < bestCost )
+		{
+			bestCost  = cost;
+			bestSplit = b;
+		}
+	}
+
+	// Partition, fall back to median split if binning was degenerate
+	int mid;
+	if( bestSplit > 0 )
+	{
+		BuildRef* pmid = std::partition( &refs[0]+begin, &refs[0]+end,
+			CentroidBinLess( axis, cmin[axis], binScale, NumBins, bestSplit ) );
+		mid = (int)(pmid - &refs[0]);
+	}
+	else
+	{
+		mid = (begin + end) / 2;
+		std::nth_element( refs.begin()+begin, refs.begin()+mid, refs.begin()+end,
+			CentroidLess( axis ) );
+	}
+
+	// Inner node, left child follows directly
+	node.count = 0;
+	node.axis  = axis;
+	buildRecursive( refs, begin, mid );
+	node.first = buildRecursive( refs, mid, end );
+	m_nodes[nodeIdx] = node;
+	return nodeIdx;
+}
+
+//-----------------------------------------------------------------------------
+Intersect::Triangle TriangleBVH::triangle( int tri ) const
+{
+	const double *p0 = &m_vertices[ 3*m_indices[3*tri+0] ],
+	             *p1 = &m_vertices[ 3*m_indices[3*tri+1] ],
+	             *p2 = &m_vertices[ 3*m_indices[3*tri+2] ];
+	Intersect::Triangle t;
+	t.v0 = Vec3( p0[0], p0[1], p0[2] );
+	t.v1 = Vec3( p1[0], p1[1], p1[2] );
+	t.v2 = Vec3( p2[0], p2[1], p2[2] );
+	return t;
+}
+
+//-----------------------------------------------------------------------------
+bool TriangleBVH::intersectTriangle( const Ray& ray, int tri, double tmin,
+	double tmax, Hit& hit ) const
+{
+	Intersect::RayTriangleIntersection rti = Intersect::intersect( ray, triangle( tri ) );
+
+	// Negated comparisons also reject NaN for rays parallel to triangle
+	if( !rti.bc.is_inside() || !(rti.t >= tmin) || !(rti.t < tmax) )
+		return false;
+
+	hit.face = m_faceIds[tri];
+	hit.t    = rti.t;
+	hit.bc   = rti.bc;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+void TriangleBVH::intersectPacket( const Ray* rays, int n, double tmin,
+	double* tmax, Hit* hits ) const
+{
+	if( m_nodes.empty() )
+		return;
+
+	PreparedRay pr[PacketSize];
+	for( int r=0; r < n; r++ )
+		pr[r].set( rays[r] );
+
+	// Front-to-back order of children is taken from first ray of packet
+	const double dir0[3] = { rays[0].dir.x, rays[0].dir.y, rays[0].dir.z };
+
+	std::vector<int> stack;
+	stack.reserve( 64 );
+	stack.push_back( 0 );
+	while( !stack.empty() )
+	{
+		const Node& node = m_nodes[ stack.back() ];
+		int nodeIdx = stack.back();
+		stack.pop_back();
+
+		// Rays of packet hitting this node
+		bool active[PacketSize];
+		bool any = false;
+		for( int r=0; r < n; r++ )
+		{
+			active[r] = hitBox( node.bmin, node.bmax, pr[r], tmin, tmax[r] );
+			any |= active[r];
+		}
+		if( !any )
+			continue;
+
+		if( node.count > 0 )
+		{
+			// Leaf, shrink ray intervals to closest hit so far
+			for( int i=node.first; i < node.first + node.count; i++ )
+				for( int r=0; r < n; r++ )
+					if( active[r] && intersectTriangle( rays[r], i, tmin, tmax[r], hits[r] ) )
+						tmax[r] = hits[r].t;
+		}
+		else
+		{
+			// Visit near child first, i.e. push it last
+			int left = nodeIdx + 1, right = node.first;
+			if( dir0[node.axis] >= 0. )
+			{
+				stack.push_back( right );
+				stack.push_back( left );
+			}
+			else
+			{
+				stack.push_back( left );
+				stack.push_back( right );
+			}
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+TriangleBVH::Hit TriangleBVH::intersect( const Ray& ray, double tmin, double tmax ) const
+{
+	Hit hit;
+	intersectPacket( &ray, 1, tmin, &tmax, &hit );
+	return hit;
+}
+
+//-----------------------------------------------------------------------------
+TriangleBVH::Hit TriangleBVH::intersectLine( const Ray& ray ) const
+{
+	Hit hit = intersect( ray );
+
+	// Search opposite direction only up to distance of forward hit
+	Ray back( ray.origin, ray.dir * -1. );
+	double tmax = hit.valid() ? hit.t : Infinity;
+	Hit backHit;
+	intersectPacket( &back, 1, 0., &tmax, &backHit );
+	if( backHit.valid() )
+	{
+		backHit.t = -backHit.t;
+		return backHit;
+	}
+	return hit;
+}
+
+//-----------------------------------------------------------------------------
+void TriangleBVH::intersect( const std::vector<Ray>& rays, std::vector<Hit>& hits,
+	bool bothDirections ) const
+{
+	int n = (int)rays.size();
+	hits.assign( n, Hit() );
+	if( n == 0 )
+		return;
+
+	int numPackets = (n + PacketSize - 1) / PacketSize;
+	#pragma omp parallel for schedule(dynamic,16)
+	for( int p=0; p < numPackets; p++ )
+	{
+		int begin = p*PacketSize,
+		    count = std::min( (int)PacketSize, n - begin );
+
+		double tmax[PacketSize];
+		for( int r=0; r < count; r++ )
+			tmax[r] = Infinity;
+
+		intersectPacket( &rays[begin], count, 0., tmax, &hits[begin] );
+
+		if( bothDirections )
+		{
+			// Opposite direction, bounded by distance of forward hits
+			Ray back[PacketSize];
+			Hit backHits[PacketSize];
+			for( int r=0; r < count; r++ )
+				back[r] = Ray( rays[begin+r].origin, rays[begin+r].dir * -1. );
+
+			intersectPacket( back, count, 0., tmax, backHits );
+
+			for( int r=0; r < count; r++ )
+				if( backHits[r].valid() )
+				{
+					backHits[r].t = -backHits[r].t;
+					hits[begin+r] = backHits[r];
+				}
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+void TriangleBVH::queryPlanes( const double (*planes)[4], int numPlanes,
+	std::vector<int>& faces ) const
+{
+	faces.clear();
+	if( m_nodes.empty() )
+		return;
+
+	std::vector<int> stack;
+	stack.reserve( 64 );
+	stack.push_back( 0 );
+	while( !stack.empty() )
+	{
+		int nodeIdx = stack.back();
+		const Node& node = m_nodes[ nodeIdx ];
+		stack.pop_back();
+
+		// Box is outside if even its corner furthest along a plane normal is
+		// on the outer side of that plane
+		bool outside = false;
+		for( int i=0; i < numPlanes && !outside; i++ )
+		{
+			const double* pl = planes[i];
+			double dist = pl[3];
+			for( int d=0; d < 3; d++ )
+				dist += pl[d] * (pl[d] >= 0. ? node.bmax[d] : node.bmin[d]);
+			outside = dist < 0.;
+		}
+		if( outside )
+			continue;
+
+		if( node.count > 0 )
+		{
+			for( int i=node.first; i < node.first + node.count; i++ )
+				faces.push_back( m_faceIds[i] );
+		}
+		else
+		{
+			stack.push_back( node.first );
+			stack.push_back( nodeIdx + 1 );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+Vec3 TriangleBVH::hitPoint( const Hit& hit ) const
+{
+	if( !hit.valid() || hit.face >= (int)m_triOfFace.size() || m_triOfFace[hit.face] < 0 )
+		return Vec3();
+	return triangle( m_triOfFace[hit.face] ).barycentric( hit.bc );
+}
@@ -0,0 +1,639 @@
+#include "VertexSelection.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+typedef unsigned long long Word;
+
+inline unsigned popcount( Word w )
+{
+#if defined(__GNUC__)
+	return (unsigned)__builtin_popcountll( w );
+#else
+	w = w - ((w >> 1) & 0x5555555555555555ULL);
+	w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+	w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return (unsigned)((w * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/// Index of lowest set bit, w must not be zero
+inline unsigned lowestBit( Word w )
+{
+#if defined(__GNUC__)
+	return (unsigned)__builtin_ctzll( w );
+#else
+	unsigned n = 0;
+	while( !(w & 1) ) { w >>= 1; n++; }
+	return n;
+#endif
+}
+
+/// Call f(index) for all set bits in ascending order
+template<typename F>
+void forEachBit( const std::vector<Word>& words, unsigned base, F& f )
+{
+	for( unsigned i=0; i < words.size(); i++ )
+	{
+		Word w = words[i];
+		while( w )
+		{
+			f( base + 64*i + lowestBit( w ) );
+			w &= w - 1;
+		}
+	}
+}
+
+/// Collects indices
+struct IndexCollector
+{
+	std::vector<unsigned>& idx;
+	IndexCollector( std::vector<unsigned>& idx_ ): idx(idx_) {}
+	void operator () ( unsigned i ) { idx.push_back( i ); }
+};
+
+/// Merges consecutive indices into runs
+struct RunCollector
+{
+	std::vector<VertexSelection::Run>& runs;
+	RunCollector( std::vector<VertexSelection::Run>& runs_ ): runs(runs_) {}
+	void operator () ( unsigned i )
+	{
+		if( !runs.empty() && runs.back().first + runs.back().second == i )
+			runs.back().second++;
+		else
+			runs.push_back( VertexSelection::Run( i, 1 ) );
+	}
+};
+
+/// Traverse all indices of a chunk in ascending order
+template<typename Chunk, typename F>
+void forEachIndex( const Chunk& c, F& f )
+{
+	unsigned base = c.key << VertexSelection::ChunkBits;
+	if( c.isBitmap() )
+		forEachBit( c.bitmap, base, f );
+	else
+		for( size_t i=0; i < c.array.size(); i++ )
+			f( base + c.array[i] );
+}
+
+/// Split sorted unique indices into groups of equal chunk key
+inline size_t groupEnd( const std::vector<unsigned>& sorted, size_t begin )
+{
+	unsigned key = sorted[begin] >> VertexSelection::ChunkBits;
+	size_t end = begin;
+	while( end < sorted.size() && (sorted[end] >> VertexSelection::ChunkBits) == key )
+		end++;
+	return end;
+}
+
+inline void sortUnique( const std::vector<unsigned>& idx, std::vector<unsigned>& sorted )
+{
+	sorted = idx;
+	std::sort( sorted.begin(), sorted.end() );
+	sorted.erase( std::unique( sorted.begin(), sorted.end() ), sorted.end() );
+}
+
+} // anonymous namespace
+
+//-----------------------------------------------------------------------------
+//  Chunk
+//-----------------------------------------------------------------------------
+
+bool VertexSelection::Chunk::contains( unsigned short low ) const
+{
+	if( isBitmap() )
+		return (bitmap[low >> 6] >> (low & 63)) & 1;
+	return std::binary_search( array.begin(), array.end(), low );
+}
+
+bool VertexSelection::Chunk::insert( unsigned short low )
+{
+	if( isBitmap() )
+	{
+		Word& w = bitmap[low >> 6];
+		Word bit = Word(1) << (low & 63);
+		if( w & bit )
+			return false;
+		w |= bit;
+		count++;
+		return true;
+	}
+
+	std::vector<unsigned short>::iterator it = std::lower_bound( array.begin(), array.end(), low );
+	if( it != array.end() && *it == low )
+		return false;
+	array.insert( it, low );
+	count++;
+	if( count > ArrayMax )
+		toBitmap();
+	return true;
+}
+
+bool VertexSelection::Chunk::erase( unsigned short low )
+{
+	if( isBitmap() )
+	{
+		Word& w = bitmap[low >> 6];
+		Word bit = Word(1) << (low & 63);
+		if( !(w & bit) )
+			return false;
+		w &= ~bit;
+		count--;
+		// Hysteresis avoids repeated conversion around ArrayMax
+		if( count < ArrayMax/2 )
+			toArray();
+		return true;
+	}
+
+	std::vector<unsigned short>::iterator it = std::lower_bound( array.begin(), array.end(), low );
+	if( it == array.end() || *it != low )
+		return false;
+	array.erase( it );
+	count--;
+	return true;
+}
+
+void VertexSelection::Chunk::toBitmap()
+{
+	if( isBitmap() )
+		return;
+	std::vector<Word> w;
+	words( w );
+	bitmap.swap( w );
+	std::vector<unsigned short>().swap( array );
+}
+
+void VertexSelection::Chunk::toArray()
+{
+	if( !isBitmap() )
+		return;
+	array.clear();
+	array.reserve( count );
+	for( unsigned i=0; i < BitmapWords; i++ )
+	{
+		Word w = bitmap[i];
+		while( w )
+		{
+			array.push_back( (unsigned short)(64*i + lowestBit( w )) );
+			w &= w - 1;
+		}
+	}
+	std::vector<Word>().swap( bitmap );
+}
+
+void VertexSelection::Chunk::optimize()
+{
+	if( isBitmap() && count <= ArrayMax )
+		toArray();
+	else
+	if( !isBitmap() && count > ArrayMax )
+		toBitmap();
+}
+
+void VertexSelection::Chunk::words( std::vector<Word>& w ) const
+{
+	if( isBitmap() )
+	{
+		w = bitmap;
+		return;
+	}
+	w.assign( BitmapWords, 0 );
+	for( size_t i=0; i < array.size(); i++ )
+		w[ array[i] >> 6 ] |= Word(1) << (array[i] & 63);
+}
+
+void VertexSelection::Chunk::setWords( const std::vector<Word>& w )
+{
+	bitmap = w;
+	std::vector<unsigned short>().swap( array );
+	count = 0;
+	for( unsigned i=0; i < BitmapWords; i++ )
+		count += popcount( bitmap[i] );
+	optimize();
+}
+
+//-----------------------------------------------------------------------------
+//  Chunk lookup
+//-----------------------------------------------------------------------------
+
+size_t VertexSelection::lowerBound( unsigned key ) const
+{
+	size_t lo = 0, hi = m_chunks.size();
+	while( lo < hi )
+	{
+		size_t mid = (lo + hi) / 2;
+		if( m_chunks[mid].key < key )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+VertexSelection::Chunk* VertexSelection::findChunk( unsigned key )
+{
+	size_t i = lowerBound( key );
+	return (i < m_chunks.size() && m_chunks[i].key == key) ? &m_chunks[i] : NULL;
+}
+
+const VertexSelection::Chunk* VertexSelection::findChunk( unsigned key ) const
+{
+	size_t i = lowerBound( key );
+	return (i < m_chunks.size() && m_chunks[i].key == key) ? &m_chunks[i] : NULL;
+}
+
+VertexSelection::Chunk& VertexSelection::getChunk( unsigned key )
+{
+	size_t i = lowerBound( key );
+	if( i == m_chunks.size() || m_chunks[i].key != key )
+		m_chunks.insert( m_chunks.begin() + i, Chunk( key ) );
+	return m_chunks[i];
+}
+
+void VertexSelection::removeEmptyChunks()
+{
+	size_t j = 0;
+	for( size_t i=0; i < m_chunks.size(); i++ )
+		if( m_chunks[i].count > 0 )
+		{
+			if( i != j )
+				std::swap( m_chunks[j], m_chunks[i] );
+			j++;
+		}
+	m_chunks.resize( j );
+}
+
+//-----------------------------------------------------------------------------
+//  Element access
+//-----------------------------------------------------------------------------
+
+size_t VertexSelection::size() const
+{
+	size_t n = 0;
+	for( size_t i=0; i < m_chunks.size(); i++ )
+		n += m_chunks[i].count;
+	return n;
+}
+
+bool VertexSelection::contains( unsigned idx ) const
+{
+	const Chunk* c = findChunk( idx >> ChunkBits );
+	return c && c->contains( (unsigned short)(idx & (ChunkSize-1)) );
+}
+
+void VertexSelection::insert( unsigned idx )
+{
+	getChunk( idx >> ChunkBits ).insert( (unsigned short)(idx & (ChunkSize-1)) );
+}
+
+void VertexSelection::erase( unsigned idx )
+{
+	Chunk* c = findChunk( idx >> ChunkBits );
+	if( c && c->erase( (unsigned short)(idx & (ChunkSize-1)) ) && c->count == 0 )
+		removeEmptyChunks();
+}
+
+void VertexSelection::insert( const std::vector<unsigned>& idx )
+{
+	std::vector<unsigned> sorted;
+	sortUnique( idx, sorted );
+
+	for( size_t begin=0; begin < sorted.size(); )
+	{
+		size_t end = groupEnd( sorted, begin );
+		Chunk& c = getChunk( sorted[begin] >> ChunkBits );
+
+		if( !c.isBitmap() && c.count + (end - begin) > ArrayMax )
+			c.toBitmap();
+
+		if( c.isBitmap() )
+		{
+			for( size_t i=begin; i < end; i++ )
+				c.insert( (unsigned short)(sorted[i] & (ChunkSize-1)) );
+		}
+		else
+		{
+			// Merge sorted lists
+			std::vector<unsigned short> low, merged;
+			low.reserve( end - begin );
+			for( size_t i=begin; i < end; i++ )
+				low.push_back( (unsigned short)(sorted[i] & (ChunkSize-1)) );
+			merged.reserve( c.array.size() + low.size() );
+			std::set_union( c.array.begin(), c.array.end(), low.begin(), low.end(),
+				std::back_inserter( merged ) );
+			c.array.swap( merged );
+			c.count = (unsigned)c.array.size();
+		}
+		c.optimize();
+		begin = end;
+	}
+}
+
+void VertexSelection::erase( const std::vector<unsigned>& idx )
+{
+	std::vector<unsigned> sorted;
+	sortUnique( idx, sorted );
+
+	for( size_t begin=0; begin < sorted.size(); )
+	{
+		size_t end = groupEnd( sorted, begin );
+		Chunk* c = findChunk( sorted[begin] >> ChunkBits );
+		if( c && c->isBitmap() )
+		{
+			for( size_t i=begin; i < end; i++ )
+			{
+				unsigned short low = (unsigned short)(sorted[i] & (ChunkSize-1));
+				Word& w = c->bitmap[low >> 6];
+				Word bit = Word(1) << (low & 63);
+				if( w & bit )
+				{
+					w &= ~bit;
+					c->count--;
+				}
+			}
+			c->optimize();
+		}
+		else
+		if( c )
+		{
+			std::vector<unsigned short> low, remaining;
+			low.reserve( end - begin );
+			for( size_t i=begin; i < end; i++ )
+				low.push_back( (unsigned short)(sorted[i] & (ChunkSize-1)) );
+			std::set_difference( c->array.begin(), c->array.end(), low.begin(), low.end(),
+				std::back_inserter( remaining ) );
+			c->array.swap( remaining );
+			c->count = (unsigned)c->array.size();
+		}
+		begin = end;
+	}
+	removeEmptyChunks();
+}
+
+void VertexSelection::insertRange( unsigned first, unsigned last )
+{
+	std::vector<Word> w;
+	while( first < last )
+	{
+		unsigned key = first >> ChunkBits,
+		         lo  = first & (ChunkSize-1),
+		         hi  = std::min( last - (key << ChunkBits), (unsigned)ChunkSize );
+
+		Chunk& c = getChunk( key );
+		c.words( w );
+		for( unsigned i=lo; i < hi; )
+		{
+			if( (i & 63) == 0 && i + 64 <= hi )
+			{
+				w[i >> 6] = ~Word(0);
+				i += 64;
+			}
+			else
+			{
+				w[i >> 6] |= Word(1) << (i & 63);
+				i++;
+			}
+		}
+		c.setWords( w );
+
+		first = (key << ChunkBits) + hi;
+		if( hi == (unsigned)ChunkSize && first == 0 )
+			break; // Overflow at end of unsigned range
+	}
+}
+
+//-----------------------------------------------------------------------------
+//  Set algebra
+//-----------------------------------------------------------------------------
+
+VertexSelection& VertexSelection::operator |= ( const VertexSelection& other )
+{
+	std::vector<Chunk> result;
+	result.reserve( m_chunks.size() + other.m_chunks.size() );
+	std::vector<Word> wa, wb;
+
+	size_t i=0, j=0;
+	while( i < m_chunks.size() || j < other.m_chunks.size() )
+	{
+		if( j == other.m_chunks.size() || (i < m_chunks.size() && m_chunks[i].key < other.m_chunks[j].key) )
+			result.push_back( m_chunks[i++] );
+		else
+		if( i == m_chunks.size() || other.m_chunks[j].key < m_chunks[i].key )
+			result.push_back( other.m_chunks[j++] );
+		else
+		{
+			const Chunk &a = m_chunks[i++], &b = other.m_chunks[j++];
+			Chunk c( a.key );
+			if( !a.isBitmap() && !b.isBitmap() && a.count + b.count <= ArrayMax )
+			{
+				std::set_union( a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+					std::back_inserter( c.array ) );
+				c.count = (unsigned)c.array.size();
+			}
+			else
+			{
+				a.words( wa );
+				b.words( wb );
+				for( unsigned k=0; k < BitmapWords; k++ )
+					wa[k] |= wb[k];
+				c.setWords( wa );
+			}
+			result.push_back( c );
+		}
+	}
+	m_chunks.swap( result );
+	return *this;
+}
+
+VertexSelection& VertexSelection::operator &= ( const VertexSelection& other )
+{
+	std::vector<Word> wa, wb;
+	for( size_t i=0; i < m_chunks.size(); i++ )
+	{
+		Chunk& a = m_chunks[i];
+		const Chunk* b = other.findChunk( a.key );
+		if( !b )
+		{
+			a.count = 0;
+			continue;
+		}
+
+		if( !a.isBitmap() || !b->isBitmap() )
+		{
+			// Result is sparse, filter array entries
+			const Chunk& sparse = a.isBitmap() ? *b : a;
+			const Chunk& test   = a.isBitmap() ? a : *b;
+			std::vector<unsigned short> kept;
+			for( size_t k=0; k < sparse.array.size(); k++ )
+				if( test.contains( sparse.array[k] ) )
+					kept.push_back( sparse.array[k] );
+			std::vector<Word>().swap( a.bitmap );
+			a.array.swap( kept );
+			a.count = (unsigned)a.array.size();
+		}
+		else
+		{
+			a.words( wa );
+			b->words( wb );
+			for( unsigned k=0; k < BitmapWords; k++ )
+				wa[k] &= wb[k];
+			a.setWords( wa );
+		}
+	}
+	removeEmptyChunks();
+	return *this;
+}
+
+VertexSelection& VertexSelection::operator -= ( const VertexSelection& other )
+{
+	std::vector<Word> wa, wb;
+	for( size_t i=0; i < m_chunks.size(); i++ )
+	{
+		Chunk& a = m_chunks[i];
+		const Chunk* b = other.findChunk( a.key );
+		if( !b )
+			continue;
+
+		if( !a.isBitmap() )
+		{
+			std::vector<unsigned short> kept;
+			for( size_t k=0; k < a.array.size(); k++ )
+				if( !b->contains( a.array[k] ) )
+					kept.push_back( a.array[k] );
+			a.array.swap( kept );
+			a.count = (unsigned)a.array.size();
+		}
+		else
+		{
+			a.words( wa );
+			b->words( wb );
+			for( unsigned k=0; k < BitmapWords; k++ )
+				wa[k] &= ~wb[k];
+			a.setWords( wa );
+		}
+	}
+	removeEmptyChunks();
+	return *this;
+}
+
+bool VertexSelection::operator == ( const VertexSelection& other ) const
+{
+	if( m_chunks.size() != other.m_chunks.size() )
+		return false;
+
+	std::vector<Word> wa, wb;
+	for( size_t i=0; i < m_chunks.size(); i++ )
+	{
+		const Chunk &a = m_chunks[i], &b = other.m_chunks[i];
+		if( a.key != b.key || a.count != b.count )
+			return false;
+		if( a.isBitmap() == b.isBitmap() )
+		{
+			if( a.array != b.array || a.bitmap != b.bitmap )
+				return false;
+		}
+		else
+		{
+			a.words( wa );
+			b.words( wb );
+			if( wa != wb )
+				return false;
+		}
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//  Export
+//-----------------------------------------------------------------------------
+
+void VertexSelection::toIndices( std::vector<unsigned>& idx ) const
+{
+	idx.clear();
+	idx.reserve( size() );
+	IndexCollector f( idx );
+	for( size_t i=0; i < m_chunks.size(); i++ )
+		forEachIndex( m_chunks[i], f );
+}
+
+void VertexSelection::toRuns( std::vector<Run>& runs ) const
+{
+	runs.clear();
+	RunCollector f( runs );
+	for( size_t i=0; i < m_chunks.size(); i++ )
+		forEachIndex( m_chunks[i], f );
+}
+
+void VertexSelection::toMask( std::vector<float>& mask, unsigned size ) const
+{
+	mask.assign( size, 0.f );
+	std::vector<unsigned> idx;
+	toIndices( idx );
+	for( size_t i=0; i < idx.size() && idx[i] < size; i++ )
+		mask[ idx[i] ] = 1.f;
+}
+
+void VertexSelection::fromRuns( const std::vector<Run>& runs )
+{
+	clear();
+	for( size_t i=0; i < runs.size(); i++ )
+		insertRange( runs[i].first, runs[i].first + runs[i].second );
+}
+
+//-----------------------------------------------------------------------------
+//  Topological operations
+//-----------------------------------------------------------------------------
+
+void VertexSelection::grow( const meshtools::Mesh& mesh, int rings )
+{
+	using meshtools::Mesh;
+
+	std::vector<unsigned> front;
+	toIndices( front );
+	for( int r=0; r < rings && !front.empty(); r++ )
+	{
+		std::vector<unsigned> added;
+		for( size_t i=0; i < front.size(); i++ )
+		{
+			if( front[i] >= mesh.n_vertices() )
+				continue;
+			Mesh::ConstVertexVertexIter vv_it = mesh.cvv_iter( Mesh::VertexHandle( front[i] ) );
+			for( ; vv_it; ++vv_it )
+				if( !contains( vv_it.handle().idx() ) )
+					added.push_back( vv_it.handle().idx() );
+		}
+		insert( added );
+
+		// Next ring only needs to be grown from newly added vertices
+		sortUnique( added, front );
+	}
+}
+
+void VertexSelection::shrink( const meshtools::Mesh& mesh, int rings )
+{
+	using meshtools::Mesh;
+
+	for( int r=0; r < rings && !empty(); r++ )
+	{
+		std::vector<unsigned> idx, removed;
+		toIndices( idx );
+		for( size_t i=0; i < idx.size(); i++ )
+		{
+			if( idx[i] >= mesh.n_vertices() )
+				continue;
+			Mesh::ConstVertexVertexIter vv_it = mesh.cvv_iter( Mesh::VertexHandle( idx[i] ) );
+			for( ; vv_it; ++vv_it )
+				if( !contains( vv_it.handle().idx() ) )
+				{
+					removed.push_back( idx[i] );
+					break;
+				}
+		}
+		if( removed.empty() )
+			break;
+		erase( removed );
+	}
+}
@@ -0,0 +1,676 @@
+// meshbench - Timing harness for the meshtools analysis functions
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include "meshtools.h"
+#include "MeshBuffer.h"
+#include "ShapePCA.h"
+#include "ShapeCovariance.h"
+#include "MeshLaplacian.h"
+#include "../meshspace/PAMClustering.h"
+#include "../meshspace/filters.h"
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#endif
+
+using namespace meshtools;
+
+const char g_usage[] =
+"meshbench - Benchmark meshtools analysis functions on synthetic shape data.\n"
+"\n"
+"Usage: meshbench [options]\n"
+"\n"
+"Options:\n"
+"  -s <levels>   Comma separated icosphere subdivision levels (default 2,3,4)\n"
+"  -f <frames>   Number of shapes per dataset (default 32)\n"
+"  -t <threads>  Comma separated thread counts (default 1,2,4,... up to max.)\n"
+"  -r <repeat>   Repetitions per measurement (default 3)\n"
+"  -b <names>    Comma separated subset of benchmarks to run (default all)\n"
+"  -o <file>     Write JSON report to file instead of stdout\n"
+"  -l            List available benchmarks\n"
+"\n"
+"Each dataset consists of noisy low-frequency deformations of an icosphere.\n"
+"Datasets are generated with a fixed seed, i.e. results of different runs \n"
+"and builds are directly comparable. The report lists minimum and mean \n"
+"wall-clock time, throughput, peak resident set size increase over the \n"
+"memory in use before the benchmark and speedup relative to the first \n"
+"thread count.\n";
+
+//-----------------------------------------------------------------------------
+//  Utilities
+//-----------------------------------------------------------------------------
+
+/// Wall-clock stopwatch
+class Stopwatch
+{
+public:
+	typedef std::chrono::high_resolution_clock Clock;
+
+	Stopwatch(): m_elapsed(0.) {}
+	void start() { m_start = Clock::now(); }
+	void stop()
+	{
+		m_elapsed += std::chrono::duration<double>( Clock::now() - m_start ).count();
+	}
+	void reset() { m_elapsed = 0.; }
+	double elapsed() const { return m_elapsed; }
+
+private:
+	Clock::time_point m_start;
+	double m_elapsed;
+};
+
+/// Current resident set size of this process in MB
+double currentRSS()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS pmc;
+	if( GetProcessMemoryInfo( GetCurrentProcess(), &pmc, sizeof(pmc) ) )
+		return pmc.WorkingSetSize / (1024.*1024.);
+	return 0.;
+#elif defined(__APPLE__)
+	mach_task_basic_info info;
+	mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+	if( task_info( mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count ) == KERN_SUCCESS )
+		return info.resident_size / (1024.*1024.);
+	return 0.;
+#else
+	// Field "VmRSS" of /proc/self/status
+	std::ifstream f( "/proc/self/status" );
+	std::string line;
+	while( std::getline( f, line ) )
+		if( line.compare( 0, 6, "VmRSS:" ) == 0 )
+			return atof( line.c_str() + 6 ) / 1024.; // kilobytes
+	return 0.;
+#endif
+}
+
+/**
+	Peak resident set size increase during a benchmark run in MB.
+
+	The process wide high-water mark (getrusage) only ever grows over all
+	benchmarks run so far. Instead, on Linux the kernel high-water mark VmHWM
+	is reset to the current RSS on start(); elsewhere a background thread
+	samples the current RSS every millisecond. The baseline is the RSS just
+	before the run, i.e. the input dataset is not included.
+*/
+class RSSMonitor
+{
+public:
+	RSSMonitor(): m_baseline(0.), m_peak(0.), m_running(false) {}
+	~RSSMonitor() { stop(); }
+
+	void start()
+	{
+		m_baseline = m_peak = currentRSS();
+	#if !defined(_WIN32) && !defined(__APPLE__)
+		// Writing "5" to clear_refs resets VmHWM (since Linux 4.0)
+		std::ofstream f( "/proc/self/clear_refs" );
+		f << "5";
+		f.close();
+		if( f ) return;
+	#endif
+		m_running = true;
+		m_sampler = std::thread( &RSSMonitor::sample, this );
+	}
+
+	/// Stop monitoring and return peak increase over baseline in MB
+	double stop()
+	{
+		if( m_running )
+		{
+			m_running = false;
+			m_sampler.join();
+		}
+	#if !defined(_WIN32) && !defined(__APPLE__)
+		else
+			m_peak = std::max( m_peak, vmHWM() );
+	#endif
+		return std::max( m_peak - m_baseline, 0. );
+	}
+
+private:
+	void sample()
+	{
+		while( m_running )
+		{
+			m_peak = std::max( m_peak, currentRSS() );
+			std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+		}
+		m_peak = std::max( m_peak, currentRSS() );
+	}
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+	static double vmHWM()
+	{
+		std::ifstream f( "/proc/self/status" );
+		std::string line;
+		while( std::getline( f, line ) )
+			if( line.compare( 0, 6, "VmHWM:" ) == 0 )
+				return atof( line.c_str() + 6 ) / 1024.; // kilobytes
+		return 0.;
+	}
+#endif
+
+	double m_baseline, m_peak;
+	std::atomic<bool> m_running;
+	std::thread m_sampler;
+};
+
+int maxThreads()
+{
+#ifdef USE_OPENMP
+	return omp_get_num_procs();
+#else
+	return 1;
+#endif
+}
+
+void setNumThreads( int n )
+{
+#ifdef USE_OPENMP
+	omp_set_num_threads( n );
+#endif
+}
+
+/// Deterministic random numbers, independent of platform rand()
+class Random
+{
+public:
+	Random( unsigned seed ): m_state( seed ) {}
+
+	/// Uniform in [0,1)
+	double uniform()
+	{
+		m_state = 1664525u * m_state + 1013904223u;
+		return (m_state >> 8) / 16777216.;
+	}
+
+	/// Standard normal distribution (Box-Muller)
+	double normal()
+	{
+		double u1 = uniform() + 1e-12,
+		       u2 = uniform();
+		return sqrt( -2.*log(u1) ) * cos( 6.283185307179586*u2 );
+	}
+
+private:
+	unsigned m_state;
+};
+
+/// Silent progress reporter, suppresses console progress output
+class NoProgress : public ProgressReporter
+{
+public:
+	void setProgress( double ) {}
+	bool isCancelled() const { return false; }
+};
+
+std::vector<int> parseIntList( const char* s )
+{
+	std::vector<int> list;
+	std::stringstream ss( s );
+	std::string item;
+	while( std::getline( ss, item, ',' ) )
+		if( !item.empty() )
+			list.push_back( atoi( item.c_str() ) );
+	return list;
+}
+
+std::vector<std::string> parseStringList( const char* s )
+{
+	std::vector<std::string> list;
+	std::stringstream ss( s );
+	std::string item;
+	while( std::getline( ss, item, ',' ) )
+		if( !item.empty() )
+			list.push_back( item );
+	return list;
+}
+
+//-----------------------------------------------------------------------------
+//  Synthetic datasets
+//-----------------------------------------------------------------------------
+
+/// Unit icosphere given as shared vertex list and triangle indices
+struct Icosphere
+{
+	std::vector<Eigen::Vector3d> vertices;
+	std::vector<int>             triangles; // 3 indices per face
+
+	Icosphere( int level );
+
+private:
+	int midpoint( int a, int b, std::map<std::pair<int,int>,int>& cache );
+};
+
+Icosphere::Icosphere( int level )
+{
+	const double t = (1. + sqrt(5.)) / 2.;
+	const double v[12][3] = {
+		{-1, t, 0}, { 1, t, 0}, {-1,-t, 0}, { 1,-t, 0},
+		{ 0,-1, t}, { 0, 1, t}, { 0,-1,-t}, { 0, 1,-t},
+		{ t, 0,-1}, { t, 0, 1}, {-t, 0,-1}, {-t, 0, 1} };
+	const int f[20][3] = {
+		{0,11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7,10}, {0,10,11},
+		{1, 5, 9}, {5,11, 4}, {11,10,2}, {10,7, 6}, {7, 1, 8},
+		{3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8}, {3, 8, 9},
+		{4, 9, 5}, {2, 4,11}, {6, 2,10}, {8, 6, 7}, {9, 8, 1} };
+
+	for( int i=0; i < 12; i++ )
+		vertices.push_back( Eigen::Vector3d( v[i][0], v[i][1], v[i][2] ).normalized() );
+	for( int i=0; i < 20; i++ )
+		for( int j=0; j < 3; j++ )
+			triangles.push_back( f[i][j] );
+
+	// Split each triangle into four
+	for( int l=0; l < level; l++ )
+	{
+		std::map<std::pair<int,int>,int> cache;
+		std::vector<int> tris;
+		tris.reserve( 4*triangles.size() );
+		for( size_t i=0; i < triangles.size(); i+=3 )
+		{
+			int a = triangles[i], b = triangles[i+1], c = triangles[i+2];
+			int ab = midpoint( a, b, cache ),
+			    bc = midpoint( b, c, cache ),
+			    ca = midpoint( c, a, cache );
+			int sub[12] = { a,ab,ca, b,bc,ab, c,ca,bc, ab,bc,ca };
+			tris.insert( tris.end(), sub, sub+12 );
+		}
+		triangles.swap( tris );
+	}
+}
+
+int Icosphere::midpoint( int a, int b, std::map<std::pair<int,int>,int>& cache )
+{
+	std::pair<int,int> key( std::min(a,b), std::max(a,b) );
+	std::map<std::pair<int,int>,int>::iterator it = cache.find( key );
+	if( it != cache.end() )
+		return it->second;
+
+	vertices.push_back( (vertices[a] + vertices[b]).normalized() );
+	int idx = (int)vertices.size() - 1;
+	cache[key] = idx;
+	return idx;
+}
+
+/// Shape dataset with all derived inputs required by the benchmarks
+struct Dataset
+{
+	int                 level;
+	int                 numVertices;
+	std::vector<Mesh*>  frames;
+	MeshBuffer          mb;
+	std::string         mbFilename; ///< \a mb written to disk for read benchmark
+	PCAModel            pca;
+	Eigen::MatrixXd     B;          ///< Shape basis for inter-point covariance
+	Eigen::MatrixXd     D;          ///< Distance matrix for clustering (subset)
+
+	Dataset( int level, int numFrames );
+	~Dataset();
+};
+
+Dataset::Dataset( int level_, int numFrames )
+: level( level_ )
+{
+	Icosphere ico( level );
+	numVertices = (int)ico.vertices.size();
+
+	// Random low-frequency deformations plus per vertex noise
+	const int numModes = 6;
+	Random rnd( 42 + level );
+	Eigen::MatrixXd freq( numModes, 3 ), phase( numModes, 3 );
+	for( int m=0; m < numModes; m++ )
+		for( int d=0; d < 3; d++ )
+		{
+			freq (m,d) = 1. + 3.*rnd.uniform();
+			phase(m,d) = 6.283185307179586*rnd.uniform();
+		}
+
+	for( int f=0; f < numFrames; f++ )
+	{
+		Eigen::VectorXd amp( numModes );
+		for( int m=0; m < numModes; m++ )
+			amp(m) = 0.1 * rnd.normal() / (m+1);
+
+		Mesh* mesh = new Mesh;
+		std::vector<Mesh::VertexHandle> vh( numVertices );
+		for( int i=0; i < numVertices; i++ )
+		{
+			const Eigen::Vector3d& p = ico.vertices[i];
+			double r = 1.;
+			for( int m=0; m < numModes; m++ )
+				r += amp(m) * sin( freq(m,0)*p(0) + phase(m,0) )
+				            * sin( freq(m,1)*p(1) + phase(m,1) )
+				            * sin( freq(m,2)*p(2) + phase(m,2) );
+			Eigen::Vector3d q = r*p + 0.005*Eigen::Vector3d( rnd.normal(), rnd.normal(), rnd.normal() );
+			vh[i] = mesh->add_vertex( Mesh::Point( (float)q(0), (float)q(1), (float)q(2) ) );
+		}
+		for( size_t i=0; i < ico.triangles.size(); i+=3 )
+			mesh->add_face( vh[ico.triangles[i]], vh[ico.triangles[i+1]], vh[ico.triangles[i+2]] );
+
+		updateMeshVertexNormals( mesh );
+		frames.push_back( mesh );
+		mb.addFrame( mesh );
+	}
+
+	// Derived inputs (not part of timing)
+	std::stringstream ss;
+	ss << "meshbench-level" << level << ".mb";
+	mbFilename = ss.str();
+	mb.write( mbFilename.c_str() );
+
+	NoProgress silent;
+	MeshBuffer pcmb;
+	Mesh mshape;
+	computePCA( mb, pcmb, pca, mshape, &silent );
+	B = pca.PC * pca.ev.asDiagonal();
+
+	// Pairwise distances on mean shape for a vertex subset
+	int n = std::min( numVertices, 1000 );
+	Eigen::Matrix3Xd P = reshape( pca.mu ).leftCols( n );
+	D.resize( n, n );
+	for( int i=0; i < n; i++ )
+		for( int j=0; j < n; j++ )
+			D(i,j) = (P.col(i) - P.col(j)).norm();
+}
+
+Dataset::~Dataset()
+{
+	for( size_t i=0; i < frames.size(); i++ )
+		delete frames[i];
+	std::remove( mbFilename.c_str() );
+}
+
+//-----------------------------------------------------------------------------
+//  Benchmarks
+//-----------------------------------------------------------------------------
+// Each benchmark times only the analysis call itself and returns the number
+// of processed items used for the throughput measure.
+
+typedef double (*BenchmarkFunc)( Dataset& ds, Stopwatch& sw );
+
+double benchAddFrame( Dataset& ds, Stopwatch& sw )
+{
+	MeshBuffer mb;
+	sw.start();
+	for( size_t i=0; i < ds.frames.size(); i++ )
+		mb.addFrame( ds.frames[i] );
+	sw.stop();
+	return (double)ds.numVertices * ds.frames.size();
+}
+
+double benchRead( Dataset& ds, Stopwatch& sw )
+{
+	MeshBuffer mb;
+	sw.start();
+	mb.read( ds.mbFilename.c_str() );
+	sw.stop();
+	return (double)ds.numVertices * ds.frames.size();
+}
+
+double benchPCA( Dataset& ds, Stopwatch& sw )
+{
+	NoProgress silent;
+	MeshBuffer pcmb;
+	PCAModel pca;
+	Mesh mshape;
+	sw.start();
+	computePCA( ds.mb, pcmb, pca, mshape, &silent );
+	sw.stop();
+	return (double)ds.numVertices * ds.frames.size();
+}
+
+double benchSampleCovariance( Dataset& ds, Stopwatch& sw )
+{
+	NoProgress silent;
+	Eigen::MatrixXd S;
+	sw.start();
+	ShapeCovariance::computeSampleCovariance( ds.pca.X, S, &silent );
+	sw.stop();
+	return (double)ds.numVertices;
+}
+
+double benchInterPointCovariance( Dataset& ds, Stopwatch& sw )
+{
+	NoProgress silent;
+	Eigen::MatrixXd G;
+	sw.start();
+	ShapeCovariance::computeInterPointCovariance( ds.B, 1.0, G, &silent );
+	sw.stop();
+	return (double)ds.numVertices;
+}
+
+double benchPAMClustering( Dataset& ds, Stopwatch& sw )
+{
+	srand( 42 ); // PAMClustering uses random_shuffle for initial medoids
+	PAMClustering pam( ds.D, 8 );
+	sw.start();
+	pam.cluster();
+	sw.stop();
+	return (double)ds.D.rows();
+}
+
+double benchMeshLaplacian( Dataset& ds, Stopwatch& sw )
+{
+	MeshLaplacian ml;
+	sw.start();
+	ml.compute( *ds.frames[0] );
+	sw.stop();
+	return (double)ds.numVertices;
+}
+
+double benchClosestPointDistance( Dataset& ds, Stopwatch& sw )
+{
+	std::vector<float> dist;
+	sw.start();
+	filters::closestPointDistance( *ds.frames[0], *ds.frames[ds.frames.size()>1 ? 1 : 0], dist );
+	sw.stop();
+	return (double)ds.numVertices;
+}
+
+struct Benchmark
+{
+	const char*   name;
+	BenchmarkFunc func;
+	int           maxVertices; ///< Skip larger datasets (0 for no limit)
+	bool          threaded;    ///< Measure scaling across thread counts?
+};
+
+const Benchmark g_benchmarks[] = {
+	{ "MeshBuffer::addFrame",         benchAddFrame,             0,    false },
+	{ "MeshBuffer::read",             benchRead,                 0,    false },
+	{ "computePCA",                   benchPCA,                  0,    true  },
+	{ "computeSampleCovariance",      benchSampleCovariance,     0,    true  },
+	{ "computeInterPointCovariance",  benchInterPointCovariance, 0,    true  },
+	{ "PAMClustering::cluster",       benchPAMClustering,        0,    false },
+	{ "MeshLaplacian::compute",       benchMeshLaplacian,        1000, true  }, // dense O(n^3)
+	{ "closestPointDistance",         benchClosestPointDistance, 0,    true  }
+};
+const int g_numBenchmarks = sizeof(g_benchmarks) / sizeof(Benchmark);
+
+//-----------------------------------------------------------------------------
+//  Main
+//-----------------------------------------------------------------------------
+
+struct Result
+{
+	std::string name;
+	int    level, vertices, frames, threads;
+	double timeMin, timeMean, throughput, peakRSS, speedup; // peakRSS relative to baseline
+};
+
+void writeJSON( std::ostream& os, const std::vector<Result>& results,
+                int frames, int repeat )
+{
+	os << "{\n"
+	   << "  \"benchmark\": \"meshbench\",\n"
+	#ifdef USE_OPENMP
+	   << "  \"openmp\": true,\n"
+	#else
+	   << "  \"openmp\": false,\n"
+	#endif
+	   << "  \"max_threads\": " << maxThreads() << ",\n"
+	   << "  \"frames\": " << frames << ",\n"
+	   << "  \"repeat\": " << repeat << ",\n"
+	   << "  \"results\": [\n";
+	for( size_t i=0; i < results.size(); i++ )
+	{
+		const Result& r = results[i];
+		os << "    { \"name\": \"" << r.name << "\""
+		   << ", \"level\": "       << r.level
+		   << ", \"vertices\": "    << r.vertices
+		   << ", \"frames\": "      << r.frames
+		   << ", \"threads\": "     << r.threads
+		   << ", \"time_min_s\": "  << r.timeMin
+		   << ", \"time_mean_s\": " << r.timeMean
+		   << ", \"items_per_s\": " << r.throughput
+		   << ", \"peak_rss_delta_mb\": " << r.peakRSS
+		   << ", \"speedup\": "     << r.speedup
+		   << " }" << (i+1 < results.size() ? "," : "") << "\n";
+	}
+	os << "  ]\n"
+	   << "}\n";
+}
+
+int main( int argc, char* argv[] )
+{
+	using namespace std;
+
+	// -- Parse command line
+	vector<int> levels, threads;
+	vector<string> names;
+	int numFrames = 32,
+	    repeat    = 3;
+	string outfile;
+
+	levels.push_back( 2 );
+	levels.push_back( 3 );
+	levels.push_back( 4 );
+	for( int t=1; t < maxThreads(); t*=2 )
+		threads.push_back( t );
+	threads.push_back( maxThreads() );
+
+	for( int i=1; i < argc; i++ )
+	{
+		string opt( argv[i] );
+		if( opt == "-l" )
+		{
+			for( int b=0; b < g_numBenchmarks; b++ )
+				cout << g_benchmarks[b].name << endl;
+			return 0;
+		}
+		if( i+1 >= argc )
+		{
+			cout << g_usage;
+			return 0;
+		}
+		const char* arg = argv[++i];
+		if( opt == "-s" ) levels    = parseIntList( arg ); else
+		if( opt == "-f" ) numFrames = atoi( arg );         else
+		if( opt == "-t" ) threads   = parseIntList( arg ); else
+		if( opt == "-r" ) repeat    = atoi( arg );         else
+		if( opt == "-b" ) names     = parseStringList( arg ); else
+		if( opt == "-o" ) outfile   = arg;
+		else
+		{
+			cout << g_usage;
+			return 0;
+		}
+	}
+	if( numFrames < 2 || repeat < 1 || levels.empty() || threads.empty() )
+	{
+		cerr << "Invalid options!" << endl;
+		return -1;
+	}
+
+	// -- Run benchmarks
+	vector<Result> results;
+	for( size_t l=0; l < levels.size(); l++ )
+	{
+		cerr << "Generating dataset level " << levels[l] << " ..." << endl;
+		Dataset ds( levels[l], numFrames );
+
+		for( int b=0; b < g_numBenchmarks; b++ )
+		{
+			const Benchmark& bench = g_benchmarks[b];
+			if( !names.empty() && find( names.begin(), names.end(), bench.name ) == names.end() )
+				continue;
+			if( bench.maxVertices > 0 && ds.numVertices > bench.maxVertices )
+				continue;
+
+			double baseTime = 0.;
+			size_t numThreadCounts = bench.threaded ? threads.size() : 1;
+			for( size_t t=0; t < numThreadCounts; t++ )
+			{
+				int nthreads = bench.threaded ? threads[t] : 1;
+				setNumThreads( nthreads );
+
+				cerr << "  " << bench.name << " (" << ds.numVertices << " vertices, "
+				     << nthreads << " threads)" << endl;
+
+				double tmin=0., tsum=0., items=0.;
+				RSSMonitor rss;
+				rss.start();
+				for( int r=0; r < repeat; r++ )
+				{
+					Stopwatch sw;
+					items = bench.func( ds, sw );
+					tsum += sw.elapsed();
+					tmin = (r==0) ? sw.elapsed() : std::min( tmin, sw.elapsed() );
+				}
+				double rssDelta = rss.stop();
+				if( t==0 )
+					baseTime = tmin;
+
+				Result res;
+				res.name       = bench.name;
+				res.level      = ds.level;
+				res.vertices   = ds.numVertices;
+				res.frames     = numFrames;
+				res.threads    = nthreads;
+				res.timeMin    = tmin;
+				res.timeMean   = tsum / repeat;
+				res.throughput = (tmin > 0.) ? items / tmin : 0.;
+				res.peakRSS    = rssDelta;
+				res.speedup    = (tmin > 0.) ? baseTime / tmin : 1.;
+				results.push_back( res );
+			}
+		}
+	}
+
+	// -- Report
+	if( outfile.empty() )
+		writeJSON( cout, results, numFrames, repeat );
+	else
+	{
+		ofstream of( outfile.c_str() );
+		if( !of.is_open() )
+		{
+			cerr << "Could not open " << outfile << "!" << endl;
+			return -1;
+		}
+		writeJSON( of, results, numFrames, repeat );
+	}
+
+	return 0;
+}
@@ -4,6 +4,7 @@
 #include <ICP.h>        // "Sparse Iterative Closest Point" by Sofien Bouaziz
 #include "meshtools.h"  // some custom OpenMesh functions
 #include "Intersect.h"
+#include "TriangleBVH.h"
 
 using namespace meshtools;
 
@@ -156,93 +157,45 @@ void alignMeshes( Mesh& source_mesh, const Mesh& target_mesh, SICP::Parameters p
 	meshICP( source_mesh, target_mesh, parm, mask );
 }
 
-bool computeIntersection( const Mesh::Point& p, const Mesh::Normal& n,
-	const Mesh::Point& v0, const Mesh::Point& v1, const Mesh::Point& v2,
-	Mesh::Point& intersection, double& distance )
-{
-	using namespace Intersect;
-	Ray r( Vec3(p[0],p[1],p[2]), Vec3(n[0],n[1],n[2]) );
-	Triangle t;
-	t.v0 = Vec3(v0[0],v0[1],v0[2]);
-	t.v1 = Vec3(v1[0],v1[1],v1[2]);
-	t.v2 = Vec3(v2[0],v2[1],v2[2]);
-
-	RayTriangleIntersection rti = intersect( r, t );	
-	Vec3 q = t.barycentric( rti.bc );
-	intersection[0] = q.x;
-	intersection[1] = q.y;
-	intersection[2] = q.z;
-	distance = rti.t;
-	return rti.bc.is_inside();
-}
-
 void projectMesh( Mesh& mesh, const Mesh& surface )
 {
-	struct Intersection
-	{
-		Mesh::Point p;
-		double dist;
-
-		Intersection() {}
-		Intersection( Mesh::Point p_, double dist_ ): p(p_), dist(dist_) {};
-
-		// Sort according to absolute distance
-		bool operator < ( const Intersection& other ) const
-		{
-			return fabs(dist) < fabs(other.dist);
-		}
-	};
-
-	// Resulting mesh projected onto surface
-	Mesh projected_mesh = mesh;
+	using Intersect::Ray;
+	using Intersect::Vec3;
 
 	// Vertex normals are required
 	if( !mesh.has_vertex_normals() )
 		meshtools::updateMeshVertexNormals( &mesh );
 
-	// For each mesh vertex find intersection with surface in normal direction
-	int numProjPts = 0;
-	Mesh::VertexIter v_it = mesh.vertices_begin();
-	for( int count=0; v_it != mesh.vertices_end(); ++v_it, count++ )
-	{
-		if( count%100==0 )
-			printf("Projecting mesh %3.0f%% \r", 100.*count / (float)mesh.n_vertices());
+	// Resulting mesh projected onto surface
+	Mesh projected_mesh = mesh;
 
-		// Define ray
-		Mesh::Point ray_origin = mesh.point( *v_it );
-		Mesh::Normal ray_dir = mesh.normal( *v_it );
+	// Acceleration structure over surface triangles
+	TriangleBVH bvh;
+	bvh.build( surface );
 
-		// Result intersections
-		std::vector<Intersection> intersections;
+	// One ray per mesh vertex in normal direction
+	std::vector<Ray> rays( mesh.n_vertices() );
+	for( int i=0; i < (int)mesh.n_vertices(); i++ )
+	{
+		Mesh::VertexHandle vh( i );
+		const Mesh::Point&  p = mesh.point ( vh );
+		const Mesh::Normal& n = mesh.normal( vh );
+		rays[i] = Ray( Vec3(p[0],p[1],p[2]), Vec3(n[0],n[1],n[2]) );
+	}
 
-		// Brute-force intersection calculation with all surface triangles
-		Mesh::FaceIter f_it = surface.faces_begin();
-		for( ; f_it != surface.faces_end(); ++f_it )
-		{
-			// Collect vertex coordinates of a triangle
-			static std::vector<Mesh::Point> points(3);
-			Mesh::FaceVertexIter fv_it = surface.cfv_iter( f_it );
-			for( int i=0; fv_it && i < 3; ++fv_it, i++ )
-				points[i] = surface.point( fv_it );
-
-			// Check for intersection
-			Intersection x;
-			if( computeIntersection( ray_origin, ray_dir, points[0], points[1], points[2], x.p, x.dist ) )
-			{
-				intersections.push_back( x );
-			}
-		}
+	// Closest surface intersection in both directions along the normal
+	std::vector<TriangleBVH::Hit> hits;
+	bvh.intersect( rays, hits, true );
 
-		if( !intersections.empty() )
+	int numProjPts = 0;
+	for( int i=0; i < (int)mesh.n_vertices(); i++ )
+	{
+		Mesh::VertexHandle vh( i );
+		if( hits[i].valid() )
 		{
-			// Surface intersections found, set projected point
-
-			// Sort according to distance
-			std::sort( intersections.begin(), intersections.end() );
-
-			// Project onto closest intersection point 
-			projected_mesh.point( *v_it ) = intersections.front().p;
-
+			// Surface intersection found, set projected point
+			Vec3 q = bvh.hitPoint( hits[i] );
+			projected_mesh.point( vh ) = Mesh::Point( q.x, q.y, q.z );
 			numProjPts++;
 
 			// REMARK: A threshold on surface distance could be useful to 
@@ -251,7 +204,7 @@ void projectMesh( Mesh& mesh, const Mesh& surface )
 		else
 		{
 			// No projection point found, mark vertex for deletion
-			projected_mesh.delete_vertex( *v_it, false );
+			projected_mesh.delete_vertex( vh, false );
 		}
 	}
 	printf("Projected %d points  \n",numProjPts);
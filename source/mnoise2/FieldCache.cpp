@@ -0,0 +1,104 @@
+/*
+	FieldCache.cpp
+
+	mnemonic 2004
+*/
+
+#include "FieldCache.h"
+#include <stdlib.h>		// for: abs()
+
+/******************************************************************************/
+FieldCache::FieldCache()
+	: spacing(0.f),
+	  size(0),
+	  valid(false)
+{
+	origin[0] = origin[1] = origin[2] = 0;
+}
+
+/******************************************************************************/
+void FieldCache::setup( float spacing_, int size_ )
+{
+	if( spacing_ == spacing && size_ == size ) return;
+
+	spacing = spacing_;
+	size    = size_ > 0 ? size_ : 0;
+	data.assign( (size_t)size*size*size, 0.f );
+	valid   = false;
+}
+
+/******************************************************************************/
+int FieldCache::scroll( const int o[3], Source& src )
+{
+	if( size <= 0 ) return 0;
+
+	// Window moved by a full size along any axis, nothing can be kept
+	bool full = !valid;
+	for( int a=0; a < 3; a++ )
+		if( abs( o[a] - origin[a] ) >= size )
+			full = true;
+
+	// Lattice indices of newly exposed points, a row along x is either new
+	// completely or only its part outside the previous window range.
+	std::vector<int> ids;
+	int x0 = o[0], x1 = o[0] + size;
+	int old0 = full ? x1 : origin[0], 
+	    old1 = full ? x1 : origin[0] + size;
+	if( old0 < x0 ) old0 = x0;
+	if( old1 > x1 ) old1 = x1;
+	if( old1 < old0 ) old1 = old0;
+
+	for( int k=o[2]; k < o[2]+size; k++ )
+	for( int j=o[1]; j < o[1]+size; j++ )
+	{
+		bool row = full 
+			|| j < origin[1] || j >= origin[1]+size
+			|| k < origin[2] || k >= origin[2]+size;
+
+		for( int i=x0; i < x1; i++ )
+		{
+			if( !row && i == old0 )
+			{
+				// skip cached part of row
+				i = old1 - 1;
+				continue;
+			}
+			ids.push_back( i );
+			ids.push_back( j );
+			ids.push_back( k );
+		}
+	}
+
+	origin[0] = o[0];
+	origin[1] = o[1];
+	origin[2] = o[2];
+	valid = true;
+
+	// Sample new points blockwise and scatter them into the ring
+	const int block = 1024;
+	int n = (int)ids.size() / 3,
+	    nblocks = (n + block - 1) / block;
+
+	#pragma omp parallel for schedule(dynamic)
+	for( int b=0; b < nblocks; b++ )
+	{
+		float px[block], py[block], pz[block], val[block];
+		int first = b*block,
+		    m     = (n - first < block) ? n - first : block;
+		const int* id = &ids[ 3*first ];
+
+		for( int l=0; l < m; l++ )
+		{
+			px[l] = id[3*l  ] * spacing;
+			py[l] = id[3*l+1] * spacing;
+			pz[l] = id[3*l+2] * spacing;
+		}
+
+		src.sample_field( px, py, pz, val, m );
+
+		for( int l=0; l < m; l++ )
+			data[ (wrap(id[3*l+2])*size + wrap(id[3*l+1]))*size + wrap(id[3*l]) ] = val[l];
+	}
+
+	return n;
+}
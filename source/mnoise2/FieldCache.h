@@ -0,0 +1,67 @@
+/*
+	FieldCache.h
+
+	mnemonic 2004
+*/
+#ifndef FIELDCACHE_H
+#define FIELDCACHE_H
+
+#include <vector>
+
+/**
+  Toroidal cache of scalar field samples on a regular lattice in world
+  coordinates.
+
+  The cache holds a window of size^3 lattice points, lattice point (i,j,k)
+  being located at world position (i,j,k)*spacing. Points are stored at
+  their lattice index modulo size, such that moving the window by a few
+  lattice points only requires sampling the newly exposed slabs, which
+  overwrite the slabs scrolled out at the opposite side.
+ */
+class FieldCache
+{
+public:
+	/// Field to be cached, sample_field() is called concurrently (if
+	/// compiled with OpenMP) and therefore has to be thread-safe.
+	class Source
+	{
+	public:
+		virtual ~Source() {}
+		virtual void sample_field( const float* x, const float* y, const float* z,
+		                           float* result, int n ) = 0;
+	};
+
+	FieldCache();
+
+	/// Set lattice spacing and window size, invalidates cache if changed
+	void  setup( float spacing, int size );
+	/// Discard all cached samples, e.g. after the field changed
+	void  invalidate() { valid = false; };
+
+	/// Move window to start at given lattice index, sampling only lattice
+	/// points not contained in the previous window. Returns number of
+	/// lattice points sampled.
+	int   scroll( const int origin[3], Source& src );
+
+	/// Cached value at lattice index (i,j,k) which must lie inside window
+	float at( int i, int j, int k ) const
+	{
+		return data[ (wrap(k)*size + wrap(j))*size + wrap(i) ];
+	}
+
+	float get_spacing() const { return spacing; };
+	int   get_size() const { return size; };
+	const int* get_origin() const { return origin; };
+
+protected:
+	int wrap( int i ) const { i %= size; return i < 0 ? i + size : i; };
+
+private:
+	float spacing;
+	int   size;
+	int   origin[3];  // lattice index of first point of window
+	bool  valid;
+	std::vector<float> data;
+};
+
+#endif
@@ -23,6 +23,9 @@ public:
 	///    1  if intersecting
 	int clip_aabb( float aabb_min[3], float aabb_max[3] );
 
+	/// The 6 planes as consecutive (a,b,c,d) tuples, e.g. for FrustumCuller
+	const float* get_planes() const { return &planes[0][0]; }
+
 private:
 	// 6-sided viewing frustum
 	// a plane is represented by the equation
@@ -1,9 +1,17 @@
 #ifdef WIN32
 #include <windows.h>
 #endif
-#include <GL/gl.h>
+#include <GL/glew.h>
 #include "MNoise.h"
 #include "primitives.h"		// draw_aabb( min,max )
+#include "MarchingCubes_tables.h" // cube_edge_lattice
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <time.h>
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
 
 #ifdef MNOISE_USE_IMPROVEDNOISE
 	#include "ImprovedNoise.h"
@@ -11,6 +19,138 @@
 	#include "PerlinNoise.h"
 #endif
 
+namespace {
+
+int num_threads()
+{
+#ifdef USE_OPENMP
+	return omp_get_max_threads();
+#else
+	return 1;
+#endif
+}
+
+int thread_num()
+{
+#ifdef USE_OPENMP
+	return omp_get_thread_num();
+#else
+	return 0;
+#endif
+}
+
+// Vertex on a lattice edge of an octree level, ordered by edge and vertex
+struct EdgeVertex
+{
+	int      level, axis, i, j, k;
+	unsigned vertex;
+
+	bool same_edge( const EdgeVertex& e ) const
+	{
+		return level == e.level && axis == e.axis && i == e.i && j == e.j && k == e.k;
+	}
+	bool operator < ( const EdgeVertex& e ) const
+	{
+		if( level != e.level ) return level < e.level;
+		if( axis  != e.axis  ) return axis  < e.axis;
+		if( i != e.i ) return i < e.i;
+		if( j != e.j ) return j < e.j;
+		if( k != e.k ) return k < e.k;
+		return vertex < e.vertex;
+	}
+};
+
+// Merge vertices out[first+v] into out[first+remap[v]], remap[v] <= v, and
+// compact the kept ones. Indices of out starting at ifirst are remapped.
+void merge_vertices( const std::vector<unsigned>& remap, unsigned first, 
+                     unsigned ifirst, MCMesh& out, bool parallel )
+{
+	// Compact kept vertices, remap[v] <= v so index[remap[v]] is known
+	unsigned count = (unsigned)remap.size();
+	bool normals = !out.normals.empty();
+	std::vector<unsigned> index( count );
+	unsigned m = 0;
+	for( unsigned v=0; v < count; v++ )
+	{
+		if( remap[v] != v )
+		{
+			index[v] = index[ remap[v] ];
+			continue;
+		}
+		index[v] = m;
+		for( int d=0; d < 3; d++ )
+		{
+			out.vertices[ 3*(first+m)+d ] = out.vertices[ 3*(first+v)+d ];
+			if( normals )
+				out.normals[ 3*(first+m)+d ] = out.normals[ 3*(first+v)+d ];
+		}
+		m++;
+	}
+	out.vertices.resize( 3*(first+m) );
+	if( normals )
+		out.normals.resize( 3*(first+m) );
+
+	int ni = (int)out.indices.size();
+	#pragma omp parallel for if(parallel)
+	for( int i=(int)ifirst; i < ni; i++ )
+		out.indices[i] = first + index[ out.indices[i] - first ];
+}
+
+// Merge vertices out[first+v] whose entries in edges lie on the same lattice
+// edge into the first one of them, vertices without entry are kept
+void weld_edges( std::vector<EdgeVertex>& edges, unsigned first, 
+                 unsigned ifirst, MCMesh& out, bool parallel )
+{
+	unsigned count = (unsigned)out.num_vertices() - first;
+	if( count == 0 )
+		return;
+
+	// Map each vertex to the first one on its edge
+	std::sort( edges.begin(), edges.end() );
+	std::vector<unsigned> remap( count );
+	for( unsigned v=0; v < count; v++ )
+		remap[v] = v;
+	unsigned n = (unsigned)edges.size();
+	for( unsigned a=0; a < n; )
+	{
+		unsigned b = a+1;
+		while( b < n && edges[b].same_edge( edges[a] ) )
+			b++;
+		for( unsigned c=a; c < b; c++ )
+			remap[ edges[c].vertex ] = edges[a].vertex;
+		a = b;
+	}
+
+	merge_vertices( remap, first, ifirst, out, parallel );
+}
+
+// Edge length of the blocks of scrolling mode in cubes. Larger blocks share
+// less vertices with their neighbours but overhang the domain further.
+const int block_size = 8;
+
+// Toroidal index of a block in the ring of nb blocks per axis
+inline int wrap_block( int i, int nb )
+{
+	i %= nb;
+	return i < 0 ? i + nb : i;
+}
+
+// Test if a lattice point of spacing h in the box [lo,hi] lies within the
+// zero neighbourhood of process_batch() around p (with margin for rounding)
+bool near_lattice( const float* lo, const float* hi, float h, const float* p )
+{
+	const float eps = 0.002f;
+	for( int d=0; d < 3; d++ )
+	{
+		float c = floor( p[d] / h + .5f ) * h;
+		if( fabs( p[d] - c ) > eps || c < lo[d] - eps || c > hi[d] + eps )
+			return false;
+	}
+	return true;
+}
+
+} // anonymous namespace
+
 /******************************************************************************/
 /**
  Example settings for MCscale and MCsize for power of two grid size
@@ -36,25 +176,33 @@
 MNoise::MNoise( int size_, float MCscale, int MCsize )
 	//: MarchingCubes( 0.5, MCscale, 2<<size_), //MCsize ),
 	: MarchingCubes( 0.5, MCscale, MCsize ),
-	  root(NULL),
-	  frust(NULL)
+	  noise_gen( (unsigned)time(NULL) ),
+	  frust(NULL),
+	  garbage(0),
+	  tree_valid(false),
+	  lod(0.f),
+	  tree_lod(0.f),
+	  viewpoint(0,0,0),
+	  tree_viewpoint(0,0,0),
+	  valid(false),
+	  parallel(true),
+	  scrolling(false),
+	  vbo(0),
+	  ibo(0)
 {
-	root = new Octree( vector3(-1,-1,-1), vector3(1,1,1) );
 	size = size_; 
 	posz = posy = posz = 1.23456789f;
 	octaves = 2;
 	persistance = 0.75;
 	mode = 1;
-
-#ifndef MNOISE_USE_IMPROVEDNOISE	
-	PerlinNoise::reseed();
-#endif	
+	field_params = get_params();
 }
 
 /******************************************************************************/
 MNoise::~MNoise()
 {
-	if( root ) delete root; root=0;
+	if( vbo ) glDeleteBuffers( 1, &vbo );
+	if( ibo ) glDeleteBuffers( 1, &ibo );
 }
 
 /******************************************************************************/
@@ -62,27 +210,562 @@ MNoise::~MNoise()
 void MNoise::draw_octree()
 {
 	// Debug visualization: Show octree AABB's
-	root->draw_leaves( frust );
+	if( !cells.empty() )
+		draw_cells( 0, frust );
 }
 
 void MNoise::draw()
 {
-	// Draw visible octree leaves after frustum culling
-	Leaves leaves;
+	std::vector<int> ids;
+	if( scrolling )
+	{
+		// Single index range covering the complete domain
+		ids.push_back( 0 );
+	}
+	else
+	{
+		// Visible octree leaves after frustum culling
+		visible_leaves( frust, ids );
+		std::sort( ids.begin(), ids.end() );
+
+		cubecount = (int)ids.size();
+	}
 
-	root->give_visible_leaves( frust, &leaves );
+	if( !valid || mesh.indices.empty() ) return;
 
-	cubecount=0;
-	while( !leaves.empty() )
+	// Mesh of scrolling mode is in world coordinates
+	if( scrolling )
 	{
-		Node l = leaves.top();
-		
-		marchcube( l.aabb_min[0], l.aabb_min[1], l.aabb_min[2] );
-		
-		cubecount++;
-		
-		leaves.pop();
+		glPushMatrix();
+		glTranslatef( -posx, -posy, -posz );
+	}
+
+	// Draw index ranges of visible leaves, either from buffer objects
+	// (pointers are offsets then) or directly from client memory
+	bool use_vbo = vbo && ibo;
+	if( use_vbo )
+	{
+		glBindBuffer( GL_ARRAY_BUFFER, vbo );
+		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, ibo );
+	}
+
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glVertexPointer( 3, GL_FLOAT, 0, use_vbo ? NULL : &mesh.vertices[0] );
+	if( !mesh.normals.empty() )
+	{
+		glEnableClientState( GL_NORMAL_ARRAY );
+		glNormalPointer( GL_FLOAT, 0, use_vbo 
+			? (const GLvoid*)(mesh.vertices.size()*sizeof(float)) 
+			: &mesh.normals[0] );
+	}
+
+	for( size_t i=0; i < ids.size(); )
+	{
+		// merge consecutive leaves into a single draw call
+		unsigned first = leaf_offsets[ ids[i] ],
+		         last  = leaf_offsets[ ids[i]+1 ];
+		for( i++; i < ids.size() && ids[i] == ids[i-1]+1; i++ )
+			last = leaf_offsets[ ids[i]+1 ];
+
+		if( last > first )
+			glDrawElements( GL_TRIANGLES, last-first, GL_UNSIGNED_INT, use_vbo
+				? (const GLvoid*)(first*sizeof(unsigned))
+				: &mesh.indices[first] );
+	}
+
+	glDisableClientState( GL_NORMAL_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
+
+	if( use_vbo )
+	{
+		glBindBuffer( GL_ARRAY_BUFFER, 0 );
+		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+	}
+
+	if( scrolling )
+		glPopMatrix();
+}
+
+bool MNoise::update()
+{
+	if( scrolling )
+		return update_field();
+
+	bool changed = false;
+
+	// Changed octree leaves invalidate all extracted leaves
+	if( update_tree() )
+		valid = false;
+
+	// Parameter change invalidates all extracted leaves
+	Params p = get_params();
+	if( !valid || !(p == params) )
+	{
+		arenas.clear();
+		leaf_meshes.assign( leaves.size(), LeafMesh() );
+		params = p;
+		valid = true;
+		changed = true;
+	}
+
+	// Visible leaves not extracted yet
+	std::vector<int> visible, ids;
+	visible_leaves( frust, visible );
+	for( size_t i=0; i < visible.size(); i++ )
+		if( leaf_meshes[ visible[i] ].arena < 0 )
+			ids.push_back( visible[i] );
+
+	if( !ids.empty() )
+	{
+		march_leaves( ids, arenas, leaf_meshes );
+		changed = true;
+	}
+
+	if( !changed )
+		return false;
+
+	mesh.clear();
+	concat_leaves( arenas, leaf_meshes, mesh, &leaf_offsets );
+	upload();
+	return true;
+}
+
+bool MNoise::update_field()
+{
+	// Blocks per axis covering the domain [-1,1]^3 at any position
+	float h  = get_scale();
+	int   nb = (int)ceil( 2.f / (block_size*h) ) + 1,
+	      n  = nb*block_size;
+
+	// Noise samples depend on lattice and fBm parameters, blocks also on
+	// isovalue, mode and normals but (up to process()) not on position
+	Params p = get_params();
+	p.posx = p.posy = p.posz = 0.f;
+
+	field.setup( h, n+3 );
+	if( field_params.octaves != p.octaves || field_params.persistance != p.persistance )
+		field.invalidate();
+
+	bool reset = !valid || !(p == field_params);
+	field_params = p;
+
+	// Block index of first block, window is padded by one sample for the
+	// central differences of the normals
+	float pos[3] = { posx, posy, posz };
+	int   first[3], origin[3];
+	for( int a=0; a < 3; a++ )
+	{
+		first [a] = (int)floor( (pos[a] - 1.f) / (block_size*h) );
+		origin[a] = first[a]*block_size - 1;
+	}
+
+	FieldSource src( this );
+	field.scroll( origin, src );
+
+	// The cut-out term a/r^2 of process() depends on the position everywhere,
+	// blocks polygonized for different positions would disagree on their
+	// shared faces and crack. The whole domain is polygonized at once then,
+	// which avoids the padding and welding of the blocks.
+	if( cutout() != 0.f )
+	{
+		if( !reset && get_params() == params )
+			return false;
+
+		int base[3] = { first[0]*block_size, first[1]*block_size, first[2]*block_size };
+		BlockMarcher marcher( this, base, pos, n );
+		mesh.clear();
+		marcher.polygonize( base[0]*h, base[1]*h, base[2]*h, n, n, n, mesh );
+		blocks.clear();
+	}
+	else
+	{
+		if( reset || (int)blocks.size() != nb*nb*nb )
+			blocks.assign( nb*nb*nb, FieldBlock() );
+
+		// Blocks scrolled in replace the ones scrolled out at the same location
+		// of the ring, others are only polygonized again if stale
+		std::vector<int> ids;
+		for( int k=first[2]; k < first[2]+nb; k++ )
+		for( int j=first[1]; j < first[1]+nb; j++ )
+		for( int i=first[0]; i < first[0]+nb; i++ )
+		{
+			int slot = (wrap_block( k, nb )*nb + wrap_block( j, nb ))*nb + wrap_block( i, nb );
+			FieldBlock& b = blocks[slot];
+			if( b.valid && b.index[0] == i && b.index[1] == j && b.index[2] == k 
+			    && !stale_block( b ) )
+				continue;
+
+			b.index[0] = i; b.index[1] = j; b.index[2] = k;
+			b.viewer[0] = posx; b.viewer[1] = posy; b.viewer[2] = posz;
+			b.valid = true;
+			ids.push_back( slot );
+		}
+
+		// The mesh is in world coordinates, i.e. unchanged if no block changed
+		if( valid && ids.empty() )
+			return false;
+
+		int m = (int)ids.size();
+		#pragma omp parallel for schedule(dynamic) if(parallel)
+		for( int s=0; s < m; s++ )
+		{
+			FieldBlock& b = blocks[ ids[s] ];
+			b.mesh.clear();
+			b.edges.clear();
+
+			int base[3] = { b.index[0]*block_size, b.index[1]*block_size, b.index[2]*block_size };
+			BlockMarcher marcher( this, base, b.viewer, block_size );
+			marcher.polygonize( base[0]*h, base[1]*h, base[2]*h, block_size, block_size,
+			                    block_size, b.mesh, &b.edges );
+		}
+
+		mesh.clear();
+		concat_blocks( first, nb );
+	}
+
+	leaf_offsets.assign( 1, 0 );
+	leaf_offsets.push_back( (unsigned)mesh.indices.size() );
+	cubecount = n*n*n;
+
+	// Octree path has to re-extract its leaves after leaving scrolling mode
+	arenas.clear();
+	leaf_meshes.clear();
+	params = get_params();
+	valid  = true;
+
+	upload();
+	return true;
+}
+
+bool MNoise::stale_block( const FieldBlock& b ) const
+{
+	float pos[3] = { posx, posy, posz };
+	if( pos[0] == b.viewer[0] && pos[1] == b.viewer[1] && pos[2] == b.viewer[2] )
+		return false;
+
+	// Sampled lattice points of the block including padding
+	float h = get_scale(), lo[3], hi[3];
+	for( int d=0; d < 3; d++ )
+	{
+		lo[d] = (b.index[d]*block_size - 1)*h;
+		hi[d] = ((b.index[d]+1)*block_size + 1)*h;
+	}
+
+	// process_batch() zeroes samples within 0.001 of the viewer (per axis),
+	// all neighbours sharing such a sample are polygonized again with it
+	return near_lattice( lo, hi, h, pos ) || near_lattice( lo, hi, h, b.viewer );
+}
+
+void MNoise::concat_blocks( const int first[3], int nb )
+{
+	// Output location of each block in domain order
+	int n = nb*nb*nb;
+	std::vector<int> slots( n );
+	std::vector<unsigned> vbase( n+1 ), ibase( n+1 );
+	vbase[0] = (unsigned)mesh.num_vertices();
+	ibase[0] = (unsigned)mesh.indices.size();
+	for( int s=0; s < n; s++ )
+	{
+		int i = first[0] + s % nb,
+		    j = first[1] + (s / nb) % nb,
+		    k = first[2] + s / (nb*nb);
+		slots[s] = (wrap_block( k, nb )*nb + wrap_block( j, nb ))*nb + wrap_block( i, nb );
+
+		const MCMesh& bm = blocks[ slots[s] ].mesh;
+		vbase[s+1] = vbase[s] + (unsigned)bm.num_vertices();
+		ibase[s+1] = ibase[s] + (unsigned)bm.indices.size();
+	}
+
+	bool normals = get_compute_normals();
+	mesh.vertices.resize( 3*vbase[n] );
+	if( normals )
+		mesh.normals.resize( 3*vbase[n] );
+	mesh.indices.resize( ibase[n] );
+
+	#pragma omp parallel for schedule(dynamic,8) if(parallel)
+	for( int s=0; s < n; s++ )
+	{
+		const MCMesh& bm = blocks[ slots[s] ].mesh;
+		std::copy( bm.vertices.begin(), bm.vertices.end(), mesh.vertices.begin() + 3*vbase[s] );
+		if( normals )
+			std::copy( bm.normals.begin(), bm.normals.end(), mesh.normals.begin() + 3*vbase[s] );
+
+		// Rebase vertex indices
+		for( size_t k=0; k < bm.indices.size(); k++ )
+			mesh.indices[ ibase[s] + k ] = bm.indices[k] + vbase[s];
+	}
+
+	// Only vertices on the faces of a block can be shared with its neighbours.
+	// The first vertex in domain order on each lattice edge of the domain is
+	// kept, looked up by its dense edge index.
+	const unsigned none = ~0u;
+	int np = nb*block_size + 1;
+	std::vector<unsigned> shared( 3*np*np*np, none ), 
+	                      remap( vbase[n] - vbase[0] );
+	for( unsigned v=0; v < remap.size(); v++ )
+		remap[v] = v;
+
+	for( int s=0; s < n; s++ )
+	{
+		const FieldBlock& b = blocks[ slots[s] ];
+		int ofs[3];
+		for( int d=0; d < 3; d++ )
+			ofs[d] = (b.index[d] - first[d])*block_size;
+
+		for( size_t v=0; 4*v < b.edges.size(); v++ )
+		{
+			const int* e = &b.edges[4*v];
+			bool face = false;
+			for( int d=0; d < 3; d++ )
+				if( d != e[0] && (e[1+d] == 0 || e[1+d] == block_size) )
+					face = true;
+			if( !face )
+				continue;
+
+			int key = ((e[0]*np + ofs[2]+e[3])*np + ofs[1]+e[2])*np + ofs[0]+e[1];
+			unsigned w = vbase[s] - vbase[0] + (unsigned)v;
+			if( shared[key] == none )
+				shared[key] = w;
+			else
+				remap[w] = shared[key];
+		}
+	}
+
+	merge_vertices( remap, vbase[0], ibase[0], mesh, parallel );
+}
+
+MNoise::BlockMarcher::BlockMarcher( const MNoise* n, const int base_[3], 
+                                    const float viewer_[3], int size )
+	: MarchingCubes( n->get_isovalue(), n->get_scale(), size ),
+	  noise( n )
+{
+	set_compute_normals( n->get_compute_normals() );
+	for( int d=0; d < 3; d++ )
+	{
+		base  [d] = base_[d];
+		viewer[d] = viewer_[d];
+	}
+}
+
+void MNoise::BlockMarcher::sample_layer( int k, int px, int py, const float* x, 
+                                         const float* y, const float* z, float* result )
+{
+	// Layer point (i,j) corresponds to lattice point (i-1,j-1,k) of block
+	for( int j=0; j < py; j++ )
+		for( int i=0; i < px; i++ )
+			result[ j*px + i ] = noise->field.at( base[0] + i-1, base[1] + j-1, base[2] + k );
+
+	// process() is defined relative to the viewer
+	int m = px*py;
+	rx.resize( m ); ry.resize( m ); rz.resize( m );
+	for( int i=0; i < m; i++ )
+	{
+		rx[i] = x[i] - viewer[0];
+		ry[i] = y[i] - viewer[1];
+		rz[i] = z[i] - viewer[2];
+	}
+	noise->process_batch( &rx[0], &ry[0], &rz[0], result, m );
+}
+
+void MNoise::upload()
+{
+	// Upload to buffer objects if supported (requires GLEW initialization)
+	if( !GLEW_VERSION_1_5 ) return;
+
+	if( !vbo ) glGenBuffers( 1, &vbo );
+	if( !ibo ) glGenBuffers( 1, &ibo );
+
+	GLsizeiptr vsize = mesh.vertices.size()*sizeof(float),
+	           nsize = mesh.normals .size()*sizeof(float),
+	           isize = mesh.indices .size()*sizeof(unsigned);
+
+	glBindBuffer( GL_ARRAY_BUFFER, vbo );
+	glBufferData( GL_ARRAY_BUFFER, vsize+nsize, NULL, GL_DYNAMIC_DRAW );
+	if( vsize ) glBufferSubData( GL_ARRAY_BUFFER, 0, vsize, &mesh.vertices[0] );
+	if( nsize ) glBufferSubData( GL_ARRAY_BUFFER, vsize, nsize, &mesh.normals[0] );
+
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, ibo );
+	glBufferData( GL_ELEMENT_ARRAY_BUFFER, isize, 
+	              isize ? &mesh.indices[0] : NULL, GL_DYNAMIC_DRAW );
+
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+}
+
+void MNoise::extract( MCMesh& out, Frustum* f, std::vector<unsigned>* offsets )
+{
+	if( update_tree() )
+		valid = false;
+
+	// Cull flat array of leaves
+	std::vector<int> ids( leaves.size() );
+	int n = (int)leaves.size();
+	if( f && n > 0 )
+	{
+		culler.setPlanes( f->get_planes(), 6 );
+		n = culler.cull( leaf_bounds, 0, leaves.size(), &ids[0] );
+	}
+	else
+		for( int i=0; i < n; i++ )
+			ids[i] = i;
+	ids.resize( n );
+
+	std::vector<MCMesh>   tmp_arenas;
+	std::vector<LeafMesh> tmp_leaf_meshes( leaves.size() );
+	march_leaves( ids, tmp_arenas, tmp_leaf_meshes );
+	concat_leaves( tmp_arenas, tmp_leaf_meshes, out, offsets );
+}
+
+void MNoise::march_leaves( const std::vector<int>& ids, std::vector<MCMesh>& arenas,
+                           std::vector<LeafMesh>& leaf_meshes )
+{
+	if( (int)arenas.size() < num_threads() )
+		arenas.resize( num_threads() );
+
+	// Dynamic scheduling balances leaves with and without surface
+	int n = (int)ids.size();
+	#pragma omp parallel for schedule(dynamic,8) if(parallel)
+	for( int k=0; k < n; k++ )
+	{
+		int t = thread_num();
+		MCMesh&   arena = arenas[t];
+		LeafMesh& lm    = leaf_meshes[ ids[k] ];
+		Node&     l     = leaves[ ids[k] ];
+
+		lm.arena  = t;
+		lm.vfirst = (unsigned)arena.num_vertices();
+		lm.ifirst = (unsigned)arena.indices.size();
+
+		lm.edges = marchcube( l.aabb_min[0], l.aabb_min[1], l.aabb_min[2], cube_size( l ), arena );
+
+		lm.vcount = (unsigned)arena.num_vertices() - lm.vfirst;
+		lm.icount = (unsigned)arena.indices.size() - lm.ifirst;
+	}
+}
+
+void MNoise::concat_leaves( const std::vector<MCMesh>& arenas, 
+                            const std::vector<LeafMesh>& leaf_meshes,
+                            MCMesh& out, std::vector<unsigned>* offsets )
+{
+	// Output location of each leaf
+	int n = (int)leaf_meshes.size();
+	std::vector<unsigned> vbase( n+1 ), ibase( n+1 );
+	vbase[0] = (unsigned)out.num_vertices();
+	ibase[0] = (unsigned)out.indices.size();
+	for( int i=0; i < n; i++ )
+	{
+		vbase[i+1] = vbase[i] + leaf_meshes[i].vcount;
+		ibase[i+1] = ibase[i] + leaf_meshes[i].icount;
+	}
+
+	bool normals = get_compute_normals();
+	out.vertices.resize( 3*vbase[n] );
+	if( normals )
+		out.normals.resize( 3*vbase[n] );
+	out.indices.resize( ibase[n] );
+
+	#pragma omp parallel for schedule(dynamic,64) if(parallel)
+	for( int i=0; i < n; i++ )
+	{
+		const LeafMesh& lm = leaf_meshes[i];
+		if( lm.arena < 0 || lm.vcount == 0 )
+			continue;
+
+		const MCMesh& arena = arenas[ lm.arena ];
+		std::copy( arena.vertices.begin() + 3*lm.vfirst, 
+		           arena.vertices.begin() + 3*(lm.vfirst + lm.vcount),
+		           out.vertices.begin() + 3*vbase[i] );
+		if( normals )
+			std::copy( arena.normals.begin() + 3*lm.vfirst, 
+			           arena.normals.begin() + 3*(lm.vfirst + lm.vcount),
+			           out.normals.begin() + 3*vbase[i] );
+
+		// Rebase vertex indices
+		for( unsigned k=0; k < lm.icount; k++ )
+			out.indices[ ibase[i] + k ] = arena.indices[ lm.ifirst + k ] - lm.vfirst + vbase[i];
+	}
+
+	weld_leaves( leaf_meshes, vbase, ibase[0], out );
+
+	if( offsets )
+		offsets->assign( ibase.begin(), ibase.end() );
+}
+
+void MNoise::weld_leaves( const std::vector<LeafMesh>& leaf_meshes,
+                          const std::vector<unsigned>& vbase, unsigned ifirst,
+                          MCMesh& out ) const
+{
+	int      n     = (int)leaf_meshes.size();
+	unsigned first = vbase[0],
+	         count = vbase[n] - first;
+	if( count == 0 )
+		return;
+
+	// Lattice edge of each vertex. Cubes only share edges if they tile the
+	// leaf, otherwise (scale not matching the octree) vertices stay unique.
+	std::vector<EdgeVertex> edges( count );
+	#pragma omp parallel for schedule(dynamic,64) if(parallel)
+	for( int l=0; l < n; l++ )
+	{
+		const LeafMesh& lm = leaf_meshes[l];
+		if( lm.arena < 0 || lm.vcount == 0 )
+			continue;
+
+		Node  leaf  = leaves[l]; // copy, vector3 has no const accessors
+		float edge  = leaf.aabb_max[0] - leaf.aabb_min[0];
+		bool  tiled = fabs( edge - cube_size( leaf ) ) <= 1e-3f*edge;
+		int   base[3];
+		for( int d=0; d < 3; d++ )
+			base[d] = (int)floor( (leaf.aabb_min[d] + 1.f) / edge + .5f );
+
+		unsigned v = vbase[l] - first;
+		for( int e=0; e < 12; e++ ) if( lm.edges & (1<<e) )
+		{
+			EdgeVertex& ev = edges[v];
+			ev.vertex = v;
+			if( tiled )
+			{
+				ev.level = leaf.level;
+				ev.axis  = cube_edge_lattice[e][0];
+				ev.i     = base[0] + cube_edge_lattice[e][1];
+				ev.j     = base[1] + cube_edge_lattice[e][2];
+				ev.k     = base[2] + cube_edge_lattice[e][3];
+			}
+			else
+			{
+				ev.level = -1;  // unique key
+				ev.axis  = 0;
+				ev.i     = (int)v;
+				ev.j     = ev.k = 0;
+			}
+			v++;
+		}
 	}
+
+	weld_edges( edges, first, ifirst, out, parallel );
+}
+
+MNoise::Params MNoise::get_params() const
+{
+	Params p;
+	p.isovalue    = get_isovalue();
+	p.scale       = get_scale();
+	p.posx        = posx;
+	p.posy        = posy;
+	p.posz        = posz;
+	p.persistance = persistance;
+	p.octaves     = octaves;
+	p.mode        = mode;
+	p.normals     = get_compute_normals();
+	return p;
+}
+
+bool MNoise::Params::operator == ( const Params& p ) const
+{
+	return isovalue == p.isovalue && scale == p.scale 
+	    && posx == p.posx && posy == p.posy && posz == p.posz
+	    && persistance == p.persistance && octaves == p.octaves
+	    && mode == p.mode && normals == p.normals;
 }
 
 void MNoise::draw_all()
@@ -94,11 +777,9 @@ void MNoise::draw_all()
 /******************************************************************************/
 int MNoise::build()
 {
-	Octree* node = root;
-	vector3 min, max;
-	
-	// build complete (means all leafs are in the same depth) octree
-	root->build_complete( size );
+	// sparse octree is built lazily on next update() for current parameters
+	tree_valid = false;
+	valid = false;
 	
 	return 0;
 }
@@ -118,13 +799,58 @@ float MNoise::fabsnoise( float x, float y, float z )
 	  #ifdef MNOISE_USE_IMPROVEDNOISE		
 		result += ImprovedNoise::noise(x*scale, y*scale, z*scale) * amplitude;
 	  #else
-		result += PerlinNoise::noise(x, y, z) * amplitude;
+		result += noise_gen.noise(x, y, z) * amplitude;
 	  #endif
 		amplitude *= persistance;
 		//x *= 2.0; y *= 2.0; z *= 2.0;
 	}
 	return result;
 }
+
+void MNoise::fabsnoise_batch( const float* x, const float* y, const float* z,
+                              float* result, int n )
+{
+	fabsnoise_batch( x, y, z, result, n, posx, posy, posz );
+}
+
+void MNoise::fabsnoise_batch( const float* x, const float* y, const float* z,
+                              float* result, int n, float ox, float oy, float oz )
+{
+	// Process in blocks to keep the offset coordinates on the stack
+	const int block = 256;
+	float px[block], py[block], pz[block], noise[block];
+
+	for( int ofs=0; ofs < n; ofs += block )
+	{
+		int m = (n - ofs < block) ? n - ofs : block;
+		for( int i=0; i < m; i++ )
+		{
+			px[i] = x[ofs+i] + ox;
+			py[i] = y[ofs+i] + oy;
+			pz[i] = z[ofs+i] + oz;
+		}
+
+	#ifdef MNOISE_USE_IMPROVEDNOISE
+		for( int i=0; i < m; i++ )
+			result[ofs+i] = fabsnoise( px[i], py[i], pz[i] );
+	#else
+		// All octaves sample at the same frequency (see fabsnoise()), hence
+		// noise is evaluated only once and accumulated in the same order.
+		noise_gen.noise_batch( px, py, pz, noise, m );
+		for( int i=0; i < m; i++ )
+		{
+			float amplitude = 1.0;
+			float r = 0.0;
+			for( int o=0; o < octaves; o++ )
+			{
+				r += noise[i] * amplitude;
+				amplitude *= persistance;
+			}
+			result[ofs+i] = r;
+		}
+	#endif
+	}
+}
 	
 float MNoise::sample( float x, float y, float z )
 {
@@ -137,16 +863,41 @@ float MNoise::sample( float x, float y, float z )
 #else
 	float noise = fabsnoise( x+posx,y+posy,z+posz );
 #endif
+	return process( noise, x, y, z );
+}
+
+void MNoise::sample_batch( const float* x, const float* y, const float* z,
+                           float* result, int n )
+{
+	fabsnoise_batch( x, y, z, result, n );
+	process_batch( x, y, z, result, n );
+}
+
+void MNoise::process_batch( const float* x, const float* y, const float* z,
+                            float* result, int n ) const
+{
+	float eps = 0.001f;
+	for( int i=0; i < n; i++ )
+	{
+		if( (fabs(x[i])<=eps) && (fabs(y[i])<=eps) && (fabs(z[i])<=eps) )
+			result[i] = 0;
+		else
+			result[i] = process( result[i], x[i], y[i], z[i] );
+	}
+}
+
+float MNoise::process( float noise, float x, float y, float z ) const
+{
 	float ret = noise;
 
 	switch( mode )
 	{
 		case 1:	// center-sphere cut-out
-			ret =  fabs(noise) - ( 0.1f / (x*x + y*y + z*z));
+			ret =  fabs(noise) - ( cutout() / (x*x + y*y + z*z));
 			break;
 		
 		case 2: // jabberwokky
-			ret = sin(noise*4) - ( 0.01f / (x*x + y*y + z*z));
+			ret = sin(noise*4) - ( cutout() / (x*x + y*y + z*z));
 			break;
 		
 		// test alternative modes
@@ -167,88 +918,404 @@ float MNoise::sample( float x, float y, float z )
 }
 
 /******************************************************************************/
-void MNoise::Octree::draw_leaves( Frustum* frust )
+// Sparse octree
+
+namespace {
+
+// Bounds of PerlinNoise::noise() with unit length gradients g_c and fade
+// s(t) = 3t^2 - 2t^3. In a lattice cell with local coordinates (u,v,w)
+//   N(p) = sum_c w_c(p) d_c(p),  d_c = g_c.(p-c),  w_c = s(.)s(.)s(.),
+// with weights w_c >= 0 summing to one and |d_c| <= |p-c|.
+//
+// Along one axis, q(v) = (1-s(v)) v^2 + s(v) (1-v)^2 is the weighted squared
+// distance to the two lattice planes. With v = 1/2 + t it equals
+// 1/4 - 2t^2 (1 - 2t^2) <= 1/4.
+//
+// Range: by Jensen, |N| <= sum_c w_c |p-c| <= sqrt( sum_c w_c |p-c|^2 )
+//   = sqrt( q(u) + q(v) + q(w) ) <= sqrt(3)/2.
+//
+// Gradient: grad N = sum_c w_c g_c + sum_c d_c grad w_c. The first sum is
+// bounded by 1. The x component of the second sum is s'(u) times the
+// w_y w_z weighted sum of (d_1 - d_0) over the four yz corners, hence by
+// Jensen bounded by s'(u) ( sqrt(u^2 + R) + sqrt((1-u)^2 + R) ) where
+// R = q(v) + q(w) <= 1/2. With a = u(1-u) <= 1/4 and Cauchy-Schwarz this
+// is at most 6a sqrt(2(2 - 2a)) = 12 a sqrt(1-a) <= 3 sqrt(3)/2, which is
+// attained at u = 1/2. The same holds for y and z, so
+//   |grad N| <= 1 + sqrt(3) * 3 sqrt(3)/2 = 5.5.
+// The bound ignores cancellation between random gradients, so it is far
+// above typical maxima (about 2.3), but it makes pruning conservative.
+const float noise_max       = 0.8660254f;
+const float noise_lipschitz = 5.5f;
+
+inline float sqr( float x ) { return x*x; }
+
+} // anonymous namespace
+
+float MNoise::cube_size( const Node& leaf ) const
 {
-	// test visibility (frustum clipping)
-	if( frust )
-	{
-		int vis = frust->clip_aabb( aabb_min.get(), aabb_max.get() );
-		
-		// node outside of viewing frustum
-		if( vis < 0 ) 
-#ifdef DEBUG_CUBE
-			glColor3f( .2f,0,0 ); else glColor3f( 1,0,0 );
+	return get_scale() * (float)(1 << leaf.level);
+}
+
+bool MNoise::bound( vector3 bmin, vector3 bmax, float& lo, float& hi, float& lipschitz )
+{
+#ifdef MNOISE_USE_IMPROVEDNOISE
+	return false;
 #else
-			return;
-#endif
+	if( mode == 3 ) return false;
+
+	// fBm is a scaled version of noise since all octaves share the frequency
+	float amplitudes = 0.f, amplitude = 1.f;
+	for( int i=0; i < octaves; i++ )
+	{
+		amplitudes += fabs( amplitude );
+		amplitude *= persistance;
 	}
-	
-	if( is_leaf() )
+
+	vector3 center = (bmin + bmax) / 2.f;
+	vector3 diag   = (bmax - bmin) / 2.f;
+	float radius = diag.magnitude();
+
+	float lnoise = amplitudes * noise_lipschitz,
+	      vmax   = amplitudes * noise_max,
+	      vc     = fabsnoise( center[0]+posx, center[1]+posy, center[2]+posz ),
+	      vlo    = std::max( vc - lnoise*radius, -vmax ),
+	      vhi    = std::min( vc + lnoise*radius,  vmax );
+
+	// squared distance range to origin for the cut-out terms
+	float rmin2=0.f, rmax2=0.f;
+	for( int d=0; d < 3; d++ )
 	{
-#if 0
-		draw_aabb( aabb_min, aabb_max );
-#else
-		// draw slightly smaller box to check boundary calculations
-		vector3 d = (aabb_max - aabb_min) / 2.f;
-		vector3 center = aabb_min + d;
-		draw_aabb( center - d*.9, center + d*.9 );
-#endif
+		float a = bmin[d], b = bmax[d];
+		if( a > 0.f ) rmin2 += a*a; else 
+		if( b < 0.f ) rmin2 += b*b;
+		rmax2 += std::max( a*a, b*b );
 	}
+
+	switch( mode )
+	{
+		case 1:	// fabs(noise) - 0.1/r^2
+			if( vlo <= 0.f && vhi >= 0.f )
+				lo = 0.f;
+			else
+				lo = std::min( fabs(vlo), fabs(vhi) );
+			hi = std::max( fabs(vlo), fabs(vhi) );
+			lo = (rmin2 > 0.f) ? lo - cutout() / rmin2 : -FLT_MAX;
+			hi = hi - cutout() / rmax2;
+			lipschitz = lnoise;
+			break;
+
+		case 2: // sin(4*noise) - 0.01/r^2
+			lo = std::max( sin(4*vc) - 4*lnoise*radius, -1.f );
+			hi = std::min( sin(4*vc) + 4*lnoise*radius,  1.f );
+			lo = (rmin2 > 0.f) ? lo - cutout() / rmin2 : -FLT_MAX;
+			hi = hi - cutout() / rmax2;
+			lipschitz = 4*lnoise;
+			break;
+
+		default:
+			lo = vlo;
+			hi = vhi;
+			lipschitz = lnoise;
+	}
+
+	// sample() returns 0 close to the origin
+	float eps = 0.001f;
+	if( bmin[0] <= eps && bmax[0] >= -eps && 
+	    bmin[1] <= eps && bmax[1] >= -eps &&
+	    bmin[2] <= eps && bmax[2] >= -eps )
+	{
+		lo = std::min( lo, 0.f );
+		hi = std::max( hi, 0.f );
+	}
+
+	return true;
+#endif
+}
+
+void MNoise::test_cell( int c )
+{
+	Cell& cell = cells[c];
+	cell.pos.set( posx, posy, posz );
+	cell.empty = false;
+	cell.slack = 0.f;
+
+	// region covered by marching cubes of all leaves in subtree
+	float size = cell.aabb_max[0] - cell.aabb_min[0],
+	      grow = std::max( 0.f, get_scale() * (float)(1 << cell.level) - size );
+	vector3 bmax = cell.aabb_max + vector3( grow, grow, grow );
+
+	float lo, hi, lipschitz;
+	if( !bound( cell.aabb_min, bmax, lo, hi, lipschitz ) )
+		return;
+
+	// marching cubes emits triangles only if values on both sides of isovalue
+	float iso = get_isovalue();
+	if( lo >= iso )
+		cell.empty = true, cell.slack = (lo - iso) / lipschitz;
 	else
+	if( hi < iso )
+		cell.empty = true, cell.slack = (iso - hi) / lipschitz;
+}
+
+void MNoise::refine_cell( int c )
+{
+	cells[c].children = -1;
+	test_cell( c );
+	if( cells[c].empty || cells[c].level == 0 )
+		return;
+
+	// level of detail
+	vector3 d = (cells[c].aabb_max - cells[c].aabb_min) / 2.f;
+	vector3 center = cells[c].aabb_min + d;
+	float dist = (center - viewpoint).magnitude() - d.magnitude();
+	if( lod > 0.f && dist > 0.f && 2*d[0] <= lod*dist )
+		return;
+
+	// children in same order as in former complete octree
+	static const int ofs[8][3] = {
+		{0,0,0}, {1,0,0}, {1,1,0}, {0,1,0},
+		{0,0,1}, {1,0,1}, {1,1,1}, {0,1,1} };
+
+	int first = (int)cells.size();
+	cells[c].children = first;
+	for( int i=0; i < 8; i++ )
 	{
-		for( int i=0; i < 8; i++ )  if( sons[i] )
+		Cell child;
+		child.aabb_min = cells[c].aabb_min + vector3( ofs[i][0]*d[0], ofs[i][1]*d[1], ofs[i][2]*d[2] );
+		child.aabb_max = child.aabb_min + d;
+		child.leaf     = -1;
+		child.level    = cells[c].level - 1;
+		child.children = -1;
+		cells.push_back( child );
+	}
+
+	for( int i=0; i < 8; i++ )
+		refine_cell( first + i );
+}
+
+int MNoise::count_cells( int c ) const
+{
+	int n = 1;
+	if( cells[c].children >= 0 )
+		for( int i=0; i < 8; i++ )
+			n += count_cells( cells[c].children + i );
+	return n;
+}
+
+bool MNoise::update_cell( int c )
+{
+	if( cells[c].empty )
+	{
+		// re-evaluate pruned subtree if moved further than its bound allows
+		vector3 delta = cells[c].pos - vector3( posx, posy, posz );
+		if( delta.magnitude() < cells[c].slack )
+			return false;
+
+		refine_cell( c );
+		return !cells[c].empty;
+	}
+
+	// prune subtree if it does not intersect the isosurface anymore
+	test_cell( c );
+	if( cells[c].empty )
+	{
+		if( cells[c].children >= 0 )
 		{
-			sons[i]->draw_leaves( frust );
+			garbage += count_cells( c ) - 1;
+			cells[c].children = -1;
 		}
+		return true;
 	}
+
+	bool changed = false;
+	if( cells[c].children >= 0 )
+		for( int i=0; i < 8; i++ )
+			changed |= update_cell( cells[c].children + i );
+	return changed;
 }
 
-/******************************************************************************/
-void MNoise::Octree::give_visible_leaves( Frustum* frust, 
-                                          std::stack<Node>* leaves )
+bool MNoise::update_tree()
 {
-	// test visibility (frustum clipping)
-	if( frust )
+	Params p = get_params();
+
+	// Bounds depend on all parameters except position and normals
+	bool rebuild = !tree_valid || cells.empty()
+		|| p.isovalue != tree_params.isovalue || p.scale != tree_params.scale 
+		|| p.persistance != tree_params.persistance 
+		|| p.octaves != tree_params.octaves || p.mode != tree_params.mode
+		|| lod != tree_lod 
+		|| (lod > 0.f && (viewpoint - tree_viewpoint).magnitude() > 0.f);
+
+	bool changed = false,
+	     moved   = p.posx != tree_params.posx || p.posy != tree_params.posy 
+	               || p.posz != tree_params.posz;
+	if( rebuild )
 	{
-		int vis = frust->clip_aabb( aabb_min.get(), aabb_max.get() );
-		
-		// node outside of viewing frustum
-		if( vis < 0 ) return;
+		Cell root;
+		root.aabb_min.set( -1,-1,-1 );
+		root.aabb_max.set(  1, 1, 1 );
+		root.leaf     = -1;
+		root.level    = size;
+		root.children = -1;
+
+		cells.clear();
+		cells.push_back( root );
+		garbage = 0;
+		refine_cell( 0 );
+		changed = true;
 	}
-	
-	if( is_leaf() )
+	else
+	if( moved )
+	{
+		changed = update_cell( 0 );
+		if( garbage > (int)cells.size() / 2 )
+			compact_tree();
+	}
+
+	tree_params    = p;
+	tree_valid     = true;
+	tree_lod       = lod;
+	tree_viewpoint = viewpoint;
+
+	if( changed )
+	{
+		leaves.clear();
+		number_leaves( 0 );
+	}
+	if( rebuild || moved )
+		update_bounds();
+	return changed;
+}
+
+void MNoise::compact_tree()
+{
+	// copy referenced cells breadth first, keeping children consecutive
+	std::vector<Cell> compact;
+	compact.reserve( cells.size() - garbage );
+	compact.push_back( cells[0] );
+	for( size_t i=0; i < compact.size(); i++ )
+	{
+		int children = compact[i].children;
+		if( children < 0 ) continue;
+
+		compact[i].children = (int)compact.size();
+		for( int k=0; k < 8; k++ )
+			compact.push_back( cells[ children + k ] );
+	}
+
+	cells.swap( compact );
+	garbage = 0;
+}
+
+void MNoise::number_leaves( int c )
+{
+	Cell& cell = cells[c];
+	cell.leaf = -1;
+	if( cell.empty ) 
+		return;
+
+	if( cell.children < 0 )
 	{
-		//leaf l; l.aabb_min = aabb_min; l.aabb_max = aabb_max;		
-		//leaves->push( l );
-		leaves->push( (Node)*this );
+		cell.leaf = (int)leaves.size();
+		leaves.push_back( (Node)cell );
 	}
 	else
 	{
-		for( int i=0; i < 8; i++ )  if( sons[i] )
+		for( int i=0; i < 8; i++ )
+			number_leaves( cell.children + i );
+	}
+}
+
+void MNoise::update_bounds()
+{
+	cell_bounds.resize( cells.size() );
+	for( size_t i=0; i < cells.size(); i++ )
+		cell_bounds.set( i, cells[i].aabb_min.get(), cells[i].aabb_max.get() );
+
+	leaf_bounds.resize( leaves.size() );
+	for( size_t i=0; i < leaves.size(); i++ )
+		leaf_bounds.set( i, leaves[i].aabb_min.get(), leaves[i].aabb_max.get() );
+}
+
+void MNoise::visible_leaves( Frustum* f, std::vector<int>& ids )
+{
+	ids.clear();
+	if( cells.empty() || cells[0].empty )
+		return;
+
+	// Cells to visit with the frustum planes they intersect
+	std::vector<int>           todo;
+	std::vector<unsigned char> todo_masks;
+
+	int           group[8];
+	unsigned char group_masks[8];
+	int n = 1;
+	group[0] = 0;
+	group_masks[0] = 0;
+	if( f )
+	{
+		culler.setPlanes( f->get_planes(), 6 );
+		n = culler.cull( cell_bounds, 0, 1, group, group_masks );
+	}
+
+	for( ;; )
+	{
+		for( int i=0; i < n; i++ )
 		{
-			sons[i]->give_visible_leaves( frust, leaves );
+			const Cell& cell = cells[ group[i] ];
+			if( cell.empty )
+				continue;
+			if( cell.children < 0 )
+				ids.push_back( cell.leaf );
+			else
+			{
+				todo.push_back( cell.children );
+				todo_masks.push_back( group_masks[i] );
+			}
 		}
+
+		if( todo.empty() )
+			break;
+
+		// Test children against the planes intersected by their parent
+		int first = todo.back();
+		unsigned mask = todo_masks.back();
+		todo.pop_back();
+		todo_masks.pop_back();
+		n = culler.cull( cell_bounds, first, 8, group, group_masks, mask );
 	}
 }
 
-/******************************************************************************/
-void MNoise::Octree::build_complete( int level )
+void MNoise::draw_cells( int c, Frustum* f )
 {
-	if( level==0 ) return;
-		
-	vector3 d = (aabb_max - aabb_min) / 2.f;
-	vector3 center = aabb_min + d;
-		
-	sons[0] = new Octree( aabb_min, center );
-	sons[1] = new Octree( aabb_min + vector3( d[0],   0,  0 ) , center + vector3( d[0],   0,   0 ) );
-	sons[2] = new Octree( aabb_min + vector3( d[0],d[1],  0 ) , center + vector3( d[0],d[1],   0 ) );
-	sons[3] = new Octree( aabb_min + vector3(    0,d[1],  0 ) , center + vector3(    0,d[1],   0 ) );
-	sons[4] = new Octree( aabb_min + vector3(    0,   0,d[2] ), center + vector3(    0,   0,d[2] ) );
-	sons[5] = new Octree( aabb_min + vector3( d[0],   0,d[2] ), center + vector3( d[0],   0,d[2] ) );
-	sons[6] = new Octree( aabb_min + vector3( d[0],d[1],d[2] ), center + vector3( d[0],d[1],d[2] ) );
-	sons[7] = new Octree( aabb_min + vector3(    0,d[1],d[2] ), center + vector3(    0,d[1],d[2] ) );
+	Cell& cell = cells[c];
+	if( cell.empty ) 
+		return;
 
-	for( int i=0; i < 8; i++ )
-		sons[i]->build_complete( level - 1 );		
+	// test visibility (frustum clipping)
+	if( f )
+	{
+		int vis = f->clip_aabb( cell.aabb_min.get(), cell.aabb_max.get() );
+		
+		// node outside of viewing frustum
+		if( vis < 0 ) 
+#ifdef DEBUG_CUBE
+			glColor3f( .2f,0,0 ); else glColor3f( 1,0,0 );
+#else
+			return;
+#endif
+	}
+	
+	if( cell.children < 0 )
+	{
+		// draw slightly smaller box to check boundary calculations
+		vector3 d = (cell.aabb_max - cell.aabb_min) / 2.f;
+		vector3 center = cell.aabb_min + d;
+		draw_aabb( center - d*.9, center + d*.9 );
+	}
+	else
+	{
+		for( int i=0; i < 8; i++ )
+			draw_cells( cell.children + i, f );
+	}
 }
-
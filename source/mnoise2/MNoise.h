@@ -6,13 +6,47 @@
 #include "vector3.h"
 #include "Frustum.h"
 #include "MarchingCubes.h"
-#include <stack>
+#include "FieldCache.h"
+#include "PerlinNoise.h"
+#include <glutils/FrustumCuller.h>
+#include <vector>
 
 /** 
   Marching Noise - 3D Perlin noise isosurface
 
-  MNoise holds a complete octree used for frustum culling in which each leaf
-  stores the mid-points needed by the marching cubes algorithm.
+  MNoise holds a sparse octree used for frustum culling in which each leaf
+  corresponds to a single cube of the marching cubes algorithm. Subtrees
+  which can not intersect the isosurface are pruned via a Lipschitz bound
+  of the noise. Optionally leaves are coarsened with distance to the
+  viewpoint (level of detail). When the position changes only pruned
+  subtrees whose bound is no longer conservative are rebuilt.
+
+  The isosurface of visible leaves is extracted into an indexed mesh which is
+  kept (and uploaded as vertex buffer object if available) until the
+  isovalue, noise parameters or position change. Frustum culling is then
+  performed per leaf on the index ranges of the cached mesh.
+
+  Frustum culling traverses the octree testing the 8 children of a cell at
+  once via FrustumCuller, only against the planes intersected by the cell.
+
+  Leaves are polygonized in parallel (if compiled with OpenMP), each thread
+  appending to its own arena. Per leaf results are kept in the arenas, such
+  that leaves becoming visible only have to be polygonized once as long as
+  the parameters do not change.
+
+  Alternatively in scrolling mode the octree is bypassed and the domain is
+  polygonized from a toroidal FieldCache of noise samples on a lattice fixed
+  in world coordinates. The domain is split into blocks of the lattice whose
+  meshes are kept in a ring buffer next to the samples, in world coordinates,
+  and the position is applied as offset in the modelview. When the position
+  changes only the newly exposed slabs of the lattice are sampled and only
+  the blocks in them are polygonized, such that the cost per frame is
+  proportional to the camera speed instead of to the domain volume. Modes
+  with a cut-out around the viewer depend on the position everywhere, there
+  the whole domain is polygonized again whenever the position changes (from
+  the cached samples, without blocks which would crack on their shared faces
+  when polygonized for different positions). Note that the lattice then
+  moves with the noise instead of with the viewer.
  */
 class MNoise : public MarchingCubes
 {
@@ -21,7 +55,34 @@ public:
 	~MNoise();
 	
 	int  build();
+	/// Polygonize visible leaves not extracted yet (all leaves if parameters
+	/// changed since last update) and rebuild the mesh, returns true if the
+	/// mesh was regenerated.
+	bool update();
+	/// Seed noise generator and force re-extraction
+	void reseed( unsigned seed ) { noise_gen = PerlinNoiseGenerator( seed ); invalidate(); };
+	unsigned get_seed() const { return noise_gen.get_seed(); };
+	/// Force re-extraction on next update(), e.g. after reseeding the noise
+	void invalidate() { valid = false; tree_valid = false; field.invalidate(); };
+	/// Draw visible leaves of mesh of last update()
 	void draw();
+	/// Mesh of last update(), in scrolling mode in world coordinates (i.e.
+	/// not relative to the position)
+	const MCMesh& get_mesh() const { return mesh; };
+	/// Extract isosurface of all octree leaves (or only of those inside the
+	/// given frustum) and append it to out, vertices on cube edges shared by
+	/// leaves of the same level are welded. If offsets is given it receives
+	/// the start of each leaf in out.indices followed by the end offset.
+	void extract( MCMesh& out, Frustum* f=NULL,
+	              std::vector<unsigned>* offsets=NULL );
+
+	/// Enable parallel polygonization of leaves (only with OpenMP)
+	void set_parallel( bool b ) { parallel = b; };
+	bool get_parallel() const { return parallel; };
+	/// Enable scrolling mode, polygonizing the complete domain from cached
+	/// noise samples (no octree, no frustum culling)
+	void set_scrolling( bool b ) { if( b != scrolling ) valid = false; scrolling = b; };
+	bool get_scrolling() const { return scrolling; };
 	/// Debug visualization: Show octree AABB's
 	void draw_octree();
 	/// Debug mode: Draw all cubes (ignore octree and frustum culling completely)
@@ -33,8 +94,20 @@ public:
 	
 	// sample function for marchingcubes
 	float sample( float x, float y, float z ); // FIXME: public?
+	/// Batched version of sample() evaluating the noise vectorized
+	void  sample_batch( const float* x, const float* y, const float* z,
+	                    float* result, int n );
 	
 	int   get_cubecount() { return cubecount; };
+	/// Number of octree nodes (including pruned ones)
+	int   get_cellcount() const { return (int)cells.size() - garbage; };
+
+	/// Set level of detail threshold, octree cells are only subdivided while
+	/// their edge length exceeds lod times their distance to the viewpoint.
+	/// Default is 0, i.e. all leaves at finest level.
+	void  set_lod( float lod_ ) { lod = lod_; };
+	float get_lod() const { return lod; };
+	void  set_viewpoint( vector3 p ) { viewpoint = p; };
 
 	//void  set_scale( float s ) { scale = s; };
 	//float get_scale() { return scale; };
@@ -62,6 +135,20 @@ public:
 	
 protected:
 	float fabsnoise( float x, float y, float z );	
+	/// Apply processing according to mode to noise value sampled at (x,y,z)
+	float process( float noise, float x, float y, float z ) const;
+	/// process() for n noise values sampled at (x,y,z), zero at origin
+	void  process_batch( const float* x, const float* y, const float* z,
+	                     float* result, int n ) const;
+	/// Strength a of the cut-out term a/r^2 subtracted by process() at
+	/// distance r to the viewer, 0 if the current mode has none
+	float cutout() const { return mode == 1 ? 0.1f : mode == 2 ? 0.01f : 0.f; };
+	/// fabsnoise() for n points offset by current position (posx,posy,posz)
+	void  fabsnoise_batch( const float* x, const float* y, const float* z,
+	                       float* result, int n );
+	/// fabsnoise() for n points offset by (ox,oy,oz)
+	void  fabsnoise_batch( const float* x, const float* y, const float* z,
+	                       float* result, int n, float ox, float oy, float oz );
 	
 
 protected:
@@ -69,50 +156,50 @@ protected:
 	struct Node
 	{
 		vector3 aabb_min, aabb_max;
+		int leaf;   // leaf number, -1 for inner and empty nodes
+		int level;  // remaining subdivision levels, 0 at finest level
 	};
 
-	typedef std::stack<Node> Leaves;
-
-	/// Recursively defined octree (full)
-	class Octree : public Node
+	/// Sparse octree node, stored in contiguous array cells where the 8
+	/// children of a node are stored consecutively.
+	struct Cell : public Node
 	{
-		friend class MNoise;
-
-		Octree* sons[8];
-
-	public:
-		Octree( vector3 const min, vector3 const max ) 
-		{ 
-			aabb_min = min;
-			aabb_max = max; 
-			for( int i=0; i < 8; i++ ) sons[i] = NULL;
-		};
-	
-		~Octree()
-		{
-			for( int i=0; i < 8; i++ )
-				if( sons[i] ) { delete sons[i]; sons[i]=NULL; }
-		};
-	
-		/// create all 8 sons until level==0
-		void build_complete( int level );
-	
-		/// draw all leafs in this subtree
-		void draw_leaves( Frustum* frust=NULL );
-
-		bool is_leaf() {
-			return( !sons[0]&&!sons[1]&&!sons[2]&&!sons[3]&&
-					!sons[4]&&!sons[5]&&!sons[6]&&!sons[7] );
-		};
-
-	protected:
-		void give_visible_leaves( Frustum* frust, 
-			                      std::stack<Node>* leaves );
+		int     children;  // index of first child, -1 for leaves
+		bool    empty;     // pruned, can not intersect the isosurface
+		float   slack;     // max. position change until empty is re-evaluated
+		vector3 pos;       // position at evaluation of empty
 	};
 
+	/// Conservative range [lo,hi] of sampled values in given box, returns
+	/// false if no bound is available for current mode. Also returns the
+	/// Lipschitz constant of sampled values wrt. position changes.
+	bool  bound( vector3 bmin, vector3 bmax, float& lo, float& hi, float& lipschitz );
+	/// Test if cell can be pruned, sets empty, slack and pos accordingly
+	void  test_cell( int c );
+	/// (Re)build subtree of cell
+	void  refine_cell( int c );
+	/// Rebuild pruned subtrees whose bound is violated after position change
+	/// and prune subtrees which became empty, returns true if tree changed
+	bool  update_cell( int c );
+	/// Rebuild tree if necessary, returns true if leaves changed
+	bool  update_tree();
+	/// Remove unreferenced cells
+	void  compact_tree();
+	/// Number of cells in subtree
+	int   count_cells( int c ) const;
+	/// Number cells of non-empty leaves in depth first order
+	void  number_leaves( int c );
+	/// Copy bounds of cells and leaves for culling
+	void  update_bounds();
+	/// Leaf numbers of non-empty leaves inside frustum (all if f is NULL)
+	void  visible_leaves( Frustum* f, std::vector<int>& ids );
+	/// Debug visualization of non-empty leaves
+	void  draw_cells( int c, Frustum* f );
+	/// Edge length of marching cube of given leaf
+	float cube_size( const Node& leaf ) const;
 
 private:
-	Octree*  root;          // root of octree
+	PerlinNoiseGenerator noise_gen; // used concurrently by polygonization
 	Frustum* frust;         // viewing frustum
 	int   size;		        // size as power of two (2^size)
 	int   cubecount;        // numer of cubes drawn	
@@ -120,6 +207,119 @@ private:
 	int   octaves;
 	float persistance;
 	int   mode;
+
+	/// Parameters the extracted mesh depends on
+	struct Params
+	{
+		float isovalue, scale, posx, posy, posz, persistance;
+		int   octaves, mode;
+		bool  normals;
+
+		bool operator == ( const Params& p ) const;
+	};
+	Params get_params() const;
+
+	/// Extracted mesh of a single leaf, stored in one of the arenas
+	struct LeafMesh
+	{
+		int      arena;           // -1 if not extracted
+		unsigned vfirst, vcount;  // vertex range in arena
+		unsigned ifirst, icount;  // index range in arena
+		int      edges;           // intersected cube edges, see marchcube()
+
+		LeafMesh(): arena(-1), vfirst(0), vcount(0), ifirst(0), icount(0),
+		            edges(0) {}
+	};
+
+	/// Polygonize given leaves in parallel, one arena per thread
+	void march_leaves( const std::vector<int>& ids, std::vector<MCMesh>& arenas,
+	                   std::vector<LeafMesh>& leaf_meshes );
+	/// Append extracted leaves in leaf order to out and weld them
+	void concat_leaves( const std::vector<MCMesh>& arenas, 
+	                    const std::vector<LeafMesh>& leaf_meshes,
+	                    MCMesh& out, std::vector<unsigned>* offsets );
+	/// Merge vertices of concatenated leaves lying on the same lattice edge,
+	/// starting at vertex vbase[0] and index ifirst of out. The first vertex
+	/// in leaf order is kept, such that the result is deterministic.
+	void weld_leaves( const std::vector<LeafMesh>& leaf_meshes,
+	                  const std::vector<unsigned>& vbase, unsigned ifirst,
+	                  MCMesh& out ) const;
+	/// Upload mesh to GL buffer objects (if supported)
+	void upload();
+	/// update() in scrolling mode, scroll field cache and polygonize blocks
+	/// which are new or stale
+	bool update_field();
+
+	/// Polygonized block of block_size^3 cubes in scrolling mode
+	struct FieldBlock
+	{
+		int    index[3];   // block index, i.e. lattice index / block_size
+		bool   valid;
+		float  viewer[3];  // position the block was polygonized for
+		MCMesh mesh;       // in world coordinates
+		std::vector<int> edges; // lattice edge per vertex, see polygonize()
+
+		FieldBlock(): valid(false) {}
+	};
+	/// Test if the zero neighbourhood of the viewer in process_batch() affects
+	/// the block at the position it was polygonized for or the current one
+	/// (modes without cut-out)
+	bool stale_block( const FieldBlock& b ) const;
+	/// Concatenate blocks of the domain starting at block index first in
+	/// mesh and weld their vertices on shared faces
+	void concat_blocks( const int first[3], int nb );
+
+	/// Samples world space noise for the field cache
+	struct FieldSource : public FieldCache::Source
+	{
+		MNoise* noise;
+		FieldSource( MNoise* n ): noise(n) {}
+		void sample_field( const float* x, const float* y, const float* z,
+		                   float* result, int n )
+		{
+			noise->fabsnoise_batch( x, y, z, result, n, 0.f, 0.f, 0.f );
+		}
+	};
+
+	/// Polygonizes a block of size^3 cubes from the field cache as seen from
+	/// the given viewer position, one instance per block such that blocks can
+	/// be polygonized concurrently
+	struct BlockMarcher : public MarchingCubes
+	{
+		const MNoise* noise;
+		int   base[3];   // lattice index of first cube corner
+		float viewer[3];
+		std::vector<float> rx, ry, rz;  // positions relative to viewer
+
+		BlockMarcher( const MNoise* n, const int base_[3], const float viewer_[3],
+		              int size );
+		void sample_layer( int k, int px, int py, const float* x,
+		                   const float* y, const float* z, float* result );
+	};
+
+	std::vector<Cell>     cells;        // octree, root at index 0
+	int                   garbage;      // number of unreferenced cells
+	Params                tree_params;  // parameters of octree
+	bool                  tree_valid;   // octree is up to date wrt. params
+	float                 lod, tree_lod;
+	vector3               viewpoint, tree_viewpoint;
+
+	std::vector<Node>     leaves;       // non-empty octree leaves
+	AABBArray             cell_bounds;  // bounds of cells for culling
+	AABBArray             leaf_bounds;  // bounds of leaves for culling
+	FrustumCuller         culler;
+	std::vector<MCMesh>   arenas;       // per thread polygonization results
+	std::vector<LeafMesh> leaf_meshes;  // per leaf location in arenas
+	MCMesh                mesh;         // concatenated mesh of extracted leaves
+	std::vector<unsigned> leaf_offsets; // index range of each leaf in mesh
+	Params                params;       // parameters of arenas and mesh
+	bool                  valid;        // arenas are up to date wrt. params
+	bool                  parallel;
+	bool                  scrolling;
+	FieldCache            field;        // world space noise in scrolling mode
+	Params                field_params; // parameters of field and blocks
+	std::vector<FieldBlock> blocks;     // ring of blocks, see update_field()
+	unsigned              vbo, ibo;     // GL buffer objects, 0 if unused
 };
 
 #endif
@@ -4,6 +4,9 @@
 #include <windows.h>
 #endif
 #include <GL/gl.h>
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
 
 // example sample function
 float MarchingCubes::sample( float x, float y, float z )
@@ -36,6 +39,19 @@ float MarchingCubes::sample( float x, float y, float z )
 	return result;
 }
 
+void MarchingCubes::sample_batch( const float* x, const float* y, const float* z,
+                                  float* result, int n )
+{
+	for( int i=0; i < n; i++ )
+		result[i] = sample( x[i], y[i], z[i] );
+}
+
+void MarchingCubes::sample_layer( int k, int px, int py, const float* x, 
+                                  const float* y, const float* z, float* result )
+{
+	sample_batch( x, y, z, result, px*py );
+}
+
 // get_offset finds the approximate point of intersection of the surface
 // between two points with the values val1 and val2
 float MarchingCubes::get_offset( float val1, float val2, float desired )
@@ -51,7 +67,7 @@ float MarchingCubes::get_offset( float val1, float val2, float desired )
 }
 
 // perform marching cubes algorithm on a single cube
-void MarchingCubes::marchcube( float x, float y, float z )
+int MarchingCubes::marchcube( float x, float y, float z, float size, MCMesh& mesh )
 {
 	float 	cube[8];
 	int 	index=0;
@@ -59,14 +75,23 @@ void MarchingCubes::marchcube( float x, float y, float z )
 	vector3	edgeverts[12];
 	vector3 normals[12];
 	int 	i,j;
+
+	// sample positions, 8 corners or up to 6 per intersected edge for normals
+	float	px[72], py[72], pz[72], val[72];
+	int		n;
 	
 	for( i=0; i < 8; i++ )
 	{
-		// local copy of cube values for intersection-calc
-		cube[i] = sample( x + cube_ofs[i][0]*scale, 
-		                  y + cube_ofs[i][1]*scale, 
-		                  z + cube_ofs[i][2]*scale );
+		px[i] = x + cube_ofs[i][0]*size;
+		py[i] = y + cube_ofs[i][1]*size;
+		pz[i] = z + cube_ofs[i][2]*size;
+	}
+	
+	// local copy of cube values for intersection-calc
+	sample_batch( px, py, pz, cube, 8 );
 
+	for( i=0; i < 8; i++ )
+	{
 		// build index
 		if( cube[i] < isovalue ) index |= 1<<i;
 	}
@@ -75,75 +100,287 @@ void MarchingCubes::marchcube( float x, float y, float z )
 	edgeflags = edge_tab[ index ];
 	
 	// cube completely inside/outside -> no intersections
-	if( edgeflags == 0 ) return;
+	if( edgeflags == 0 ) return 0;
 	
 	// find intersection surface-edge 
+	n = 0;
 	for( i=0; i < 12; i++ ) if( edgeflags & (1<<i) )
 	{
 		float ofs = get_offset( cube[cube_con[i][0]], cube[cube_con[i][1]], 
 		                        isovalue );
 		
 		edgeverts[i].set( 
-		  x + ( cube_ofs[ cube_con[i][0] ][0] + ofs * cube_dir[i][0] ) * scale,
-		  y + ( cube_ofs[ cube_con[i][0] ][1] + ofs * cube_dir[i][1] ) * scale,
-		  z + ( cube_ofs[ cube_con[i][0] ][2] + ofs * cube_dir[i][2] ) * scale
+		  x + ( cube_ofs[ cube_con[i][0] ][0] + ofs * cube_dir[i][0] ) * size,
+		  y + ( cube_ofs[ cube_con[i][0] ][1] + ofs * cube_dir[i][1] ) * size,
+		  z + ( cube_ofs[ cube_con[i][0] ][2] + ofs * cube_dir[i][2] ) * size
 		);
 		
 		float delta = 0.001;
 		
 		if( compute_normals )
 		{
-			normals[i].set(
-			  sample( edgeverts[i][0]-delta, edgeverts[i][1], edgeverts[i][2] ) 
-		    - sample( edgeverts[i][0]+delta, edgeverts[i][1], edgeverts[i][2] ),
-
-			  sample( edgeverts[i][0], edgeverts[i][1]-delta, edgeverts[i][2] ) 
-		 	- sample( edgeverts[i][0], edgeverts[i][1]+delta, edgeverts[i][2] ),
-
-			  sample( edgeverts[i][0], edgeverts[i][1], edgeverts[i][2]-delta )
-			- sample( edgeverts[i][0], edgeverts[i][1], edgeverts[i][2]+delta )		  
-			);
-			
+			// central differences, gathered to sample all edges at once
+			for( j=0; j < 6; j++ )
+			{
+				px[n+j] = edgeverts[i][0];
+				py[n+j] = edgeverts[i][1];
+				pz[n+j] = edgeverts[i][2];
+			}
+			px[n  ] -= delta;  px[n+1] += delta;
+			py[n+2] -= delta;  py[n+3] += delta;
+			pz[n+4] -= delta;  pz[n+5] += delta;
+			n += 6;
+		}
+	}
+	
+	if( compute_normals )
+	{
+		sample_batch( px, py, pz, val, n );
+		
+		n = 0;
+		for( i=0; i < 12; i++ ) if( edgeflags & (1<<i) )
+		{
+			normals[i].set( val[n  ] - val[n+1],
+			                val[n+2] - val[n+3],
+			                val[n+4] - val[n+5] );
 			normals[i].normalize();
+			n += 6;
 		}
 	}
 	
-#if 1
-	// draw triangles
-	glBegin( GL_TRIANGLE_STRIP );
-	for( i=0; i < 5; i++ ) if( tri_tab[index][3*i] >= 0 )
-	{		
+	// add vertices of intersected edges and triangles to mesh
+	unsigned verts[12];
+	for( i=0; i < 12; i++ ) if( edgeflags & (1<<i) )
+	{
+		verts[i] = (unsigned)mesh.num_vertices();
 		for( j=0; j < 3; j++ )
 		{
-			int vert = tri_tab[index][3*i+j];
-			
+			mesh.vertices.push_back( edgeverts[i][j] );
 			if( compute_normals )
-				glNormal3fv( normals[vert].get() );
-			glVertex3fv( edgeverts[vert].get() );
+				mesh.normals.push_back( normals[i][j] );
 		}
 	}
-	glEnd();
-#else
-	// Debug visualization: Show sample points		
-	glPointSize( 5.f );
-	glBegin( GL_POINTS );
-	for( i=0; i < 8; i++ )
+
+	for( i=0; i < 5 && tri_tab[index][3*i] >= 0; i++ )
+		for( j=0; j < 3; j++ )
+			mesh.indices.push_back( verts[ tri_tab[index][3*i+j] ] );
+
+	return edgeflags;
+}
+
+bool MCMesh::write_obj( const char* filename ) const
+{
+	FILE* f = fopen( filename, "w" );
+	if( !f )
 	{
-		// build index
-		if( cube[i] < isovalue ) 
+		fprintf( stderr, "MCMesh::write_obj() : Couldn't open %s!\n", filename );
+		return false;
+	}
+
+	fprintf( f, "# %u vertices, %u triangles\n",
+	         (unsigned)num_vertices(), (unsigned)num_triangles() );
+	for( size_t i=0; i < vertices.size(); i+=3 )
+		fprintf( f, "v %g %g %g\n", vertices[i], vertices[i+1], vertices[i+2] );
+	for( size_t i=0; i < normals.size(); i+=3 )
+		fprintf( f, "vn %g %g %g\n", normals[i], normals[i+1], normals[i+2] );
+
+	// OBJ indices are 1-based
+	bool has_normals = !normals.empty();
+	for( size_t i=0; i < indices.size(); i+=3 )
+	{
+		unsigned a = indices[i]+1, b = indices[i+1]+1, c = indices[i+2]+1;
+		if( has_normals )
+			fprintf( f, "f %u//%u %u//%u %u//%u\n", a,a, b,b, c,c );
+		else
+			fprintf( f, "f %u %u %u\n", a, b, c );
+	}
+
+	bool ok = !ferror( f );
+	fclose( f );
+	if( !ok )
+		fprintf( stderr, "MCMesh::write_obj() : Error writing %s!\n", filename );
+	return ok;
+}
+
+void MarchingCubes::draw_mcubes()
+{
+	float ofs = (-(datasize/2))*scale;
+
+	grid_mesh.clear();
+	polygonize( ofs, ofs, ofs, datasize, datasize, datasize, grid_mesh );
+	draw_mesh( grid_mesh );
+}
+
+void MarchingCubes::draw_mesh( const MCMesh& mesh )
+{
+	if( mesh.indices.empty() ) return;
+
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glVertexPointer( 3, GL_FLOAT, 0, &mesh.vertices[0] );
+	if( !mesh.normals.empty() )
+	{
+		glEnableClientState( GL_NORMAL_ARRAY );
+		glNormalPointer( GL_FLOAT, 0, &mesh.normals[0] );
+	}
+
+	glDrawElements( GL_TRIANGLES, (GLsizei)mesh.indices.size(), GL_UNSIGNED_INT,
+	                &mesh.indices[0] );
+
+	glDisableClientState( GL_NORMAL_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
+}
+
+// Lattice of sampled values for polygonize(), stores a ring of four
+// z-layers (k-1 to k+2) to process the cubes between layer k and k+1
+// including the central differences at their corners. Each layer is padded
+// by one sample at each side.
+struct MCLattice
+{
+	int nx, ny, px, py;
+	std::vector<float> values;
+
+	MCLattice( int nx_, int ny_ )
+	: nx(nx_), ny(ny_), px(nx_+3), py(ny_+3), values( 4*(nx_+3)*(ny_+3) )
+	{}
+
+	float* layer( int k ) { return &values[ ((k+1)&3) * px*py ]; }
+
+	float operator () ( int i, int j, int k )
+	{
+		return layer( k )[ (j+1)*px + i+1 ];
+	}
+
+	// negative gradient (scaled by twice the grid spacing)
+	void normal( int i, int j, int k, float* n )
+	{
+		n[0] = (*this)(i-1,j,k) - (*this)(i+1,j,k);
+		n[1] = (*this)(i,j-1,k) - (*this)(i,j+1,k);
+		n[2] = (*this)(i,j,k-1) - (*this)(i,j,k+1);
+	}
+};
+
+void MarchingCubes::polygonize( float x0, float y0, float z0, int nx, int ny, int nz,
+                                MCMesh& mesh, std::vector<int>* edges )
+{
+	if( nx <= 0 || ny <= 0 || nz <= 0 ) return;
+
+	const unsigned none = ~0u;
+
+	MCLattice lat( nx, ny );
+	int layersize = lat.px * lat.py;
+
+	// sample positions of a padded layer
+	std::vector<float> lx( layersize ), ly( layersize ), lz( layersize );
+	for( int j=0; j < lat.py; j++ )
+		for( int i=0; i < lat.px; i++ )
 		{
-			glColor3f( 0.6,0.6,1 );
+			lx[ j*lat.px + i ] = x0 + (i-1)*scale;
+			ly[ j*lat.px + i ] = y0 + (j-1)*scale;
 		}
-		else
+
+	// edge vertex indices, x- and y-edges for bottom [0] and top [1] layer
+	// of current slab and z-edges in between
+	std::vector<unsigned> xedge[2], yedge[2], zedge;
+	for( int l=0; l < 2; l++ )
+	{
+		xedge[l].assign( nx*(ny+1), none );
+		yedge[l].assign( (nx+1)*ny, none );
+	}
+	zedge.assign( (nx+1)*(ny+1), none );
+
+	for( int k=-1; k <= nz+1; k++ )
+	{
+		// sample next layer
+		std::fill( lz.begin(), lz.end(), z0 + k*scale );
+		sample_layer( k, lat.px, lat.py, &lx[0], &ly[0], &lz[0], lat.layer( k ) );
+
+		// cubes between layers k-2 and k-1 are complete now
+		int kc = k-2;
+		if( kc < 0 ) continue;
+
+		for( int j=0; j < ny; j++ )
+		for( int i=0; i < nx; i++ )
 		{
-			glColor3f( 0.1,0.1,.4 );
+			float cube[8];
+			int   index=0;
+			for( int c=0; c < 8; c++ )
+			{
+				cube[c] = lat( i+cube_ofs[c][0], j+cube_ofs[c][1], kc+cube_ofs[c][2] );
+				if( cube[c] < isovalue ) index |= 1<<c;
+			}
+
+			int edgeflags = edge_tab[ index ];
+			if( edgeflags == 0 ) continue;
+
+			unsigned verts[12];
+			for( int e=0; e < 12; e++ ) if( edgeflags & (1<<e) )
+			{
+				int axis = cube_edge_lattice[e][0],
+				    ia   = i  + cube_edge_lattice[e][1],
+				    ja   = j  + cube_edge_lattice[e][2],
+				    ka   = kc + cube_edge_lattice[e][3],
+				    dl   = cube_edge_lattice[e][3];
+
+				unsigned* cache;
+				if( axis == 0 )
+					cache = &xedge[dl][ ja*nx + ia ];
+				else if( axis == 1 )
+					cache = &yedge[dl][ ja*(nx+1) + ia ];
+				else
+					cache = &zedge[ ja*(nx+1) + ia ];
+
+				if( *cache == none )
+				{
+					int ib = ia + (axis==0),
+					    jb = ja + (axis==1),
+					    kb = ka + (axis==2);
+
+					float ofs = get_offset( lat(ia,ja,ka), lat(ib,jb,kb), isovalue );
+
+					*cache = (unsigned)mesh.num_vertices();
+					mesh.vertices.push_back( x0 + (ia + ofs*(axis==0))*scale );
+					mesh.vertices.push_back( y0 + (ja + ofs*(axis==1))*scale );
+					mesh.vertices.push_back( z0 + (ka + ofs*(axis==2))*scale );
+
+					if( compute_normals )
+					{
+						float na[3], nb[3], n[3];
+						lat.normal( ia, ja, ka, na );
+						lat.normal( ib, jb, kb, nb );
+						for( int d=0; d < 3; d++ )
+							n[d] = na[d] + ofs*(nb[d] - na[d]);
+
+						float len = sqrt( n[0]*n[0] + n[1]*n[1] + n[2]*n[2] );
+						if( len > 0.f )
+						{
+							n[0] /= len; n[1] /= len; n[2] /= len;
+						}
+						mesh.normals.push_back( n[0] );
+						mesh.normals.push_back( n[1] );
+						mesh.normals.push_back( n[2] );
+					}
+
+					if( edges )
+					{
+						edges->push_back( axis );
+						edges->push_back( ia );
+						edges->push_back( ja );
+						edges->push_back( ka );
+					}
+				}
+				verts[e] = *cache;
+			}
+
+			for( int t=0; t < 5 && tri_tab[index][3*t] >= 0; t++ )
+				for( int v=0; v < 3; v++ )
+					mesh.indices.push_back( verts[ tri_tab[index][3*t+v] ] );
 		}
 
-		// local copy of cube values for intersection-calc
-		glVertex3f( x + cube_ofs[i][0]*scale, 
-		            y + cube_ofs[i][1]*scale, 
-		            z + cube_ofs[i][2]*scale );
+		// top layer of this slab becomes bottom layer of the next one
+		xedge[0].swap( xedge[1] );
+		yedge[0].swap( yedge[1] );
+		std::fill( xedge[1].begin(), xedge[1].end(), none );
+		std::fill( yedge[1].begin(), yedge[1].end(), none );
+		std::fill( zedge.begin(), zedge.end(), none );
 	}
-	glEnd();
-#endif
 }
@@ -2,6 +2,22 @@
 #define MARCHINGCUBES_H
 
 #include "vector3.h"
+#include <vector>
+
+/// Indexed triangle mesh with shared vertices as produced by MarchingCubes
+struct MCMesh
+{
+	std::vector<float>    vertices; ///< 3 floats per vertex
+	std::vector<float>    normals;  ///< 3 floats per vertex, empty w/o normals
+	std::vector<unsigned> indices;  ///< 3 vertex indices per triangle
+
+	void clear() { vertices.clear(); normals.clear(); indices.clear(); }
+	size_t num_vertices () const { return vertices.size() / 3; }
+	size_t num_triangles() const { return indices.size() / 3; }
+
+	/// Write mesh as Wavefront OBJ file
+	bool write_obj( const char* filename ) const;
+};
 
 class MarchingCubes
 {
@@ -24,19 +40,41 @@ public:
 
 	/// Override this by the function to be polygonized
 	virtual float sample( float x, float y, float z );
+
+	/// Evaluate sample() for n points given as separate coordinate arrays.
+	/// Override this if the function can be evaluated more efficiently for
+	/// several points at once, the default simply calls sample() per point.
+	virtual void sample_batch( const float* x, const float* y, const float* z,
+	                           float* result, int n );
+
+	/// Sample padded layer k of the lattice of polygonize(), i.e. the px*py
+	/// points (i-1,j-1,k) at the given positions with result[j*px+i]. The
+	/// default calls sample_batch(), override this e.g. to provide cached
+	/// lattice values.
+	virtual void sample_layer( int k, int px, int py, const float* x, 
+	                           const float* y, const float* z, float* result );
 	
-	void draw_mcubes()
-	{
-		for( int x=0; x < datasize; x++ )
-		for( int y=0; y < datasize; y++ )
-		for( int z=0; z < datasize; z++ )
-			marchcube( (x-datasize/2)*scale, (y-datasize/2)*scale, (z-datasize/2)*scale );
-	};
+	/// Polygonize complete datasize^3 grid centered at origin and draw it
+	void draw_mcubes();
+
+	/// Polygonize grid of nx*ny*nz cubes with edge length scale starting at
+	/// (x0,y0,z0) and append the result to mesh. The field is sampled once
+	/// per lattice point slab by slab, normals are derived from the sampled
+	/// lattice and vertices on shared cube edges are generated only once.
+	/// If edges is given, the lattice edge of each appended vertex is appended
+	/// to it as four ints: its axis and the lattice index (i,j,k) of its lower
+	/// end point, relative to (x0,y0,z0).
+	void polygonize( float x0, float y0, float z0, int nx, int ny, int nz,
+	                 MCMesh& mesh, std::vector<int>* edges=NULL );
+
+	/// Draw mesh via vertex arrays
+	static void draw_mesh( const MCMesh& mesh );
 	
 	void  set_isovalue( float iso ) { isovalue = iso; };
-	float get_isovalue() { return isovalue; };
+	float get_isovalue() const { return isovalue; };
 	
 	void  set_compute_normals( bool b ) { compute_normals = b; }
+	bool  get_compute_normals() const { return compute_normals; }
 
 	///@{ Scale sampling of octree leaf cell to produce overdraw effect.
 	///   For the base domain from (-1,-1,-1) to (1,1,1) and an octree edge
@@ -48,7 +86,15 @@ public:
 	///@}
 
 protected:
-	void  marchcube( float x, float y, float z );
+	/// Polygonize single cube at (x,y,z) with given edge length and append
+	/// the result to mesh, vertices are shared only within the cube. Returns
+	/// the intersected cube edges (bit i for edge i), the appended vertices
+	/// belong to the set bits in increasing order.
+	int   marchcube( float x, float y, float z, float size, MCMesh& mesh );
+	int   marchcube( float x, float y, float z, MCMesh& mesh )
+	{
+		return marchcube( x, y, z, scale, mesh );
+	}
 	float get_offset( float val1, float val2, float desired );
 
 private:
@@ -56,6 +102,8 @@ private:
 	float scale;
 	int   datasize;
 	bool  compute_normals;
+
+	MCMesh grid_mesh;  // buffer for draw_mcubes()
 };
 
 #endif
@@ -28,6 +28,15 @@
         {0.0, 0.0, 1.0},{0.0, 0.0, 1.0},{ 0.0, 0.0, 1.0},{0.0,  0.0, 1.0}
 	};
 
+	// lattice edge for each cube edge, given as axis and offset of its
+	// lower end point (used to share edge vertices between cubes)
+	static const int cube_edge_lattice[12][4] =
+	{
+        {0, 0,0,0}, {1, 1,0,0}, {0, 0,1,0}, {1, 0,0,0},
+        {0, 0,0,1}, {1, 1,0,1}, {0, 0,1,1}, {1, 0,0,1},
+        {2, 0,0,0}, {2, 1,0,0}, {2, 1,1,0}, {2, 0,1,0}
+	};
+
 	static const int edge_tab[256] = {
 
 	0x0  , 0x109, 0x203, 0x30a, 0x406, 0x50f, 0x605, 0x70c,
@@ -11,6 +11,15 @@
 #include <math.h>
 #include <time.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PERLINNOISE_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(PERLINNOISE_SSE2) && defined(__AVX2__)
+#define PERLINNOISE_AVX2
+#include <immintrin.h>
+#endif
+
 namespace {
 #ifdef PERLINNOISE_USE_ICQ_FRAND
 	// nice direct float RNG from Inigo Quilez
@@ -40,6 +49,254 @@ namespace {
 		myrandnext = seed;
 	}
 #endif
+
+	// deterministic RNG with explicit state for PerlinNoiseGenerator,
+	// returns values in [0,32767] as myrand()
+	int lcg_rand( unsigned& state )
+	{
+		state = state * 1103515245 + 12345;
+		return (int)((state/65536) % 32768);
+	}
+
+	// random float in [-1,1]
+	float lcg_frand( unsigned& state )
+	{
+		return (float)lcg_rand( state ) / 16383.5f - 1.f;
+	}
+
+	// scalar helpers of PerlinNoiseGenerator, same as in PerlinNoise
+	inline float ease( float t )                   { return t * t * (3.f - 2.f * t); }
+	inline float lerp( float t, float a, float b ) { return a + t * (b - a); }
+	inline float dot3( float rx, float ry, float rz, const float* q )
+	{
+		return rx * q[0] + ry * q[1] + rz * q[2];
+	}
+
+#ifdef PERLINNOISE_SSE2
+	/// Lookup tables and constants for the vectorized noise kernel
+	struct NoiseTables
+	{
+		const unsigned* perm;
+		const float*    grad3;
+		float           large;
+	};
+
+	/// Tables of PerlinNoiseGenerator with 16 bit permutation and gradients
+	/// padded to 4 floats
+	struct PackedNoiseTables
+	{
+		const unsigned short* perm;
+		const float*          grad4;
+		float                 large;
+	};
+
+	/// SSE2 operations on 4 lanes, gathers are done element-wise
+	struct SSE2Lanes
+	{
+		typedef __m128  F;
+		typedef __m128i I;
+
+		static F    load ( const float* p )  { return _mm_loadu_ps( p ); }
+		static void store( float* p, F v )   { _mm_storeu_ps( p, v ); }
+		static F    set1 ( float f )         { return _mm_set1_ps( f ); }
+		static I    set1i( int i )           { return _mm_set1_epi32( i ); }
+		static F    add  ( F a, F b )        { return _mm_add_ps( a, b ); }
+		static F    sub  ( F a, F b )        { return _mm_sub_ps( a, b ); }
+		static F    mul  ( F a, F b )        { return _mm_mul_ps( a, b ); }
+		static I    addi ( I a, I b )        { return _mm_add_epi32( a, b ); }
+		static I    andi ( I a, I b )        { return _mm_and_si128( a, b ); }
+		static I    trunc( F a )             { return _mm_cvttps_epi32( a ); }
+		static F    tofloat( I a )           { return _mm_cvtepi32_ps( a ); }
+
+		static I gather( const unsigned* table, I idx )
+		{
+			int i[4];
+			_mm_storeu_si128( (__m128i*)i, idx );
+			return _mm_set_epi32( table[i[3]], table[i[2]], table[i[1]], table[i[0]] );
+		}
+
+		static I gather( const unsigned short* table, I idx )
+		{
+			int i[4];
+			_mm_storeu_si128( (__m128i*)i, idx );
+			return _mm_set_epi32( table[i[3]], table[i[2]], table[i[1]], table[i[0]] );
+		}
+
+		static void gather3( const float* table, I idx, F& q0, F& q1, F& q2 )
+		{
+			int i[4];
+			_mm_storeu_si128( (__m128i*)i, idx );
+			const float *a = table + 3*i[0], *b = table + 3*i[1],
+			            *c = table + 3*i[2], *d = table + 3*i[3];
+			q0 = _mm_set_ps( d[0], c[0], b[0], a[0] );
+			q1 = _mm_set_ps( d[1], c[1], b[1], a[1] );
+			q2 = _mm_set_ps( d[2], c[2], b[2], a[2] );
+		}
+
+		// one load per lane, unaligned since heap allocated generators need
+		// not honour the table alignment before C++17
+		static void gather4( const float* table, I idx, F& q0, F& q1, F& q2 )
+		{
+			int i[4];
+			_mm_storeu_si128( (__m128i*)i, idx );
+			F a = _mm_loadu_ps( table + 4*i[0] ), b = _mm_loadu_ps( table + 4*i[1] ),
+			  c = _mm_loadu_ps( table + 4*i[2] ), d = _mm_loadu_ps( table + 4*i[3] );
+			_MM_TRANSPOSE4_PS( a, b, c, d );
+			q0 = a; q1 = b; q2 = c;
+		}
+	};
+
+  #ifdef PERLINNOISE_AVX2
+	/// AVX2 operations on 8 lanes with hardware gathers
+	struct AVX2Lanes
+	{
+		typedef __m256  F;
+		typedef __m256i I;
+
+		static F    load ( const float* p )  { return _mm256_loadu_ps( p ); }
+		static void store( float* p, F v )   { _mm256_storeu_ps( p, v ); }
+		static F    set1 ( float f )         { return _mm256_set1_ps( f ); }
+		static I    set1i( int i )           { return _mm256_set1_epi32( i ); }
+		static F    add  ( F a, F b )        { return _mm256_add_ps( a, b ); }
+		static F    sub  ( F a, F b )        { return _mm256_sub_ps( a, b ); }
+		static F    mul  ( F a, F b )        { return _mm256_mul_ps( a, b ); }
+		static I    addi ( I a, I b )        { return _mm256_add_epi32( a, b ); }
+		static I    andi ( I a, I b )        { return _mm256_and_si256( a, b ); }
+		static I    trunc( F a )             { return _mm256_cvttps_epi32( a ); }
+		static F    tofloat( I a )           { return _mm256_cvtepi32_ps( a ); }
+
+		static I gather( const unsigned* table, I idx )
+		{
+			return _mm256_i32gather_epi32( (const int*)table, idx, 4 );
+		}
+
+		// reads 32 bit at 16 bit offsets, table needs one entry padding
+		static I gather( const unsigned short* table, I idx )
+		{
+			return _mm256_and_si256( _mm256_set1_epi32( 0xffff ),
+				_mm256_i32gather_epi32( (const int*)table, idx, 2 ) );
+		}
+
+		static void gather3( const float* table, I idx, F& q0, F& q1, F& q2 )
+		{
+			I idx3 = _mm256_add_epi32( _mm256_add_epi32( idx, idx ), idx );
+			q0 = _mm256_i32gather_ps( table,     idx3, 4 );
+			q1 = _mm256_i32gather_ps( table + 1, idx3, 4 );
+			q2 = _mm256_i32gather_ps( table + 2, idx3, 4 );
+		}
+
+		static void gather4( const float* table, I idx, F& q0, F& q1, F& q2 )
+		{
+			I idx4 = _mm256_slli_epi32( idx, 2 );
+			q0 = _mm256_i32gather_ps( table,     idx4, 4 );
+			q1 = _mm256_i32gather_ps( table + 1, idx4, 4 );
+			q2 = _mm256_i32gather_ps( table + 2, idx4, 4 );
+		}
+	};
+  #endif
+
+	// Vector versions of the inline helpers in PerlinNoise, the order of
+	// operations matches exactly to produce bit-identical results.
+
+	template<class L>
+	inline typename L::F ease_curve( typename L::F t )
+	{
+		return L::mul( L::mul( t, t ), L::sub( L::set1( 3.f ), L::mul( L::set1( 2.f ), t ) ) );
+	}
+
+	template<class L>
+	inline typename L::F linear_interp( typename L::F t, typename L::F a, typename L::F b )
+	{
+		return L::add( a, L::mul( t, L::sub( b, a ) ) );
+	}
+
+	template<class L>
+	inline typename L::F dot3( typename L::F rx, typename L::F ry, typename L::F rz,
+	                           typename L::F q0, typename L::F q1, typename L::F q2 )
+	{
+		return L::add( L::add( L::mul( rx, q0 ), L::mul( ry, q1 ) ), L::mul( rz, q2 ) );
+	}
+
+	// Table lookups for both table layouts
+
+	template<class L>
+	inline void gather_grad( const NoiseTables& tab, typename L::I idx,
+	                         typename L::F& q0, typename L::F& q1, typename L::F& q2 )
+	{
+		L::gather3( tab.grad3, idx, q0, q1, q2 );
+	}
+
+	template<class L>
+	inline void gather_grad( const PackedNoiseTables& tab, typename L::I idx,
+	                         typename L::F& q0, typename L::F& q1, typename L::F& q2 )
+	{
+		L::gather4( tab.grad4, idx, q0, q1, q2 );
+	}
+
+	template<class L, class T>
+	inline void setup_values( const float* p, const T& tab,
+	                          typename L::I& g0, typename L::I& g1,
+	                          typename L::F& d0, typename L::F& d1 )
+	{
+		typename L::F t = L::add( L::load( p ), L::set1( tab.large ) );
+		typename L::I i = L::trunc( t );
+		g0 = L::andi( i, L::set1i( 255 ) );
+		g1 = L::andi( L::addi( g0, L::set1i( 1 ) ), L::set1i( 255 ) );
+		d0 = L::sub( t, L::tofloat( i ) );
+		d1 = L::sub( d0, L::set1( 1.f ) );
+	}
+
+	/// PerlinNoise::noise3d() for one lane width of points
+	template<class L, class T>
+	void noise3d_lanes( const T& tab, const float* px, const float* py,
+	                    const float* pz, float* result )
+	{
+		typedef typename L::F F;
+		typedef typename L::I I;
+
+		I grid_point_l, grid_point_r, grid_point_d, grid_point_u, grid_point_b, grid_point_f;
+		F dist_from_l, dist_from_r, dist_from_d, dist_from_u, dist_from_b, dist_from_f;
+		setup_values<L>( px, tab, grid_point_l, grid_point_r, dist_from_l, dist_from_r );
+		setup_values<L>( py, tab, grid_point_d, grid_point_u, dist_from_d, dist_from_u );
+		setup_values<L>( pz, tab, grid_point_b, grid_point_f, dist_from_b, dist_from_f );
+
+		I indexL = L::gather( tab.perm, grid_point_l ),
+		  indexR = L::gather( tab.perm, grid_point_r );
+
+		I indexLD = L::gather( tab.perm, L::addi( indexL, grid_point_d ) ),
+		  indexRD = L::gather( tab.perm, L::addi( indexR, grid_point_d ) ),
+		  indexLU = L::gather( tab.perm, L::addi( indexL, grid_point_u ) ),
+		  indexRU = L::gather( tab.perm, L::addi( indexR, grid_point_u ) );
+
+		F sX = ease_curve<L>( dist_from_l ),
+		  sY = ease_curve<L>( dist_from_d ),
+		  sZ = ease_curve<L>( dist_from_b );
+
+		F q0, q1, q2, u, v, a, b, c, d;
+
+		gather_grad<L>( tab, L::addi( indexLD, grid_point_b ), q0, q1, q2 ); u = dot3<L>( dist_from_l, dist_from_d, dist_from_b, q0, q1, q2 );
+		gather_grad<L>( tab, L::addi( indexRD, grid_point_b ), q0, q1, q2 ); v = dot3<L>( dist_from_r, dist_from_d, dist_from_b, q0, q1, q2 );
+		a = linear_interp<L>( sX, u, v );
+
+		gather_grad<L>( tab, L::addi( indexLU, grid_point_b ), q0, q1, q2 ); u = dot3<L>( dist_from_l, dist_from_u, dist_from_b, q0, q1, q2 );
+		gather_grad<L>( tab, L::addi( indexRU, grid_point_b ), q0, q1, q2 ); v = dot3<L>( dist_from_r, dist_from_u, dist_from_b, q0, q1, q2 );
+		b = linear_interp<L>( sX, u, v );
+
+		c = linear_interp<L>( sY, a, b );
+
+		gather_grad<L>( tab, L::addi( indexLD, grid_point_f ), q0, q1, q2 ); u = dot3<L>( dist_from_l, dist_from_d, dist_from_f, q0, q1, q2 );
+		gather_grad<L>( tab, L::addi( indexRD, grid_point_f ), q0, q1, q2 ); v = dot3<L>( dist_from_r, dist_from_d, dist_from_f, q0, q1, q2 );
+		a = linear_interp<L>( sX, u, v );
+
+		gather_grad<L>( tab, L::addi( indexLU, grid_point_f ), q0, q1, q2 ); u = dot3<L>( dist_from_l, dist_from_u, dist_from_f, q0, q1, q2 );
+		gather_grad<L>( tab, L::addi( indexRU, grid_point_f ), q0, q1, q2 ); v = dot3<L>( dist_from_r, dist_from_u, dist_from_f, q0, q1, q2 );
+		b = linear_interp<L>( sX, u, v );
+
+		d = linear_interp<L>( sY, a, b );
+
+		L::store( result, linear_interp<L>( sZ, c, d ) );
+	}
+#endif // PERLINNOISE_SSE2
 } // anonymous namespace
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -240,6 +497,31 @@ float PerlinNoise::noise( float p1, float p2, float p3 )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+void PerlinNoise::noise3d_batch( const float* x, const float* y, const float* z,
+                                 float* result, int n )
+{
+	if (! initialized) { reseed(); }
+
+	int i=0;
+#ifdef PERLINNOISE_SSE2
+	NoiseTables tab = { permutation_table, &gradient_table3d[0][0], (float)LARGE_PWR2 };
+  #ifdef PERLINNOISE_AVX2
+	for( ; i+8 <= n; i+=8 )
+		noise3d_lanes<AVX2Lanes>( tab, x+i, y+i, z+i, result+i );
+  #endif
+	for( ; i+4 <= n; i+=4 )
+		noise3d_lanes<SSE2Lanes>( tab, x+i, y+i, z+i, result+i );
+#endif
+	// Remaining points
+	for( ; i < n; i++ )
+	{
+		float p[3] = { x[i], y[i], z[i] };
+		result[i] = noise3d( p );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 void PerlinNoise::reseed()
 {
 #ifdef PERLINNOISE_USE_ICQ_FRAND
@@ -314,3 +596,124 @@ void PerlinNoise::gen_luts()
 
 	initialized = true;
 }
+
+////////////////////////////////////////////////////////////////////////////////
+// PerlinNoiseGenerator
+
+PerlinNoiseGenerator::PerlinNoiseGenerator( unsigned seed_ )
+	: seed( seed_ )
+{
+	unsigned state = seed;
+	int i,j;
+
+	for( i=0; i < WRAP_INDEX; i++ )
+	{
+		permutation[i] = (unsigned short)i;
+
+		// random unit length gradient (rejecting degenerate ones)
+		float* g = gradients[i];
+		float len;
+		do {
+			for( j=0; j < 3; j++ )
+				g[j] = lcg_frand( state );
+			len = (float) sqrt( g[0]*g[0] + g[1]*g[1] + g[2]*g[2] );
+		} while( len < 1e-3f );
+
+		for( j=0; j < 3; j++ )
+			g[j] /= len;
+		g[3] = 0.f;
+	}
+
+	// shuffle permutation table
+	for( i=0; i < WRAP_INDEX; i++ )
+	{
+		j = lcg_rand( state ) & MOD_MASK;
+		unsigned short tmp = permutation[i];
+		permutation[i] = permutation[j];
+		permutation[j] = tmp;
+	}
+
+	// duplicate entries as in PerlinNoise::gen_luts()
+	for( i=0; i < WRAP_INDEX+2; i++ )
+	{
+		permutation[ WRAP_INDEX + i ] = permutation[i];
+		for( j=0; j < 4; j++ )
+			gradients[ WRAP_INDEX + i ][j] = gradients[i][j];
+	}
+	permutation[ TABLE_SIZE ] = permutation[ TABLE_SIZE+1 ] = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+float PerlinNoiseGenerator::noise( float x, float y, float z ) const
+{
+	// Same operations as PerlinNoise::noise3d() to produce identical results
+	// for identical tables
+	float pos[3] = { x, y, z };
+	int   g0[3], g1[3];
+	float d0[3], d1[3];
+	for( int k=0; k < 3; k++ )
+	{
+		float t = pos[k] + LARGE_PWR2;
+		g0[k] = ((int)t) & MOD_MASK;
+		g1[k] = (g0[k] + 1) & MOD_MASK;
+		d0[k] = t - (int)t;
+		d1[k] = d0[k] - 1.f;
+	}
+
+	int indexL = permutation[ g0[0] ],
+	    indexR = permutation[ g1[0] ];
+
+	int indexLD = permutation[ indexL + g0[1] ],
+	    indexRD = permutation[ indexR + g0[1] ],
+	    indexLU = permutation[ indexL + g1[1] ],
+	    indexRU = permutation[ indexR + g1[1] ];
+
+	float sX = ease( d0[0] ),
+	      sY = ease( d0[1] ),
+	      sZ = ease( d0[2] );
+
+	float u, v, a, b, c, d;
+
+	u = dot3( d0[0], d0[1], d0[2], gradients[indexLD+g0[2]] );
+	v = dot3( d1[0], d0[1], d0[2], gradients[indexRD+g0[2]] );
+	a = lerp( sX, u, v );
+
+	u = dot3( d0[0], d1[1], d0[2], gradients[indexLU+g0[2]] );
+	v = dot3( d1[0], d1[1], d0[2], gradients[indexRU+g0[2]] );
+	b = lerp( sX, u, v );
+
+	c = lerp( sY, a, b );
+
+	u = dot3( d0[0], d0[1], d1[2], gradients[indexLD+g1[2]] );
+	v = dot3( d1[0], d0[1], d1[2], gradients[indexRD+g1[2]] );
+	a = lerp( sX, u, v );
+
+	u = dot3( d0[0], d1[1], d1[2], gradients[indexLU+g1[2]] );
+	v = dot3( d1[0], d1[1], d1[2], gradients[indexRU+g1[2]] );
+	b = lerp( sX, u, v );
+
+	d = lerp( sY, a, b );
+
+	return lerp( sZ, c, d );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void PerlinNoiseGenerator::noise_batch( const float* x, const float* y, const float* z,
+                                        float* result, int n ) const
+{
+	int i=0;
+#ifdef PERLINNOISE_SSE2
+	PackedNoiseTables tab = { permutation, &gradients[0][0], (float)LARGE_PWR2 };
+  #ifdef PERLINNOISE_AVX2
+	for( ; i+8 <= n; i+=8 )
+		noise3d_lanes<AVX2Lanes>( tab, x+i, y+i, z+i, result+i );
+  #endif
+	for( ; i+4 <= n; i+=4 )
+		noise3d_lanes<SSE2Lanes>( tab, x+i, y+i, z+i, result+i );
+#endif
+	// Remaining points
+	for( ; i < n; i++ )
+		result[i] = noise( x[i], y[i], z[i] );
+}
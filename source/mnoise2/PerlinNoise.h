@@ -12,6 +12,12 @@
 
 #define PERLINNOISE_USE_ICQ_FRAND
 
+#ifdef _MSC_VER
+	#define PERLINNOISE_ALIGN(n) __declspec(align(n))
+#else
+	#define PERLINNOISE_ALIGN(n) __attribute__((aligned(n)))
+#endif
+
 /**
   Perlin noise
 
@@ -31,6 +37,15 @@ public:
 	static float noise( float p1, float p2 );
 	static float noise( float p1, float p2,float p3 );
 
+	/// Evaluate 3d noise for n points given as separate coordinate arrays.
+	/// Results are bit-identical to noise3d(), but lanes of 4 (SSE2) or 8 (AVX2,
+	/// CMake option MNOISE2_USE_AVX2) points are processed at once if enabled
+	/// at compile time. Compiling with -mfma breaks bit-identity since the
+	/// compiler then fuses multiply-adds of noise3d(). Only reads the lookup
+	/// tables and is therefore safe to call from several threads.
+	static void noise3d_batch( const float* x, const float* y, const float* z,
+	                           float* result, int n );
+
 	static int get_seed() { return cur_seed; };
 
 private:
@@ -84,4 +99,38 @@ private:
 	};
 };
 
+/**
+  Seeded 3d Perlin noise generator
+
+  In contrast to the static PerlinNoise interface a generator owns its lookup
+  tables. These are generated from the seed given on construction and never
+  change afterwards, such that a generator can be evaluated by several threads
+  at once and differently seeded generators can be used side by side. The
+  tables are compact (16 bit permutation, gradients packed into 4 floats) and
+  aligned to cache lines.
+ */
+class PerlinNoiseGenerator
+{
+public:
+	explicit PerlinNoiseGenerator( unsigned seed );
+
+	unsigned get_seed() const { return seed; };
+
+	float noise( float x, float y, float z ) const;
+
+	/// Evaluate noise() for n points given as separate coordinate arrays,
+	/// vectorized as PerlinNoise::noise3d_batch() and bit-identical to noise().
+	void  noise_batch( const float* x, const float* y, const float* z,
+	                   float* result, int n ) const;
+
+private:
+	enum{ WRAP_INDEX=256, MOD_MASK=255, LARGE_PWR2=4096, TABLE_SIZE=WRAP_INDEX*2+2 };
+
+	// Gradient xyz and zero padding, permutation is padded by two entries
+	// for 32 bit gathers
+	PERLINNOISE_ALIGN(64) float          gradients  [ TABLE_SIZE ][4];
+	PERLINNOISE_ALIGN(64) unsigned short permutation[ TABLE_SIZE + 2 ];
+	unsigned seed;
+};
+
 #endif
@@ -5,7 +5,14 @@
 #include <sstream>
 #include <ctime>
 #include <cstring>
+#include <cstdio>
+#include <cctype>
+#include <vector>
+#include <algorithm>
 #include <exception>
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
 
 #include "GL/GLError.h"
 
@@ -142,6 +149,7 @@ void saveTGA( std::string filename )
 //______________________________________________________________________________
 #ifdef SCREENSHOT_SUPPORT_PNG
 #include <png.h>
+#include <zlib.h> // compression constants, not included by libpng >= 1.5
 //#include <csetjmp>
 
 // based on code from http://zarb.org/~gc/html/libpng.html 
@@ -305,6 +313,429 @@ histogram, before the call to png_destroy_write_struct();
 
 #endif
 
+//______________________________________________________________________________
+// Tiled rendering
+
+/// Image file written row by row from top to bottom (RGB, 8 bit per channel)
+class RowWriter
+{
+public:
+	virtual ~RowWriter() {}
+	virtual bool open( std::string filename, int width, int height ) = 0;
+	virtual bool write_row( const unsigned char* rgb ) = 0;
+	/// Complete and close file
+	virtual bool finish() = 0;
+};
+
+/// Uncompressed TGA with top-left origin
+class TGARowWriter : public RowWriter
+{
+public:
+	TGARowWriter(): fp(NULL) {}
+	~TGARowWriter() { if( fp ) fclose( fp ); }
+
+	bool open( std::string filename, int width, int height )
+	{
+		if( width > 0xFFFF || height > 0xFFFF )
+		{
+			cerr << "[Screenshot::saveTiled] Image too large for TGA!" << endl;
+			return false;
+		}
+		fp = fopen( filename.c_str(), "wb" );
+		if( !fp )
+		{
+			cerr << "Error: Unable to open " << filename << endl;
+			return false;
+		}
+		row.resize( width*3 );
+
+		TGA_HEADER header = { 0,0,2, {0,0,0,0,0}, 
+			{0,0},{0,0},
+			{width%256,width/256},
+			{height%256,height/256},
+			24,0x20 }; // bit 5 of descriptor: rows stored from top to bottom
+		return fwrite( &header, sizeof(TGA_HEADER), 1, fp ) == 1;
+	}
+
+	bool write_row( const unsigned char* rgb )
+	{
+		// TGA stores BGR
+		for( size_t i=0; i < row.size(); i+=3 )
+		{
+			row[i  ] = rgb[i+2];
+			row[i+1] = rgb[i+1];
+			row[i+2] = rgb[i  ];
+		}
+		return fwrite( &row[0], 1, row.size(), fp ) == row.size();
+	}
+
+	bool finish()
+	{
+		bool ok = fclose( fp ) == 0;
+		fp = NULL;
+		return ok;
+	}
+
+private:
+	FILE* fp;
+	std::vector<unsigned char> row;
+};
+
+/// Uncompressed baseline TIFF (little endian) with a single strip. The image
+/// file directory is put in front of the pixel data such that all offsets
+/// are known in advance and rows can be appended sequentially.
+class TIFFRowWriter : public RowWriter
+{
+public:
+	TIFFRowWriter(): fp(NULL), rowsize(0) {}
+	~TIFFRowWriter() { if( fp ) fclose( fp ); }
+
+	bool open( std::string filename, int width, int height )
+	{
+		// Header, IFD with 12 entries, BitsPerSample and resolution values
+		const unsigned ifd_offset  = 8,
+		               num_entries = 12,
+		               bps_offset  = ifd_offset + 2 + num_entries*12 + 4,
+		               xres_offset = bps_offset + 6,
+		               yres_offset = xres_offset + 8,
+		               data_offset = yres_offset + 8;
+
+		rowsize = (size_t)width * 3;
+		double datasize = (double)rowsize * height;
+		if( datasize + data_offset > 4294967295. )
+		{
+			cerr << "[Screenshot::saveTiled] Image too large for TIFF!" << endl;
+			return false;
+		}
+
+		fp = fopen( filename.c_str(), "wb" );
+		if( !fp )
+		{
+			cerr << "Error: Unable to open " << filename << endl;
+			return false;
+		}
+
+		std::vector<unsigned char> head;
+		head.push_back( 'I' ); head.push_back( 'I' );
+		put16( head, 42 );
+		put32( head, ifd_offset );
+
+		put16( head, num_entries );
+		entry( head, 256, 4, 1, width );              // ImageWidth
+		entry( head, 257, 4, 1, height );             // ImageLength
+		entry( head, 258, 3, 3, bps_offset );         // BitsPerSample
+		entry( head, 259, 3, 1, 1 );                  // Compression: none
+		entry( head, 262, 3, 1, 2 );                  // Photometric: RGB
+		entry( head, 273, 4, 1, data_offset );        // StripOffsets
+		entry( head, 277, 3, 1, 3 );                  // SamplesPerPixel
+		entry( head, 278, 4, 1, height );             // RowsPerStrip
+		entry( head, 279, 4, 1, (unsigned)datasize ); // StripByteCounts
+		entry( head, 282, 5, 1, xres_offset );        // XResolution
+		entry( head, 283, 5, 1, yres_offset );        // YResolution
+		entry( head, 296, 3, 1, 2 );                  // ResolutionUnit: inch
+		put32( head, 0 ); // no further IFD
+
+		put16( head, 8 ); put16( head, 8 ); put16( head, 8 );
+		put32( head, 72 ); put32( head, 1 );
+		put32( head, 72 ); put32( head, 1 );
+
+		return fwrite( &head[0], 1, head.size(), fp ) == head.size();
+	}
+
+	bool write_row( const unsigned char* rgb )
+	{
+		return fwrite( rgb, 1, rowsize, fp ) == rowsize;
+	}
+
+	bool finish()
+	{
+		bool ok = fclose( fp ) == 0;
+		fp = NULL;
+		return ok;
+	}
+
+private:
+	static void put16( std::vector<unsigned char>& buf, unsigned v )
+	{
+		buf.push_back( v & 0xFF );
+		buf.push_back( (v >> 8) & 0xFF );
+	}
+	static void put32( std::vector<unsigned char>& buf, unsigned v )
+	{
+		put16( buf, v & 0xFFFF );
+		put16( buf, v >> 16 );
+	}
+	/// IFD entry, values of type SHORT are left-justified in the value field
+	static void entry( std::vector<unsigned char>& buf, unsigned tag, 
+	                   unsigned type, unsigned count, unsigned value )
+	{
+		put16( buf, tag );
+		put16( buf, type );
+		put32( buf, count );
+		put32( buf, value );
+	}
+
+	FILE*  fp;
+	size_t rowsize;
+};
+
+#ifdef SCREENSHOT_SUPPORT_PNG
+/// PNG written via png_write_row(), see also savePNG()
+class PNGRowWriter : public RowWriter
+{
+public:
+	PNGRowWriter(): fp(NULL), png_ptr(NULL), info_ptr(NULL) {}
+	~PNGRowWriter()
+	{
+		if( png_ptr ) png_destroy_write_struct( &png_ptr, info_ptr ? &info_ptr : NULL );
+		if( fp ) fclose( fp );
+	}
+
+	bool open( std::string filename, int width, int height )
+	{
+		fp = fopen( filename.c_str(), "wb" );
+		if( !fp )
+		{
+			cerr << "[Screenshot::saveTiled] File " << filename 
+				 << " could not be opened for writing" << endl;
+			return false;
+		}
+
+		png_ptr = png_create_write_struct( PNG_LIBPNG_VER_STRING, NULL, NULL, NULL );
+		if( !png_ptr )
+		{
+			cerr << "[Screenshot::saveTiled] png_create_write_struct failed" << endl;
+			return false;
+		}
+		info_ptr = png_create_info_struct( png_ptr );
+		if( !info_ptr )
+		{
+			cerr << "[Screenshot::saveTiled] png_create_info_struct failed" << endl;
+			return false;
+		}
+
+		if( setjmp(png_jmpbuf(png_ptr)) )
+		{
+			cerr << "[Screenshot::saveTiled] Error during writing header" << endl;
+			return false;
+		}
+		png_init_io( png_ptr, fp );
+
+		// Default instead of best compression, for poster sized images the
+		// latter takes considerably longer than rendering.
+		png_set_compression_level( png_ptr, Z_DEFAULT_COMPRESSION );
+
+		png_set_IHDR( png_ptr, info_ptr, 
+				width, height,
+				8, 
+				PNG_COLOR_TYPE_RGB, 
+				PNG_INTERLACE_NONE, 
+				PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT );
+		png_write_info( png_ptr, info_ptr );
+		return true;
+	}
+
+	bool write_row( const unsigned char* rgb )
+	{
+		if( setjmp(png_jmpbuf(png_ptr)) )
+		{
+			cerr << "[Screenshot::saveTiled] Error during writing bytes" << endl;
+			return false;
+		}
+		png_write_row( png_ptr, (png_bytep)rgb );
+		return true;
+	}
+
+	bool finish()
+	{
+		if( setjmp(png_jmpbuf(png_ptr)) )
+		{
+			cerr << "[Screenshot::saveTiled] Error during end of write" << endl;
+			return false;
+		}
+		png_write_end( png_ptr, NULL );
+
+		bool ok = fclose( fp ) == 0;
+		fp = NULL;
+		return ok;
+	}
+
+private:
+	FILE*       fp;
+	png_structp png_ptr;
+	png_infop   info_ptr;
+};
+#endif
+
+/// Open writer according to file extension, returns NULL on error
+RowWriter* createRowWriter( std::string filename, int width, int height )
+{
+	std::string ext;
+	size_t dot = filename.find_last_of( '.' );
+	if( dot != std::string::npos )
+		ext = filename.substr( dot+1 );
+	std::transform( ext.begin(), ext.end(), ext.begin(), ::tolower );
+
+	RowWriter* writer = NULL;
+	if( ext == "tga" )
+		writer = new TGARowWriter;
+	else
+	if( ext == "tif" || ext == "tiff" )
+		writer = new TIFFRowWriter;
+  #ifdef SCREENSHOT_SUPPORT_PNG
+	else
+	if( ext == "png" )
+		writer = new PNGRowWriter;
+  #endif
+	else
+	{
+		cerr << "[Screenshot::saveTiled] Unsupported image format \"" << ext
+		     << "\"!" << endl;
+		return NULL;
+	}
+
+	if( !writer->open( filename, width, height ) )
+	{
+		delete writer;
+		return NULL;
+	}
+	return writer;
+}
+
+/// Write band of given number of rows, stored from bottom to top
+bool writeBand( RowWriter* writer, const unsigned char* band, int width, int rows )
+{
+	for( int y=rows-1; y >= 0; --y )
+		if( !writer->write_row( band + (size_t)y*width*3 ) )
+			return false;
+	return true;
+}
+
+bool saveTiled( std::string filename, int width, int height, 
+                int tile_width, int tile_height,
+                RenderTileFunc render_tile, void* user )
+{
+	if( width <= 0 || height <= 0 || tile_width <= 0 || tile_height <= 0 )
+	{
+		cerr << "[Screenshot::saveTiled] Invalid image or tile size!" << endl;
+		return false;
+	}
+	tile_width  = std::min( tile_width,  width  );
+	tile_height = std::min( tile_height, height );
+
+	RowWriter* writer = createRowWriter( filename, width, height );
+	if( !writer )
+		return false;
+
+	// Two bands of full image width, rows from bottom to top as read back
+	size_t band_size = (size_t)width * tile_height * 3;
+	std::vector<unsigned char> bands[2];
+	try
+	{
+		bands[0].resize( band_size );
+		bands[1].resize( band_size );
+	}
+	catch( bad_alloc& )
+	{
+		cerr << "Error: Couldn't allocate band buffers of size " << band_size << "!" << endl;
+		delete writer;
+		return false;
+	}
+
+	int num_bands = (height + tile_height - 1) / tile_height;
+	volatile int full[2] = { 0, 0 }; // band buffer holds a rendered band
+	volatile int failed = 0;         // writing failed, stop rendering
+
+	GLint row_length, alignment;
+	glGetIntegerv( GL_PACK_ROW_LENGTH, &row_length );
+	glGetIntegerv( GL_PACK_ALIGNMENT,  &alignment );
+
+	// The calling thread (owning the GL context) renders, a second thread
+	// (if available) writes the bands.
+	#pragma omp parallel num_threads(2)
+	{
+	  #ifdef USE_OPENMP
+		int thread  = omp_get_thread_num(),
+		    threads = omp_get_num_threads();
+	  #else
+		int thread = 0, threads = 1;
+	  #endif
+		if( thread == 0 )
+		{
+			for( int b=0; b < num_bands && !failed; ++b )
+			{
+				// wait until band buffer is written
+				int s = b % 2;
+				while( full[s] && !failed )
+				{
+					#pragma omp flush
+				}
+				if( failed )
+					break;
+
+				// b-th band from top covering rows y..y+h-1 from bottom
+				int h = std::min( tile_height, height - b*tile_height ),
+				    y = height - b*tile_height - h;
+				for( int x=0; x < width; x+=tile_width )
+				{
+					int w = std::min( tile_width, width - x );
+					render_tile( x, y, w, h, user );
+
+					// read tile directly into its place in the band
+					glPixelStorei( GL_PACK_ROW_LENGTH, width );
+					glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+					glReadPixels( 0,0, w,h, GL_RGB, GL_UNSIGNED_BYTE, 
+					              &bands[s][(size_t)x*3] );
+				}
+
+				if( threads > 1 )
+				{
+					#pragma omp flush
+					full[s] = 1;
+					#pragma omp flush
+				}
+				else
+				if( !writeBand( writer, &bands[s][0], width, h ) )
+					failed = 1;
+			}
+		}
+		else
+		if( thread == 1 )
+		{
+			for( int b=0; b < num_bands; ++b )
+			{
+				// wait until band is rendered
+				int s = b % 2;
+				while( !full[s] && !failed )
+				{
+					#pragma omp flush
+				}
+				if( failed )
+					break;
+
+				int h = std::min( tile_height, height - b*tile_height );
+				if( !writeBand( writer, &bands[s][0], width, h ) )
+					failed = 1;
+				else
+					full[s] = 0;
+				#pragma omp flush
+				if( failed )
+					break;
+			}
+		}
+	}
+
+	glPixelStorei( GL_PACK_ROW_LENGTH, row_length );
+	glPixelStorei( GL_PACK_ALIGNMENT,  alignment );
+	GL::checkGLError( "Screenshot::saveTiled()" );
+
+	bool ok = !failed && writer->finish();
+	delete writer;
+	if( !ok )
+		cerr << "[Screenshot::saveTiled] Writing " << filename << " failed!" << endl;
+	return ok;
+}
+
 //______________________________________________________________________________
 #ifdef SCREENSHOT_SUPPORT_SDL
 #include <SDL/SDL.h>
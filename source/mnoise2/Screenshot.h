@@ -18,6 +18,22 @@ namespace Screenshot
 	#ifdef SCREENSHOT_SUPPORT_SDL
 	void saveBMP( std::string filename );
 	#endif
+
+	/// Callback rendering tile (x,y,w,h) of the image into the current render
+	/// target at (0,0,w,h), where y is measured from the bottom of the image.
+	typedef void (*RenderTileFunc)( int x, int y, int w, int h, void* user );
+
+	/**
+	  Render image of arbitrary size tile by tile and write it to file, the
+	  format is given by the extension (.png if supported, .tif/.tiff, .tga).
+	  The tiles of one row of tiles (band) are read back into a band buffer
+	  which is then written row by row, such that at most two bands are held
+	  in memory. With OpenMP the file is encoded on a second thread while the
+	  next band is rendered, otherwise both alternate.
+	*/
+	bool saveTiled( std::string filename, int width, int height, 
+	                int tile_width, int tile_height,
+	                RenderTileFunc render_tile, void* user=NULL );
 }
 
 #endif
@@ -31,7 +31,7 @@ void read_parammap( std::istream& is, std::map<std::string,std::string>& params
 		if( splitter != string::npos )
 		{
 			// split on equality sign
-			string param = line.substr(0,splitter-1),
+			string param = line.substr(0,splitter),
 				   value = line.substr(splitter+1);
 
 			// remove white spaces from parameter
@@ -1,6 +1,12 @@
 #ifndef SIMPLEPARAMMAP_H
 #define SIMPLEPARAMMAP_H
 
+#include <string>
+#include <map>
+#include <vector>
+#include <sstream>
+#include <iostream>
+
 namespace SimpleParammap {
 
 void strip_whitespaces( std::string& s );
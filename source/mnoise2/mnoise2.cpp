@@ -7,10 +7,11 @@
 // - dump/load state (allows to collect several states interactively in lores
 //                    and perform highres offscreen rendering subsequently)
 // - some sort of bookmark
-// - export mesh functionality (allow further processing e.g. in Meshlab)
 // - modify light direction
 //
 // RECENTLY DONE:
+// - export mesh functionality (allow further processing e.g. in Meshlab)
+//   => OBJ export of extracted isosurface, see export_mesh()
 // - started WiiMote support :-)
 // - screenshot button
 //   => TGA/PNG export, see Screenshot.cpp
@@ -58,6 +59,8 @@
 #include <iostream>
 #include <iomanip>
 #include <cstdlib>        // atexit(), aoi(), atof()
+#include <climits>        // INT_MAX
+#include <algorithm>      // min()
 #include <ctime>          // time(), clock()
 #include <cassert>
 #include <vector>
@@ -84,6 +87,7 @@ float	clear[3];
 float   fgcol[4];
 float 	scale=1;
 float   cellscale=1.f;
+float   lod=0.f;
 
 int   linesmooth=1;
 float linewidth=1.f;
@@ -94,6 +98,7 @@ int shaded=1;
 int update=1;
 int update_once=0;
 int do_normals=1;
+int scrolling=0;
 int color_material=1;
 
 int dbg_show_octree=0;
@@ -102,9 +107,6 @@ int dbg_draw_all=0;
 float persistance;
 int octaves;
 
-// display list for cube
-int dl_cube=0;
-
 int 	glut_main_window;
 int		wireframe = 0;
 int		overdraw = 1;
@@ -125,6 +127,8 @@ float MCscale = 1./(float)MCsize;
 #ifdef SUPPORT_OFFSCREEN_RENDERING
 RenderToTexture r2t;
 GL::GLTexture r2t_tex;
+int export_width  = OFFSCREEN_WIDTH,
+    export_height = OFFSCREEN_HEIGHT;
 #endif
 
 bool wiimote_available = false;
@@ -323,7 +327,7 @@ void init()
 		cerr << "Error: Couldn't create render texture!" << endl;
 		exit(-921);
 	}
-	r2t_tex.Image( 0, GL_RGB, OFFSCREEN_WIDTH,OFFSCREEN_HEIGHT, 0, GL_RGB, GL_FLOAT, NULL );
+	r2t_tex.Image( 0, GL_RGB, OFFSCREEN_TILE_SIZE,OFFSCREEN_TILE_SIZE, 0, GL_RGB, GL_FLOAT, NULL );
 	if( !r2t.init( r2t_tex.GetWidth(),r2t_tex.GetHeight(),r2t_tex.GetID(), true ) )
 	{
 		cerr << "Error: Couldn't initialize rendering to texture!" << endl;
@@ -373,6 +377,24 @@ void reshape( int width, int height )
 
 }
 
+/* set projection to sub-frustum of tile (x,y,w,h) of reshape(width,height) */
+void reshape_tile( int width, int height, int x, int y, int w, int h )
+{
+	// frustum bounds of gluPerspective() in reshape()
+	double znear = 0.1,
+	       top   = znear, // znear * tan( 90/2 degrees )
+	       right = top * (double)width / (double)height;
+
+	glMatrixMode( GL_PROJECTION );
+	glLoadIdentity();
+	glFrustum( -right + 2*right *  x    / width,
+	           -right + 2*right * (x+w) / width,
+	           -top   + 2*top   *  y    / height,
+	           -top   + 2*top   * (y+h) / height,
+	           znear, 50 );
+	glMatrixMode( GL_MODELVIEW );
+}
+
 //------------------------------------------------------------------------------
 
 void draw_internal()
@@ -398,15 +420,14 @@ void draw_frustum()
 
 	mycube->set_frustum( &myfrust );		
 
-	if( update || !dl_cube || update_once )
-	{		
-		glNewList( dl_cube, GL_COMPILE );
-		draw_internal();
-		glEndList();
+	// re-extract mesh only if noise parameters or position changed
+	if( update || update_once )
+	{
+		mycube->update();
 		update_once = 0;
 	}
 	
-	glCallList( dl_cube );
+	draw_internal();
 	
 	#ifdef DEBUG_CUBE
 	// draw control block
@@ -629,7 +650,9 @@ void writestate( std::ostream& os=std::cout )
 	   << "octaves = " << octaves << endl
 	   << "FIELDsize = " << FIELDsize << endl
 	   << "MCsize = " << MCsize << endl
-	   << "MCscale = " << MCscale << endl;
+	   << "MCscale = " << MCscale << endl
+	   << "lod = " << lod << endl
+	   << "seed = " << mycube->get_seed() << endl;
 
 	os << "[mnoise2_RenderSettings]" << endl;
 	os << "clear = " << clear[0] << " " << clear[1] << " " << clear[2] << endl
@@ -672,11 +695,17 @@ void dumpstate()
 void reseed( int )
 {
 #ifdef MNOISE_USE_IMPROVEDNOISE	
+	mycube->invalidate();
 #else
-	PerlinNoise::reseed();
+	// time based seed, advanced if reseeding twice within a second
+	unsigned seed = (unsigned)time(NULL);
+	if( seed <= mycube->get_seed() )
+		seed = mycube->get_seed() + 1;
+	mycube->reseed( seed );
 	if( verbosity > 1 )
-		printf("New seed = %X\n",PerlinNoise::get_seed());
+		printf("New seed = %X\n",mycube->get_seed());
 #endif
+	update_once = 1;
 }
 
 float frand()
@@ -753,10 +782,27 @@ void randstate()
 }
 
 //------------------------------------------------------------------------------
+/* gl2ps feedback buffer size (in floats) sufficient to render current mesh */
+int export_ps_buffsize()
+{
+	// In GL_3D_COLOR feedback mode a vertex takes 7 floats, hence a triangle
+	// 2+3*7 and a line 1+2*7 floats. Triangles split by clipping take more,
+	// debug drawing and gl2ps pass through tokens are covered by a margin.
+	const double triangle = 2+3*7, 
+	             line     = 1+2*7,
+	             margin   = 1024*1024;
+	double per_triangle = triangle;
+	if( wireframe )
+		per_triangle = 3*line + (overdraw ? triangle : 0);
+
+	double size = 1.25 * per_triangle * mycube->get_mesh().num_triangles() + margin;
+	return (int)std::min( size, (double)INT_MAX );
+}
+
 void export_ps( std::string filename="" )
 {   
 	FILE *fp;
-	int state = GL2PS_OVERFLOW, buffsize = 0;
+	int state = GL2PS_OVERFLOW, buffsize = export_ps_buffsize();
 	
 	time_t seconds = time(NULL);
 	
@@ -772,53 +818,89 @@ void export_ps( std::string filename="" )
 		return;
 	}
 
+	// buffer is sized from the mesh, retry only in case the estimate failed
     while( state == GL2PS_OVERFLOW )
 	{
-      buffsize += 1024*1024;
       gl2psBeginPage("test", "gl2psTestSimple", NULL, GL2PS_EPS, GL2PS_BSP_SORT, 
                      GL2PS_DRAW_BACKGROUND | GL2PS_USE_CURRENT_VIEWPORT, 
                      GL_RGBA, 0, NULL, 0, 0, 0,  buffsize, fp, "out.eps");
       render();
       state = gl2psEndPage();
+      if( state == GL2PS_OVERFLOW )
+      {
+        if( buffsize > INT_MAX/2 )
+        {
+          cerr << "Feedback buffer overflow exporting " << filename << "!" << endl;
+          break;
+        }
+        buffsize *= 2;
+      }
     }
     fclose(fp);
     printf( "Current GL-Viewport exportet to %s\n", filename.c_str() );
 }
 
+//------------------------------------------------------------------------------
+void export_mesh( std::string filename="" )
+{
+	char autoname[1024];
+	sprintf( autoname, "mnoise2-mesh-%d.obj", (int)time(NULL) );
+	if( filename.empty() )
+		filename = std::string(autoname);
+
+	// extract isosurface of complete octree, independent of current view
+	MCMesh mesh;
+	mycube->extract( mesh );
+	if( mesh.write_obj( filename.c_str() ) )
+		printf( "Mesh with %d vertices and %d triangles exported to %s\n",
+		        (int)mesh.num_vertices(), (int)mesh.num_triangles(), filename.c_str() );
+}
+
+void export_mesh( int )
+{
+	export_mesh();
+}
+
 //------------------------------------------------------------------------------
 #ifdef SUPPORT_OFFSCREEN_RENDERING
 #include "GLError.h"
+/* render tile of offscreen image into r2t, see Screenshot::saveTiled() */
+void render_tile( int x, int y, int w, int h, void* )
+{
+	glViewport( 0,0, w,h );
+	reshape_tile( export_width, export_height, x,y,w,h );
+	render();
+}
+
 void export_offscreen( std::string filename )
 {
-	int w = r2t_tex.GetWidth(), 
-		h = r2t_tex.GetHeight();
+	int tw = r2t_tex.GetWidth(), 
+		th = r2t_tex.GetHeight();
 
-	std::cout << "export_offscreen() filename=\"" << filename << "\"" << std::endl;
+	std::cout << "export_offscreen() filename=\"" << filename << "\" size=" 
+	          << export_width << "x" << export_height << std::endl;
 
 	GL::checkGLError("export_offscreen() - begin");
 
 	glPushAttrib( GL_ALL_ATTRIB_BITS );	GL::checkGLError("export_offscreen() - PushAttrib()");
 
 	r2t.bind( r2t_tex.GetID() );  	GL::checkGLError("export_offscreen() - r2t.bind()");
-	glViewport(0,0,w,h);            GL::checkGLError("export_offscreen() - viewport()");	
-	reshape(w,h);                   GL::checkGLError("export_offscreen() - reshape()");
 
 	// HACK: heuristically thicken lines for higher resolution
 	float tmp_linewidth = linewidth;
 #ifdef SCREENSHOT_AUTO_ADJUST_LINEWIDTH
-	linewidth *= (double)w / 1024;
+	linewidth *= (double)export_width / 1024;
 #endif
-	render();                       GL::checkGLError("export_offscreen() - render()");
+	Screenshot::saveTiled( filename, export_width, export_height, tw, th, render_tile );
+	GL::checkGLError("export_offscreen() - saveTiled()");
 	linewidth = tmp_linewidth;
 
-  #ifdef SCREENSHOT_SUPPORT_PNG
-	Screenshot::savePNG( filename ); GL::checkGLError("export_offscreen() - savePNG()");
-  #else
-	Screenshot::saveTGA( filename ); GL::checkGLError("export_offscreen() - saveTGA()");
-  #endif
 	r2t.unbind();                   GL::checkGLError("export_offscreen() - r2t.unbind()");
 
 	glPopAttrib();                  GL::checkGLError("export_offscreen() - PopAttrib()");
+
+	// restore projection of main window
+	reshape( glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT) );
 }
 
 // dummy for GLUI_Update_CB
@@ -845,7 +927,9 @@ void export_offscreen( int )
 #define ID_MODE_CHANGE 57
 #define ID_NORMALS_CHANGE 58
 #define ID_CELLSCALE_CHANGE 59
-#define ID_LAST 59
+#define ID_LOD_CHANGE 60
+#define ID_SCROLLING_CHANGE 61
+#define ID_LAST 61
 
 void callback( int id )
 {
@@ -881,6 +965,14 @@ void callback( int id )
 		case ID_CELLSCALE_CHANGE:
 			mycube->set_scale( cellscale );
 			break;
+
+		case ID_LOD_CHANGE:
+			mycube->set_lod( lod );
+			break;
+
+		case ID_SCROLLING_CHANGE:
+			mycube->set_scrolling( scrolling!=0 );
+			break;
 			
 		case ID_BLEND_CHANGE:
 		case ID_SMOOTH_CHANGE:
@@ -980,6 +1072,10 @@ void glut_keyboard( unsigned char key, int x, int y )
 		dbg_draw_all=(dbg_draw_all+1)%2;
 		break;
 
+	case 'e':
+		export_mesh();
+		break;
+
 	case 27:
 	case 'q':
 		exit(0);
@@ -1196,9 +1292,6 @@ int main( int argc, char* argv[] )
 	glEnable( GL_FOG );
 #endif
 
-	/* prepare display list for cube */
-	dl_cube = glGenLists( 1 );
-	
 
 #ifdef GLUI_GUI
 
@@ -1227,6 +1320,7 @@ int main( int argc, char* argv[] )
 	GLUI_Checkbox* opt_overdraw   = new GLUI_Checkbox( opt_rollout, "Overdraw", &overdraw );
 	GLUI_Checkbox* opt_update     = new GLUI_Checkbox( opt_rollout, "Update", &update );
 	GLUI_Checkbox* opt_do_normals = new GLUI_Checkbox( opt_rollout, "Normals", &do_normals, ID_NORMALS_CHANGE, (GLUI_Update_CB)callback);
+	GLUI_Checkbox* opt_scrolling  = new GLUI_Checkbox( opt_rollout, "Scrolling", &scrolling, ID_SCROLLING_CHANGE, (GLUI_Update_CB)callback);
 	GLUI_Checkbox* opt_color_material = new GLUI_Checkbox( opt_rollout, "ColorMaterial", &color_material );
 	GLUI_Spinner* linewidth_spinner = new GLUI_Spinner( opt_rollout, 
 		"Linewidth", GLUI_SPINNER_FLOAT, &linewidth );
@@ -1272,18 +1366,29 @@ int main( int argc, char* argv[] )
 		glui->add_spinner( "Cell scale", GLUI_SPINNER_FLOAT, &cellscale, ID_CELLSCALE_CHANGE, (GLUI_Update_CB)callback );
 	cellscale_spinner->set_float_limits( 1.f/128.f, 2.f, GLUI_LIMIT_CLAMP );
 
+	GLUI_Spinner* lod_spinner =
+		glui->add_spinner( "LOD", GLUI_SPINNER_FLOAT, &lod, ID_LOD_CHANGE, (GLUI_Update_CB)callback );
+	lod_spinner->set_float_limits( 0.f, 1.f, GLUI_LIMIT_CLAMP );
+
 
 	glui->add_statictext( "" );
 	glui->add_edittext( "Cubes", GLUI_EDITTEXT_INT, &cubecount );
 	
 	glui->add_statictext( "" );
 	glui->add_button( "Export PS" , 3, (GLUI_Update_CB)export_ps );
+	glui->add_button( "Export OBJ", 6, (GLUI_Update_CB)export_mesh );
 #ifdef SUPPORT_OFFSCREEN_RENDERING
   #ifdef SCREENSHOT_SUPPORT_PNG
 	glui->add_button( "Export PNG", 4, (GLUI_Update_CB)export_offscreen );	
   #else
 	glui->add_button( "Export TGA", 4, (GLUI_Update_CB)export_offscreen );
   #endif
+	GLUI_Spinner* export_width_spinner =
+		glui->add_spinner( "Export width", GLUI_SPINNER_INT, &export_width );
+	export_width_spinner->set_int_limits( 1, 65535, GLUI_LIMIT_CLAMP );
+	GLUI_Spinner* export_height_spinner =
+		glui->add_spinner( "Export height", GLUI_SPINNER_INT, &export_height );
+	export_height_spinner->set_int_limits( 1, 65535, GLUI_LIMIT_CLAMP );
 #endif
 	
 	glui->add_statictext( "" );
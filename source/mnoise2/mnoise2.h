@@ -30,6 +30,9 @@
 #define OFFSCREEN_WIDTH  8096
 #define OFFSCREEN_HEIGHT 5060
 
+// Size of offscreen render target, larger images are rendered tile by tile
+#define OFFSCREEN_TILE_SIZE 2048
+
 // Debug octree code
 //#define DEBUG_CUBE
 
@@ -0,0 +1,421 @@
+////////////////////////////////////////////////////////////////////////////////
+// MNOISE2 headless command line program
+//
+// Batch isosurface generation w/o GLUT/GLUI and w/o an OpenGL context.
+// Noise and render settings are read from a parameter map as written by
+// mnoise2 "Dump State" (see writestate()), camera poses from a text file.
+// For each pose the isosurface inside the viewing frustum is extracted and
+// written as OBJ mesh and/or rendered in software as PPM image. Frames are
+// processed in parallel (if compiled with OpenMP), each thread with its own
+// MNoise instance. Output is deterministic for a given seed.
+//
+// (c) 2004-2011 386dx25.de
+////////////////////////////////////////////////////////////////////////////////
+
+#include "MNoise.h"
+#include "Frustum.h"
+#include "SimpleParammap.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cstdio>
+#include <cmath>
+#include <ctime>
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+/** settings ******************************************************************/
+
+struct Settings
+{
+	// noise, see mnoise2 writestate()
+	int   FIELDsize;
+	float MCscale;
+	int   MCsize;
+	float isovalue;
+	float persistance;
+	int   octaves;
+	int   mode;
+	int   do_normals;
+	float lod;
+	unsigned seed;
+
+	// rendering
+	int   width, height;
+	float clear[3];
+	float fgcol[3];
+	float posz;
+};
+
+/// Camera pose, position in noise field and view rotation as in mnoise2
+struct Pose
+{
+	float pos[3];
+	float view_rotate[16];
+};
+
+void read_settings( const map<string,string>& params, Settings& s, Pose& pose )
+{
+	using namespace SimpleParammap;
+
+	parse_val_from_stringmap( params, "FIELDsize",   s.FIELDsize,   5 );
+	parse_val_from_stringmap( params, "MCsize",      s.MCsize,      1<<(s.FIELDsize-1) );
+	parse_val_from_stringmap( params, "MCscale",     s.MCscale,     1.f/(float)s.MCsize );
+	parse_val_from_stringmap( params, "isovalue",    s.isovalue,    0.5f );
+	parse_val_from_stringmap( params, "persistance", s.persistance, 0.75f );
+	parse_val_from_stringmap( params, "octaves",     s.octaves,     1 );
+	parse_val_from_stringmap( params, "mode",        s.mode,        1 );
+	parse_val_from_stringmap( params, "do_normals",  s.do_normals,  1 );
+	parse_val_from_stringmap( params, "lod",         s.lod,         0.f );
+	parse_val_from_stringmap( params, "seed",        s.seed,        1u );
+	parse_val_from_stringmap( params, "width",       s.width,       1024 );
+	parse_val_from_stringmap( params, "height",      s.height,      768 );
+	parse_val_from_stringmap( params, "posz",        s.posz,        0.f );
+
+	vector<float> v;
+	parse_vals_from_stringmap( params, "clear", v, vector<float>( 3, 1.f ) );
+	copy( v.begin(), v.end(), s.clear );
+	v.clear();
+	parse_vals_from_stringmap( params, "fgcol", v, vector<float>( 3, 0.f ) );
+	copy( v.begin(), v.end(), s.fgcol );
+
+	// default pose
+	float identity[16] = { 1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1 };
+	v.clear();
+	parse_vals_from_stringmap( params, "view_rotate", v, vector<float>( identity, identity+16 ) );
+	copy( v.begin(), v.end(), pose.view_rotate );
+	v.clear();
+	parse_vals_from_stringmap( params, "trans_vector", v, vector<float>( 4, 0.f ) );
+	copy( v.begin(), v.begin()+3, pose.pos );
+}
+
+/// Read poses, one per line as "x y z [r0 .. r15]" with optional view
+/// rotation (column major as view_rotate), empty lines and # comments are
+/// skipped. Poses w/o rotation use the rotation of the default pose.
+bool read_poses( const char* filename, const Pose& default_pose, vector<Pose>& poses )
+{
+	ifstream f( filename );
+	if( !f.is_open() )
+	{
+		cerr << "Error: Couldn't open poses file " << filename << "!" << endl;
+		return false;
+	}
+
+	string line;
+	int lineno = 0;
+	while( getline( f, line ) )
+	{
+		lineno++;
+		if( line.find_first_not_of( " \t\r" ) == string::npos || line[0] == '#' )
+			continue;
+
+		vector<float> v;
+		SimpleParammap::parse_vals( line, v );
+		if( v.size() != 3 && v.size() != 3+16 )
+		{
+			cerr << "Error: Invalid pose in " << filename << " line " << lineno << "!" << endl;
+			return false;
+		}
+
+		Pose p = default_pose;
+		copy( v.begin(), v.begin()+3, p.pos );
+		if( v.size() > 3 )
+			copy( v.begin()+3, v.end(), p.view_rotate );
+		poses.push_back( p );
+	}
+	return true;
+}
+
+/** camera ********************************************************************/
+
+/// Modelview matrix as in mnoise2 render(): translation by posz times view
+/// rotation (view tilt is not supported)
+void camera_modelview( const Pose& pose, float posz, float modl[16] )
+{
+	copy( pose.view_rotate, pose.view_rotate+16, modl );
+	for( int j=0; j < 4; j++ )
+		modl[4*j+2] += posz * modl[4*j+3];
+}
+
+/// Projection matrix as in mnoise2 reshape(), gluPerspective(90,aspect,0.1,50)
+void camera_projection( int width, int height, float proj[16] )
+{
+	const float znear = 0.1f, zfar = 50.f, f = 1.f; // f = cot( 90/2 degrees )
+	float aspect = (float)width / (float)height;
+	fill( proj, proj+16, 0.f );
+	proj[ 0] = f / aspect;
+	proj[ 5] = f;
+	proj[10] = (zfar + znear) / (znear - zfar);
+	proj[11] = -1.f;
+	proj[14] = 2.f*zfar*znear / (znear - zfar);
+}
+
+/// Transform point (x,y,z,1) by column major matrix
+void transform( const float m[16], const float* p, float r[4] )
+{
+	for( int i=0; i < 4; i++ )
+		r[i] = m[i]*p[0] + m[4+i]*p[1] + m[8+i]*p[2] + m[12+i];
+}
+
+/** software rendering ********************************************************/
+
+/// Render mesh flat shaded with z-buffer and headlight, a simple preview
+/// replacing the OpenGL rendering of mnoise2. Triangles crossing the near
+/// plane are skipped. Image rows are stored from top to bottom.
+void rasterize( const MCMesh& mesh, const float modl[16], const float proj[16],
+                const Settings& s, vector<unsigned char>& image, vector<float>& depth )
+{
+	int w = s.width, h = s.height;
+	image.resize( (size_t)w*h*3 );
+	depth.assign( (size_t)w*h, 1.f );
+	for( size_t i=0; i < image.size(); i++ )
+		image[i] = (unsigned char)(255.f * s.clear[i%3]);
+
+	for( size_t t=0; t < mesh.indices.size(); t+=3 )
+	{
+		float eye[3][4], sx[3], sy[3], sz[3];
+		bool clipped = false;
+		for( int k=0; k < 3; k++ )
+		{
+			const float* v = &mesh.vertices[ 3*mesh.indices[t+k] ];
+			float clip[4];
+			transform( modl, v, eye[k] );
+			transform( proj, eye[k], clip );
+			if( eye[k][2] > -0.1f )
+			{
+				clipped = true;
+				break;
+			}
+			sx[k] = (clip[0]/clip[3]*.5f + .5f) * w;
+			sy[k] = (.5f - clip[1]/clip[3]*.5f) * h;
+			sz[k] = clip[2]/clip[3];
+		}
+		if( clipped )
+			continue;
+
+		float area = (sx[1]-sx[0])*(sy[2]-sy[0]) - (sx[2]-sx[0])*(sy[1]-sy[0]);
+		if( area == 0.f )
+			continue;
+
+		// headlight shading with eye space face normal
+		float e1[3], e2[3], n[3];
+		for( int k=0; k < 3; k++ )
+		{
+			e1[k] = eye[1][k] - eye[0][k];
+			e2[k] = eye[2][k] - eye[0][k];
+		}
+		n[0] = e1[1]*e2[2] - e1[2]*e2[1];
+		n[1] = e1[2]*e2[0] - e1[0]*e2[2];
+		n[2] = e1[0]*e2[1] - e1[1]*e2[0];
+		float len = sqrt( n[0]*n[0] + n[1]*n[1] + n[2]*n[2] );
+		float shade = len > 0.f ? .2f + .8f*fabs( n[2] ) / len : .2f;
+		unsigned char col[3];
+		for( int k=0; k < 3; k++ )
+			col[k] = (unsigned char)(255.f * min( 1.f, s.fgcol[k] * shade ));
+
+		int x0 = max( 0,   (int)floor( min( sx[0], min( sx[1], sx[2] ) ) ) ),
+		    x1 = min( w-1, (int)ceil ( max( sx[0], max( sx[1], sx[2] ) ) ) ),
+		    y0 = max( 0,   (int)floor( min( sy[0], min( sy[1], sy[2] ) ) ) ),
+		    y1 = min( h-1, (int)ceil ( max( sy[0], max( sy[1], sy[2] ) ) ) );
+
+		for( int y=y0; y <= y1; y++ )
+			for( int x=x0; x <= x1; x++ )
+			{
+				// barycentric coordinates of pixel center
+				float px = x + .5f, py = y + .5f;
+				float b0 = ((sx[1]-px)*(sy[2]-py) - (sx[2]-px)*(sy[1]-py)) / area,
+				      b1 = ((sx[2]-px)*(sy[0]-py) - (sx[0]-px)*(sy[2]-py)) / area,
+				      b2 = 1.f - b0 - b1;
+				if( b0 < 0.f || b1 < 0.f || b2 < 0.f )
+					continue;
+
+				float z = b0*sz[0] + b1*sz[1] + b2*sz[2];
+				size_t ofs = (size_t)y*w + x;
+				if( z >= depth[ofs] )
+					continue;
+				depth[ofs] = z;
+				for( int k=0; k < 3; k++ )
+					image[3*ofs+k] = col[k];
+			}
+	}
+}
+
+bool write_ppm( const char* filename, int width, int height,
+                const vector<unsigned char>& image )
+{
+	FILE* f = fopen( filename, "wb" );
+	if( !f )
+	{
+		fprintf( stderr, "write_ppm() : Couldn't open %s!\n", filename );
+		return false;
+	}
+	fprintf( f, "P6\n%d %d\n255\n", width, height );
+	fwrite( &image[0], 1, image.size(), f );
+
+	bool ok = !ferror( f );
+	fclose( f );
+	if( !ok )
+		fprintf( stderr, "write_ppm() : Error writing %s!\n", filename );
+	return ok;
+}
+
+/** main **********************************************************************/
+
+double wall_time()
+{
+#ifdef USE_OPENMP
+	return omp_get_wtime();
+#else
+	return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+int main( int argc, char* argv[] )
+{
+	if( argc < 4 )
+	{
+		cout << "usage: " << argv[0] << " <params.txt> <poses.txt|-> <output prefix> [obj|ppm|both]" << endl;
+		cout << "options:" << endl;
+		cout << "  params.txt     parameter map as written by mnoise2 \"Dump State\"," << endl
+		     << "                 additionally seed, width and height" << endl;
+		cout << "  poses.txt      camera poses, one per line \"x y z [r0 .. r15]\"," << endl
+		     << "                 - for single pose given by trans_vector/view_rotate" << endl;
+		cout << "  output prefix  frames are written to <prefix>00000.obj/.ppm etc." << endl;
+		cout << "  obj|ppm|both   write extracted meshes, rendered images or both" << endl;
+		return 0;
+	}
+
+	string format = argc > 4 ? argv[4] : "obj";
+	bool write_obj = format == "obj" || format == "both",
+	     write_img = format == "ppm" || format == "both";
+	if( !write_obj && !write_img )
+	{
+		cerr << "Error: Unknown output format " << format << "!" << endl;
+		return -1;
+	}
+
+	/* read settings and poses */
+
+	ifstream fparams( argv[1] );
+	if( !fparams.is_open() )
+	{
+		cerr << "Error: Couldn't open parameter file " << argv[1] << "!" << endl;
+		return -1;
+	}
+	map<string,string> params;
+	SimpleParammap::read_parammap( fparams, params );
+
+	Settings s;
+	Pose default_pose;
+	read_settings( params, s, default_pose );
+	if( s.width <= 0 || s.height <= 0 || s.MCsize <= 0 )
+	{
+		cerr << "Error: Invalid image or grid size!" << endl;
+		return -1;
+	}
+
+	vector<Pose> poses;
+	if( string(argv[2]) == "-" )
+		poses.push_back( default_pose );
+	else
+	if( !read_poses( argv[2], default_pose, poses ) )
+		return -1;
+
+	float proj[16];
+	camera_projection( s.width, s.height, proj );
+
+	/* process frames */
+
+	int num_frames = (int)poses.size(),
+	    num_failed = 0;
+	size_t num_triangles = 0;
+	double t0 = wall_time();
+
+	#pragma omp parallel reduction(+:num_failed,num_triangles)
+	{
+		// per thread noise instance, same parameters and seed in every thread
+		MNoise noise( s.FIELDsize, s.MCscale, s.MCsize );
+		noise.reseed( s.seed );
+		noise.set_isovalue( s.isovalue );
+		noise.set_persistance( s.persistance );
+		noise.set_octaves( s.octaves );
+		noise.set_mode( s.mode );
+		noise.set_compute_normals( s.do_normals != 0 );
+		noise.set_lod( s.lod );
+		noise.set_parallel( false ); // parallel over frames instead
+		noise.build();
+
+		MCMesh mesh;
+		Frustum frust;
+		vector<unsigned char> image;
+		vector<float> depth;
+
+		#pragma omp for schedule(dynamic)
+		for( int i=0; i < num_frames; i++ )
+		{
+			const Pose& pose = poses[i];
+			double t_start = wall_time();
+
+			float modl[16];
+			camera_modelview( pose, s.posz, modl );
+			frust.extract_frustum( modl, proj, true );
+
+			noise.set_posx( pose.pos[0] );
+			noise.set_posy( pose.pos[1] );
+			noise.set_posz( pose.pos[2] );
+
+			mesh.clear();
+			noise.extract( mesh, &frust );
+			double t_extract = wall_time();
+
+			char filename[1024];
+			bool ok = true;
+			if( write_obj )
+			{
+				sprintf( filename, "%s%05d.obj", argv[3], i );
+				ok &= mesh.write_obj( filename );
+			}
+			if( write_img )
+			{
+				rasterize( mesh, modl, proj, s, image, depth );
+				sprintf( filename, "%s%05d.ppm", argv[3], i );
+				ok &= write_ppm( filename, s.width, s.height, image );
+			}
+			double t_end = wall_time();
+
+			if( !ok ) num_failed++;
+			num_triangles += mesh.num_triangles();
+
+			#pragma omp critical
+			{
+				printf( "Frame %5d: %8u triangles, extract %.3fs, output %.3fs (%.0f triangles/s)\n",
+				        i, (unsigned)mesh.num_triangles(), t_extract - t_start,
+				        t_end - t_extract,
+				        mesh.num_triangles() / max( t_end - t_start, 1e-6 ) );
+				fflush( stdout );
+			}
+		}
+	}
+
+	double dt = wall_time() - t0;
+	int num_threads = 1;
+#ifdef USE_OPENMP
+	num_threads = omp_get_max_threads();
+#endif
+	printf( "Finished %d frames in %.3fs on %d threads (%.2f frames/s, %.0f triangles/s)\n",
+	        num_frames, dt, num_threads, num_frames / max( dt, 1e-6 ),
+	        num_triangles / max( dt, 1e-6 ) );
+	if( num_failed > 0 )
+	{
+		fprintf( stderr, "Error: Writing %d frames failed!\n", num_failed );
+		return -2;
+	}
+	return 0;
+}
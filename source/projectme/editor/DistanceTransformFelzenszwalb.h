@@ -4,6 +4,8 @@
   Changes:
   - Removed dependency on image.h by operating on raw float* buffers.
   Max Hermann, November 2014 (hermann@cs.uni-bonn.de)
+  - Added DistanceTransform engine for 2D/3D images, parallel over lines
+    with reusable scratch buffers and optional nearest feature indices.
 */
 /*
 Copyright (C) 2006 Pedro Felzenszwalb
@@ -23,6 +25,11 @@ along with this program; if not, write to the Free Software
 Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
 */
 #include <algorithm>
+#include <vector>
+#include <cstddef>
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
 
 #define INF (float)1E20
 
@@ -31,11 +38,12 @@ namespace DistanceTransformFelzenszwalb {
 template <class T>
 inline T square(const T &x) { return x*x; }
 
-/* dt of 1d function using squared distance */
-static float *dt(float *f, int n) {
-  float *d = new float[n];
-  int *v = new int[n];
-  float *z = new float[n+1];
+/* dt of 1d function using squared distance, result is written to d and, if
+   arg is given, the index of the minimizing sample of f to arg. v and z are
+   scratch buffers of size n and n+1. */
+inline void dt(const float *f, int n, float *d, int *arg, int *v, float *z) {
+  if (n <= 0)
+    return;
   int k = 0;
   v[0] = 0;
   z[0] = -INF;
@@ -57,43 +65,192 @@ static float *dt(float *f, int n) {
     while (z[k+1] < q)
       k++;
     d[q] = square(q-v[k]) + f[v[k]];
+    if (arg)
+      arg[q] = v[k];
   }
+}
 
-  delete [] v;
-  delete [] z;
+/* dt of 1d function using squared distance */
+static float *dt(float *f, int n) {
+  float *d = new float[n];
+  std::vector<int> v(n);
+  std::vector<float> z(n+1);
+  dt(f, n, d, NULL, &v[0], &z[0]);
   return d;
 }
 
+/**
+  Squared distance transform of 2D and 3D images, separable in one pass per
+  axis of 1D transforms along all lines of that axis.
 
-/* dt of 2d function using squared distance */
-static void dt(float *im,int width,int height) {
-  float *f = new float[std::max(width,height)];
+  Lines are processed in parallel (if compiled with OpenMP), each thread
+  using its own scratch buffers which are kept between calls. Lines along
+  rows are contiguous, for the other axes BlockSize neighbouring lines are
+  gathered into a contiguous block (blocked transpose) and scattered back
+  afterwards, instead of reading each line with a large stride.
 
-  // transform along columns
-  for (int x = 0; x < width; x++) {
-    for (int y = 0; y < height; y++) {
-      f[y] = im[y*width+x];
-    }
-    float *d = dt(f, height);
-    for (int y = 0; y < height; y++) {
-	  im[y*width+x] = d[y];
+  Optionally the linear index of the nearest feature, i.e. the sample of
+  the input attaining the minimum, is returned per sample.
+*/
+class DistanceTransform
+{
+public:
+  enum { BlockSize = 16 };
+
+  /// In-place transform of width x height image in row major order, if
+  /// nearest is given it receives the index of the nearest feature.
+  void dt2(float *im, int width, int height, int *nearest=NULL) {
+    dt3(im, width, height, 1, nearest);
+  }
+
+  /// In-place transform of width x height x depth volume in x-fastest
+  /// order, if nearest is given it receives the index of the nearest feature.
+  void dt3(float *vol, int width, int height, int depth, int *nearest=NULL) {
+    if (width <= 0 || height <= 0 || depth <= 0)
+      return;
+
+    size_t slice = (size_t)width*height,
+           size  = slice*depth;
+    if (nearest)
+      for (size_t i = 0; i < size; i++)
+        nearest[i] = (int)i;
+
+    reserve(std::max(width, std::max(height, depth)));
+
+    // transform along columns, then along z and finally along rows
+    if (height > 1)
+      passStrided(vol, nearest, depth, slice, width, height, width);
+    if (depth > 1)
+      passStrided(vol, nearest, 1, 0, (int)slice, depth, slice);
+    passRows(vol, nearest, height*depth, width);
+  }
+
+  /// Column pass of dt2() only. The row pass can then be done per row via
+  /// dt1(), e.g. fused with further processing of the distances.
+  void dt2Columns(float *im, int width, int height) {
+    if (width <= 0 || height <= 0)
+      return;
+    reserve(std::max(width, height));
+    if (height > 1)
+      passStrided(im, NULL, 1, 0, width, height, width);
+  }
+
+  /// Transform contiguous line f of length n into d using the scratch of
+  /// the calling thread, may be called concurrently after reserve(n).
+  void dt1(const float *f, int n, float *d) {
+    Scratch &s = scratch();
+    dt(f, n, d, NULL, &s.v[0], &s.z[0]);
+  }
+
+  /// Allocate scratch buffers for lines up to length n for all threads
+  void reserve(int n) {
+    int threads = 1;
+#ifdef USE_OPENMP
+    threads = omp_get_max_threads();
+#endif
+    if ((int)m_scratch.size() < threads)
+      m_scratch.resize(threads);
+    for (size_t t = 0; t < m_scratch.size(); t++)
+      m_scratch[t].reserve(n);
+  }
+
+protected:
+  /// Per thread buffers
+  struct Scratch {
+    std::vector<float> block, d, z;
+    std::vector<int>   blockIdx, arg, v, idx;
+
+    void reserve(int n) {
+      if ((int)d.size() >= n)
+        return;
+      block   .resize(BlockSize*n);
+      blockIdx.resize(BlockSize*n);
+      d  .resize(n);
+      arg.resize(n);
+      v  .resize(n);
+      idx.resize(n);
+      z  .resize(n+1);
     }
-    delete [] d;
+  };
+
+  Scratch& scratch() {
+#ifdef USE_OPENMP
+    return m_scratch[omp_get_thread_num()];
+#else
+    return m_scratch[0];
+#endif
   }
 
-  // transform along rows
-  for (int y = 0; y < height; y++) {
-    for (int x = 0; x < width; x++) {
-      f[x] = im[y*width+x];
+  /// Transform line f of length n in-place, propagating nearest indices
+  /// along the line (if given)
+  void line(Scratch &s, float *f, int *nearest, int n) {
+    dt(f, n, &s.d[0], nearest ? &s.arg[0] : NULL, &s.v[0], &s.z[0]);
+    std::copy(s.d.begin(), s.d.begin()+n, f);
+    if (nearest) {
+      for (int q = 0; q < n; q++)
+        s.idx[q] = nearest[s.arg[q]];
+      std::copy(s.idx.begin(), s.idx.begin()+n, nearest);
     }
-    float *d = dt(f, width);
-    for (int x = 0; x < width; x++) {
-      im[y*width+x] = d[x];
+  }
+
+  /// Transform numLines contiguous lines of length n
+  void passRows(float *data, int *nearest, int numLines, int n) {
+    #pragma omp parallel for schedule(dynamic,16)
+    for (int y = 0; y < numLines; y++)
+      line(scratch(), data + (size_t)y*n, nearest ? nearest + (size_t)y*n : NULL, n);
+  }
+
+  /// Transform lines of length n with samples stride apart, starting at
+  /// o*outerStride + i for o < numOuter and i < numInner
+  void passStrided(float *data, int *nearest, int numOuter, size_t outerStride,
+                   int numInner, int n, size_t stride) {
+    int blocksPerOuter = (numInner + BlockSize-1) / BlockSize,
+        numBlocks      = numOuter * blocksPerOuter;
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int b = 0; b < numBlocks; b++) {
+      Scratch &s = scratch();
+      int o  = b / blocksPerOuter,
+          i0 = (b % blocksPerOuter) * BlockSize,
+          nb = std::min((int)BlockSize, numInner - i0);
+      size_t base = o*outerStride + i0;
+
+      // gather block of nb lines, row by row
+      for (int q = 0; q < n; q++) {
+        const float *src = data + base + q*stride;
+        for (int l = 0; l < nb; l++)
+          s.block[l*n+q] = src[l];
+        if (nearest) {
+          const int *isrc = nearest + base + q*stride;
+          for (int l = 0; l < nb; l++)
+            s.blockIdx[l*n+q] = isrc[l];
+        }
+      }
+
+      for (int l = 0; l < nb; l++)
+        line(s, &s.block[l*n], nearest ? &s.blockIdx[l*n] : NULL, n);
+
+      // scatter block back
+      for (int q = 0; q < n; q++) {
+        float *dst = data + base + q*stride;
+        for (int l = 0; l < nb; l++)
+          dst[l] = s.block[l*n+q];
+        if (nearest) {
+          int *idst = nearest + base + q*stride;
+          for (int l = 0; l < nb; l++)
+            idst[l] = s.blockIdx[l*n+q];
+        }
+      }
     }
-    delete [] d;
   }
 
-  delete f;
+private:
+  std::vector<Scratch> m_scratch;
+};
+
+/* dt of 2d function using squared distance */
+static void dt(float *im,int width,int height) {
+  DistanceTransform().dt2(im, width, height);
 }
 
 /* dt of binary image using squared distance */
@@ -43,6 +43,7 @@ bool ImageModule::createImage( int width, int height )
 	m_filename = std::string("");
 	
 	m_dirty = true; // Upload texture in next render() call		
+	invalidate();
 	return true;
 }
 
@@ -84,6 +85,7 @@ bool ImageModule::loadImage( const char* filename )
 	m_filename = std::string(filename);
 		
 	m_dirty = true; // Upload texture in next render() call		
+	invalidate();
 	return true;
 }
 
@@ -137,6 +139,7 @@ void ImageModule::fillImage( unsigned char R, unsigned char G, unsigned char B,
 		}
 
 	m_dirty = true; // Upload texture in next render() call
+	invalidate();
 }
 
 //----------------------------------------------------------------------------
@@ -204,6 +207,7 @@ void ImageModule::paint( int x0, int y0, unsigned char R, unsigned char G, unsig
 	}
 
 	m_dirty = true; // Upload texture in next render() call
+	invalidate();
 }
 
 //----------------------------------------------------------------------------
@@ -37,6 +37,7 @@ public:
 	int  target() const { return m_target.name(); }
 	void destroy();
 	void touch() {}
+	bool isTimeDependent() const { return false; }
 	///@}
 	
 	/// @name Serialization
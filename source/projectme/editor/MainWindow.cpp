@@ -480,6 +480,7 @@ void MainWindow::createUI()
 		*actReloadShader,
 		*actEditShader,
 		*actModuleInit,
+		*actModuleTimings,
 		*actNewArea,
 		*actOpenStyleSheet;
 	
@@ -507,6 +508,8 @@ void MainWindow::createUI()
 	actModuleInit = new QAction( tr("Custom module init"), this );
 	actModuleInit->setShortcut( tr("Ctrl+I") );
 
+	actModuleTimings = new QAction( tr("Print module timings"), this );
+
 	actNewArea  = new QAction( tr("New area"), this );
 
 	actOpenStyleSheet = new QAction( tr("Open style sheet..."), this );
@@ -545,6 +548,7 @@ void MainWindow::createUI()
 	menuModules->addAction( actEditShader );
 	menuModules->addSeparator();
 	menuModules->addAction( actModuleInit );
+	menuModules->addAction( actModuleTimings );
 	menuModules->addSeparator();
 	
 	// "New module" menu entries + connection to signal mapper
@@ -594,6 +598,7 @@ void MainWindow::createUI()
 	connect( actNewArea, SIGNAL(triggered()), this, SLOT(newArea()) );
 
 	connect( actModuleInit, SIGNAL(triggered()), this, SLOT(customModuleInit()) );
+	connect( actModuleTimings, SIGNAL(triggered()), this, SLOT(printModuleTimings()) );
 
 	connect( m_nodeEditorWidget, SIGNAL(connectionChanged()), this, SLOT(updateTables()) );
 	connect( m_nodeEditorWidget, SIGNAL(selectionChanged(ModuleRenderer*)), m_moduleWidget, SLOT(setActiveModule(ModuleRenderer*)) );
@@ -834,6 +839,11 @@ void MainWindow::forceRender()
 	QApplication::processEvents();
 }
 
+void MainWindow::printModuleTimings()
+{
+	m_projectMe.moduleManager().printTimings( cout );
+}
+
 void MainWindow::updateViewMenu()
 {
 	m_menuView->clear();
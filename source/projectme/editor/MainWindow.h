@@ -112,6 +112,7 @@ private slots:
 	void newArea();
 
 	void forceRender();
+	void printModuleTimings();
 
 protected:
 	void createUI();
@@ -2,6 +2,10 @@
 
 #include <iostream>
 #include <sstream>
+#include <iomanip>
+#include <queue>
+#include <functional>
+#include <chrono>
 
 //=============================================================================
 //  ModuleBase
@@ -64,7 +68,8 @@ std::string ModuleBase::getDefaultName()
 
 ModuleRenderer::ModuleRenderer( std::string typeName )
 : ModuleBase( typeName ),
-	m_active( "active", true )
+	m_active( "active", true ),
+	m_invalid( true )
 {
 	parameters().push_back( &m_active );
 }
@@ -113,11 +118,15 @@ void ModuleManager::clear()
 		delete m_modules[i];
 	}
 	m_modules.clear();
+	m_dependencies.clear();
+	m_timings.clear();
+	m_states.clear();
 }
 
 void ModuleManager::addModule( ModuleRenderer* module )
 {
 	m_modules.push_back( module );
+	m_states.erase( module ); // Forget state of deleted module at same address
 }
 
 ModuleRenderer* ModuleManager::findModule( std::string name, std::string type )
@@ -146,8 +155,186 @@ int ModuleManager::moduleIndex( ModuleRenderer* m )
 	return -1;
 }
 
+void ModuleManager::sortModules( std::vector<int>& order, std::vector<char>& cyclic,
+	                              std::vector< std::vector<int> >& sources ) const
+{
+	int n = (int)m_modules.size();
+
+	std::map<ModuleRenderer*,int> index;
+	for( int i=0; i < n; i++ )
+		index[m_modules[i]] = i;
+
+	// Dependency graph on module indices
+	std::vector< std::vector<int> > targets( n );
+	std::vector<int> indegree( n, 0 );
+	sources.assign( n, std::vector<int>() );
+	for( unsigned k=0; k < m_dependencies.size(); k++ )
+	{
+		std::map<ModuleRenderer*,int>::const_iterator 
+			src = index.find( m_dependencies[k].first  ),
+			dst = index.find( m_dependencies[k].second );
+		if( src == index.end() || dst == index.end() )
+			continue;
+
+		targets[src->second].push_back( dst->second );
+		sources[dst->second].push_back( src->second );
+		indegree[dst->second]++;
+	}
+
+	// Kahn's algorithm, always picking the ready module inserted first
+	std::priority_queue< int, std::vector<int>, std::greater<int> > ready;
+	for( int i=0; i < n; i++ )
+		if( indegree[i] == 0 )
+			ready.push( i );
+
+	order.clear();
+	while( !ready.empty() )
+	{
+		int i = ready.top(); ready.pop();
+		order.push_back( i );
+		for( unsigned k=0; k < targets[i].size(); k++ )
+			if( --indegree[targets[i][k]] == 0 )
+				ready.push( targets[i][k] );
+	}
+
+	// Remaining modules are on or behind a cycle
+	cyclic.assign( n, 0 );
+	for( int i=0; i < n; i++ )
+		if( indegree[i] > 0 )
+		{
+			order.push_back( i );
+			cyclic[i] = 1;
+		}
+}
+
+bool ModuleManager::updateState( ModuleRenderer* m, ModuleState& s )
+{
+	bool changed = false;
+
+	// Parameters and options
+	const ParameterList* lists[2] = { &m->parameters(), &m->options() };
+	std::vector<std::string> values;
+	for( int l=0; l < 2; l++ )
+		for( unsigned i=0; i < lists[l]->size(); i++ )
+			values.push_back( lists[l]->at(i) ? lists[l]->at(i)->str() : std::string() );
+	if( values != s.values )
+	{
+		s.values.swap( values );
+		changed = true;
+	}
+
+	// Input channels
+	std::vector<int> channels( m->numChannels() );
+	for( unsigned i=0; i < channels.size(); i++ )
+		channels[i] = m->channel( (int)i );
+	if( channels != s.channels )
+	{
+		s.channels.swap( channels );
+		changed = true;
+	}
+
+	return changed;
+}
+
 void ModuleManager::update()
 {
-    for( unsigned i=0; i < m_modules.size(); i++ )
-		m_modules[i]->update();
+	std::vector<int> order;
+	std::vector<char> cyclic;
+	std::vector< std::vector<int> > sources;
+	sortModules( order, cyclic, sources );
+
+	// Drop state of removed modules
+	std::map<ModuleRenderer*,ModuleState> states;
+	for( unsigned i=0; i < m_modules.size(); i++ )
+		states[m_modules[i]] = m_states[m_modules[i]];
+	m_states.swap( states );
+
+	// Determine outdated modules, dirty marks modules rendered in this update
+	std::vector<char> dirty( m_modules.size(), 0 );
+	std::vector<int> prepare;
+	for( unsigned k=0; k < order.size(); k++ )
+	{
+		int i = order[k];
+		ModuleRenderer* m = m_modules[i];
+		ModuleState& s = m_states[m];
+
+		// Evaluate all conditions to keep state up to date
+		bool invalid = m->takeInvalidated();
+		bool changed = updateState( m, s );
+		bool outdated = !m_scheduling || cyclic[i] || invalid || changed ||
+		                m->isTimeDependent();
+		for( unsigned j=0; j < sources[i].size(); j++ )
+			if( dirty[sources[i][j]] )
+				outdated = true;
+
+		dirty[i] = outdated && m->isActive();
+		s.timing.prepareMs = 0.;
+		if( dirty[i] && m->needsPrepare() )
+			prepare.push_back( i );
+	}
+
+	// CPU side prepare phases in parallel. A single module is prepared on
+	// this thread, such that it can still use OpenMP internally.
+	int numPrepare = (int)prepare.size();
+	#pragma omp parallel for schedule(dynamic) if(numPrepare > 1)
+	for( int j=0; j < numPrepare; j++ )
+	{
+		ModuleRenderer* m = m_modules[prepare[j]];
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		m->prepare();
+		std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+
+		// Distinct modules, hence distinct states already present in map
+		m_states.find( m )->second.timing.prepareMs = 
+			std::chrono::duration<double,std::milli>( t1 - t0 ).count();
+	}
+
+	// Render outdated modules in order
+	m_timings.clear();
+	for( unsigned k=0; k < order.size(); k++ )
+	{
+		int i = order[k];
+		ModuleRenderer* m = m_modules[i];
+
+		ModuleTiming& t = m_states[m].timing;
+		t.module   = m;
+		t.rendered = dirty[i] != 0;
+		t.lastMs   = 0.;
+		if( t.rendered )
+		{
+			std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+			m->update();
+			std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+
+			t.lastMs = std::chrono::duration<double,std::milli>( t1 - t0 ).count();
+			t.avgMs  = t.renderCount ? 0.9*t.avgMs + 0.1*t.lastMs : t.lastMs;
+			t.renderCount++;
+		}
+		else
+			t.skipCount++;
+
+		m_timings.push_back( t );
+	}
+}
+
+void ModuleManager::printTimings( std::ostream& os ) const
+{
+	double total = 0.;
+	os << "Module timings (CPU time of prepare() + render() in ms):" << std::endl;
+	for( unsigned i=0; i < m_timings.size(); i++ )
+	{
+		const ModuleTiming& t = m_timings[i];
+		os << "  " << std::setw(24) << std::left << t.module->getName()
+		   << std::setw(26) << t.module->getModuleType() << std::right;
+		if( t.rendered )
+			os << std::setw(9) << std::fixed << std::setprecision(3) << t.prepareMs
+			   << " +" << std::setw(9) << t.lastMs;
+		else
+			os << std::setw(20) << "skipped";
+		os << "  avg " << std::setw(9) << std::fixed << std::setprecision(3) << t.avgMs
+		   << "  rendered " << t.renderCount << ", skipped " << t.skipCount 
+		   << std::endl;
+		total += t.prepareMs + t.lastMs;
+	}
+	os << "  Total " << std::fixed << std::setprecision(3) << total << " ms" << std::endl;
 }
@@ -7,6 +7,7 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <ostream>
 
 //=============================================================================
 //  ModuleBase
@@ -81,6 +82,29 @@ public:
 	/// This is the poll function invoking render() if the module is active.
 	void update();
 
+	bool isActive() const { return m_active.value(); }
+
+	/// Returns true if the output changes over time even if parameters and
+	/// inputs stay the same, e.g. for animations. Static modules return false
+	/// and are then only rendered by ModuleManager if outdated.
+	virtual bool isTimeDependent() const { return true; }
+
+	/// Mark output as outdated on changes not reflected in parameters, options
+	/// or input channels, e.g. after loading new data into a static module.
+	void invalidate() { m_invalid = true; }
+	/// Returns and resets the invalidate() flag
+	bool takeInvalidated() { bool b = m_invalid; m_invalid = false; return b; }
+
+	/// CPU side part of an update, e.g. computing texture data, invoked by
+	/// ModuleManager before render() if needsPrepare() returns true. May run
+	/// on a worker thread concurrently to prepare() of other modules, hence
+	/// must not issue any GL calls nor modify data shared between modules.
+	virtual void prepare() {}
+	/// Returns true if prepare() has work to do for the next render() call.
+	/// Modules should also call prepare() from render() if still required,
+	/// to work when used without ModuleManager.
+	virtual bool needsPrepare() const { return false; }
+
 	/// Render the effect into a texture
 	virtual void render() = 0;
 	/// Return the texture id where the effect has rendered into
@@ -109,6 +133,7 @@ public:
 private:
 	Position m_position;
 	BoolParameter m_active;
+	bool m_invalid;
 };
 
 //=============================================================================
@@ -118,12 +143,53 @@ private:
 	\class ModuleManager
 
 	Manage a set of \a ModuleRenderer instances.
+
+	Modules are rendered in topological order of their dependencies, i.e. a
+	module is rendered after all modules it reads from. Modules which are not
+	constrained keep their insertion order.
+
+	Only outdated modules are rendered: A module is outdated if it is time
+	dependent, was invalidated, if any of its parameters, options or input
+	channels changed since its last update, or if a module it depends on was
+	rendered in the same update. Modules on a dependency cycle (feedback) are
+	always rendered.
+
+	Before rendering, the CPU side prepare() phases of all outdated modules
+	are run in parallel (if compiled with OpenMP). They are independent by
+	contract, since prepare() does not access GL resources. Only the GL work
+	in render() is then issued on the calling thread, while the GPU may
+	still process the previous frame.
+
+	The CPU time spent in each prepare() and render() call is recorded and
+	can be printed via printTimings(). Note that GPU work is only included
+	as far as the driver blocks on submission.
 */
 class ModuleManager
 {
 public:
 	typedef std::vector<ModuleRenderer*> ModuleArray;
 
+	/// Dependency of a destination module on a source module (source,destination)
+	typedef std::pair<ModuleRenderer*,ModuleRenderer*> Dependency;
+	typedef std::vector<Dependency> Dependencies;
+
+	/// Render statistics of a single module
+	struct ModuleTiming
+	{
+		ModuleRenderer* module;
+		bool     rendered;    ///< rendered in last update()?
+		double   lastMs;      ///< duration of render() in last update()
+		double   prepareMs;   ///< duration of prepare() in last update()
+		double   avgMs;       ///< running average duration of render()
+		unsigned renderCount;
+		unsigned skipCount;
+
+		ModuleTiming(): module(NULL), rendered(false), lastMs(0.), prepareMs(0.),
+			avgMs(0.), renderCount(0), skipCount(0) {}
+	};
+	typedef std::vector<ModuleTiming> ModuleTimings;
+
+	ModuleManager(): m_scheduling( true ) {}
 	~ModuleManager();
 
 	void clear();
@@ -140,11 +206,48 @@ public:
 	/// Returns index of module or -1 if not found
 	int moduleIndex( ModuleRenderer* m );
 
-	/// Trigger rendering for *all* modules
+	/// Set dependencies between modules, usually derived from connections.
+	/// Dependencies involving modules not managed here are ignored.
+	void setDependencies( const Dependencies& deps ) { m_dependencies = deps; }
+	const Dependencies& dependencies() const { return m_dependencies; }
+
+	/// Trigger rendering of outdated modules in dependency order, preceded
+	/// by their prepare() phases
 	void update();
 
+	/// If disabled, update() renders *all* modules (in dependency order)
+	void setScheduling( bool enable ) { m_scheduling = enable; }
+	bool scheduling() const { return m_scheduling; }
+
+	///@{ Render statistics, in order of last update()
+	const ModuleTimings& timings() const { return m_timings; }
+	void printTimings( std::ostream& os ) const;
+	///@}
+
+protected:
+	/// Topological order of module indices, modules on cycles are appended
+	/// in insertion order and marked in cyclic. Also returns the indices of
+	/// the modules each module depends on.
+	void sortModules( std::vector<int>& order, std::vector<char>& cyclic,
+	                  std::vector< std::vector<int> >& sources ) const;
+
+	/// State of a module at its last update
+	struct ModuleState
+	{
+		std::vector<std::string> values;   ///< parameter and option values
+		std::vector<int>         channels; ///< input channel texture ids
+		ModuleTiming             timing;
+	};
+
+	/// Update state, returns true if parameters, options or inputs changed
+	static bool updateState( ModuleRenderer* m, ModuleState& s );
+
 private:
-	ModuleArray m_modules;
+	ModuleArray   m_modules;
+	Dependencies  m_dependencies;
+	bool          m_scheduling;
+	ModuleTimings m_timings;
+	std::map<ModuleRenderer*,ModuleState> m_states;
 };
 
 #endif // MODULE_H
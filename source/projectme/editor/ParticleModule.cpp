@@ -29,6 +29,7 @@ ParticleModule::ParticleModule()
     parameters().push_back( &m_params.animation );
     parameters().push_back( &m_params.animSpeed );
     parameters().push_back( &m_params.timestep  );
+    parameters().push_back( &m_params.backend   );
 	// Add options
 	options().push_back( &m_opts.width  );
 	options().push_back( &m_opts.height );
@@ -123,6 +124,7 @@ void ParticleModule::render()
 	}
 
     m_ps.setTimestep( (float)(m_params.timestep.value()/100.0) );
+    m_ps.setBackend( m_params.backend.value() );
 	m_ps.update();
 
 	if( m_r2t.bind( m_target.name() ) )
@@ -70,13 +70,15 @@ private:
         EnumParameter animation;
         DoubleParameter animSpeed;
         DoubleParameter timestep;
+        EnumParameter backend;
 		Params()
         : pointSize("PointSize"),
           blendMode("BlendMode","None","Alpha","Over"),
           fraction("Fraction"),
           animation("Animation","Static","In","Out"),
           animSpeed("AnimSpeed"),
-          timestep("Timestep")
+          timestep("Timestep"),
+          backend("Backend","GPU","CPU")
 		{
 			pointSize.setValueAndDefault( 1.5 );
 			pointSize.setLimits( 0.1, 50.0 );
@@ -88,6 +90,7 @@ private:
             animSpeed.setLimits( 0.0, 100.0 );
             timestep.setValueAndDefault( 0.15 ); // 100* original dt
             timestep.setLimits( 0.001, 10.0 );
+            backend.setValue( ParticleSystem::BackendGPU );
 		}
 	};
 	Params m_params;
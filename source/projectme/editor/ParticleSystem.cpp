@@ -71,7 +71,9 @@ ParticleSystem::ParticleSystem()
   m_curTargetBuf( 1 ),
   m_blendFunc( BlendAlpha ),
   m_fraction( 1.f ),
-  m_timestep( 0.0015f )
+  m_timestep( 0.0015f ),
+  m_backend( BackendGPU ),
+  m_cpuValid( false )
 {
 	m_targetSize[0] = 1024;
 	m_targetSize[1] = 1024;
@@ -312,7 +314,10 @@ void ParticleSystem::update()
 {
 	if( m_initialized )
 	{
-		advectParticles();
+		if( m_backend == BackendCPU )
+			advectParticlesCPU();
+		else
+			advectParticles();
 		swapParticleBuffers();
 	}
 }
@@ -552,6 +557,52 @@ void ParticleSystem::advectParticles()
 	glActiveTexture( GL_TEXTURE0 + 0 ); // Reset to active texture unit 0!
 }
 
+//----------------------------------------------------------------------------
+void ParticleSystem::advectParticlesCPU()
+{
+	unsigned N = (unsigned)m_width*m_height;
+	unsigned srcBuf = (m_curTargetBuf+1)%2;
+
+	// Download particle state after reseed or change of backend
+	if( !m_cpuValid )
+	{
+		m_cpu.resize( m_width, m_height );
+		m_cpuPos.resize( N*4 );
+		m_cpuVel.resize( N*4 );
+		glBindTexture( GL_TEXTURE_2D, m_texPos[srcBuf] );
+		glGetTexImage( GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, (void*)&m_cpuPos[0] );
+		glBindTexture( GL_TEXTURE_2D, m_texVel[srcBuf] );
+		glGetTexImage( GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, (void*)&m_cpuVel[0] );
+		m_cpu.setState( &m_cpuPos[0], &m_cpuVel[0] );
+		m_cpuValid = true;
+	}
+
+	// Download force texture, it may be rendered by another module each frame
+	GLint width=0, height=0;
+	glBindTexture( GL_TEXTURE_2D, m_curTexForce );
+	glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH,  &width  );
+	glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height );
+	m_cpuForce.resize( width*height*4 );
+	if( !m_cpuForce.empty() )
+		glGetTexImage( GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, (void*)&m_cpuForce[0] );
+	m_cpu.setForceField( m_cpuForce.empty() ? NULL : &m_cpuForce[0], width, height );
+	checkGLError("ParticleSystem::advectParticlesCPU() : After texture download");
+
+	// Euler step
+	m_cpu.setTimestep( m_timestep );
+	m_cpu.advect();
+
+	// Upload to target buffers
+	m_cpu.getState( &m_cpuPos[0], &m_cpuVel[0] );
+	glBindTexture( GL_TEXTURE_2D, m_texPos[m_curTargetBuf] );
+	glTexSubImage2D( GL_TEXTURE_2D, 0, 0,0, m_width,m_height, 
+					GL_RGBA, GL_FLOAT, (void*)&m_cpuPos[0] );
+	glBindTexture( GL_TEXTURE_2D, m_texVel[m_curTargetBuf] );
+	glTexSubImage2D( GL_TEXTURE_2D, 0, 0,0, m_width,m_height, 
+					GL_RGBA, GL_FLOAT, (void*)&m_cpuVel[0] );
+	glBindTexture( GL_TEXTURE_2D, 0 );
+	checkGLError("ParticleSystem::advectParticlesCPU() : After texture upload");
+}
 
 //-----------------------------------------------------------------------------
 void ParticleSystem::killAllParticles()
@@ -559,6 +610,9 @@ void ParticleSystem::killAllParticles()
 	// Max. number of particles
 	unsigned N = (unsigned)m_width*m_height;
 
+	// CPU backend has to download new state
+	m_cpuValid = false;
+
 	// Temporary RGBA buffer
 	float* buf = new float[ N*4 ];
 
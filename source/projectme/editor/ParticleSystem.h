@@ -6,6 +6,9 @@
 using GL::GLSLProgram;
 #endif
 
+#include "ParticleSystemCPU.h"
+#include <vector>
+
 /**
 	\class ParticleSystem
 
@@ -19,6 +22,10 @@ using GL::GLSLProgram;
 
 	Rendering is done in a second pass, generating a vertex for each particle.
 
+	Alternatively advection can be performed on the CPU by ParticleSystemCPU,
+	in which case the force texture is downloaded and the particle buffers
+	are uploaded in each update() step.
+
 	The implementation is uses only OpenGL 2.1 functionality.
 */
 class ParticleSystem
@@ -104,6 +111,22 @@ public:
     {
         m_timestep = timestep;
     }
+
+    enum Backends {
+        BackendGPU, // advection shader
+        BackendCPU  // ParticleSystemCPU
+    };
+
+    void setBackend( int backend )
+    {
+        if( backend != m_backend )
+            m_cpuValid = false; // Download particle buffers on next update
+        m_backend = backend;
+    }
+    int getBackend() const
+    {
+        return m_backend;
+    }
 	
 protected:	
 	void loadShadersFromDisk();
@@ -115,6 +138,7 @@ protected:
 	///@}
 
 	void advectParticles();
+	void advectParticlesCPU();
 	void swapParticleBuffers();
 
 	///@{ Generate some test data
@@ -157,6 +181,12 @@ private:
     float m_fraction; ///< Percentage of number of simulated particles
 
     float m_timestep;
+
+    int m_backend;
+
+    ParticleSystemCPU  m_cpu;
+    bool               m_cpuValid; ///< m_cpu holds current particle state?
+    std::vector<float> m_cpuPos, m_cpuVel, m_cpuForce; ///< RGBA transfer buffers
 };
 
 #endif // PARTICLESYSTEM_H
@@ -0,0 +1,307 @@
+#include "ParticleSystemCPU.h"
+#include <cmath>
+#include <algorithm>
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#if defined(__AVX2__)
+#define PARTICLESYSTEMCPU_AVX2
+#include <immintrin.h>
+#endif
+
+// Constants of shader/particle_advect.fs
+namespace {
+	const float ForceScale   = 700.f; // scale of force field
+	const float GravityScale = 150.f; // gravity along x-axis
+
+	/// Pseudo random number as in the shader
+	inline float shaderRand( float cx, float cy )
+	{
+		float v = std::sin( cx*12.9898f + cy*78.233f ) * 43758.5453f;
+		return v - std::floor( v );
+	}
+}
+
+//----------------------------------------------------------------------------
+ParticleSystemCPU::ParticleSystemCPU()
+: m_width(0),
+  m_height(0),
+  m_timestep( 0.0015f ),
+  m_forceWidth(0),
+  m_forceHeight(0)
+{
+}
+
+//----------------------------------------------------------------------------
+void ParticleSystemCPU::resize( int width, int height )
+{
+	m_width  = std::max( width,  0 );
+	m_height = std::max( height, 0 );
+	for( int c=0; c < 4; c++ )
+	{
+		m_pos[c].assign( size(), 0.f );
+		m_vel[c].assign( size(), 0.f );
+	}
+}
+
+//----------------------------------------------------------------------------
+void ParticleSystemCPU::setState( const float* pos, const float* vel )
+{
+	int n = size();
+	for( int i=0; i < n; i++ )
+		for( int c=0; c < 4; c++ )
+		{
+			m_pos[c][i] = pos[4*i+c];
+			m_vel[c][i] = vel[4*i+c];
+		}
+}
+
+//----------------------------------------------------------------------------
+void ParticleSystemCPU::getState( float* pos, float* vel ) const
+{
+	int n = size();
+	for( int i=0; i < n; i++ )
+		for( int c=0; c < 4; c++ )
+		{
+			pos[4*i+c] = m_pos[c][i];
+			vel[4*i+c] = m_vel[c][i];
+		}
+}
+
+//----------------------------------------------------------------------------
+void ParticleSystemCPU::setForceField( const float* rgba, int width, int height )
+{
+	m_forceWidth  = std::max( width,  0 );
+	m_forceHeight = std::max( height, 0 );
+	int n = m_forceWidth*m_forceHeight;
+	for( int c=0; c < 3; c++ )
+	{
+		m_force[c].resize( n );
+		for( int i=0; i < n; i++ )
+			m_force[c][i] = rgba[4*i+c];
+	}
+}
+
+//----------------------------------------------------------------------------
+void ParticleSystemCPU::sampleForce( float x, float y, float* f ) const
+{
+	if( m_forceWidth <= 0 || m_forceHeight <= 0 )
+	{
+		f[0] = f[1] = f[2] = 0.f;
+		return;
+	}
+
+	// Texel coordinates, clamped before conversion to int
+	float fw = (float)m_forceWidth,
+	      fh = (float)m_forceHeight;
+	float u = (0.5f*(x + 1.f))*fw - 0.5f,
+	      v = (0.5f*(y + 1.f))*fh - 0.5f;
+	u = std::min( std::max( u, -1.f ), fw );
+	v = std::min( std::max( v, -1.f ), fh );
+
+	float x0 = std::floor( u ),
+	      y0 = std::floor( v ),
+	      a  = u - x0,
+	      b  = v - y0;
+
+	// Clamp to edge
+	int ix = (int)x0,
+	    iy = (int)y0,
+	    ix0 = std::min( std::max( ix,   0 ), m_forceWidth -1 ),
+	    ix1 = std::min( std::max( ix+1, 0 ), m_forceWidth -1 ),
+	    iy0 = std::min( std::max( iy,   0 ), m_forceHeight-1 ),
+	    iy1 = std::min( std::max( iy+1, 0 ), m_forceHeight-1 );
+
+	for( int c=0; c < 3; c++ )
+	{
+		const float* t = &m_force[c][0];
+		float t00 = t[iy0*m_forceWidth+ix0], t10 = t[iy0*m_forceWidth+ix1],
+		      t01 = t[iy1*m_forceWidth+ix0], t11 = t[iy1*m_forceWidth+ix1];
+		f[c] = (1.f-b)*((1.f-a)*t00 + a*t10) + b*((1.f-a)*t01 + a*t11);
+	}
+}
+
+//----------------------------------------------------------------------------
+void ParticleSystemCPU::reincarnate( int i, float px, float py )
+{
+	// Texture coordinate of particle as in the shader
+	float tx = (float)(i % m_width) / (float)m_width,
+	      ty = (float)(i / m_width) / (float)m_height;
+
+	m_pos[0][i] = 2.f*shaderRand( tx+px, ty+py ) - 1.f;
+	m_pos[1][i] = 2.f*shaderRand( px*ty, py*tx ) - 1.f;
+	m_pos[2][i] = 0.f;
+	m_pos[3][i] = std::fabs( shaderRand( tx*ty, tx ) ) + 0.3f; // lifetime
+
+	m_vel[0][i] = m_vel[1][i] = m_vel[2][i] = 0.f;
+	m_vel[3][i] = 1.f;
+}
+
+//----------------------------------------------------------------------------
+void ParticleSystemCPU::advectParticle( int i )
+{
+	float dt = m_timestep;
+
+	float px = m_pos[0][i], py = m_pos[1][i], pz = m_pos[2][i],
+	      pw = m_pos[3][i] - dt; // Update lifetime
+
+	if( pw < 0.f || pw > 2.f )
+	{
+		reincarnate( i, px, py );
+		return;
+	}
+
+	// Euler step, force field pointing against the gradient
+	float f[3];
+	sampleForce( px, py, f );
+	float vx = dt*(-f[0]*ForceScale + GravityScale),
+	      vy = dt*(-f[1]*ForceScale),
+	      vz = dt*(-f[2]*ForceScale);
+	px += dt*vx;
+	py += dt*vy;
+	pz += dt*vz;
+
+	// Particles leaving the domain die
+	bool borderHit = false;
+	if( px > 1.f || px < -1.f ) { vx = -vx; borderHit=true; }
+	if( py > 1.f || py < -1.f ) { vy = -vy; borderHit=true; }
+	if( pz > 1.f || pz < -1.f ) { borderHit=true; }
+	if( borderHit )
+	{
+		pw = -1.f;
+		px = py = -2.f;
+	}
+
+	// z component is passed through from the velocity (shader workaround)
+	m_pos[0][i] = px;
+	m_pos[1][i] = py;
+	m_pos[2][i] = m_vel[2][i];
+	m_pos[3][i] = pw;
+	m_vel[0][i] = vx;
+	m_vel[1][i] = vy;
+}
+
+//----------------------------------------------------------------------------
+void ParticleSystemCPU::advectRange( int first, int last )
+{
+	int i = first;
+
+#ifdef PARTICLESYSTEMCPU_AVX2
+	if( m_forceWidth > 0 && m_forceHeight > 0 )
+	{
+		const __m256 dt     = _mm256_set1_ps( m_timestep ),
+		             zero   = _mm256_setzero_ps(),
+		             one    = _mm256_set1_ps( 1.f ),
+		             half   = _mm256_set1_ps( 0.5f ),
+		             two    = _mm256_set1_ps( 2.f ),
+		             sign   = _mm256_set1_ps( -0.f ),
+		             fscale = _mm256_set1_ps( ForceScale ),
+		             grav   = _mm256_set1_ps( GravityScale ),
+		             fw     = _mm256_set1_ps( (float)m_forceWidth ),
+		             fh     = _mm256_set1_ps( (float)m_forceHeight );
+		const __m256i iw    = _mm256_set1_epi32( m_forceWidth ),
+		              wmax  = _mm256_set1_epi32( m_forceWidth -1 ),
+		              hmax  = _mm256_set1_epi32( m_forceHeight-1 ),
+		              izero = _mm256_setzero_si256(),
+		              ione  = _mm256_set1_epi32( 1 );
+
+		for( ; i+8 <= last; i+=8 )
+		{
+			__m256 px = _mm256_loadu_ps( &m_pos[0][i] ),
+			       py = _mm256_loadu_ps( &m_pos[1][i] ),
+			       pz = _mm256_loadu_ps( &m_pos[2][i] ),
+			       pw = _mm256_sub_ps( _mm256_loadu_ps( &m_pos[3][i] ), dt );
+
+			int dead = _mm256_movemask_ps( _mm256_or_ps(
+				_mm256_cmp_ps( pw, zero, _CMP_LT_OQ ),
+				_mm256_cmp_ps( pw, two,  _CMP_GT_OQ ) ) );
+
+			// Bilinear lookup, see sampleForce()
+			__m256 u = _mm256_sub_ps( _mm256_mul_ps( _mm256_mul_ps( half, _mm256_add_ps( px, one ) ), fw ), half ),
+			       v = _mm256_sub_ps( _mm256_mul_ps( _mm256_mul_ps( half, _mm256_add_ps( py, one ) ), fh ), half );
+			u = _mm256_min_ps( _mm256_max_ps( u, _mm256_sub_ps( zero, one ) ), fw );
+			v = _mm256_min_ps( _mm256_max_ps( v, _mm256_sub_ps( zero, one ) ), fh );
+			__m256 x0 = _mm256_floor_ps( u ),
+			       y0 = _mm256_floor_ps( v ),
+			       a  = _mm256_sub_ps( u, x0 ),
+			       b  = _mm256_sub_ps( v, y0 ),
+			       a1 = _mm256_sub_ps( one, a ),
+			       b1 = _mm256_sub_ps( one, b );
+			__m256i ix  = _mm256_cvttps_epi32( x0 ),
+			        iy  = _mm256_cvttps_epi32( y0 ),
+			        ix0 = _mm256_min_epi32( _mm256_max_epi32( ix, izero ), wmax ),
+			        ix1 = _mm256_min_epi32( _mm256_max_epi32( _mm256_add_epi32( ix, ione ), izero ), wmax ),
+			        iy0 = _mm256_mullo_epi32( _mm256_min_epi32( _mm256_max_epi32( iy, izero ), hmax ), iw ),
+			        iy1 = _mm256_mullo_epi32( _mm256_min_epi32( _mm256_max_epi32( _mm256_add_epi32( iy, ione ), izero ), hmax ), iw ),
+			        i00 = _mm256_add_epi32( iy0, ix0 ), i10 = _mm256_add_epi32( iy0, ix1 ),
+			        i01 = _mm256_add_epi32( iy1, ix0 ), i11 = _mm256_add_epi32( iy1, ix1 );
+
+			__m256 f[3];
+			for( int c=0; c < 3; c++ )
+			{
+				const float* t = &m_force[c][0];
+				__m256 t00 = _mm256_i32gather_ps( t, i00, 4 ),
+				       t10 = _mm256_i32gather_ps( t, i10, 4 ),
+				       t01 = _mm256_i32gather_ps( t, i01, 4 ),
+				       t11 = _mm256_i32gather_ps( t, i11, 4 );
+				f[c] = _mm256_add_ps(
+					_mm256_mul_ps( b1, _mm256_add_ps( _mm256_mul_ps( a1, t00 ), _mm256_mul_ps( a, t10 ) ) ),
+					_mm256_mul_ps( b,  _mm256_add_ps( _mm256_mul_ps( a1, t01 ), _mm256_mul_ps( a, t11 ) ) ) );
+			}
+
+			// Euler step, see advectParticle()
+			__m256 vx = _mm256_mul_ps( dt, _mm256_add_ps( _mm256_mul_ps( _mm256_xor_ps( f[0], sign ), fscale ), grav ) ),
+			       vy = _mm256_mul_ps( dt, _mm256_mul_ps( _mm256_xor_ps( f[1], sign ), fscale ) ),
+			       vz = _mm256_mul_ps( dt, _mm256_mul_ps( _mm256_xor_ps( f[2], sign ), fscale ) );
+			__m256 nx = _mm256_add_ps( px, _mm256_mul_ps( dt, vx ) ),
+			       ny = _mm256_add_ps( py, _mm256_mul_ps( dt, vy ) ),
+			       nz = _mm256_add_ps( pz, _mm256_mul_ps( dt, vz ) );
+
+			// Border handling
+			__m256 mone = _mm256_sub_ps( zero, one ),
+			       hitx = _mm256_or_ps( _mm256_cmp_ps( nx, one, _CMP_GT_OQ ), _mm256_cmp_ps( nx, mone, _CMP_LT_OQ ) ),
+			       hity = _mm256_or_ps( _mm256_cmp_ps( ny, one, _CMP_GT_OQ ), _mm256_cmp_ps( ny, mone, _CMP_LT_OQ ) ),
+			       hitz = _mm256_or_ps( _mm256_cmp_ps( nz, one, _CMP_GT_OQ ), _mm256_cmp_ps( nz, mone, _CMP_LT_OQ ) ),
+			       hit  = _mm256_or_ps( _mm256_or_ps( hitx, hity ), hitz );
+			vx = _mm256_blendv_ps( vx, _mm256_xor_ps( vx, sign ), hitx );
+			vy = _mm256_blendv_ps( vy, _mm256_xor_ps( vy, sign ), hity );
+			nx = _mm256_blendv_ps( nx, _mm256_sub_ps( zero, two ), hit );
+			ny = _mm256_blendv_ps( ny, _mm256_sub_ps( zero, two ), hit );
+			pw = _mm256_blendv_ps( pw, mone, hit );
+
+			_mm256_storeu_ps( &m_pos[0][i], nx );
+			_mm256_storeu_ps( &m_pos[1][i], ny );
+			_mm256_storeu_ps( &m_pos[2][i], _mm256_loadu_ps( &m_vel[2][i] ) );
+			_mm256_storeu_ps( &m_pos[3][i], pw );
+			_mm256_storeu_ps( &m_vel[0][i], vx );
+			_mm256_storeu_ps( &m_vel[1][i], vy );
+
+			// Re-incarnate dead particles from their previous position
+			if( dead )
+			{
+				float ox[8], oy[8];
+				_mm256_storeu_ps( ox, px );
+				_mm256_storeu_ps( oy, py );
+				for( int l=0; l < 8; l++ )
+					if( dead & (1 << l) )
+						reincarnate( i+l, ox[l], oy[l] );
+			}
+		}
+	}
+#endif
+
+	for( ; i < last; i++ )
+		advectParticle( i );
+}
+
+//----------------------------------------------------------------------------
+void ParticleSystemCPU::advect()
+{
+	int n = size(),
+	    numChunks = (n + ChunkSize-1) / ChunkSize;
+
+	#pragma omp parallel for schedule(static)
+	for( int k=0; k < numChunks; k++ )
+		advectRange( k*ChunkSize, std::min( (k+1)*ChunkSize, n ) );
+}
@@ -0,0 +1,80 @@
+#ifndef PARTICLESYSTEMCPU_H
+#define PARTICLESYSTEMCPU_H
+
+#include <vector>
+
+/**
+	\class ParticleSystemCPU
+
+	CPU implementation of the particle advection of ParticleSystem, i.e. of
+	shader/particle_advect.fs, to be used as reference for testing and as
+	fallback without GPU support.
+
+	Particles are laid out as in the GPU textures (width*height particles in
+	row major order), but stored as structure of arrays with one buffer per
+	component. The force field is sampled bilinearly with clamp to edge as
+	done by the GL_LINEAR force texture.
+
+	Particles are advected in parallel chunks (if compiled with OpenMP), 8 at
+	a time with AVX2 (CMake option PROJECTME_USE_AVX2), otherwise one by one.
+	Both paths are bit-identical unless the compiler fuses multiply-adds of
+	the scalar path, as it does with -mfma (implied by PROJECTME_USE_AVX2 and
+	/arch:AVX2). They then only agree up to FMA rounding, which accumulates
+	over many steps. Compared to the shader, results differ
+	by the precision of the GPU's texture filtering and sin() used in the
+	pseudo random reincarnation.
+*/
+class ParticleSystemCPU
+{
+public:
+	ParticleSystemCPU();
+
+	/// Resize to width*height particles, all particles are reset to zero
+	void resize( int width, int height );
+	int width () const { return m_width; }
+	int height() const { return m_height; }
+	int size  () const { return m_width*m_height; }
+
+	///@{ Particle state as RGBA buffers of size() texels, i.e. in the format
+	///   of the position and velocity textures of ParticleSystem
+	void setState( const float* pos, const float* vel );
+	void getState( float* pos, float* vel ) const;
+	///@}
+
+	/// Set force field from RGBA texels, only the xyz components are used
+	void setForceField( const float* rgba, int width, int height );
+
+	void  setTimestep( float timestep ) { m_timestep = timestep; }
+	float getTimestep() const { return m_timestep; }
+
+	/// Single Euler step of all particles
+	void advect();
+
+	///@{ Component c in 0..3 (x,y,z,w) of particle buffers
+	const float* positions ( int c ) const { return &m_pos[c][0]; }
+	const float* velocities( int c ) const { return &m_vel[c][0]; }
+	///@}
+
+protected:
+	/// Advect particles [first,last)
+	void advectRange( int first, int last );
+	/// Advect single particle
+	void advectParticle( int i );
+	/// Re-incarnate particle i at pseudo random position
+	void reincarnate( int i, float px, float py );
+	/// Bilinear force field lookup at particle position (x,y) in [-1,1]^2
+	void sampleForce( float x, float y, float* f ) const;
+
+private:
+	enum { ChunkSize = 4096 };
+
+	int   m_width, m_height;
+	float m_timestep;
+
+	std::vector<float> m_pos[4], m_vel[4]; // particle state
+
+	int   m_forceWidth, m_forceHeight;
+	std::vector<float> m_force[3];         // force field components
+};
+
+#endif // PARTICLESYSTEMCPU_H
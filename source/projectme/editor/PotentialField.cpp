@@ -0,0 +1,266 @@
+#include "PotentialField.h"
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define POTENTIALFIELD_SSE
+#include <emmintrin.h>
+#endif
+// Enabled by the CMake option PROJECTME_USE_AVX2, otherwise half floats are
+// converted in software. GCC and Clang require -mf16c (not implied by
+// -mavx2), MSVC has no F16C macro but every AVX2 capable CPU supports it
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define POTENTIALFIELD_F16C
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#define POTENTIALFIELD_ALLOC(size) _aligned_malloc( size, 64 )
+#define POTENTIALFIELD_FREE(ptr)   _aligned_free( ptr )
+#else
+#define POTENTIALFIELD_ALLOC(size) aligned_alloc_64( size )
+#define POTENTIALFIELD_FREE(ptr)   free( ptr )
+namespace {
+	void* aligned_alloc_64( size_t size )
+	{
+		void* ptr = NULL;
+		if( posix_memalign( &ptr, 64, size ) != 0 )
+			return NULL;
+		return ptr;
+	}
+}
+#endif
+
+const float PotentialField::Infinity = INF;
+
+//----------------------------------------------------------------------------
+PotentialField::PotentialField()
+: m_width(0),
+  m_height(0),
+  m_stride(0),
+  m_euclidean(false),
+  m_format(Float32),
+  m_outFormat(Float32),
+  m_outWidth(0),
+  m_outHeight(0),
+  m_dist(NULL),
+  m_out(NULL),
+  m_scratch(NULL),
+  m_distCapacity(0),
+  m_outCapacity(0),
+  m_scratchCapacity(0)
+{
+}
+
+//----------------------------------------------------------------------------
+PotentialField::~PotentialField()
+{
+	POTENTIALFIELD_FREE( m_dist );
+	POTENTIALFIELD_FREE( m_out );
+	POTENTIALFIELD_FREE( m_scratch );
+}
+
+//----------------------------------------------------------------------------
+void* PotentialField::reserve( void* buf, size_t& capacity, size_t size )
+{
+	if( size <= capacity )
+		return buf;
+
+	POTENTIALFIELD_FREE( buf );
+	buf = POTENTIALFIELD_ALLOC( size );
+	capacity = buf ? size : 0;
+	return buf;
+}
+
+//----------------------------------------------------------------------------
+float* PotentialField::input( int width, int height )
+{
+	m_width  = std::max( width,  0 );
+	m_height = std::max( height, 0 );
+	// Round scratch rows up to full cache lines
+	m_stride = ((size_t)m_width + 15) & ~(size_t)15;
+
+	m_dist = (float*)reserve( m_dist, m_distCapacity,
+	                          sizeof(float)*m_width*m_height );
+	return m_dist;
+}
+
+//----------------------------------------------------------------------------
+void PotentialField::compute()
+{
+	int w = m_width,
+	    h = m_height;
+	if( w <= 0 || h <= 0 || !m_dist )
+		return;
+
+	int threads = 1;
+#ifdef USE_OPENMP
+	threads = omp_get_max_threads();
+#endif
+
+	// Potential rows of a block plus one row on either side, RGBA row
+	size_t scratchSize = (BlockRows+2)*m_stride + 4*m_stride;
+	size_t elementSize = (m_format==Float16) ? sizeof(unsigned short) : sizeof(float);
+	m_outWidth = m_outHeight = 0; // Previous output is invalidated by reserve()
+	m_out     = reserve( m_out, m_outCapacity, elementSize*4*w*h );
+	m_scratch = (float*)reserve( m_scratch, m_scratchCapacity,
+	                             sizeof(float)*scratchSize*threads );
+	if( !m_out || !m_scratch )
+		return;
+	m_outFormat = m_format;
+	m_outWidth  = w;
+	m_outHeight = h;
+
+	// Column pass of distance transform in-place
+	m_dt.dt2Columns( m_dist, w, h );
+
+	// Fused row pass, potential and gradient per block of rows. Rows at the
+	// block border are transformed twice, once for each adjacent block.
+	int numBlocks = (h + BlockRows-1) / BlockRows;
+
+	#pragma omp parallel for schedule(dynamic)
+	for( int b=0; b < numBlocks; b++ )
+	{
+		int thread = 0;
+	#ifdef USE_OPENMP
+		thread = omp_get_thread_num();
+	#endif
+		float* rows = m_scratch + thread*scratchSize;
+		float* rgba = rows + (BlockRows+2)*m_stride;
+
+		int y0 = b*BlockRows,
+		    y1 = std::min( y0 + (int)BlockRows, h ),
+		    r0 = std::max( y0-1, 0 ),
+		    r1 = std::min( y1+1, h );
+
+		for( int r=r0; r < r1; r++ )
+		{
+			float* pot = rows + (r-r0)*m_stride;
+			m_dt.dt1( m_dist + (size_t)r*w, w, pot );
+
+			if( m_euclidean )
+			{
+				int x=0;
+			#ifdef POTENTIALFIELD_SSE
+				for( ; x+4 <= w; x+=4 )
+					_mm_store_ps( pot+x, _mm_sqrt_ps( _mm_load_ps( pot+x ) ) );
+			#endif
+				for( ; x < w; x++ )
+					pot[x] = std::sqrt( pot[x] );
+			}
+		}
+
+		for( int y=y0; y < y1; y++ )
+		{
+			float* out = (m_format==Float16) ? rgba
+			                 : (float*)m_out + (size_t)4*y*w;
+
+			if( y==0 || y==h-1 )
+				memset( (void*)out, 0, 4*w*sizeof(float) ); // Zero border
+			else
+				gradientRow( rows + (y-1-r0)*m_stride, rows + (y-r0)*m_stride,
+				             rows + (y+1-r0)*m_stride, out );
+
+			if( m_format==Float16 )
+				toHalf( rgba, (unsigned short*)m_out + (size_t)4*y*w, 4*w );
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+void PotentialField::gradientRow( const float* p, const float* c,
+                                  const float* n, float* out ) const
+{
+	int w = m_width;
+	float s = 0.5f / (float)std::max(m_width,m_height);
+
+	// Zero border
+	for( int i=0; i < 4; i++ )
+		out[i] = out[4*(w-1)+i] = 0.f;
+
+	int x=1;
+#ifdef POTENTIALFIELD_SSE
+	__m128 vs = _mm_set1_ps( s ),
+	       zw = _mm_setr_ps( 0.f, 1.f, 0.f, 1.f );
+	for( ; x+4 <= w-1; x+=4 )
+	{
+		// Finite differences
+		__m128 dx = _mm_mul_ps( vs, _mm_sub_ps( _mm_loadu_ps( c+x+1 ),
+		                                        _mm_loadu_ps( c+x-1 ) ) ),
+		       dy = _mm_mul_ps( vs, _mm_sub_ps( _mm_loadu_ps( n+x ),
+		                                        _mm_loadu_ps( p+x ) ) );
+
+		// Interleave to (dx,dy,0,1)
+		__m128 lo = _mm_unpacklo_ps( dx, dy ),
+		       hi = _mm_unpackhi_ps( dx, dy );
+		_mm_storeu_ps( out+4*x   , _mm_movelh_ps( lo, zw ) );
+		_mm_storeu_ps( out+4*x+4 , _mm_movehl_ps( zw, lo ) );
+		_mm_storeu_ps( out+4*x+8 , _mm_movelh_ps( hi, zw ) );
+		_mm_storeu_ps( out+4*x+12, _mm_movehl_ps( zw, hi ) );
+	}
+#endif
+	for( ; x < w-1; x++ )
+	{
+		out[4*x+0] = s*(c[x+1] - c[x-1]); // dx
+		out[4*x+1] = s*(n[x] - p[x]);     // dy
+		out[4*x+2] = 0.f; // z
+		out[4*x+3] = 1.f; // alpha
+	}
+}
+
+//----------------------------------------------------------------------------
+namespace {
+	unsigned short floatToHalf( float f )
+	{
+		unsigned x;
+		memcpy( &x, &f, sizeof(float) );
+
+		unsigned sign = (x >> 16) & 0x8000,
+		         bits = (x >> 23) & 0xff,
+		         mant = x & 0x7fffff;
+		int      exp  = (int)bits - 127 + 15;
+
+		if( bits == 0xff ) // Inf, NaN
+			return (unsigned short)(sign | 0x7c00 | (mant ? 0x200 : 0));
+		if( exp >= 31 )    // Overflow
+			return (unsigned short)(sign | 0x7c00);
+		if( exp <= 0 )     // Subnormal or zero
+		{
+			if( exp < -10 )
+				return (unsigned short)sign;
+			mant |= 0x800000;
+			unsigned shift = (unsigned)(14 - exp),
+			         h     = mant >> shift,
+			         rem   = mant & ((1u << shift) - 1),
+			         half  = 1u << (shift - 1);
+			if( rem > half || (rem == half && (h & 1)) )
+				h++;
+			return (unsigned short)(sign | h);
+		}
+
+		// Rounding may carry into the exponent, yielding Inf on overflow
+		unsigned h   = ((unsigned)exp << 10) | (mant >> 13),
+		         rem = mant & 0x1fff;
+		if( rem > 0x1000 || (rem == 0x1000 && (h & 1)) )
+			h++;
+		return (unsigned short)(sign | h);
+	}
+}
+
+void PotentialField::toHalf( const float* src, unsigned short* dst, int n )
+{
+	int i=0;
+#ifdef POTENTIALFIELD_F16C
+	for( ; i+8 <= n; i+=8 )
+		_mm_storeu_si128( (__m128i*)(dst+i),
+			_mm256_cvtps_ph( _mm256_loadu_ps( src+i ), _MM_FROUND_TO_NEAREST_INT ) );
+#endif
+	for( ; i < n; i++ )
+		dst[i] = floatToHalf( src[i] );
+}
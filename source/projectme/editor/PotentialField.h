@@ -0,0 +1,92 @@
+#ifndef POTENTIALFIELD_H
+#define POTENTIALFIELD_H
+
+#include "DistanceTransformFelzenszwalb.h"
+#include <vector>
+
+/**
+	\class PotentialField
+
+	Force field from a binary feature image, given by the gradient of the
+	distance transform to the nearest feature pixel.
+
+	Input is a distance buffer with feature pixels set to zero and all others
+	to PotentialField::Infinity. The column pass of the distance transform is
+	done in-place, the row pass is fused with the square root (optional) and
+	the central difference gradient in a single pass over blocks of rows,
+	such that the distances never leave the cache. Blocks are processed in
+	parallel (if compiled with OpenMP), vectorized via SSE if available.
+
+	The result is an RGBA image (dx,dy,0,1) with zero border, suitable for
+	upload as GL_RGBA32F or, in half float format, as GL_RGBA16F texture.
+	All buffers are kept between calls and only reallocated on growth.
+*/
+class PotentialField
+{
+public:
+	enum Format { Float32, Float16 };
+
+	static const float Infinity;
+
+	PotentialField();
+	~PotentialField();
+
+	/// Resize to given image size, returns input buffer of width*height
+	/// samples to be filled with 0 for features and Infinity otherwise.
+	float* input( int width, int height );
+
+	/// Compute force field from input(), destroys input buffer contents
+	void compute();
+
+	/// Use euclidean instead of squared distance as potential (default: false)
+	void setEuclidean( bool b ) { m_euclidean = b; }
+	bool euclidean() const { return m_euclidean; }
+
+	/// Output format of next compute(), half floats stored as unsigned short
+	/// (default: Float32)
+	void setFormat( Format f ) { m_format = f; }
+	Format format() const { return m_format; }
+
+	int width () const { return m_width; }
+	int height() const { return m_height; }
+
+	/// RGBA output of last compute(), 4*dataWidth()*dataHeight() elements
+	/// in dataFormat(), NULL if nothing was computed yet
+	const void* data() const { return m_outWidth ? m_out : NULL; }
+	///@{ Format and size of data(), independent of later changes via
+	///   setFormat() and input()
+	Format dataFormat() const { return m_outFormat; }
+	int    dataWidth () const { return m_outWidth; }
+	int    dataHeight() const { return m_outHeight; }
+	///@}
+
+	/// Convert n floats to IEEE 754 half floats (round to nearest even)
+	static void toHalf( const float* src, unsigned short* dst, int n );
+
+protected:
+	/// Gradient of potential row c with neighbouring rows p,n as RGBA
+	void gradientRow( const float* p, const float* c, const float* n,
+	                  float* out ) const;
+
+private:
+	/// Grow aligned buffer to given size in bytes, returns buffer
+	static void* reserve( void* buf, size_t& capacity, size_t size );
+
+	enum { BlockRows = 32 };
+
+	int    m_width, m_height;
+	size_t m_stride;      // row stride in scratch in floats
+	bool   m_euclidean;
+	Format m_format;
+	Format m_outFormat;   // format and size of m_out contents
+	int    m_outWidth, m_outHeight;
+
+	float* m_dist;        // input and column transformed distances
+	void*  m_out;         // RGBA output
+	float* m_scratch;     // per thread potential rows and RGBA row
+	size_t m_distCapacity, m_outCapacity, m_scratchCapacity;
+
+	DistanceTransformFelzenszwalb::DistanceTransform m_dt;
+};
+
+#endif // POTENTIALFIELD_H
@@ -1,5 +1,4 @@
 #include "PotentialFromImageModule.h"
-#include "DistanceTransformFelzenszwalb.h"
 #include <glutils/GLError.h>
 #ifdef GL_NAMESPACE
 using GL::checkGLError;
@@ -20,10 +19,8 @@ MODULEFACTORY_REGISTER( PotentialFromImageModule, "PotentialFromImageModule" )
 PotentialFromImageModule::PotentialFromImageModule()
 : ModuleRenderer( "PotentialFromImageModule" ),
   m_initialized( false ),
-  m_width(0),
-  m_height(0),
-  m_data( NULL ),
-  m_dirty(false)
+  m_dirty(false),
+  m_computePending(false)
 {
 }
 
@@ -31,77 +28,65 @@ PotentialFromImageModule::PotentialFromImageModule()
 bool PotentialFromImageModule::loadImage( const char* filename )
 {
 	// Load image from disk
-	QImage* img = new QImage;
-	if( !(img->load(QString( filename ))) )
+	QImage img;
+	if( !img.load(QString( filename )) )
+		return false;
+	img = img.convertToFormat( QImage::Format_RGB32 );
+	
+	// Threshold into distance buffer, zero at features (flipped vertically)
+	int width  = img.width(),
+	    height = img.height();
+	const int threshold = 128;
+	float* buf = m_field.input( width, height );
+	if( !buf )
 	{
-		delete img;
+		cerr << "PotentialFromImageModule::loadImage() : Out of memory!" << endl;
 		return false;
 	}
-	
-	// Convert QImage to scalar float buffer
-	int width  = img->width(),
-	    height = img->height();
-	const float threshold = 128.f;
-	unsigned char* cbuf = new unsigned char[ width * height ];
-	unsigned ofs = 0;
 	for( int y=0; y < height; y++ )
-		for( int x=0; x < width; x++, ofs++ )
-		{
+	{
+		const QRgb* line = (const QRgb*)img.constScanLine( height-y-1 );
+		float* dst = buf + y*width;
+		for( int x=0; x < width; x++ )
 			// Just consider R channel for now
-			QRgb color = img->pixel(x,height-y-1);
-			float scalar = qRed(color);
-			// Threshold
-			cbuf[ofs] = (scalar > threshold) ? 1 : 0;
-		}
-	
-	// Apply distance transform to float buffer in-place
-	float* buf = DistanceTransformFelzenszwalb::dt<unsigned char>( cbuf, width, height, 1 );
-		
-	// Compute gradient
-	float scale = 1.0 / (float)std::max(width,height);
-	float* grad = new float[ width * height * 4 ]; // RGB format
-    memset( (void*)grad, 0, width*height*2*sizeof(float) ); // Zero border / z
-	for( int y=1; y < (height-1); y++ )
-		for( int x=1; x < (width-1); x++ )
-		{
-			// Finite differences
-			ofs = y*width+x;
-			unsigned stride = width;			
-		  #if 1
-			grad[4*ofs+0] = scale*0.5*(buf[ofs+1] - buf[ofs-1]); // dx
-			grad[4*ofs+1] = scale*0.5*(buf[ofs+stride] - buf[ofs-stride]); // dy
-			grad[4*ofs+2] = 0.0; // z
-		  #else
-			grad[4*ofs+0] = grad[4*ofs+1] = grad[4*ofs+2] = buf[ofs];
-		  #endif
-			grad[4*ofs+3] = 1.0; // alpha
-		}
+			dst[x] = (qRed(line[x]) > threshold) ? 0.f : PotentialField::Infinity;
+	}
 	
-	// Free memory
-	delete [] buf; buf=NULL;
-	delete img;
-		
-	// Store data
-	if( m_data ) delete [] m_data;
-	m_data   = grad;
-	m_width  = width;
-	m_height = height;
 	m_filename = std::string(filename);
 		
-	m_dirty = true; // Upload texture in next render() call
+	m_computePending = true; // Compute force field in next prepare() call
+	invalidate();
 		
 	return true;
 }
 
+//----------------------------------------------------------------------------
+void PotentialFromImageModule::prepare()
+{
+	if( !m_computePending )
+		return;
+	
+	// Distance transform, potential and gradient in one pass
+	m_field.compute();
+	
+	m_computePending = false;
+	m_dirty = true; // Upload texture in next render() call
+}
+
 //----------------------------------------------------------------------------
 void PotentialFromImageModule::updateTexture()
 {
 	if( !m_initialized && !init() )
 		return;
 	
-	GLint internalFormat = GL_RGBA32F;
-	m_target.image( 0, internalFormat, m_width,m_height, 0, GL_RGBA, GL_FLOAT, 
-		(void*)m_data );
+	if( !m_field.data() )
+		return;
+	
+	// Format and size of computed data, options may have changed since
+	bool half = m_field.dataFormat() == PotentialField::Float16;
+	GLint internalFormat = half ? GL_RGBA16F : GL_RGBA32F;
+	m_target.image( 0, internalFormat, m_field.dataWidth(),m_field.dataHeight(), 0, 
+		GL_RGBA, half ? GL_HALF_FLOAT : GL_FLOAT, (void*)m_field.data() );
 }
 
 //----------------------------------------------------------------------------
@@ -122,7 +107,6 @@ bool PotentialFromImageModule::init()
 void PotentialFromImageModule::destroy()
 {
 	m_target.destroy();
-	delete [] m_data; m_data = NULL;
 }
 
 //----------------------------------------------------------------------------
@@ -132,6 +116,10 @@ void PotentialFromImageModule::render()
 	// OpenGL context.	
 	if( !m_initialized && !init() ) return;	
 	
+	// Not yet prepared if rendered without ModuleManager
+	if( m_computePending )
+		prepare();
+	
 	if( m_dirty )
 	{
 		updateTexture();
@@ -146,6 +134,8 @@ Serializable::PropertyTree& PotentialFromImageModule::serialize() const
 	cache = Super::serialize();
 	
 	cache.put("PotentialFromImageModule.Texture.Filename",m_filename);
+	cache.put("PotentialFromImageModule.Potential.Euclidean",euclidean());
+	cache.put("PotentialFromImageModule.Potential.HalfFloat",halfFloat());
 
 	return cache;
 }
@@ -155,6 +145,9 @@ void PotentialFromImageModule::deserialize( Serializable::PropertyTree& pt )
 {
 	Super::deserialize( pt );
 
+	setEuclidean( pt.get( "PotentialFromImageModule.Potential.Euclidean", false ) );
+	setHalfFloat( pt.get( "PotentialFromImageModule.Potential.HalfFloat", false ) );
+
 	std::string filename = pt.get( "PotentialFromImageModule.Texture.Filename", "" );
 	if( !filename.empty() )
 	{
@@ -7,6 +7,7 @@ using GL::GLTexture;
 #endif
 
 #include "ModuleRenderer.h"
+#include "PotentialField.h"
 
 #include <string>
 
@@ -15,6 +16,12 @@ class QImage;
 
 /**
 	\class PotentialFromImageModule
+
+	Force field texture from thresholded image, see PotentialField.
+
+	The image is thresholded in loadImage(), the force field is computed
+	later in prepare(), i.e. in parallel to other modules when updated via
+	ModuleManager.
 */
 class PotentialFromImageModule : public ModuleRenderer
 {
@@ -25,12 +32,24 @@ public:
 
 	bool loadImage( const char* filename );
 
+	///@{ Potential options, applied on next loadImage()
+	void setEuclidean( bool b ) { m_field.setEuclidean( b ); }
+	bool euclidean() const { return m_field.euclidean(); }
+	/// Store force field as GL_RGBA16F instead of GL_RGBA32F texture
+	void setHalfFloat( bool b ) { m_field.setFormat( b ? PotentialField::Float16 : PotentialField::Float32 ); }
+	bool halfFloat() const { return m_field.format() == PotentialField::Float16; }
+	///@}
+
 	///@name ModuleRenderer implementation
 	///@{
 	void render();
 	int  target() const { return m_target.name(); }
 	void destroy();
 	void touch() {}
+	bool isTimeDependent() const { return false; }
+	/// Computes force field of last loaded image
+	void prepare();
+	bool needsPrepare() const { return m_computePending; }
 	///@}
 	
 	/// @name Serialization
@@ -50,10 +69,10 @@ protected:
 private:
 	bool        m_initialized;
 	std::string m_filename;	
-	int         m_width, m_height;	
-	float*      m_data;
+	PotentialField m_field;
 	GLTexture   m_target;
 	bool        m_dirty; // updateTexture() required?
+	bool        m_computePending; // prepare() required?
 };
 
 #endif // POTENTIALFROMIMAGEMODULE_H
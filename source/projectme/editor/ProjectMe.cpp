@@ -13,6 +13,19 @@ void ProjectMe::clear()
 	m_connections     .clear();
 }
 
+//----------------------------------------------------------------------------
+void ProjectMe::updateDependencies()
+{
+	ModuleManager::Dependencies deps;
+	for( unsigned i=0; i < m_connections.size(); i++ )
+		if( m_connections[i].isConnected() )
+			deps.push_back( ModuleManager::Dependency( 
+				m_connections[i].source().module,
+				m_connections[i].destination().module ) );
+
+	m_moduleManager.setDependencies( deps );
+}
+
 //----------------------------------------------------------------------------
 void ProjectMe
 	::addConnection( ModuleRenderer* src, ModuleRenderer* dst, int channel )
@@ -20,6 +33,7 @@ void ProjectMe
 	Connection c;
 	c.connect( src, dst, channel );
 	m_connections.push_back( c );
+	updateDependencies();
 }
 
 void ProjectMe
@@ -46,6 +60,7 @@ void ProjectMe
 
 		// Disconnect
 		dst->setChannel( channel, -1 );
+		updateDependencies();
 	}
 	else
 	{
@@ -232,6 +247,7 @@ void ProjectMe::deserialize( Serializable::PropertyTree& pt )
 				"Mismatch in number of connections?" << std::endl;
 		}
 	}
+	updateDependencies();
 }
 
 
@@ -240,4 +256,5 @@ void ProjectMe::touchConnections()
 {
     for( unsigned i=0; i < m_connections.size(); i++ )
 		m_connections[i].update();
+	updateDependencies();
 }
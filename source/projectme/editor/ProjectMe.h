@@ -34,6 +34,9 @@ public:
 
 	void touchConnections();
 
+	/// Pass connections as dependencies to ModuleManager for scheduling
+	void updateDependencies();
+
 	ModuleRenderer* moduleFromTarget( int texid );
 	ModuleRenderer* moduleFromNameAndType( std::string name, std::string type );
 
@@ -62,6 +62,7 @@ ShaderModule::ShaderModule()
   m_target_initialized(false),
   m_r2t_initialized   (false),
   m_shader_initialized(false),
+  m_timeDependent(true),
   m_shader(0),
   m_vshader( defaultVertexShader ),
   m_fshader( defaultFragmentShader ),
@@ -97,6 +98,7 @@ void ShaderModule::applyOptions()
 						0, GL_RGBA, GL_FLOAT, NULL );
 		m_target.unbind();
 	}
+	invalidate(); // Texture contents are lost
 }
 
 //----------------------------------------------------------------------------
@@ -204,6 +206,9 @@ bool ShaderModule::compile( std::string vshader, std::string fshader )
 		cerr << "ShaderModule::compile() : Compilation of shaders failed!" << endl;
 		return false;
 	}	
+	// Assume time-dependency until the next render() call tells otherwise
+	m_timeDependent = true;
+	invalidate();
 	return checkGLError( "ShaderModule::compile()" );
 }
 
@@ -281,6 +286,7 @@ void ShaderModule::render()
 			(GLfloat)width, (GLfloat)height, (GLfloat)1.f );
 		checkGLError( "ShaderModule::render() - After glUniform3f()" );
 	}
+	m_timeDependent = (iGlobalTime >= 0);
 	if( iGlobalTime >= 0 )
 	{	
 		float time = (float)(clock() - t0) / CLOCKS_PER_SEC;
@@ -403,6 +409,7 @@ void ShaderModule::setChannelResolution( int idx, int w, int h, int d )
 	m_channelResolution[3*idx  ] = (GLfloat)w;
 	m_channelResolution[3*idx+1] = (GLfloat)h;
 	m_channelResolution[3*idx+2] = (GLfloat)d;
+	invalidate();
 
 #ifdef _DEBUG
 	// DEBUG
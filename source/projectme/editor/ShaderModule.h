@@ -38,6 +38,8 @@ public:
 	void destroy();
 	void touch() { compile(); }
 	void applyOptions();
+	/// Time-dependent only if the current shader uses iGlobalTime
+	bool isTimeDependent() const { return m_timeDependent; }
 	///@}
 
 	///@name ModuleRenderer channels implementation
@@ -81,6 +83,7 @@ private:
 	bool            m_target_initialized;
 	bool            m_r2t_initialized;
 	bool            m_shader_initialized;
+	bool            m_timeDependent;
 
 	GLTexture       m_target;
 	GLSLProgram*    m_shader;
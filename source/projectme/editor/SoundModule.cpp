@@ -22,7 +22,8 @@ MODULEFACTORY_REGISTER( SoundModule, "SoundModule" )
 SoundModule::SoundModule()
 : ModuleRenderer( "SoundModule" ),
   m_initialized( false ),
-  m_soundInput( NULL )  
+  m_soundInput( NULL ),
+  m_prepared( false )
 {
 }
 
@@ -31,18 +32,22 @@ void SoundModule::setSoundInput( SoundInput* soundInput )
 	m_soundInput = soundInput;
 }
 
-void SoundModule::updateTexture()
+void SoundModule::prepare()
 {
-	if( !m_initialized && !init() && !m_soundInput)
-		return;	
+	if( !m_soundInput )
+		return;
 	
-	// Get sound data
+	// Get sound data, the FFT buffer is shared by all modules on the same
+	// input which may be prepared concurrently
 	short buffer[512];
-	int written = m_soundInput->pollSampleData( buffer, 512 );
-	float *fft = m_soundInput->pollFFT();
-	
-	// FFT can directly be copied (or do we have to normalize somehow???)
-	memcpy( &m_data[512], fft, sizeof(float)*512 );
+	#pragma omp critical(SoundInput)
+	{
+		m_soundInput->pollSampleData( buffer, 512 );
+		float *fft = m_soundInput->pollFFT();
+		
+		// FFT can directly be copied (or do we have to normalize somehow???)
+		memcpy( &m_data[512], fft, sizeof(float)*512 );
+	}
 	
 	// Waveform data has to be converted from short to float
 	for( int i=0; i < 512; i++ )
@@ -65,6 +70,14 @@ void SoundModule::updateTexture()
 #endif
 	}
 	
+	m_prepared = true;
+}
+
+void SoundModule::updateTexture()
+{
+	if( !m_initialized && !init() && !m_soundInput)
+		return;	
+	
 	// Download data to GPU
 	m_target.image( 0, GL_LUMINANCE16, 512,2, 0, 
 	//m_target.SubImage( 0, 0,0, 512,2, 
@@ -102,5 +115,11 @@ void SoundModule::render()
 	if( !m_initialized && !init() ) return;	
 	
 	if( m_soundInput )
+	{
+		// Not yet prepared if rendered without ModuleManager
+		if( !m_prepared )
+			prepare();
 		updateTexture();
+		m_prepared = false;
+	}
 }
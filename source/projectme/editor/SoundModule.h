@@ -29,6 +29,9 @@ public:
 	void destroy();
 	void touch() {}
 	void applyOptions() { /* Call init again to change texture size */ init(); }
+	/// Polls sound input and converts it into texture data
+	void prepare();
+	bool needsPrepare() const { return m_soundInput && !m_prepared; }
 	///@}	
 	
 protected:
@@ -36,7 +39,7 @@ protected:
 	// Creates OpenGL texture
 	bool init();
 
-	// Uploads data to texture. Called in render().
+	// Uploads data of last prepare() to texture. Called in render().
 	void updateTexture();
 
 private:
@@ -44,6 +47,7 @@ private:
 	SoundInput*	m_soundInput;
 	GLTexture   m_target;
 	float       m_data[2*512]; // Texture data
+	bool        m_prepared;    // m_data up to date for next render() call?
 };
 
 #endif // SOUNDMODULE_H